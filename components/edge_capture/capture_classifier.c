@@ -0,0 +1,142 @@
+#include "edge_capture/capture_classifier.h"
+#include <stddef.h>
+#include <string.h>
+
+// 窗口内的统计
+typedef struct {
+    uint32_t edges;
+    uint32_t pulses;            // 点亮次数（由熄灭变为点亮的边沿数）
+    uint32_t span_ms;           // 计入的采样覆盖的时间
+    uint32_t pulse_span_ms;     // 第一个到最后一个有点亮边沿的采样之间的时间
+    uint32_t quiet_ms;          // 最近一个有边沿的采样到最新采样的时间
+    uint16_t samples;
+    uint16_t busy;              // 有边沿或点亮的采样数
+    bool full;                  // 历史已覆盖整个窗口
+} window_sum_t;
+
+// 按时间顺序取第i个采样（0为最早）
+static const capture_sample_t *history_at(const capture_history_t *history, uint8_t i)
+{
+    uint8_t start = (uint8_t)((history->head + CAPTURE_HISTORY_LEN - history->count) % CAPTURE_HISTORY_LEN);
+    return &history->samples[(start + i) % CAPTURE_HISTORY_LEN];
+}
+
+// 从最新的采样向前累加，只计入整个采样间隔都落在窗口内的采样
+static void sum_window(const capture_history_t *history, uint32_t window_ms, window_sum_t *sum)
+{
+    memset(sum, 0, sizeof(*sum));
+    if (history->count < 2) {
+        return;
+    }
+
+    const capture_sample_t *newest = history_at(history, history->count - 1);
+    uint32_t boundary = newest->t_ms;
+    uint32_t last_pulse = 0;
+    bool seen_edge = false;
+    for (uint8_t i = history->count - 1; i > 0; i--) {
+        const capture_sample_t *sample = history_at(history, i);
+        const capture_sample_t *prev = history_at(history, i - 1);
+        if (newest->t_ms - prev->t_ms > window_ms) {
+            sum->full = true;
+            break;
+        }
+        if (sample->edges > 0 && !seen_edge) {
+            seen_edge = true;
+            sum->quiet_ms = newest->t_ms - sample->t_ms;
+        }
+        // 间隔内的边沿交替出现，从熄灭开始时奇数个是点亮，从点亮开始时偶数个是点亮
+        uint32_t pulses = prev->active ? sample->edges / 2 : (sample->edges + 1) / 2;
+        if (pulses > 0) {
+            if (sum->pulses == 0) {
+                last_pulse = sample->t_ms;
+            }
+            sum->pulse_span_ms = last_pulse - sample->t_ms;
+        }
+        sum->pulses += pulses;
+        sum->edges += sample->edges;
+        sum->samples++;
+        if (sample->edges > 0 || sample->active) {
+            sum->busy++;
+        }
+        boundary = prev->t_ms;
+    }
+    sum->span_ms = newest->t_ms - boundary;
+    if (sum->span_ms >= window_ms) {
+        sum->full = true;
+    }
+}
+
+void capture_history_reset(capture_history_t *history)
+{
+    memset(history, 0, sizeof(*history));
+}
+
+void capture_history_push(capture_history_t *history, const capture_sample_t *sample)
+{
+    history->samples[history->head] = *sample;
+    history->head = (uint8_t)((history->head + 1) % CAPTURE_HISTORY_LEN);
+    if (history->count < CAPTURE_HISTORY_LEN) {
+        history->count++;
+    }
+}
+
+void capture_classify_power_led(const capture_history_t *history, const capture_led_params_t *params,
+                                capture_led_result_t *result)
+{
+    result->state = CAPTURE_POWER_UNKNOWN;
+    result->blink_period_ms = 0;
+
+    window_sum_t sum;
+    sum_window(history, params->window_ms, &sum);
+    if (sum.samples == 0) {
+        return;
+    }
+
+    // 周期取相邻两次点亮的平均间隔，不受占空比影响；超过最长周期没有边沿说明闪烁已经停止
+    if (sum.pulses >= params->blink_min_pulses && sum.quiet_ms <= params->blink_max_ms) {
+        uint32_t period = sum.pulse_span_ms / (sum.pulses - 1);
+        if (period < params->blink_min_ms) {
+            // 翻转比闪烁快得多：PWM调光的常亮
+            result->state = CAPTURE_POWER_ON;
+            return;
+        }
+        if (period <= params->blink_max_ms) {
+            result->state = CAPTURE_POWER_SLEEP;
+            result->blink_period_ms = period;
+            return;
+        }
+    }
+
+    // 不是闪烁：窗口没有覆盖完整时可能是还没看到下一个边沿的慢速闪烁
+    if (!sum.full) {
+        return;
+    }
+    const capture_sample_t *newest = history_at(history, history->count - 1);
+    result->state = newest->active ? CAPTURE_POWER_ON : CAPTURE_POWER_OFF;
+}
+
+void capture_classify_activity(const capture_history_t *history, const capture_activity_params_t *params,
+                               capture_activity_result_t *result)
+{
+    result->pulses_per_min = 0;
+    result->busy_percent = 0;
+
+    window_sum_t sum;
+    sum_window(history, params->window_ms, &sum);
+    if (sum.samples == 0 || sum.span_ms == 0) {
+        return;
+    }
+
+    result->pulses_per_min = (uint32_t)((uint64_t)sum.pulses * 60000 / sum.span_ms);
+    result->busy_percent = (uint8_t)(sum.busy * 100 / sum.samples);
+}
+
+const char *capture_power_state_name(capture_power_state_t state)
+{
+    switch (state) {
+        case CAPTURE_POWER_OFF: return "off";
+        case CAPTURE_POWER_ON: return "on";
+        case CAPTURE_POWER_SLEEP: return "sleep";
+        default: return "unknown";
+    }
+}
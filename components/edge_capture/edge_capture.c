@@ -0,0 +1,241 @@
+#include "edge_capture/edge_capture.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "driver/gpio.h"
+#include "driver/pulse_cnt.h"
+#include "freertos/FreeRTOS.h"
+
+static const char *TAG = "edge_capture";
+
+// 输入引脚（经光耦接主板的LED插针），未连接时设为-1
+#define CAPTURE_POWER_LED_PIN       32
+#define CAPTURE_HDD_LED_PIN         33
+
+#define CAPTURE_SAMPLE_MS           250     // 读取计数和电平的周期
+#define CAPTURE_PCNT_LIMIT          30000   // 计数到此值时由驱动累加到软件计数并清零
+
+// 分类参数
+#define CAPTURE_BLINK_MIN_MS        200     // 更快的翻转按PWM调光的常亮处理
+#define CAPTURE_BLINK_MAX_MS        5000
+#define CAPTURE_BLINK_MIN_PULSES    2
+#define CAPTURE_LED_WINDOW_MS       11000   // 最长闪烁周期的两倍加采样抖动
+#define CAPTURE_ACTIVITY_WINDOW_MS  2000
+
+// 输入表
+typedef struct {
+    const char *name;
+    edge_capture_kind_t kind;
+    int8_t gpio;
+    bool active_high;               // 光耦输出通常在灯亮时拉低
+    uint8_t machine;
+} capture_input_config_t;
+
+static const capture_input_config_t s_input_config[] = {
+    { "power_led", EDGE_CAPTURE_POWER_LED, CAPTURE_POWER_LED_PIN, false, 0 },
+    { "hdd_led", EDGE_CAPTURE_ACTIVITY_LED, CAPTURE_HDD_LED_PIN, false, 0 },
+};
+
+#define CAPTURE_INPUT_COUNT (sizeof(s_input_config) / sizeof(s_input_config[0]))
+_Static_assert(CAPTURE_INPUT_COUNT <= EDGE_CAPTURE_MAX_INPUTS, "输入表超过EDGE_CAPTURE_MAX_INPUTS");
+
+static const capture_led_params_t s_led_params = {
+    .window_ms = CAPTURE_LED_WINDOW_MS,
+    .blink_min_ms = CAPTURE_BLINK_MIN_MS,
+    .blink_max_ms = CAPTURE_BLINK_MAX_MS,
+    .blink_min_pulses = CAPTURE_BLINK_MIN_PULSES,
+};
+
+static const capture_activity_params_t s_activity_params = {
+    .window_ms = CAPTURE_ACTIVITY_WINDOW_MS,
+};
+
+typedef struct {
+    pcnt_unit_handle_t unit;
+    int last_count;
+    capture_history_t history;      // 只在采样回调中访问
+    // 以下受s_lock保护
+    uint32_t edges;
+    bool active;
+    capture_led_result_t led;
+    capture_activity_result_t activity;
+} capture_input_t;
+
+static capture_input_t s_inputs[CAPTURE_INPUT_COUNT];
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t s_sample_timer = NULL;
+
+static bool read_active(const capture_input_config_t *config)
+{
+    return gpio_get_level(config->gpio) == (config->active_high ? 1 : 0);
+}
+
+// 双边沿都加一。不启用毛刺滤波：滤波按APB周期计时，驱动会持有APB最高频率锁，妨碍动态调频；
+// 光耦输出的LED信号很慢，毛刺在分类窗口内影响很小
+static esp_err_t init_unit(const capture_input_config_t *config, capture_input_t *input)
+{
+    pcnt_unit_config_t unit_config = {
+        .low_limit = -1,            // 只向上计数，驱动要求下限为负
+        .high_limit = CAPTURE_PCNT_LIMIT,
+        .flags.accum_count = 1,
+    };
+    pcnt_unit_handle_t unit = NULL;
+    esp_err_t ret = pcnt_new_unit(&unit_config, &unit);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    pcnt_chan_config_t chan_config = {
+        .edge_gpio_num = config->gpio,
+        .level_gpio_num = -1,
+    };
+    pcnt_channel_handle_t chan = NULL;
+    ret = pcnt_new_channel(unit, &chan_config, &chan);
+    if (ret != ESP_OK) {
+        pcnt_del_unit(unit);
+        return ret;
+    }
+
+    ret = pcnt_channel_set_edge_action(chan, PCNT_CHANNEL_EDGE_ACTION_INCREASE, PCNT_CHANNEL_EDGE_ACTION_INCREASE);
+    if (ret == ESP_OK) {
+        // 累计模式需要在上限处设观察点
+        ret = pcnt_unit_add_watch_point(unit, CAPTURE_PCNT_LIMIT);
+    }
+    if (ret == ESP_OK) {
+        ret = pcnt_unit_enable(unit);
+    }
+    if (ret == ESP_OK) {
+        ret = pcnt_unit_clear_count(unit);
+    }
+    if (ret == ESP_OK) {
+        ret = pcnt_unit_start(unit);
+    }
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    input->unit = unit;
+    return ESP_OK;
+}
+
+static void sample_timer_cb(void *arg)
+{
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+
+    for (size_t i = 0; i < CAPTURE_INPUT_COUNT; i++) {
+        const capture_input_config_t *config = &s_input_config[i];
+        capture_input_t *input = &s_inputs[i];
+        int count = 0;
+        if (input->unit == NULL || pcnt_unit_get_count(input->unit, &count) != ESP_OK) {
+            continue;
+        }
+
+        uint32_t delta = (uint32_t)(count - input->last_count);
+        input->last_count = count;
+        capture_sample_t sample = {
+            .t_ms = now_ms,
+            .edges = delta > UINT16_MAX ? UINT16_MAX : (uint16_t)delta,
+            .active = read_active(config),
+        };
+        capture_history_push(&input->history, &sample);
+
+        capture_led_result_t led = { 0 };
+        capture_activity_result_t activity = { 0 };
+        if (config->kind == EDGE_CAPTURE_POWER_LED) {
+            capture_classify_power_led(&input->history, &s_led_params, &led);
+        } else {
+            capture_classify_activity(&input->history, &s_activity_params, &activity);
+        }
+
+        portENTER_CRITICAL(&s_lock);
+        capture_power_state_t old_state = input->led.state;
+        input->edges += delta;
+        input->active = sample.active;
+        input->led = led;
+        input->activity = activity;
+        portEXIT_CRITICAL(&s_lock);
+
+        if (config->kind == EDGE_CAPTURE_POWER_LED && led.state != old_state) {
+            ESP_LOGI(TAG, "%s: %s -> %s (周期 %lu ms)", config->name, capture_power_state_name(old_state),
+                     capture_power_state_name(led.state), (unsigned long)led.blink_period_ms);
+        }
+    }
+}
+
+esp_err_t edge_capture_init(void)
+{
+    if (s_sample_timer != NULL) {
+        return ESP_OK;
+    }
+
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    int ready = 0;
+    for (size_t i = 0; i < CAPTURE_INPUT_COUNT; i++) {
+        const capture_input_config_t *config = &s_input_config[i];
+        capture_input_t *input = &s_inputs[i];
+        capture_history_reset(&input->history);
+        if (config->gpio < 0) {
+            continue;
+        }
+
+        esp_err_t ret = init_unit(config, input);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "%s(GPIO%d)初始化PCNT失败: %s", config->name, config->gpio, esp_err_to_name(ret));
+            continue;
+        }
+
+        // 第一个采样只作为窗口起点
+        capture_sample_t sample = { .t_ms = now_ms, .edges = 0, .active = read_active(config) };
+        capture_history_push(&input->history, &sample);
+        input->active = sample.active;
+        ready++;
+    }
+
+    if (ready == 0) {
+        ESP_LOGW(TAG, "没有可用的捕获输入");
+        return ESP_OK;
+    }
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = sample_timer_cb,
+        .name = "edge_capture",
+    };
+    esp_err_t ret = esp_timer_create(&timer_args, &s_sample_timer);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ret = esp_timer_start_periodic(s_sample_timer, (uint64_t)CAPTURE_SAMPLE_MS * 1000);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    ESP_LOGI(TAG, "边沿捕获初始化完成，%d 个输入", ready);
+    return ESP_OK;
+}
+
+uint8_t edge_capture_input_count(void)
+{
+    return (uint8_t)CAPTURE_INPUT_COUNT;
+}
+
+esp_err_t edge_capture_get_input(uint8_t id, edge_capture_info_t *info)
+{
+    if (id >= CAPTURE_INPUT_COUNT || info == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const capture_input_config_t *config = &s_input_config[id];
+    const capture_input_t *input = &s_inputs[id];
+    info->name = config->name;
+    info->kind = config->kind;
+    info->gpio = config->gpio;
+    info->machine = config->machine;
+    info->ready = input->unit != NULL;
+
+    portENTER_CRITICAL(&s_lock);
+    info->active = input->active;
+    info->edges = input->edges;
+    info->power = input->led.state;
+    info->blink_period_ms = input->led.blink_period_ms;
+    info->pulses_per_min = input->activity.pulses_per_min;
+    info->busy_percent = input->activity.busy_percent;
+    portEXIT_CRITICAL(&s_lock);
+    return ESP_OK;
+}
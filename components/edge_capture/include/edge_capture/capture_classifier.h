@@ -0,0 +1,69 @@
+#ifndef CAPTURE_CLASSIFIER_H
+#define CAPTURE_CLASSIFIER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// 边沿计数分类
+// 输入为周期采样的边沿数和采样时的电平，按时间窗口判断电源灯的状态（常亮/闪烁/熄灭）和
+// 硬盘灯的活动频率。只依赖标准C，可以在主机上用合成波形测试
+
+#define CAPTURE_HISTORY_LEN     64      // 每个输入保留的采样数，需覆盖最长的分类窗口
+
+// 电源状态：S0常亮，S3闪烁，S5熄灭
+typedef enum {
+    CAPTURE_POWER_UNKNOWN = 0,  // 采样还不够一个窗口
+    CAPTURE_POWER_OFF,
+    CAPTURE_POWER_ON,
+    CAPTURE_POWER_SLEEP,
+} capture_power_state_t;
+
+// 一次采样：上次采样以来的边沿数和采样时是否点亮
+typedef struct {
+    uint32_t t_ms;
+    uint16_t edges;
+    bool active;
+} capture_sample_t;
+
+// 采样环形缓冲区，最早的采样只作为窗口起点，它的边沿不计入
+typedef struct {
+    capture_sample_t samples[CAPTURE_HISTORY_LEN];
+    uint8_t head;               // 下一个写入位置
+    uint8_t count;
+} capture_history_t;
+
+typedef struct {
+    uint32_t window_ms;         // 分类窗口，不小于最长闪烁周期的2倍加一个采样间隔，保证总能看到两次点亮
+    uint32_t blink_min_ms;      // 闪烁周期范围，更快的翻转按PWM调光的常亮处理
+    uint32_t blink_max_ms;
+    uint16_t blink_min_pulses;  // 窗口内至少点亮这么多次才算闪烁（至少2次才能测出周期）
+} capture_led_params_t;
+
+typedef struct {
+    capture_power_state_t state;
+    uint32_t blink_period_ms;   // 闪烁时的周期，否则为0
+} capture_led_result_t;
+
+typedef struct {
+    uint32_t window_ms;
+} capture_activity_params_t;
+
+typedef struct {
+    uint32_t pulses_per_min;    // 窗口内的闪烁次数折算到每分钟
+    uint8_t busy_percent;       // 有边沿或点亮的采样比例
+} capture_activity_result_t;
+
+void capture_history_reset(capture_history_t *history);
+void capture_history_push(capture_history_t *history, const capture_sample_t *sample);
+
+// 电源灯分类
+void capture_classify_power_led(const capture_history_t *history, const capture_led_params_t *params,
+                                capture_led_result_t *result);
+
+// 硬盘灯活动分类
+void capture_classify_activity(const capture_history_t *history, const capture_activity_params_t *params,
+                               capture_activity_result_t *result);
+
+const char *capture_power_state_name(capture_power_state_t state);
+
+#endif /* CAPTURE_CLASSIFIER_H */
@@ -0,0 +1,40 @@
+#ifndef EDGE_CAPTURE_H
+#define EDGE_CAPTURE_H
+
+#include "esp_err.h"
+#include "edge_capture/capture_classifier.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// 电源灯/硬盘灯边沿捕获
+// 每个输入由一个PCNT单元在硬件中对双边沿计数，CPU不处理单个边沿；定时器周期读取计数和电平，
+// 按窗口区分电源灯的常亮(S0)、闪烁(S3)和熄灭(S5)，并统计硬盘灯的活动频率
+
+#define EDGE_CAPTURE_MAX_INPUTS 4
+
+typedef enum {
+    EDGE_CAPTURE_POWER_LED = 0,     // 电源灯：判断开机/睡眠/关机
+    EDGE_CAPTURE_ACTIVITY_LED,      // 硬盘灯：统计活动频率
+} edge_capture_kind_t;
+
+typedef struct {
+    const char *name;
+    edge_capture_kind_t kind;
+    int8_t gpio;
+    uint8_t machine;                // 所属机器（pc_monitor机器表下标）
+    bool ready;                     // PCNT单元初始化成功
+    bool active;                    // 最近一次采样时灯是否点亮
+    uint32_t edges;                 // 累计边沿数
+    capture_power_state_t power;    // 电源灯的分类结果
+    uint32_t blink_period_ms;
+    uint32_t pulses_per_min;        // 硬盘灯的分类结果
+    uint8_t busy_percent;
+} edge_capture_info_t;
+
+// 初始化所有输入并开始周期采样
+esp_err_t edge_capture_init(void);
+
+uint8_t edge_capture_input_count(void);
+esp_err_t edge_capture_get_input(uint8_t id, edge_capture_info_t *info);
+
+#endif /* EDGE_CAPTURE_H */
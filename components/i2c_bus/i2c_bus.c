@@ -0,0 +1,385 @@
+#include "i2c_bus/i2c_bus.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_rom_sys.h"
+#include "driver/gpio.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+static const char *TAG = "i2c_bus";
+
+#define I2C_BUS_DEFAULT_TIMEOUT_MS  100     // 单个事务的默认超时
+#define I2C_BUS_LOCK_TIMEOUT_MS     1000    // 等待总线锁的上限
+#define I2C_BUS_RECOVERY_PULSES     9       // 释放SDA最多需要的时钟脉冲数
+#define I2C_BUS_RECOVERY_HALF_US    5       // 恢复时钟的半周期（100kHz）
+
+struct i2c_bus_device {
+    uint8_t addr;
+    TickType_t timeout;
+    uint64_t latency_total_us;
+    i2c_bus_device_stats_t stats;
+};
+
+static i2c_bus_config_t s_config;
+static bool s_configured = false;
+static bool s_installed = false;
+
+static struct i2c_bus_device s_devices[I2C_BUS_MAX_DEVICES];
+static uint8_t s_device_count = 0;
+
+// 总线锁，保护驱动、命令链缓冲区和设备表
+static StaticSemaphore_t s_lock_buf;
+static SemaphoreHandle_t s_lock = NULL;
+static portMUX_TYPE s_init_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// 静态命令链：一个事务最多包含写和读两段（起始、地址、数据各一组，读分为ACK和最后一个NACK）
+static uint8_t s_cmd_buf[I2C_LINK_RECOMMENDED_SIZE(2)];
+
+// 统计（在持有总线锁时更新，读取时复制）
+static i2c_bus_stats_t s_stats;
+static portMUX_TYPE s_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static bool take_lock(void)
+{
+    int64_t start = esp_timer_get_time();
+    bool taken = xSemaphoreTake(s_lock, pdMS_TO_TICKS(I2C_BUS_LOCK_TIMEOUT_MS)) == pdTRUE;
+    uint32_t waited = (uint32_t)(esp_timer_get_time() - start);
+
+    portENTER_CRITICAL(&s_stats_lock);
+    if (!taken) {
+        s_stats.lock_timeouts++;
+    } else if (waited > s_stats.max_lock_wait_us) {
+        s_stats.max_lock_wait_us = waited;
+    }
+    portEXIT_CRITICAL(&s_stats_lock);
+    return taken;
+}
+
+static esp_err_t install_driver(void)
+{
+    i2c_config_t conf = {
+        .mode = I2C_MODE_MASTER,
+        .sda_io_num = s_config.sda_io,
+        .scl_io_num = s_config.scl_io,
+        .sda_pullup_en = GPIO_PULLUP_ENABLE,
+        .scl_pullup_en = GPIO_PULLUP_ENABLE,
+        .master.clk_speed = s_config.freq_hz
+    };
+
+    esp_err_t ret = i2c_param_config(s_config.port, &conf);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "I2C参数配置失败: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    ret = i2c_driver_install(s_config.port, conf.mode, 0, 0, 0);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "I2C驱动安装失败: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    s_installed = true;
+    return ESP_OK;
+}
+
+// 从设备在传输中途复位后可能一直拉低SDA，控制器只会反复超时：
+// 删除驱动，把引脚切为开漏输出手动发送时钟直到SDA释放，再发送停止条件，然后重新安装驱动
+static esp_err_t recover_locked(void)
+{
+    if (s_installed) {
+        i2c_driver_delete(s_config.port);
+        s_installed = false;
+    }
+
+    gpio_config_t io_conf = {
+        .pin_bit_mask = (1ULL << s_config.scl_io) | (1ULL << s_config.sda_io),
+        .mode = GPIO_MODE_INPUT_OUTPUT_OD,
+        .pull_up_en = GPIO_PULLUP_ENABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_DISABLE
+    };
+    gpio_set_level(s_config.sda_io, 1);
+    gpio_set_level(s_config.scl_io, 1);
+    esp_err_t ret = gpio_config(&io_conf);
+    if (ret == ESP_OK) {
+        esp_rom_delay_us(I2C_BUS_RECOVERY_HALF_US);
+        int pulses = 0;
+        while (pulses < I2C_BUS_RECOVERY_PULSES && gpio_get_level(s_config.sda_io) == 0) {
+            gpio_set_level(s_config.scl_io, 0);
+            esp_rom_delay_us(I2C_BUS_RECOVERY_HALF_US);
+            gpio_set_level(s_config.scl_io, 1);
+            esp_rom_delay_us(I2C_BUS_RECOVERY_HALF_US);
+            pulses++;
+        }
+
+        // 停止条件：SCL为高时SDA由低变高
+        gpio_set_level(s_config.scl_io, 0);
+        esp_rom_delay_us(I2C_BUS_RECOVERY_HALF_US);
+        gpio_set_level(s_config.sda_io, 0);
+        esp_rom_delay_us(I2C_BUS_RECOVERY_HALF_US);
+        gpio_set_level(s_config.scl_io, 1);
+        esp_rom_delay_us(I2C_BUS_RECOVERY_HALF_US);
+        gpio_set_level(s_config.sda_io, 1);
+        esp_rom_delay_us(I2C_BUS_RECOVERY_HALF_US);
+
+        bool released = gpio_get_level(s_config.sda_io) == 1 && gpio_get_level(s_config.scl_io) == 1;
+        ESP_LOGW(TAG, "总线恢复: 发送 %d 个时钟脉冲，SDA/SCL%s", pulses, released ? "已释放" : "仍被拉低");
+        ret = released ? ESP_OK : ESP_FAIL;
+    }
+
+    // 无论引脚是否释放都重新安装驱动，之后的事务仍可尝试
+    esp_err_t install_ret = install_driver();
+    if (ret == ESP_OK) {
+        ret = install_ret;
+    }
+
+    portENTER_CRITICAL(&s_stats_lock);
+    s_stats.recoveries++;
+    if (ret != ESP_OK) {
+        s_stats.recovery_failures++;
+    }
+    portEXIT_CRITICAL(&s_stats_lock);
+    return ret;
+}
+
+static esp_err_t build_cmd(i2c_cmd_handle_t cmd, const i2c_bus_txn_t *txn)
+{
+    uint8_t addr = txn->dev->addr;
+    esp_err_t ret = i2c_master_start(cmd);
+    if (ret == ESP_OK && (txn->write_len > 0 || txn->read_len == 0)) {
+        ret = i2c_master_write_byte(cmd, (addr << 1) | I2C_MASTER_WRITE, true);
+        if (ret == ESP_OK && txn->write_len > 0) {
+            ret = i2c_master_write(cmd, txn->write_buf, txn->write_len, true);
+        }
+        if (ret == ESP_OK && txn->read_len > 0) {
+            ret = i2c_master_start(cmd);
+        }
+    }
+    if (ret == ESP_OK && txn->read_len > 0) {
+        ret = i2c_master_write_byte(cmd, (addr << 1) | I2C_MASTER_READ, true);
+        if (ret == ESP_OK) {
+            ret = i2c_master_read(cmd, txn->read_buf, txn->read_len, I2C_MASTER_LAST_NACK);
+        }
+    }
+    if (ret == ESP_OK) {
+        ret = i2c_master_stop(cmd);
+    }
+    return ret;
+}
+
+static esp_err_t run_txn_locked(const i2c_bus_txn_t *txn)
+{
+    if (!s_installed) {
+        // 上次恢复没能重装驱动
+        esp_err_t ret = install_driver();
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create_static(s_cmd_buf, sizeof(s_cmd_buf));
+    if (cmd == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    esp_err_t ret = build_cmd(cmd, txn);
+    int64_t start = esp_timer_get_time();
+    if (ret == ESP_OK) {
+        ret = i2c_master_cmd_begin(s_config.port, cmd, txn->dev->timeout);
+    }
+    uint32_t latency = (uint32_t)(esp_timer_get_time() - start);
+    i2c_cmd_link_delete_static(cmd);
+
+    struct i2c_bus_device *dev = txn->dev;
+    portENTER_CRITICAL(&s_stats_lock);
+    s_stats.transactions++;
+    dev->stats.transactions++;
+    dev->stats.last_latency_us = latency;
+    dev->latency_total_us += latency;
+    dev->stats.avg_latency_us = (uint32_t)(dev->latency_total_us / dev->stats.transactions);
+    if (latency > dev->stats.max_latency_us) {
+        dev->stats.max_latency_us = latency;
+    }
+    if (ret == ESP_FAIL) {
+        // 旧版驱动用ESP_FAIL表示从设备没有应答
+        s_stats.nacks++;
+        dev->stats.nacks++;
+    } else if (ret == ESP_ERR_TIMEOUT) {
+        s_stats.timeouts++;
+        dev->stats.timeouts++;
+    } else if (ret != ESP_OK) {
+        s_stats.errors++;
+    }
+    portEXIT_CRITICAL(&s_stats_lock);
+    return ret;
+}
+
+esp_err_t i2c_bus_init(const i2c_bus_config_t *config)
+{
+    if (config == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&s_init_lock);
+    if (s_lock == NULL) {
+        s_lock = xSemaphoreCreateMutexStatic(&s_lock_buf);
+    }
+    portEXIT_CRITICAL(&s_init_lock);
+
+    if (!take_lock()) {
+        return ESP_ERR_TIMEOUT;
+    }
+    esp_err_t ret = ESP_OK;
+    if (!s_installed) {
+        s_config = *config;
+        s_configured = true;
+        ret = install_driver();
+        if (ret == ESP_OK) {
+            ESP_LOGI(TAG, "I2C总线初始化成功 (SDA=%d, SCL=%d, %lu Hz)",
+                     config->sda_io, config->scl_io, (unsigned long)config->freq_hz);
+        }
+    }
+    xSemaphoreGive(s_lock);
+    return ret;
+}
+
+esp_err_t i2c_bus_add_device(uint8_t addr, uint32_t timeout_ms, i2c_bus_device_handle_t *handle)
+{
+    if (handle == NULL || addr > 0x7F) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_lock == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!take_lock()) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    esp_err_t ret = ESP_OK;
+    struct i2c_bus_device *dev = NULL;
+    for (uint8_t i = 0; i < s_device_count; i++) {
+        if (s_devices[i].addr == addr) {
+            dev = &s_devices[i];
+            break;
+        }
+    }
+    if (dev == NULL && s_device_count == I2C_BUS_MAX_DEVICES) {
+        ret = ESP_ERR_NO_MEM;
+    } else if (dev == NULL) {
+        dev = &s_devices[s_device_count++];
+        *dev = (struct i2c_bus_device){
+            .addr = addr,
+            .timeout = pdMS_TO_TICKS(timeout_ms > 0 ? timeout_ms : I2C_BUS_DEFAULT_TIMEOUT_MS),
+            .stats = { .addr = addr },
+        };
+    }
+    xSemaphoreGive(s_lock);
+
+    *handle = dev;
+    return ret;
+}
+
+esp_err_t i2c_bus_transfer(i2c_bus_txn_t *txns, size_t count)
+{
+    if (txns == NULL || count == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_lock == NULL || !take_lock()) {
+        esp_err_t ret = s_lock == NULL ? ESP_ERR_INVALID_STATE : ESP_ERR_TIMEOUT;
+        for (size_t i = 0; i < count; i++) {
+            txns[i].result = ret;
+        }
+        return ret;
+    }
+
+    portENTER_CRITICAL(&s_stats_lock);
+    s_stats.batches++;
+    portEXIT_CRITICAL(&s_stats_lock);
+
+    esp_err_t first = ESP_OK;
+    for (size_t i = 0; i < count; i++) {
+        i2c_bus_txn_t *txn = &txns[i];
+        if (txn->dev == NULL || (txn->write_len > 0 && txn->write_buf == NULL) ||
+            (txn->read_len > 0 && txn->read_buf == NULL)) {
+            txn->result = ESP_ERR_INVALID_ARG;
+        } else {
+            txn->result = run_txn_locked(txn);
+            if (txn->result == ESP_ERR_TIMEOUT) {
+                // 总线被拉住，恢复后重试一次
+                ESP_LOGW(TAG, "设备0x%02X事务超时，尝试恢复总线", txn->dev->addr);
+                if (recover_locked() == ESP_OK) {
+                    txn->result = run_txn_locked(txn);
+                }
+            }
+        }
+        if (first == ESP_OK) {
+            first = txn->result;
+        }
+    }
+    xSemaphoreGive(s_lock);
+    return first;
+}
+
+esp_err_t i2c_bus_read(i2c_bus_device_handle_t dev, uint8_t *buf, size_t len)
+{
+    i2c_bus_txn_t txn = { .dev = dev, .read_buf = buf, .read_len = len };
+    return i2c_bus_transfer(&txn, 1);
+}
+
+esp_err_t i2c_bus_write(i2c_bus_device_handle_t dev, const uint8_t *buf, size_t len)
+{
+    i2c_bus_txn_t txn = { .dev = dev, .write_buf = buf, .write_len = len };
+    return i2c_bus_transfer(&txn, 1);
+}
+
+esp_err_t i2c_bus_write_read(i2c_bus_device_handle_t dev, const uint8_t *write_buf, size_t write_len,
+                             uint8_t *read_buf, size_t read_len)
+{
+    i2c_bus_txn_t txn = {
+        .dev = dev,
+        .write_buf = write_buf,
+        .write_len = write_len,
+        .read_buf = read_buf,
+        .read_len = read_len,
+    };
+    return i2c_bus_transfer(&txn, 1);
+}
+
+esp_err_t i2c_bus_recover(void)
+{
+    if (s_lock == NULL || !s_configured) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!take_lock()) {
+        return ESP_ERR_TIMEOUT;
+    }
+    esp_err_t ret = recover_locked();
+    xSemaphoreGive(s_lock);
+    return ret;
+}
+
+void i2c_bus_get_stats(i2c_bus_stats_t *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+    portENTER_CRITICAL(&s_stats_lock);
+    *stats = s_stats;
+    portEXIT_CRITICAL(&s_stats_lock);
+    stats->installed = s_installed;
+    stats->devices = s_device_count;
+}
+
+uint8_t i2c_bus_device_count(void)
+{
+    return s_device_count;
+}
+
+esp_err_t i2c_bus_get_device_stats(uint8_t index, i2c_bus_device_stats_t *stats)
+{
+    if (index >= s_device_count || stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    portENTER_CRITICAL(&s_stats_lock);
+    *stats = s_devices[index].stats;
+    portEXIT_CRITICAL(&s_stats_lock);
+    return ESP_OK;
+}
@@ -0,0 +1,83 @@
+#ifndef I2C_BUS_H
+#define I2C_BUS_H
+
+#include "esp_err.h"
+#include "driver/i2c.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// 共享I2C总线管理
+// 总线互斥锁串行化所有事务，命令链使用静态缓冲区，读写不再分配内存；事务超时（从设备拉住SDA）时
+// 手动发送时钟脉冲释放总线并重新安装驱动。按设备统计事务延迟和NACK次数
+
+#define I2C_BUS_MAX_DEVICES     8
+
+typedef struct {
+    i2c_port_t port;
+    int sda_io;
+    int scl_io;
+    uint32_t freq_hz;
+} i2c_bus_config_t;
+
+// 设备句柄，由i2c_bus_add_device分配后一直有效
+typedef struct i2c_bus_device *i2c_bus_device_handle_t;
+
+// 一个事务：先写write_len字节，再（重复起始后）读read_len字节；两者都为0时只发送地址，用于探测
+typedef struct {
+    i2c_bus_device_handle_t dev;
+    const uint8_t *write_buf;
+    size_t write_len;
+    uint8_t *read_buf;
+    size_t read_len;
+    esp_err_t result;           // 执行结果，ESP_FAIL表示NACK
+} i2c_bus_txn_t;
+
+typedef struct {
+    uint8_t addr;
+    uint32_t transactions;
+    uint32_t nacks;
+    uint32_t timeouts;
+    uint32_t last_latency_us;
+    uint32_t avg_latency_us;
+    uint32_t max_latency_us;
+} i2c_bus_device_stats_t;
+
+typedef struct {
+    bool installed;
+    uint8_t devices;
+    uint32_t transactions;
+    uint32_t nacks;
+    uint32_t timeouts;
+    uint32_t errors;            // NACK和超时以外的错误
+    uint32_t recoveries;        // 总线恢复次数
+    uint32_t recovery_failures; // 恢复后SDA/SCL仍被拉低或驱动重装失败
+    uint32_t batches;           // i2c_bus_transfer调用次数
+    uint32_t lock_timeouts;
+    uint32_t max_lock_wait_us;
+} i2c_bus_stats_t;
+
+// 安装驱动；已安装时直接返回ESP_OK（不能更换配置）
+esp_err_t i2c_bus_init(const i2c_bus_config_t *config);
+
+// 添加设备，timeout_ms为单个事务的超时（0使用默认值）；同一地址返回已有句柄
+esp_err_t i2c_bus_add_device(uint8_t addr, uint32_t timeout_ms, i2c_bus_device_handle_t *handle);
+
+// 持有总线锁按顺序执行一批事务，各自的结果写入result，返回第一个失败的结果
+// 超时的事务在总线恢复后重试一次
+esp_err_t i2c_bus_transfer(i2c_bus_txn_t *txns, size_t count);
+
+// 单个事务
+esp_err_t i2c_bus_read(i2c_bus_device_handle_t dev, uint8_t *buf, size_t len);
+esp_err_t i2c_bus_write(i2c_bus_device_handle_t dev, const uint8_t *buf, size_t len);
+esp_err_t i2c_bus_write_read(i2c_bus_device_handle_t dev, const uint8_t *write_buf, size_t write_len,
+                             uint8_t *read_buf, size_t read_len);
+
+// 手动恢复总线
+esp_err_t i2c_bus_recover(void);
+
+void i2c_bus_get_stats(i2c_bus_stats_t *stats);
+uint8_t i2c_bus_device_count(void);
+esp_err_t i2c_bus_get_device_stats(uint8_t index, i2c_bus_device_stats_t *stats);
+
+#endif /* I2C_BUS_H */
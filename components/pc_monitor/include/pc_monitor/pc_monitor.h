@@ -3,6 +3,10 @@
 
 #include "esp_err.h"
 #include <stdbool.h>
+#include <stdint.h>
+
+// 机器表的容量（一片PCF8574的输入数）
+#define PC_MONITOR_MAX_MACHINES 8
 
 // PC状态枚举
 typedef enum {
@@ -16,8 +20,56 @@ typedef enum {
     PC_STATUS_READ_I2C = 1    // 通过I2C读取PCF8574
 } pc_status_read_mode_t;
 
-// PC状态改变回调类型
-typedef void (*pc_state_change_callback_t)(pc_state_t new_state);
+// 机器信息
+typedef struct {
+    const char *name;
+    pc_state_t state;
+    bool sensor_ok;             // 最近一次读取成功
+    pc_status_read_mode_t source; // 当前使用的状态输入
+    int8_t gpio;                // 状态GPIO，-1表示没有
+    uint8_t pcf_addr;           // PCF8574地址，0表示没有
+    uint8_t pcf_bit;
+    uint8_t actuator;           // servo_control执行器下标
+} pc_machine_info_t;
+
+// 状态检测统计
+typedef struct {
+    bool interrupt_driven;      // 当前由边沿中断检测（GPIO引脚或PCF8574的INT）
+    uint16_t debounce_ms;       // 防抖窗口
+    uint32_t edges;             // 收到的边沿数
+    uint32_t edge_overflows;    // 边沿队列满而丢弃的次数
+    uint32_t transitions;       // 中断路径确认的状态变化（按机器计）
+    uint32_t confirmations;     // 有状态变化的中断确认轮数
+    uint32_t glitches;          // 电平回到原状态的毛刺
+    uint32_t polls;             // 轮询/一致性检查采样次数
+    uint32_t fast_samples;      // 其中在快速窗口内的采样
+    uint32_t sample_requests;   // 立即采样请求
+    uint32_t activities;        // 执行器动作次数
+    uint32_t interval_ms;       // 当前采样间隔
+    uint32_t detects;           // 动作之后在快速窗口内检测到变化的次数
+    uint32_t detect_misses;     // 快速窗口内没有变化的次数
+    uint32_t last_detect_ms;    // 从动作到检测到变化的时间
+    uint32_t avg_detect_ms;
+    uint32_t max_detect_ms;
+    uint32_t i2c_reads;         // PCF8574读取次数
+    uint32_t poll_corrections;  // 一致性检查发现的、中断路径漏掉的变化
+    uint32_t last_latency_us;   // 第一个边沿到确认的时间（含防抖窗口）
+    uint32_t avg_latency_us;
+    uint32_t max_latency_us;
+    uint32_t last_wake_us;      // 中断到监控任务处理的时间
+    uint32_t max_wake_us;
+} pc_monitor_stats_t;
+
+// 自适应轮询策略
+typedef struct {
+    uint32_t fast_interval_ms;  // 执行器动作或新的WebSocket订阅之后的采样间隔
+    uint32_t fast_window_ms;    // 快速采样持续时间
+    uint32_t min_interval_ms;   // 状态变化后的采样间隔，之后每次无变化翻倍
+    uint32_t max_interval_ms;   // 退避上限（由中断检测时上限为一致性检查间隔）
+} pc_poll_policy_t;
+
+// PC状态改变回调类型，machine为机器表下标
+typedef void (*pc_state_change_callback_t)(uint8_t machine, pc_state_t new_state);
 
 // 初始化PC监控模块
 esp_err_t pc_monitor_init(void);
@@ -25,16 +77,38 @@ esp_err_t pc_monitor_init(void);
 // PC监控任务（需要在独立任务中运行）
 void pc_monitor_task(void *pvParameter);
 
-// 获取当前PC状态
+// 获取默认机器（机器0）的当前状态
 pc_state_t pc_monitor_get_state(void);
 
+// 机器数量
+uint8_t pc_monitor_machine_count(void);
+
+// 获取机器信息，id超出范围时返回ESP_ERR_INVALID_ARG
+esp_err_t pc_monitor_get_machine(uint8_t id, pc_machine_info_t *info);
+
 // 注册PC状态变化回调
 void pc_monitor_register_callback(pc_state_change_callback_t callback);
 
-// 设置PC状态检测模式 (GPIO或I2C)
+// 设置PC状态检测模式 (GPIO或I2C)，对同时有两种输入的机器生效
 esp_err_t pc_monitor_set_mode(pc_status_read_mode_t mode);
 
 // 获取当前PC状态检测模式
 pc_status_read_mode_t pc_monitor_get_mode(void);
 
+// 获取状态检测统计
+void pc_monitor_get_stats(pc_monitor_stats_t *stats);
+
+// 设置/获取自适应轮询策略
+esp_err_t pc_monitor_set_poll_policy(const pc_poll_policy_t *policy);
+void pc_monitor_get_poll_policy(pc_poll_policy_t *policy);
+
+// 执行器动作之后调用，立即采样并进入快速采样窗口，快速窗口内检测到的变化计入检测时间
+void pc_monitor_notify_activity(void);
+
+// 新的WebSocket订阅之后调用，立即采样并进入快速采样窗口，不计入动作和检测统计
+void pc_monitor_notify_subscriber(void);
+
+// 请求立即采样一次
+void pc_monitor_request_sample(void);
+
 #endif /* PC_MONITOR_H */ 
\ No newline at end of file
@@ -1,14 +1,18 @@
 #include "pc_monitor/pc_monitor.h"
 #include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
 #include "driver/gpio.h"
-#include "driver/i2c.h"
+#include "i2c_bus/i2c_bus.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
 
 static const char *TAG = "pc_monitor";
 
 // GPIO引脚配置
-#define PC_STATUS_PIN 14  // GPIO14用于检测PC状态
+#define PC_STATUS_PIN 14  // GPIO14用于检测默认PC的状态
 
 // I2C配置
 #define I2C_MASTER_SCL_IO           21      // I2C时钟引脚
@@ -16,13 +20,67 @@ static const char *TAG = "pc_monitor";
 #define I2C_MASTER_NUM              I2C_NUM_0
 #define I2C_MASTER_FREQ_HZ          100000  // 100kHz
 #define PCF8574_ADDR                0x21    // PCF8574 I2C地址
-#define PCF8574_STATUS_BIT          0       // PCF8574中PC状态所在的位
+#define PCF8574_TIMEOUT_MS          100     // 单次读取超时
+#define PCF8574_STATUS_BIT          0       // PCF8574中默认PC状态所在的位
+// PCF8574的INT输出（开漏，低有效，多片可线与），默认-1表示未连接。只在确实接了INT的板子上设置引脚号：
+// 启用后I2C模式不再定期轮询（只做60秒一次的一致性检查），引脚悬空时状态变化要等一致性检查才能发现
+#define PCF8574_INT_PIN             -1
+#define PC_MAX_EXPANDERS            4       // 机器表中不同PCF8574地址的上限
 
-// 检测间隔(毫秒) - 修改为10秒，减少频繁检测
-#define PC_STATUS_CHECK_INTERVAL_MS 10000
+// 自适应轮询的默认策略(毫秒)
+#define PC_POLL_FAST_MS             250     // 执行器动作或新的WebSocket订阅之后的快速采样间隔
+#define PC_POLL_FAST_WINDOW_MS      15000   // 快速采样持续时间
+#define PC_POLL_MIN_MS              1000    // 状态变化后的采样间隔，之后每次无变化翻倍
+#define PC_POLL_MAX_MS              10000   // 没有中断可用时（I2C模式且未连接INT）的退避上限
+#define PC_POLL_LIMIT_MS            600000  // 策略中各时间的上限
+#define PC_POLL_FAST_MIN_MS         50
 
-// 当前PC状态
-static pc_state_t s_current_pc_state = PC_STATE_OFF;
+// 由边沿中断驱动时，轮询只做低频一致性检查，补上漏掉的边沿，退避上限为此间隔
+#define PC_CONSISTENCY_CHECK_MS     60000
+
+// 防抖：最后一个边沿之后电平保持这么久才确认状态变化
+#define PC_DEBOUNCE_MS              30
+// 边沿持续不断时，从第一个边沿起最多等待这么多个窗口就按当前电平确认
+#define PC_DEBOUNCE_MAX_WINDOWS     10
+
+#define PC_EDGE_QUEUE_LEN           16
+#define PC_SAMPLE_REQUEST           0       // 放入边沿队列的立即采样请求（边沿时间戳不会为0）
+
+// 机器表：每台PC的状态输入和开机执行器
+// 状态输入为GPIO（高电平为开机，-1表示没有）和/或PCF8574的一位（低电平为开机，地址0表示没有）；
+// 两者都有时按检测模式选择，PCF8574不可用时回退到GPIO。actuator为servo_control执行器表的下标。
+// 同一片PCF8574的8个输入可以分给8台机器，每次检测只读一次
+typedef struct {
+    const char *name;
+    int8_t gpio;
+    uint8_t pcf_addr;
+    uint8_t pcf_bit;
+    uint8_t actuator;
+} pc_machine_config_t;
+
+static const pc_machine_config_t s_machine_config[] = {
+    { "PC", PC_STATUS_PIN, PCF8574_ADDR, PCF8574_STATUS_BIT, 0 },
+};
+
+#define PC_MACHINE_COUNT (sizeof(s_machine_config) / sizeof(s_machine_config[0]))
+_Static_assert(PC_MACHINE_COUNT <= PC_MONITOR_MAX_MACHINES, "机器表超过PC_MONITOR_MAX_MACHINES");
+
+// 各机器的当前状态和最近一次读取是否成功
+static pc_state_t s_states[PC_MACHINE_COUNT];
+static bool s_sensor_ok[PC_MACHINE_COUNT];
+
+// 机器表中用到的PCF8574及其最近一次读到的端口值
+typedef struct {
+    uint8_t addr;
+    i2c_bus_device_handle_t dev;
+    bool present;
+    bool read;              // 本轮已读取
+    bool ok;
+    uint8_t value;
+} pc_expander_t;
+
+static pc_expander_t s_expanders[PC_MAX_EXPANDERS];
+static uint8_t s_expander_count = 0;
 
 // 状态变化回调
 static pc_state_change_callback_t s_state_change_callback = NULL;
@@ -30,175 +88,585 @@ static pc_state_change_callback_t s_state_change_callback = NULL;
 // 当前使用的读取方式
 static pc_status_read_mode_t s_read_mode = PC_STATUS_READ_I2C;
 
-// I2C初始化标志
-static bool s_i2c_initialized = false;
+// 保护PCF8574表（读取结果）、检测模式和中断使能：监控任务读取状态与HTTP任务切换模式互斥
+// i2c_bus的锁只串行化总线事务，不保护这里的缓存
+static SemaphoreHandle_t s_io_lock = NULL;
 
-// 初始化I2C
-static esp_err_t init_i2c(void)
+// 中断记录的边沿时间戳（来自用GPIO检测的机器的引脚和PCF8574的INT），以及立即采样请求
+static QueueHandle_t s_edge_queue = NULL;
+static volatile uint32_t s_edge_overflows = 0;
+static bool s_edges_ready = false;
+static bool s_int_configured = false;
+
+// 检测统计（只在监控任务中更新，读取时复制）
+static pc_monitor_stats_t s_stats;
+static uint64_t s_latency_total_us = 0;
+static portMUX_TYPE s_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// 自适应轮询（受s_stats_lock保护）
+static pc_poll_policy_t s_policy = {
+    .fast_interval_ms = PC_POLL_FAST_MS,
+    .fast_window_ms = PC_POLL_FAST_WINDOW_MS,
+    .min_interval_ms = PC_POLL_MIN_MS,
+    .max_interval_ms = PC_POLL_MAX_MS,
+};
+static int64_t s_fast_until_us = 0;
+static int64_t s_activity_us = 0;       // 等待检测结果的最近一次动作，0表示没有
+static uint32_t s_backoff_ms = PC_POLL_MIN_MS;
+static uint64_t s_detect_total_ms = 0;
+
+static void IRAM_ATTR edge_isr(void *arg)
+{
+    int64_t now = esp_timer_get_time();
+    BaseType_t woken = pdFALSE;
+    if (xQueueSendFromISR(s_edge_queue, &now, &woken) != pdTRUE) {
+        s_edge_overflows++;
+    }
+    if (woken == pdTRUE) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+static pc_expander_t *find_expander(uint8_t addr)
+{
+    for (uint8_t i = 0; i < s_expander_count; i++) {
+        if (s_expanders[i].addr == addr) {
+            return &s_expanders[i];
+        }
+    }
+    return NULL;
+}
+
+// 机器当前使用的状态输入
+static pc_status_read_mode_t machine_source(const pc_machine_config_t *machine)
+{
+    const pc_expander_t *expander = machine->pcf_addr != 0 ? find_expander(machine->pcf_addr) : NULL;
+    bool has_pcf = expander != NULL && expander->present;
+    if (has_pcf && (s_read_mode == PC_STATUS_READ_I2C || machine->gpio < 0)) {
+        return PC_STATUS_READ_I2C;
+    }
+    return PC_STATUS_READ_GPIO;
+}
+
+static bool any_machine_uses_i2c(void)
+{
+    for (size_t i = 0; i < PC_MACHINE_COUNT; i++) {
+        if (machine_source(&s_machine_config[i]) == PC_STATUS_READ_I2C) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 所有机器的状态变化是否都由中断通知
+static bool edges_drive_detection(void)
 {
-    i2c_config_t conf = {
-        .mode = I2C_MODE_MASTER,
-        .sda_io_num = I2C_MASTER_SDA_IO,
-        .scl_io_num = I2C_MASTER_SCL_IO,
-        .sda_pullup_en = GPIO_PULLUP_ENABLE,
-        .scl_pullup_en = GPIO_PULLUP_ENABLE,
-        .master.clk_speed = I2C_MASTER_FREQ_HZ
+    return s_edges_ready && (s_int_configured || !any_machine_uses_i2c());
+}
+
+// 只响应各机器当前输入对应引脚的中断
+static void update_edge_interrupt(void)
+{
+    if (!s_edges_ready) {
+        return;
+    }
+    for (size_t i = 0; i < PC_MACHINE_COUNT; i++) {
+        const pc_machine_config_t *machine = &s_machine_config[i];
+        if (machine->gpio < 0) {
+            continue;
+        }
+        if (machine_source(machine) == PC_STATUS_READ_GPIO) {
+            gpio_intr_enable(machine->gpio);
+        } else {
+            gpio_intr_disable(machine->gpio);
+        }
+    }
+
+    if (!s_int_configured) {
+        return;
+    }
+    if (any_machine_uses_i2c()) {
+        gpio_intr_enable(PCF8574_INT_PIN);
+        // INT在上次读取后已经拉低，不会再有下降沿，补一次读取把它清除
+        if (gpio_get_level(PCF8574_INT_PIN) == 0) {
+            int64_t now = esp_timer_get_time();
+            xQueueSend(s_edge_queue, &now, 0);
+        }
+    } else {
+        gpio_intr_disable(PCF8574_INT_PIN);
+    }
+}
+
+// PCF8574的INT在任一输入变化时拉低，读取端口后释放；只有接线时才启用
+static void init_int_pin(void)
+{
+#if PCF8574_INT_PIN >= 0
+    gpio_config_t io_conf = {
+        .pin_bit_mask = (1ULL << PCF8574_INT_PIN),
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_ENABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_NEGEDGE
     };
-    
-    esp_err_t ret = i2c_param_config(I2C_MASTER_NUM, &conf);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "I2C参数配置失败: %s", esp_err_to_name(ret));
-        return ret;
+    esp_err_t ret = gpio_config(&io_conf);
+    if (ret == ESP_OK) {
+        ret = gpio_isr_handler_add(PCF8574_INT_PIN, edge_isr, NULL);
     }
-    
-    ret = i2c_driver_install(I2C_MASTER_NUM, conf.mode, 0, 0, 0);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "I2C驱动安装失败: %s", esp_err_to_name(ret));
+        ESP_LOGW(TAG, "PCF8574 INT引脚初始化失败，I2C模式继续轮询: %s", esp_err_to_name(ret));
+        return;
+    }
+    s_int_configured = true;
+#endif
+}
+
+static esp_err_t init_edge_interrupt(void)
+{
+    // 其他组件可能已经安装了中断服务
+    esp_err_t ret = gpio_install_isr_service(0);
+    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
         return ret;
     }
-    
-    ESP_LOGI(TAG, "I2C初始化成功");
-    s_i2c_initialized = true;
+    for (size_t i = 0; i < PC_MACHINE_COUNT; i++) {
+        if (s_machine_config[i].gpio < 0) {
+            continue;
+        }
+        ret = gpio_isr_handler_add(s_machine_config[i].gpio, edge_isr, NULL);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+    init_int_pin();
+    s_edges_ready = true;
+    update_edge_interrupt();
     return ESP_OK;
 }
 
-// 通过I2C从PCF8574读取状态
-static esp_err_t read_pcf8574_status(bool *status)
+// 初始化共享I2C总线并登记每片PCF8574，重复调用时沿用已安装的驱动和已有句柄
+static esp_err_t init_i2c(void)
 {
-    if (!s_i2c_initialized) {
-        ESP_LOGE(TAG, "I2C未初始化");
-        return ESP_ERR_INVALID_STATE;
-    }
-    
-    uint8_t data = 0;
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, (PCF8574_ADDR << 1) | I2C_MASTER_READ, true);
-    i2c_master_read_byte(cmd, &data, I2C_MASTER_LAST_NACK);
-    i2c_master_stop(cmd);
-    esp_err_t ret = i2c_master_cmd_begin(I2C_MASTER_NUM, cmd, pdMS_TO_TICKS(100));
-    i2c_cmd_link_delete(cmd);
-    
+    const i2c_bus_config_t conf = {
+        .port = I2C_MASTER_NUM,
+        .sda_io = I2C_MASTER_SDA_IO,
+        .scl_io = I2C_MASTER_SCL_IO,
+        .freq_hz = I2C_MASTER_FREQ_HZ,
+    };
+    esp_err_t ret = i2c_bus_init(&conf);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "从PCF8574读取数据失败: %s", esp_err_to_name(ret));
         return ret;
     }
-    
-    // 检查bit0的状态并取反
-    // PCF8574返回0表示开机，返回1表示关机
-    *status = (data & (1 << PCF8574_STATUS_BIT)) == 0;
-    
-    // 打印一下读取到的原始数据和解析后的状态
-    ESP_LOGD(TAG, "PCF8574原始数据: 0x%02X, bit%d=%d, 解析状态: %s", 
-             data, PCF8574_STATUS_BIT, (data >> PCF8574_STATUS_BIT) & 0x01,
-             *status ? "开机" : "关机");
-    
+
+    for (uint8_t i = 0; i < s_expander_count; i++) {
+        if (s_expanders[i].dev != NULL) {
+            continue;
+        }
+        ret = i2c_bus_add_device(s_expanders[i].addr, PCF8574_TIMEOUT_MS, &s_expanders[i].dev);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "登记PCF8574(0x%02X)失败: %s", s_expanders[i].addr, esp_err_to_name(ret));
+            return ret;
+        }
+    }
     return ESP_OK;
 }
 
+// 通过I2C读取一组PCF8574的全部8个输入，作为一批事务在一次总线锁内完成
+static void read_expanders(pc_expander_t **list, size_t count)
+{
+    i2c_bus_txn_t txns[PC_MAX_EXPANDERS];
+    uint8_t data[PC_MAX_EXPANDERS] = { 0 };
+    for (size_t i = 0; i < count; i++) {
+        txns[i] = (i2c_bus_txn_t){ .dev = list[i]->dev, .read_buf = &data[i], .read_len = 1 };
+    }
+    i2c_bus_transfer(txns, count);
+
+    portENTER_CRITICAL(&s_stats_lock);
+    s_stats.i2c_reads += count;
+    portEXIT_CRITICAL(&s_stats_lock);
+
+    for (size_t i = 0; i < count; i++) {
+        pc_expander_t *expander = list[i];
+        expander->ok = txns[i].result == ESP_OK;
+        if (!expander->ok) {
+            ESP_LOGE(TAG, "从PCF8574(0x%02X)读取数据失败: %s", expander->addr, esp_err_to_name(txns[i].result));
+            continue;
+        }
+        expander->value = data[i];
+        ESP_LOGD(TAG, "PCF8574(0x%02X)原始数据: 0x%02X", expander->addr, data[i]);
+    }
+}
+
+// 探测机器表中的每片PCF8574，返回是否至少有一片可用
+static bool probe_expanders(void)
+{
+    pc_expander_t *list[PC_MAX_EXPANDERS];
+    for (uint8_t i = 0; i < s_expander_count; i++) {
+        list[i] = &s_expanders[i];
+    }
+    read_expanders(list, s_expander_count);
+
+    bool any = false;
+    for (uint8_t i = 0; i < s_expander_count; i++) {
+        s_expanders[i].present = s_expanders[i].ok;
+        any = any || s_expanders[i].present;
+    }
+    return any;
+}
+
+// 从机器表收集不重复的PCF8574地址
+static void collect_expanders(void)
+{
+    for (size_t i = 0; i < PC_MACHINE_COUNT; i++) {
+        uint8_t addr = s_machine_config[i].pcf_addr;
+        if (addr == 0 || find_expander(addr) != NULL) {
+            continue;
+        }
+        if (s_expander_count == PC_MAX_EXPANDERS) {
+            ESP_LOGW(TAG, "PCF8574数量超过 %d，忽略地址 0x%02X", PC_MAX_EXPANDERS, addr);
+            continue;
+        }
+        s_expanders[s_expander_count++] = (pc_expander_t){ .addr = addr };
+    }
+}
+
+// 读取所有机器的状态：每片用到的PCF8574只读一次，8个输入同时更新
+static void read_all_states(pc_state_t *states, bool *ok)
+{
+    xSemaphoreTake(s_io_lock, portMAX_DELAY);
+    for (uint8_t i = 0; i < s_expander_count; i++) {
+        s_expanders[i].read = false;
+    }
+
+    // 先收集本轮用到的PCF8574，一起读取
+    pc_expander_t *pending[PC_MAX_EXPANDERS];
+    size_t pending_count = 0;
+    for (size_t i = 0; i < PC_MACHINE_COUNT; i++) {
+        const pc_machine_config_t *machine = &s_machine_config[i];
+        if (machine_source(machine) != PC_STATUS_READ_I2C) {
+            continue;
+        }
+        pc_expander_t *expander = find_expander(machine->pcf_addr);
+        if (!expander->read) {
+            expander->read = true;
+            pending[pending_count++] = expander;
+        }
+    }
+    if (pending_count > 0) {
+        read_expanders(pending, pending_count);
+    }
+
+    for (size_t i = 0; i < PC_MACHINE_COUNT; i++) {
+        const pc_machine_config_t *machine = &s_machine_config[i];
+        ok[i] = true;
+        if (machine_source(machine) == PC_STATUS_READ_I2C) {
+            const pc_expander_t *expander = find_expander(machine->pcf_addr);
+            if (expander->ok) {
+                // PCF8574返回0表示开机，返回1表示关机
+                states[i] = (expander->value & (1 << machine->pcf_bit)) == 0 ? PC_STATE_ON : PC_STATE_OFF;
+                continue;
+            }
+            if (machine->gpio < 0) {
+                // 没有GPIO可以回退，保持原状态
+                states[i] = s_states[i];
+                ok[i] = false;
+                continue;
+            }
+            // I2C读取失败，尝试通过GPIO读取
+            ESP_LOGW(TAG, "%s: I2C读取失败，临时切换到GPIO读取", machine->name);
+        } else if (machine->gpio < 0) {
+            states[i] = s_states[i];
+            ok[i] = false;
+            continue;
+        }
+        states[i] = gpio_get_level(machine->gpio) ? PC_STATE_ON : PC_STATE_OFF;
+    }
+    xSemaphoreGive(s_io_lock);
+}
+
 esp_err_t pc_monitor_init(void)
 {
     esp_err_t ret = ESP_OK;
+
+    if (s_io_lock == NULL) {
+        s_io_lock = xSemaphoreCreateMutex();
+        if (s_io_lock == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
     
-    // 配置GPIO引脚 
-    gpio_config_t io_conf = {
-        .pin_bit_mask = (1ULL << PC_STATUS_PIN),
-        .mode = GPIO_MODE_INPUT,
-        .pull_up_en = GPIO_PULLUP_DISABLE,
-        .pull_down_en = GPIO_PULLDOWN_ENABLE,
-        .intr_type = GPIO_INTR_DISABLE
-    };
-    
-    ret = gpio_config(&io_conf);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "GPIO配置失败: %d", ret);
-        return ret;
+    // 配置各机器的状态GPIO
+    uint64_t pin_mask = 0;
+    for (size_t i = 0; i < PC_MACHINE_COUNT; i++) {
+        if (s_machine_config[i].gpio >= 0) {
+            pin_mask |= 1ULL << s_machine_config[i].gpio;
+        }
+    }
+    if (pin_mask != 0) {
+        gpio_config_t io_conf = {
+            .pin_bit_mask = pin_mask,
+            .mode = GPIO_MODE_INPUT,
+            .pull_up_en = GPIO_PULLUP_DISABLE,
+            .pull_down_en = GPIO_PULLDOWN_ENABLE,
+            .intr_type = GPIO_INTR_ANYEDGE
+        };
+        
+        ret = gpio_config(&io_conf);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "GPIO配置失败: %d", ret);
+            return ret;
+        }
     }
     
     // 尝试初始化I2C
-    ret = init_i2c();
-    if (ret != ESP_OK) {
-        ESP_LOGW(TAG, "I2C初始化失败，将使用GPIO检测模式: %s", esp_err_to_name(ret));
-        s_read_mode = PC_STATUS_READ_GPIO;
-    } else {
-        // 尝试读取PCF8574状态，确认设备存在
-        bool status;
-        ret = read_pcf8574_status(&status);
+    collect_expanders();
+    s_read_mode = PC_STATUS_READ_GPIO;
+    if (s_expander_count > 0) {
+        ret = init_i2c();
         if (ret != ESP_OK) {
-            ESP_LOGW(TAG, "无法从PCF8574读取状态，切换到GPIO检测模式: %s", esp_err_to_name(ret));
-            s_read_mode = PC_STATUS_READ_GPIO;
+            ESP_LOGW(TAG, "I2C初始化失败，将使用GPIO检测模式: %s", esp_err_to_name(ret));
+        } else if (!probe_expanders()) {
+            // 确认设备存在
+            ESP_LOGW(TAG, "无法从PCF8574读取状态，切换到GPIO检测模式");
         } else {
             ESP_LOGI(TAG, "PCF8574检测成功，使用I2C检测模式");
             s_read_mode = PC_STATUS_READ_I2C;
         }
     }
     
-    // 初始读取PC状态
-    if (s_read_mode == PC_STATUS_READ_GPIO) {
-        s_current_pc_state = gpio_get_level(PC_STATUS_PIN) ? PC_STATE_ON : PC_STATE_OFF;
-        ESP_LOGI(TAG, "通过GPIO检测PC初始状态: %s", s_current_pc_state == PC_STATE_ON ? "开机" : "关机");
-    } else {
-        bool status;
-        if (read_pcf8574_status(&status) == ESP_OK) {
-            s_current_pc_state = status ? PC_STATE_ON : PC_STATE_OFF;
-            ESP_LOGI(TAG, "通过I2C检测PC初始状态: %s", s_current_pc_state == PC_STATE_ON ? "开机" : "关机");
-        }
+    // 初始读取各机器的状态
+    read_all_states(s_states, s_sensor_ok);
+    for (size_t i = 0; i < PC_MACHINE_COUNT; i++) {
+        ESP_LOGI(TAG, "机器%d(%s)通过%s检测初始状态: %s", (int)i, s_machine_config[i].name,
+                 machine_source(&s_machine_config[i]) == PC_STATUS_READ_I2C ? "I2C" : "GPIO",
+                 s_states[i] == PC_STATE_ON ? "开机" : "关机");
+    }
+
+    // 边沿中断失败时仍可轮询检测
+    s_edge_queue = xQueueCreate(PC_EDGE_QUEUE_LEN, sizeof(int64_t));
+    ret = s_edge_queue != NULL ? init_edge_interrupt() : ESP_ERR_NO_MEM;
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "GPIO边沿中断初始化失败，只使用轮询检测: %s", esp_err_to_name(ret));
     }
     
     return ESP_OK;
 }
 
+// 状态变化：退避回到起点，并记录从动作到检测到变化的时间
+static void note_changes(void)
+{
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&s_stats_lock);
+    s_backoff_ms = s_policy.min_interval_ms;
+    if (s_activity_us != 0) {
+        uint32_t detect_ms = (uint32_t)((now - s_activity_us) / 1000);
+        s_activity_us = 0;
+        s_stats.detects++;
+        s_stats.last_detect_ms = detect_ms;
+        s_detect_total_ms += detect_ms;
+        s_stats.avg_detect_ms = (uint32_t)(s_detect_total_ms / s_stats.detects);
+        if (detect_ms > s_stats.max_detect_ms) {
+            s_stats.max_detect_ms = detect_ms;
+        }
+    }
+    portEXIT_CRITICAL(&s_stats_lock);
+}
+
+// 更新各机器的状态，只在变化时调用回调函数（发送WebSocket消息），返回变化的机器数
+static uint32_t apply_states(const pc_state_t *states, const bool *ok, const char *source)
+{
+    uint32_t changed = 0;
+    for (size_t i = 0; i < PC_MACHINE_COUNT; i++) {
+        s_sensor_ok[i] = ok[i];
+        if (states[i] == s_states[i]) {
+            // 状态无变化，静默检测，不发送任何通知
+            continue;
+        }
+
+        ESP_LOGI(TAG, "检测到机器%d(%s)状态变化(%s): %s -> %s", (int)i, s_machine_config[i].name, source,
+                 s_states[i] == PC_STATE_ON ? "开机" : "关机",
+                 states[i] == PC_STATE_ON ? "开机" : "关机");
+        s_states[i] = states[i];
+        changed++;
+
+        if (s_state_change_callback != NULL) {
+            s_state_change_callback((uint8_t)i, states[i]);
+        }
+    }
+    if (changed > 0) {
+        note_changes();
+    }
+    return changed;
+}
+
+// 一轮边沿结束（或等待超过上限）后按当前电平确认
+static void confirm_edges(int64_t first_edge_us)
+{
+    // 一轮INT边沿每片PCF8574只读一次，读取同时释放INT
+    pc_state_t states[PC_MACHINE_COUNT];
+    bool ok[PC_MACHINE_COUNT];
+    read_all_states(states, ok);
+    int64_t now = esp_timer_get_time();
+    uint32_t changed = apply_states(states, ok, "中断");
+
+    portENTER_CRITICAL(&s_stats_lock);
+    if (changed > 0) {
+        // 从第一个边沿到确认的时间，包含防抖窗口
+        uint32_t latency = (uint32_t)(now - first_edge_us);
+        s_stats.transitions += changed;
+        s_stats.last_latency_us = latency;
+        s_latency_total_us += latency;
+        s_stats.confirmations++;
+        s_stats.avg_latency_us = (uint32_t)(s_latency_total_us / s_stats.confirmations);
+        if (latency > s_stats.max_latency_us) {
+            s_stats.max_latency_us = latency;
+        }
+    } else {
+        // 毛刺：电平最终回到原状态
+        s_stats.glitches++;
+    }
+    portEXIT_CRITICAL(&s_stats_lock);
+}
+
+static void note_edge(int64_t edge_us)
+{
+    // 中断到任务处理的延迟
+    uint32_t wake = (uint32_t)(esp_timer_get_time() - edge_us);
+    portENTER_CRITICAL(&s_stats_lock);
+    s_stats.edges++;
+    s_stats.last_wake_us = wake;
+    if (wake > s_stats.max_wake_us) {
+        s_stats.max_wake_us = wake;
+    }
+    portEXIT_CRITICAL(&s_stats_lock);
+}
+
+static void poll_state(void)
+{
+    bool interrupt_driven = edges_drive_detection();
+    pc_state_t states[PC_MACHINE_COUNT];
+    bool ok[PC_MACHINE_COUNT];
+    read_all_states(states, ok);
+    uint32_t changed = apply_states(states, ok, interrupt_driven ? "一致性检查" : "轮询");
+
+    portENTER_CRITICAL(&s_stats_lock);
+    s_stats.polls++;
+    if (esp_timer_get_time() < s_fast_until_us) {
+        s_stats.fast_samples++;
+    }
+    if (interrupt_driven) {
+        // 中断路径漏掉的变化
+        s_stats.poll_corrections += changed;
+    }
+    portEXIT_CRITICAL(&s_stats_lock);
+}
+
+// 下一次采样的间隔：快速窗口内使用快速间隔，否则每次无变化的采样后间隔翻倍，直到上限
+static uint32_t next_poll_interval_ms(void)
+{
+    bool interrupt_driven = edges_drive_detection();
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&s_stats_lock);
+    uint32_t cap = interrupt_driven ? PC_CONSISTENCY_CHECK_MS : s_policy.max_interval_ms;
+    uint32_t interval;
+    // 动作后的快速窗口内没有检测到变化（订阅者延长的窗口不计入）
+    if (s_activity_us != 0 && now >= s_activity_us + (int64_t)s_policy.fast_window_ms * 1000) {
+        s_activity_us = 0;
+        s_stats.detect_misses++;
+    }
+    if (now < s_fast_until_us) {
+        interval = s_policy.fast_interval_ms;
+    } else {
+        interval = s_backoff_ms < cap ? s_backoff_ms : cap;
+        s_backoff_ms = interval * 2 < cap ? interval * 2 : cap;
+    }
+    s_stats.interval_ms = interval;
+    portEXIT_CRITICAL(&s_stats_lock);
+    return interval;
+}
+
 void pc_monitor_task(void *pvParameter)
 {
-    ESP_LOGI(TAG, "PC监控任务启动，使用模式: %s", s_read_mode == PC_STATUS_READ_GPIO ? "GPIO" : "I2C");
+    ESP_LOGI(TAG, "PC监控任务启动，%d台机器，使用模式: %s", (int)PC_MACHINE_COUNT,
+             s_read_mode == PC_STATUS_READ_GPIO ? "GPIO" : "I2C");
+
+    int64_t next_poll_us = esp_timer_get_time() + (int64_t)next_poll_interval_ms() * 1000;
+    int64_t first_edge_us = 0;      // 本轮边沿中的第一个，0表示没有待确认的边沿
     
     while (1) {
-        // 读取PC状态
-        pc_state_t new_state;
-        
-        if (s_read_mode == PC_STATUS_READ_GPIO) {
-            // 通过GPIO读取
-            new_state = gpio_get_level(PC_STATUS_PIN) ? PC_STATE_ON : PC_STATE_OFF;
+        int64_t now = esp_timer_get_time();
+        TickType_t wait;
+        if (first_edge_us != 0) {
+            // 等待防抖窗口，但不超过本轮的等待上限
+            int64_t remaining_ms = (first_edge_us - now) / 1000 + PC_DEBOUNCE_MS * PC_DEBOUNCE_MAX_WINDOWS;
+            if (remaining_ms > PC_DEBOUNCE_MS) {
+                remaining_ms = PC_DEBOUNCE_MS;
+            }
+            wait = remaining_ms > 0 ? pdMS_TO_TICKS(remaining_ms) : 0;
         } else {
-            // 通过I2C读取
-            bool status;
-            if (read_pcf8574_status(&status) == ESP_OK) {
-                new_state = status ? PC_STATE_ON : PC_STATE_OFF;
+            wait = next_poll_us > now ? pdMS_TO_TICKS((next_poll_us - now) / 1000) : 0;
+        }
+
+        int64_t edge_us;
+        if (s_edge_queue != NULL && xQueueReceive(s_edge_queue, &edge_us, wait) == pdTRUE) {
+            if (edge_us == PC_SAMPLE_REQUEST) {
+                // 立即采样；正在防抖时确认本身就是一次采样
+                next_poll_us = 0;
+                if (first_edge_us != 0) {
+                    continue;
+                }
             } else {
-                // I2C读取失败，尝试通过GPIO读取
-                ESP_LOGW(TAG, "I2C读取失败，临时切换到GPIO读取");
-                new_state = gpio_get_level(PC_STATUS_PIN) ? PC_STATE_ON : PC_STATE_OFF;
+                // 模式切换前残留的边沿最多多读一次，按毛刺计
+                note_edge(edge_us);
+                if (first_edge_us == 0) {
+                    first_edge_us = edge_us;
+                }
+                // 窗口内又有边沿，重新等待
+                if (esp_timer_get_time() - first_edge_us < (int64_t)PC_DEBOUNCE_MS * PC_DEBOUNCE_MAX_WINDOWS * 1000) {
+                    continue;
+                }
             }
+        } else if (s_edge_queue == NULL) {
+            vTaskDelay(wait);
         }
-        
-        // 检测状态变化
-        if (new_state != s_current_pc_state) {
-            ESP_LOGI(TAG, "检测到PC状态变化: %s -> %s",
-                s_current_pc_state == PC_STATE_ON ? "开机" : "关机",
-                new_state == PC_STATE_ON ? "开机" : "关机");
-
-            // 更新状态
-            s_current_pc_state = new_state;
-
-            // 只在状态变化时调用回调函数（发送WebSocket消息）
-            if (s_state_change_callback != NULL) {
-                ESP_LOGI(TAG, "主动发送状态变化通知");
-                s_state_change_callback(new_state);
-            }
-        } else {
-            // 状态无变化，静默检测，不发送任何通知
-            ESP_LOGD(TAG, "PC状态无变化，保持: %s",
-                s_current_pc_state == PC_STATE_ON ? "开机" : "关机");
+
+        if (first_edge_us != 0) {
+            confirm_edges(first_edge_us);
+            first_edge_us = 0;
+            continue;
+        }
+
+        if (esp_timer_get_time() >= next_poll_us) {
+            poll_state();
+            next_poll_us = esp_timer_get_time() + (int64_t)next_poll_interval_ms() * 1000;
         }
-        
-        // 延时检测
-        vTaskDelay(PC_STATUS_CHECK_INTERVAL_MS / portTICK_PERIOD_MS);
     }
 }
 
 pc_state_t pc_monitor_get_state(void)
 {
-    return s_current_pc_state;
+    return s_states[0];
+}
+
+uint8_t pc_monitor_machine_count(void)
+{
+    return (uint8_t)PC_MACHINE_COUNT;
+}
+
+esp_err_t pc_monitor_get_machine(uint8_t id, pc_machine_info_t *info)
+{
+    if (id >= PC_MACHINE_COUNT || info == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const pc_machine_config_t *machine = &s_machine_config[id];
+    info->name = machine->name;
+    info->state = s_states[id];
+    info->sensor_ok = s_sensor_ok[id];
+    info->source = machine_source(machine);
+    info->gpio = machine->gpio;
+    info->pcf_addr = machine->pcf_addr;
+    info->pcf_bit = machine->pcf_bit;
+    info->actuator = machine->actuator;
+    return ESP_OK;
 }
 
 void pc_monitor_register_callback(pc_state_change_callback_t callback)
@@ -213,31 +681,128 @@ esp_err_t pc_monitor_set_mode(pc_status_read_mode_t mode)
     if (mode != PC_STATUS_READ_GPIO && mode != PC_STATUS_READ_I2C) {
         return ESP_ERR_INVALID_ARG;
     }
-    
+    if (s_io_lock == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // 在HTTP任务中调用，与监控任务的读取互斥
+    xSemaphoreTake(s_io_lock, portMAX_DELAY);
+    esp_err_t ret = ESP_OK;
+
     // 如果切换到I2C模式，确保I2C已初始化
-    if (mode == PC_STATUS_READ_I2C && !s_i2c_initialized) {
-        esp_err_t ret = init_i2c();
-        if (ret != ESP_OK) {
-            return ret;
+    if (mode == PC_STATUS_READ_I2C) {
+        if (s_expander_count == 0) {
+            ret = ESP_ERR_NOT_SUPPORTED;
+        } else {
+            ret = init_i2c();
         }
-        
+
         // 测试PCF8574是否可用
-        bool status;
-        ret = read_pcf8574_status(&status);
-        if (ret != ESP_OK) {
-            return ret;
+        if (ret == ESP_OK && !probe_expanders()) {
+            ret = ESP_ERR_NOT_FOUND;
         }
     }
-    
+
     // 切换模式
-    s_read_mode = mode;
-    ESP_LOGI(TAG, "PC状态检测模式切换为: %s", mode == PC_STATUS_READ_GPIO ? "GPIO" : "I2C");
-    
-    return ESP_OK;
+    if (ret == ESP_OK) {
+        s_read_mode = mode;
+        update_edge_interrupt();
+        ESP_LOGI(TAG, "PC状态检测模式切换为: %s", mode == PC_STATUS_READ_GPIO ? "GPIO" : "I2C");
+    }
+    xSemaphoreGive(s_io_lock);
+
+    return ret;
 }
 
 // 获取当前检测模式
 pc_status_read_mode_t pc_monitor_get_mode(void)
 {
     return s_read_mode;
-} 
\ No newline at end of file
+}
+
+void pc_monitor_get_stats(pc_monitor_stats_t *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+    portENTER_CRITICAL(&s_stats_lock);
+    *stats = s_stats;
+    portEXIT_CRITICAL(&s_stats_lock);
+    stats->interrupt_driven = edges_drive_detection();
+    stats->edge_overflows = s_edge_overflows;
+    stats->debounce_ms = PC_DEBOUNCE_MS;
+}
+
+esp_err_t pc_monitor_set_poll_policy(const pc_poll_policy_t *policy)
+{
+    if (policy == NULL || policy->fast_interval_ms < PC_POLL_FAST_MIN_MS ||
+        policy->fast_interval_ms > policy->min_interval_ms ||
+        policy->min_interval_ms > policy->max_interval_ms ||
+        policy->max_interval_ms > PC_POLL_LIMIT_MS || policy->fast_window_ms > PC_POLL_LIMIT_MS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&s_stats_lock);
+    s_policy = *policy;
+    s_backoff_ms = policy->min_interval_ms;
+    portEXIT_CRITICAL(&s_stats_lock);
+
+    ESP_LOGI(TAG, "轮询策略: 快速 %lu ms/%lu ms，退避 %lu-%lu ms",
+             (unsigned long)policy->fast_interval_ms, (unsigned long)policy->fast_window_ms,
+             (unsigned long)policy->min_interval_ms, (unsigned long)policy->max_interval_ms);
+    // 按新策略重新安排下一次采样
+    pc_monitor_request_sample();
+    return ESP_OK;
+}
+
+void pc_monitor_get_poll_policy(pc_poll_policy_t *policy)
+{
+    if (policy == NULL) {
+        return;
+    }
+    portENTER_CRITICAL(&s_stats_lock);
+    *policy = s_policy;
+    portEXIT_CRITICAL(&s_stats_lock);
+}
+
+void pc_monitor_notify_activity(void)
+{
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&s_stats_lock);
+    s_stats.activities++;
+    s_activity_us = now;
+    s_fast_until_us = now + (int64_t)s_policy.fast_window_ms * 1000;
+    s_backoff_ms = s_policy.min_interval_ms;
+    portEXIT_CRITICAL(&s_stats_lock);
+
+    // 先立即采样一次，之后按快速间隔
+    pc_monitor_request_sample();
+}
+
+void pc_monitor_notify_subscriber(void)
+{
+    int64_t now = esp_timer_get_time();
+    int64_t until = now + (int64_t)s_policy.fast_window_ms * 1000;
+    portENTER_CRITICAL(&s_stats_lock);
+    // 只进入快速采样窗口，不记录动作：新订阅之后没有预期的状态变化，不计入检测时间和漏检
+    if (until > s_fast_until_us) {
+        s_fast_until_us = until;
+    }
+    s_backoff_ms = s_policy.min_interval_ms;
+    portEXIT_CRITICAL(&s_stats_lock);
+
+    pc_monitor_request_sample();
+}
+
+void pc_monitor_request_sample(void)
+{
+    portENTER_CRITICAL(&s_stats_lock);
+    s_stats.sample_requests++;
+    portEXIT_CRITICAL(&s_stats_lock);
+
+    // 队列满时已有待处理的边沿，处理它们时同样会采样
+    int64_t request = PC_SAMPLE_REQUEST;
+    if (s_edge_queue != NULL) {
+        xQueueSend(s_edge_queue, &request, 0);
+    }
+}
\ No newline at end of file
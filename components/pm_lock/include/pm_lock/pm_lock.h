@@ -0,0 +1,52 @@
+#ifndef PM_LOCK_H
+#define PM_LOCK_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// 动态调频与自动浅睡眠
+// 空闲时CPU降到最低频率并允许浅睡眠，处理请求、推送、DNS和舵机动作期间持有
+// ESP_PM_CPU_FREQ_MAX锁保持最高频率；每个锁统计持有次数和时间，用于确认请求延迟不受影响
+
+typedef enum {
+    PM_LOCK_HTTPD = 0,      // HTTP请求分发
+    PM_LOCK_WS,             // WebSocket广播
+    PM_LOCK_DNS,            // DNS查询处理
+    PM_LOCK_SERVO,          // 舵机动作
+    PM_LOCK_COUNT
+} pm_lock_id_t;
+
+// 单个锁的统计；一次持有指从无人持有到全部释放的时间段（多个任务可同时持有）
+typedef struct {
+    uint32_t acquires;      // 获取次数
+    uint32_t holds;         // 持有次数
+    uint8_t active;         // 当前持有者数
+    uint64_t held_us;       // 累计持有时间
+    uint32_t last_hold_us;
+    uint32_t max_hold_us;
+} pm_lock_stats_t;
+
+typedef struct {
+    bool enabled;           // esp_pm已配置
+    bool light_sleep;       // 允许自动浅睡眠
+    uint16_t max_freq_mhz;
+    uint16_t min_freq_mhz;
+    uint64_t uptime_us;
+    uint64_t any_held_us;   // 至少一个锁被持有的累计时间
+    pm_lock_stats_t locks[PM_LOCK_COUNT];
+} pm_lock_status_t;
+
+// 配置esp_pm并创建锁，应在其他组件初始化之前调用
+// 未启用CONFIG_PM_ENABLE时只做统计，获取和释放不影响频率
+esp_err_t pm_lock_init(void);
+
+// 获取/释放锁，必须成对调用；可在任意任务中调用，不可在中断中调用
+void pm_lock_acquire(pm_lock_id_t id);
+void pm_lock_release(pm_lock_id_t id);
+
+const char *pm_lock_name(pm_lock_id_t id);
+
+void pm_lock_get_status(pm_lock_status_t *status);
+
+#endif /* PM_LOCK_H */
@@ -0,0 +1,147 @@
+#include "pm_lock/pm_lock.h"
+#include "esp_log.h"
+#include "esp_pm.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "pm_lock";
+
+// 调频配置：最高频率沿用默认CPU频率，最低为晶振频率
+#define PM_MAX_FREQ_MHZ     CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ
+#define PM_MIN_FREQ_MHZ     40
+
+static const char *s_lock_names[PM_LOCK_COUNT] = {
+    [PM_LOCK_HTTPD] = "httpd",
+    [PM_LOCK_WS]    = "ws",
+    [PM_LOCK_DNS]   = "dns",
+    [PM_LOCK_SERVO] = "servo",
+};
+
+static esp_pm_lock_handle_t s_handles[PM_LOCK_COUNT];
+static pm_lock_status_t s_status;
+static int64_t s_hold_start_us[PM_LOCK_COUNT];
+static int64_t s_any_start_us = 0;
+static uint8_t s_any_active = 0;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+esp_err_t pm_lock_init(void)
+{
+#if CONFIG_PM_ENABLE
+    esp_pm_config_t config = {
+        .max_freq_mhz = PM_MAX_FREQ_MHZ,
+        .min_freq_mhz = PM_MIN_FREQ_MHZ,
+#if CONFIG_FREERTOS_USE_TICKLESS_IDLE
+        .light_sleep_enable = true,
+#endif
+    };
+    esp_err_t err = esp_pm_configure(&config);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "配置动态调频失败: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    for (int i = 0; i < PM_LOCK_COUNT; i++) {
+        if (s_handles[i] != NULL) {
+            continue;
+        }
+        err = esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, s_lock_names[i], &s_handles[i]);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "创建锁 %s 失败: %s", s_lock_names[i], esp_err_to_name(err));
+            return err;
+        }
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    s_status.enabled = true;
+    s_status.light_sleep = config.light_sleep_enable;
+    s_status.max_freq_mhz = PM_MAX_FREQ_MHZ;
+    s_status.min_freq_mhz = PM_MIN_FREQ_MHZ;
+    portEXIT_CRITICAL(&s_lock);
+
+    ESP_LOGI(TAG, "动态调频 %d-%d MHz，自动浅睡眠%s", PM_MIN_FREQ_MHZ, PM_MAX_FREQ_MHZ,
+             config.light_sleep_enable ? "开启" : "关闭");
+    return ESP_OK;
+#else
+    ESP_LOGW(TAG, "未启用CONFIG_PM_ENABLE，CPU固定频率运行");
+    return ESP_OK;
+#endif
+}
+
+void pm_lock_acquire(pm_lock_id_t id)
+{
+    if (id >= PM_LOCK_COUNT) {
+        return;
+    }
+    // 先升频再开始计时
+    if (s_handles[id] != NULL) {
+        esp_pm_lock_acquire(s_handles[id]);
+    }
+
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&s_lock);
+    pm_lock_stats_t *stats = &s_status.locks[id];
+    stats->acquires++;
+    if (stats->active++ == 0) {
+        stats->holds++;
+        s_hold_start_us[id] = now;
+    }
+    if (s_any_active++ == 0) {
+        s_any_start_us = now;
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void pm_lock_release(pm_lock_id_t id)
+{
+    if (id >= PM_LOCK_COUNT) {
+        return;
+    }
+
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&s_lock);
+    pm_lock_stats_t *stats = &s_status.locks[id];
+    if (stats->active > 0 && --stats->active == 0) {
+        uint32_t held = (uint32_t)(now - s_hold_start_us[id]);
+        stats->held_us += held;
+        stats->last_hold_us = held;
+        if (held > stats->max_hold_us) {
+            stats->max_hold_us = held;
+        }
+    }
+    if (s_any_active > 0 && --s_any_active == 0) {
+        s_status.any_held_us += (uint64_t)(now - s_any_start_us);
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (s_handles[id] != NULL) {
+        esp_pm_lock_release(s_handles[id]);
+    }
+}
+
+const char *pm_lock_name(pm_lock_id_t id)
+{
+    return id < PM_LOCK_COUNT ? s_lock_names[id] : "unknown";
+}
+
+void pm_lock_get_status(pm_lock_status_t *status)
+{
+    if (status == NULL) {
+        return;
+    }
+
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&s_lock);
+    *status = s_status;
+    // 正在进行的持有计入累计时间
+    for (int i = 0; i < PM_LOCK_COUNT; i++) {
+        if (status->locks[i].active > 0) {
+            status->locks[i].held_us += (uint64_t)(now - s_hold_start_us[i]);
+        }
+    }
+    if (s_any_active > 0) {
+        status->any_held_us += (uint64_t)(now - s_any_start_us);
+    }
+    portEXIT_CRITICAL(&s_lock);
+    status->uptime_us = (uint64_t)now;
+}
@@ -0,0 +1,61 @@
+#ifndef SAMPLING_PROFILER_H
+#define SAMPLING_PROFILER_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// 导出数据格式标识 ('SPRF')
+#define SAMPLING_PROFILER_MAGIC   0x46525053
+#define SAMPLING_PROFILER_VERSION 1
+
+// 导出数据头部（小端，后面紧跟entry_count个sampling_profiler_entry_t）
+typedef struct __attribute__((packed)) {
+    uint32_t magic;            // SAMPLING_PROFILER_MAGIC
+    uint16_t version;          // SAMPLING_PROFILER_VERSION
+    uint16_t entry_size;       // sizeof(sampling_profiler_entry_t)
+    uint32_t sample_rate_hz;   // 采样频率
+    uint32_t duration_ms;      // 采样持续时间
+    uint32_t total_samples;    // 总采样数
+    uint32_t idle_samples;     // 落在IDLE任务中的采样数
+    uint32_t dropped_samples;  // 直方图已满而丢弃的采样数
+    uint32_t entry_count;      // 直方图条目数
+} sampling_profiler_header_t;
+
+// 直方图条目：被中断的PC及其命中次数
+typedef struct __attribute__((packed)) {
+    uint32_t pc;
+    uint32_t count;
+} sampling_profiler_entry_t;
+
+// 采样统计
+typedef struct {
+    bool running;
+    uint32_t sample_rate_hz;
+    uint32_t duration_ms;
+    uint32_t total_samples;
+    uint32_t idle_samples;
+    uint32_t dropped_samples;
+    uint32_t entry_count;
+} sampling_profiler_stats_t;
+
+// 导出写回调（例如httpd_resp_send_chunk的包装）
+typedef esp_err_t (*sampling_profiler_write_fn_t)(void *ctx, const void *data, size_t len);
+
+// 开始采样（rate_hz为0时使用默认频率），会清空上一次的直方图
+esp_err_t sampling_profiler_start(uint32_t rate_hz);
+
+// 停止采样，直方图保留到下一次开始
+esp_err_t sampling_profiler_stop(void);
+
+// 获取采样统计
+void sampling_profiler_get_stats(sampling_profiler_stats_t *stats);
+
+// 导出的二进制数据总长度
+size_t sampling_profiler_export_size(void);
+
+// 以二进制格式导出直方图（需先停止采样）
+esp_err_t sampling_profiler_export(sampling_profiler_write_fn_t write_fn, void *ctx);
+
+#endif /* SAMPLING_PROFILER_H */
@@ -0,0 +1,285 @@
+#include "sampling_profiler/sampling_profiler.h"
+#include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "driver/gptimer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+#include <string.h>
+
+#if CONFIG_IDF_TARGET_ARCH_XTENSA
+#include "xtensa_context.h"
+#else
+#include "riscv/rvruntime-frames.h"
+#endif
+
+static const char *TAG = "sampling_profiler";
+
+// 采样配置
+#define PROFILER_DEFAULT_RATE_HZ   1000    // 默认采样频率
+#define PROFILER_MIN_RATE_HZ       100
+#define PROFILER_MAX_RATE_HZ       10000
+#define PROFILER_TIMER_RESOLUTION  1000000 // 定时器分辨率1MHz
+
+// 直方图配置（开放寻址哈希表，必须为2的幂）
+#define PROFILER_HIST_SLOTS        1024
+#define PROFILER_HIST_MAX_PROBE    8       // 最大线性探测次数，超出则丢弃该采样
+
+// 直方图（首次启动时分配，停止后保留以便导出）
+static sampling_profiler_entry_t *s_hist = NULL;
+
+// 采样定时器
+static gptimer_handle_t s_timer = NULL;
+static TaskHandle_t s_idle_task = NULL;
+static int s_sample_core = 0;
+
+// 采样统计（在ISR中更新）
+static volatile uint32_t s_total_samples = 0;
+static volatile uint32_t s_idle_samples = 0;
+static volatile uint32_t s_dropped_samples = 0;
+static volatile uint32_t s_entry_count = 0;
+static uint32_t s_rate_hz = 0;
+static int64_t s_start_time_us = 0;
+static int64_t s_stop_time_us = 0;
+
+// 取得被定时器中断打断的PC
+// 中断入口会把被打断任务的异常帧地址写入其TCB的pxTopOfStack（TCB第一个成员）
+static inline uint32_t IRAM_ATTR get_interrupted_pc(TaskHandle_t task)
+{
+    if (task == NULL) {
+        return 0;
+    }
+    void *frame = *(void **)task;
+    if (frame == NULL) {
+        return 0;
+    }
+#if CONFIG_IDF_TARGET_ARCH_XTENSA
+    return (uint32_t)((XtExcFrame *)frame)->pc;
+#else
+    return (uint32_t)((RvExcFrame *)frame)->mepc;
+#endif
+}
+
+// 记录一个PC到直方图
+static inline void IRAM_ATTR hist_record(uint32_t pc)
+{
+    uint32_t slot = ((pc >> 1) * 2654435761u) & (PROFILER_HIST_SLOTS - 1);
+
+    for (int probe = 0; probe < PROFILER_HIST_MAX_PROBE; probe++) {
+        sampling_profiler_entry_t *entry = &s_hist[slot];
+        if (entry->pc == pc) {
+            entry->count++;
+            return;
+        }
+        if (entry->pc == 0) {
+            entry->pc = pc;
+            entry->count = 1;
+            s_entry_count++;
+            return;
+        }
+        slot = (slot + 1) & (PROFILER_HIST_SLOTS - 1);
+    }
+
+    s_dropped_samples++;
+}
+
+// 定时器中断回调
+static bool IRAM_ATTR profiler_timer_cb(gptimer_handle_t timer, const gptimer_alarm_event_data_t *edata, void *user_ctx)
+{
+    TaskHandle_t task = xTaskGetCurrentTaskHandleForCore(s_sample_core);
+    uint32_t pc = get_interrupted_pc(task);
+
+    s_total_samples++;
+    if (task == s_idle_task) {
+        s_idle_samples++;
+    }
+
+    if (pc != 0) {
+        hist_record(pc);
+    } else {
+        s_dropped_samples++;
+    }
+
+    return false;
+}
+
+esp_err_t sampling_profiler_start(uint32_t rate_hz)
+{
+    if (s_timer != NULL) {
+        ESP_LOGW(TAG, "采样已在运行");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (rate_hz == 0) {
+        rate_hz = PROFILER_DEFAULT_RATE_HZ;
+    }
+    if (rate_hz < PROFILER_MIN_RATE_HZ || rate_hz > PROFILER_MAX_RATE_HZ) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (s_hist == NULL) {
+        s_hist = heap_caps_calloc(PROFILER_HIST_SLOTS, sizeof(sampling_profiler_entry_t),
+                                  MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        if (s_hist == NULL) {
+            ESP_LOGE(TAG, "直方图内存分配失败");
+            return ESP_ERR_NO_MEM;
+        }
+    } else {
+        memset(s_hist, 0, PROFILER_HIST_SLOTS * sizeof(sampling_profiler_entry_t));
+    }
+
+    s_total_samples = 0;
+    s_idle_samples = 0;
+    s_dropped_samples = 0;
+    s_entry_count = 0;
+    s_rate_hz = rate_hz;
+
+    // 定时器中断在创建它的核心上运行，只对该核心采样
+    s_sample_core = esp_cpu_get_core_id();
+    s_idle_task = xTaskGetIdleTaskHandleForCore(s_sample_core);
+
+    gptimer_config_t timer_config = {
+        .clk_src = GPTIMER_CLK_SRC_DEFAULT,
+        .direction = GPTIMER_COUNT_UP,
+        .resolution_hz = PROFILER_TIMER_RESOLUTION,
+    };
+    esp_err_t ret = gptimer_new_timer(&timer_config, &s_timer);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "创建采样定时器失败: %s", esp_err_to_name(ret));
+        s_timer = NULL;
+        return ret;
+    }
+
+    gptimer_event_callbacks_t cbs = {
+        .on_alarm = profiler_timer_cb,
+    };
+    gptimer_alarm_config_t alarm_config = {
+        .reload_count = 0,
+        .alarm_count = PROFILER_TIMER_RESOLUTION / rate_hz,
+        .flags.auto_reload_on_alarm = true,
+    };
+
+    ret = gptimer_register_event_callbacks(s_timer, &cbs, NULL);
+    if (ret == ESP_OK) {
+        ret = gptimer_enable(s_timer);
+    }
+    if (ret == ESP_OK) {
+        ret = gptimer_set_alarm_action(s_timer, &alarm_config);
+    }
+    if (ret == ESP_OK) {
+        s_start_time_us = esp_timer_get_time();
+        s_stop_time_us = 0;
+        ret = gptimer_start(s_timer);
+    }
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "启动采样定时器失败: %s", esp_err_to_name(ret));
+        gptimer_disable(s_timer);
+        gptimer_del_timer(s_timer);
+        s_timer = NULL;
+        return ret;
+    }
+
+    ESP_LOGI(TAG, "开始采样，频率 %lu Hz，核心 %d", (unsigned long)rate_hz, s_sample_core);
+    return ESP_OK;
+}
+
+esp_err_t sampling_profiler_stop(void)
+{
+    if (s_timer == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    gptimer_stop(s_timer);
+    gptimer_disable(s_timer);
+    gptimer_del_timer(s_timer);
+    s_timer = NULL;
+    s_stop_time_us = esp_timer_get_time();
+
+    ESP_LOGI(TAG, "采样停止 - 总采样: %lu, IDLE: %lu, 丢弃: %lu, 条目: %lu",
+             (unsigned long)s_total_samples, (unsigned long)s_idle_samples,
+             (unsigned long)s_dropped_samples, (unsigned long)s_entry_count);
+    return ESP_OK;
+}
+
+void sampling_profiler_get_stats(sampling_profiler_stats_t *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+
+    int64_t end_us = s_timer != NULL ? esp_timer_get_time() : s_stop_time_us;
+
+    stats->running = s_timer != NULL;
+    stats->sample_rate_hz = s_rate_hz;
+    stats->duration_ms = s_start_time_us > 0 ? (uint32_t)((end_us - s_start_time_us) / 1000) : 0;
+    stats->total_samples = s_total_samples;
+    stats->idle_samples = s_idle_samples;
+    stats->dropped_samples = s_dropped_samples;
+    stats->entry_count = s_entry_count;
+}
+
+size_t sampling_profiler_export_size(void)
+{
+    return sizeof(sampling_profiler_header_t) + s_entry_count * sizeof(sampling_profiler_entry_t);
+}
+
+esp_err_t sampling_profiler_export(sampling_profiler_write_fn_t write_fn, void *ctx)
+{
+    if (write_fn == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_timer != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (s_hist == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    sampling_profiler_stats_t stats;
+    sampling_profiler_get_stats(&stats);
+
+    sampling_profiler_header_t header = {
+        .magic = SAMPLING_PROFILER_MAGIC,
+        .version = SAMPLING_PROFILER_VERSION,
+        .entry_size = sizeof(sampling_profiler_entry_t),
+        .sample_rate_hz = stats.sample_rate_hz,
+        .duration_ms = stats.duration_ms,
+        .total_samples = stats.total_samples,
+        .idle_samples = stats.idle_samples,
+        .dropped_samples = stats.dropped_samples,
+        .entry_count = stats.entry_count,
+    };
+
+    esp_err_t ret = write_fn(ctx, &header, sizeof(header));
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    // 逐批写出非空条目，避免额外分配
+    sampling_profiler_entry_t batch[32];
+    size_t batch_len = 0;
+
+    for (size_t i = 0; i < PROFILER_HIST_SLOTS; i++) {
+        if (s_hist[i].pc == 0) {
+            continue;
+        }
+        batch[batch_len++] = s_hist[i];
+        if (batch_len == sizeof(batch) / sizeof(batch[0])) {
+            ret = write_fn(ctx, batch, sizeof(batch));
+            if (ret != ESP_OK) {
+                return ret;
+            }
+            batch_len = 0;
+        }
+    }
+
+    if (batch_len > 0) {
+        ret = write_fn(ctx, batch, batch_len * sizeof(sampling_profiler_entry_t));
+    }
+
+    return ret;
+}
@@ -2,11 +2,18 @@
 #define SERVO_CONTROL_H
 
 #include "esp_err.h"
+#include <stdint.h>
 
-// 初始化舵机控制
+// 初始化舵机控制（执行器表中的所有舵机和GPIO脉冲输出）
 esp_err_t servo_control_init(void);
 
-// 按下电源按钮（执行舵机按下动作）
+// 执行器数量
+uint8_t servo_control_actuator_count(void);
+
+// 用指定执行器按下电源按钮，下标超出范围时返回ESP_ERR_INVALID_ARG
+esp_err_t servo_control_press(uint8_t actuator);
+
+// 按下电源按钮（执行器0）
 esp_err_t servo_press_power_button(void);
 
 #endif /* SERVO_CONTROL_H */ 
\ No newline at end of file
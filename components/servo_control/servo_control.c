@@ -1,16 +1,18 @@
 #include "servo_control/servo_control.h"
 #include "esp_log.h"
+#include "driver/gpio.h"
 #include "driver/ledc.h"
+#include "pm_lock/pm_lock.h"
+#include "sdkconfig.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
 static const char *TAG = "servo_control";
 
 // 舵机PWM配置
-#define SERVO_PWM_PIN              5  // GPIO5用于控制舵机
+#define SERVO_PWM_PIN              5  // GPIO5用于控制默认舵机
 #define LEDC_TIMER                 LEDC_TIMER_0
 #define LEDC_MODE                  LEDC_LOW_SPEED_MODE
-#define LEDC_CHANNEL               LEDC_CHANNEL_0
 #define LEDC_DUTY_RESOLUTION       LEDC_TIMER_13_BIT  // 13位分辨率, 0-8191
 #define LEDC_FREQUENCY             50   // 50Hz PWM频率，适合大多数舵机
 
@@ -21,7 +23,27 @@ static const char *TAG = "servo_control";
 // 舵机按压时间配置
 #define SERVO_PRESS_TIME_MS        100   // 按下时间(毫秒) - 优化为100ms，减少响应延迟
 
-esp_err_t servo_control_init(void)
+// 执行器类型
+typedef enum {
+    SERVO_ACTUATOR_LEDC = 0,    // 舵机，LEDC通道输出PWM，所有舵机共用一个50Hz定时器
+    SERVO_ACTUATOR_GPIO_PULSE,  // GPIO脉冲，例如通过光耦直接短接主板的电源开关针脚
+} servo_actuator_type_t;
+
+typedef struct {
+    servo_actuator_type_t type;
+    uint8_t gpio;
+    uint8_t ledc_channel;       // LEDC执行器使用的通道
+    bool active_high;           // GPIO脉冲执行器的有效电平
+} servo_actuator_t;
+
+// 执行器表，pc_monitor的机器表按下标引用
+static const servo_actuator_t s_actuators[] = {
+    { SERVO_ACTUATOR_LEDC, SERVO_PWM_PIN, LEDC_CHANNEL_0, false },
+};
+
+#define SERVO_ACTUATOR_COUNT (sizeof(s_actuators) / sizeof(s_actuators[0]))
+
+static esp_err_t init_ledc_timer(void)
 {
     // 配置LEDC定时器
     ledc_timer_config_t ledc_timer = {
@@ -29,61 +51,117 @@ esp_err_t servo_control_init(void)
         .freq_hz = LEDC_FREQUENCY,
         .speed_mode = LEDC_MODE,
         .timer_num = LEDC_TIMER,
+#if CONFIG_PM_ENABLE
+        // 动态调频会改变APB时钟，使用不随调频变化的REF_TICK保证脉宽稳定
+        .clk_cfg = LEDC_USE_REF_TICK,
+#else
         .clk_cfg = LEDC_AUTO_CLK,
+#endif
     };
-    
+
     esp_err_t ret = ledc_timer_config(&ledc_timer);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "LEDC定时器配置失败: %d", ret);
         return ret;
     }
-    
+
+    // 安装LEDC渐变功能
+    ret = ledc_fade_func_install(0);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "LEDC渐变功能安装失败: %d", ret);
+        return ret;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t init_ledc_actuator(const servo_actuator_t *actuator)
+{
     // 配置LEDC通道
     ledc_channel_config_t ledc_channel = {
-        .channel    = LEDC_CHANNEL,
+        .channel    = actuator->ledc_channel,
         .duty       = SERVO_INIT_DUTY,
-        .gpio_num   = SERVO_PWM_PIN,
+        .gpio_num   = actuator->gpio,
         .speed_mode = LEDC_MODE,
         .timer_sel  = LEDC_TIMER,
         .hpoint     = 0,
     };
-    
-    ret = ledc_channel_config(&ledc_channel);
+
+    esp_err_t ret = ledc_channel_config(&ledc_channel);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "LEDC通道配置失败: %d", ret);
         return ret;
     }
-    
-    // 安装LEDC渐变功能
-    ret = ledc_fade_func_install(0);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "LEDC渐变功能安装失败: %d", ret);
-        return ret;
-    }
-    
+
     // 初始化舵机位置
-    ret = ledc_set_duty(LEDC_MODE, LEDC_CHANNEL, SERVO_INIT_DUTY);
+    ret = ledc_set_duty(LEDC_MODE, actuator->ledc_channel, SERVO_INIT_DUTY);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "设置LEDC占空比失败: %d", ret);
         return ret;
     }
-    
-    ret = ledc_update_duty(LEDC_MODE, LEDC_CHANNEL);
+
+    ret = ledc_update_duty(LEDC_MODE, actuator->ledc_channel);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "更新LEDC占空比失败: %d", ret);
         return ret;
     }
-    
-    ESP_LOGI(TAG, "舵机控制初始化完成");
     return ESP_OK;
 }
 
-esp_err_t servo_press_power_button(void)
+static esp_err_t init_gpio_actuator(const servo_actuator_t *actuator)
 {
-    ESP_LOGI(TAG, "执行按下电源按钮动作");
+    // 先设为无效电平再切换为输出，避免上电时误触发
+    gpio_set_level(actuator->gpio, actuator->active_high ? 0 : 1);
+    gpio_config_t io_conf = {
+        .pin_bit_mask = (1ULL << actuator->gpio),
+        .mode = GPIO_MODE_OUTPUT,
+        .pull_up_en = GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_DISABLE
+    };
+    esp_err_t ret = gpio_config(&io_conf);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "GPIO%d配置失败: %d", actuator->gpio, ret);
+        return ret;
+    }
+    return gpio_set_level(actuator->gpio, actuator->active_high ? 0 : 1);
+}
 
+esp_err_t servo_control_init(void)
+{
+    bool timer_ready = false;
+    for (size_t i = 0; i < SERVO_ACTUATOR_COUNT; i++) {
+        const servo_actuator_t *actuator = &s_actuators[i];
+        esp_err_t ret;
+        if (actuator->type == SERVO_ACTUATOR_LEDC) {
+            if (!timer_ready) {
+                ret = init_ledc_timer();
+                if (ret != ESP_OK) {
+                    return ret;
+                }
+                timer_ready = true;
+            }
+            ret = init_ledc_actuator(actuator);
+        } else {
+            ret = init_gpio_actuator(actuator);
+        }
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+
+    ESP_LOGI(TAG, "舵机控制初始化完成，%d 个执行器", (int)SERVO_ACTUATOR_COUNT);
+    return ESP_OK;
+}
+
+uint8_t servo_control_actuator_count(void)
+{
+    return (uint8_t)SERVO_ACTUATOR_COUNT;
+}
+
+static esp_err_t press_ledc(const servo_actuator_t *actuator)
+{
     // 快速设置舵机到按下位置
-    esp_err_t ret = ledc_set_duty_and_update(LEDC_MODE, LEDC_CHANNEL, SERVO_PRESS_DUTY, 0);
+    esp_err_t ret = ledc_set_duty_and_update(LEDC_MODE, actuator->ledc_channel, SERVO_PRESS_DUTY, 0);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "设置舵机按下位置失败: %d", ret);
         return ret;
@@ -95,12 +173,47 @@ esp_err_t servo_press_power_button(void)
     vTaskDelay(SERVO_PRESS_TIME_MS / portTICK_PERIOD_MS);
 
     // 快速返回到初始位置
-    ret = ledc_set_duty_and_update(LEDC_MODE, LEDC_CHANNEL, SERVO_INIT_DUTY, 0);
+    ret = ledc_set_duty_and_update(LEDC_MODE, actuator->ledc_channel, SERVO_INIT_DUTY, 0);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "设置舵机初始位置失败: %d", ret);
+    }
+    return ret;
+}
+
+static esp_err_t press_gpio(const servo_actuator_t *actuator)
+{
+    esp_err_t ret = gpio_set_level(actuator->gpio, actuator->active_high ? 1 : 0);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "GPIO%d输出失败: %d", actuator->gpio, ret);
         return ret;
     }
 
-    ESP_LOGI(TAG, "电源按钮按下动作完成，总耗时约 %d ms", SERVO_PRESS_TIME_MS + 20);
-    return ESP_OK;
-}
\ No newline at end of file
+    // 与舵机相同的按下时间
+    vTaskDelay(SERVO_PRESS_TIME_MS / portTICK_PERIOD_MS);
+    return gpio_set_level(actuator->gpio, actuator->active_high ? 0 : 1);
+}
+
+esp_err_t servo_control_press(uint8_t actuator)
+{
+    if (actuator >= SERVO_ACTUATOR_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    ESP_LOGI(TAG, "执行器%d执行按下电源按钮动作", actuator);
+
+    // 动作期间保持最高频率，不进入浅睡眠
+    pm_lock_acquire(PM_LOCK_SERVO);
+    const servo_actuator_t *entry = &s_actuators[actuator];
+    esp_err_t ret = entry->type == SERVO_ACTUATOR_LEDC ? press_ledc(entry) : press_gpio(entry);
+    pm_lock_release(PM_LOCK_SERVO);
+
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "电源按钮按下动作完成，总耗时约 %d ms", SERVO_PRESS_TIME_MS + 20);
+    }
+    return ret;
+}
+
+esp_err_t servo_press_power_button(void)
+{
+    return servo_control_press(0);
+}
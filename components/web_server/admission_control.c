@@ -0,0 +1,120 @@
+#include "admission_control.h"
+#include "conn_manager.h"
+#include "pm_lock/pm_lock.h"
+#include "wifi_manager/wifi_manager.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+
+static const char *TAG = "admission";
+
+// 各分类的准入条件：最大连续空闲块、总空闲内存
+// 只按内存拒绝：esp_http_server在单个任务中逐个处理请求，同一时刻最多一个请求在处理，
+// 按分类限制并发数永远不会触发；并发连接数由conn_manager按来源IP和连接表大小限制
+typedef struct {
+    size_t min_largest_block;
+    size_t min_free_heap;
+    const char *retry_after;
+} admission_policy_t;
+
+static const admission_policy_t s_policies[ADMISSION_CLASS_COUNT] = {
+    [ADMISSION_CLASS_CRITICAL] = { 0,         0,         "1" },
+    [ADMISSION_CLASS_NORMAL]   = { 6 * 1024,  16 * 1024, "2" },
+    [ADMISSION_CLASS_LOW]      = { 12 * 1024, 32 * 1024, "5" },
+};
+
+static const char *s_class_names[ADMISSION_CLASS_COUNT] = {
+    [ADMISSION_CLASS_CRITICAL] = "critical",
+    [ADMISSION_CLASS_NORMAL]   = "normal",
+    [ADMISSION_CLASS_LOW]      = "low",
+};
+
+static admission_stats_t s_stats[ADMISSION_CLASS_COUNT];
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+bool admission_try_enter(admission_class_t cls)
+{
+    if (cls >= ADMISSION_CLASS_COUNT) {
+        return false;
+    }
+
+    const admission_policy_t *policy = &s_policies[cls];
+    bool heap_ok = true;
+
+    // 关键请求不做内存检查，保证开机和状态查询始终可用
+    if (policy->min_largest_block > 0 || policy->min_free_heap > 0) {
+        size_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+        size_t free_heap = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+        heap_ok = largest >= policy->min_largest_block && free_heap >= policy->min_free_heap;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    if (heap_ok) {
+        s_stats[cls].admitted++;
+    } else {
+        s_stats[cls].shed_heap++;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    return heap_ok;
+}
+
+esp_err_t admission_send_shed(httpd_req_t *req, admission_class_t cls)
+{
+    ESP_LOGW(TAG, "负载保护，拒绝%s请求: %s (空闲内存: %u, 最大块: %u)",
+             admission_class_name(cls), req->uri,
+             (unsigned)heap_caps_get_free_size(MALLOC_CAP_8BIT),
+             (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+
+    // 使用静态字符串，拒绝路径上不再分配内存
+    httpd_resp_set_status(req, "503 Service Unavailable");
+    httpd_resp_set_hdr(req, "Retry-After", s_policies[cls < ADMISSION_CLASS_COUNT ? cls : ADMISSION_CLASS_LOW].retry_after);
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"服务器繁忙，请稍后重试\"}");
+}
+
+esp_err_t admission_dispatch(httpd_req_t *req)
+{
+    const admission_route_t *route = (const admission_route_t *)req->user_ctx;
+    if (route == NULL || route->handler == NULL) {
+        return httpd_resp_send_500(req);
+    }
+
+    // 请求到达时退出省电模式，同一页面的后续请求不再等待休眠唤醒
+    if (!route->passive) {
+        wifi_manager_power_notify_request();
+    }
+
+    // 处理期间保持最高CPU频率
+    pm_lock_acquire(PM_LOCK_HTTPD);
+
+    // 先按来源IP限流，再检查内存
+    esp_err_t ret;
+    if (!conn_manager_on_request(req, route->cls == ADMISSION_CLASS_CRITICAL)) {
+        ret = conn_manager_send_limited(req);
+    } else if (!admission_try_enter(route->cls)) {
+        ret = admission_send_shed(req, route->cls);
+    } else {
+        ret = route->handler(req);
+    }
+
+    pm_lock_release(PM_LOCK_HTTPD);
+    return ret;
+}
+
+void admission_get_stats(admission_class_t cls, admission_stats_t *stats)
+{
+    if (cls >= ADMISSION_CLASS_COUNT || stats == NULL) {
+        return;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    *stats = s_stats[cls];
+    portEXIT_CRITICAL(&s_lock);
+}
+
+const char *admission_class_name(admission_class_t cls)
+{
+    return cls < ADMISSION_CLASS_COUNT ? s_class_names[cls] : "unknown";
+}
@@ -0,0 +1,45 @@
+#ifndef ADMISSION_CONTROL_H
+#define ADMISSION_CONTROL_H
+
+#include "esp_err.h"
+#include "esp_http_server.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// 请求优先级分类
+typedef enum {
+    ADMISSION_CLASS_CRITICAL = 0,  // 开机、状态、认证、WebSocket，始终放行
+    ADMISSION_CLASS_NORMAL,        // 其他API
+    ADMISSION_CLASS_LOW,           // 静态页面、WiFi扫描、Captive Portal探测
+    ADMISSION_CLASS_COUNT
+} admission_class_t;
+
+// 每个分类的统计
+typedef struct {
+    uint32_t admitted;        // 放行次数
+    uint32_t shed_heap;       // 因内存不足被拒绝次数
+} admission_stats_t;
+
+// 带分类的路由，作为httpd_uri_t的user_ctx使用
+typedef struct {
+    admission_class_t cls;
+    esp_err_t (*handler)(httpd_req_t *req);
+    bool passive;             // 不通知省电模块，请求在到达时的省电模式下处理（测量入站延迟用）
+} admission_route_t;
+
+// 统一的准入分发函数，注册为httpd_uri_t的handler
+esp_err_t admission_dispatch(httpd_req_t *req);
+
+// 按内存状况判断是否放行，返回false表示应拒绝该请求
+bool admission_try_enter(admission_class_t cls);
+
+// 发送503 Retry-After响应
+esp_err_t admission_send_shed(httpd_req_t *req, admission_class_t cls);
+
+// 获取分类统计
+void admission_get_stats(admission_class_t cls, admission_stats_t *stats);
+
+// 分类名称
+const char *admission_class_name(admission_class_t cls);
+
+#endif /* ADMISSION_CONTROL_H */
@@ -0,0 +1,283 @@
+#include "captive_portal.h"
+#include "conn_manager.h"
+#include "esp_log.h"
+#include "esp_event.h"
+#include "esp_netif.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "freertos/FreeRTOS.h"
+#include <string.h>
+
+static const char *TAG = "captive_portal";
+
+// 客户端表大小（AP最多4个客户端，留出余量给重新获取地址的设备）
+#define CAPTIVE_MAX_CLIENTS     8
+#define CAPTIVE_LOGIN_URL       "http://192.168.4.1/login"
+
+// 各系统的探测类型
+typedef enum {
+    PROBE_ANDROID = 0,      // /generate_204，期望204
+    PROBE_APPLE,            // /hotspot-detect.html，期望Success页面
+    PROBE_NCSI,             // /ncsi.txt，期望"Microsoft NCSI"
+    PROBE_CONNECTTEST,      // /connecttest.txt，期望"Microsoft Connect Test"
+    PROBE_OTHER,            // /wifi/cw.html、/mmtls/*等，返回204
+} probe_kind_t;
+
+// 预先构造的成功响应，发送时不做任何分配
+typedef struct {
+    const char *uri;
+    const char *status;
+    const char *type;
+    const char *body;
+    size_t body_len;
+} probe_response_t;
+
+#define CONST_BODY(s) s, sizeof(s) - 1
+
+static const char s_apple_success[] =
+    "<HTML><HEAD><TITLE>Success</TITLE></HEAD><BODY>Success</BODY></HTML>";
+static const char s_ncsi_success[] = "Microsoft NCSI";
+static const char s_connecttest_success[] = "Microsoft Connect Test";
+
+static const probe_response_t s_responses[] = {
+    [PROBE_ANDROID]     = { "/generate_204",        "204 No Content", "text/plain", NULL, 0 },
+    [PROBE_APPLE]       = { "/hotspot-detect.html", "200 OK", "text/html",  CONST_BODY(s_apple_success) },
+    [PROBE_NCSI]        = { "/ncsi.txt",            "200 OK", "text/plain", CONST_BODY(s_ncsi_success) },
+    [PROBE_CONNECTTEST] = { "/connecttest.txt",     "200 OK", "text/plain", CONST_BODY(s_connecttest_success) },
+    [PROBE_OTHER]       = { NULL,                   "204 No Content", "text/plain", NULL, 0 },
+};
+
+typedef struct {
+    uint32_t ip;                // 网络字节序，0表示空闲
+    uint8_t mac[6];
+    bool has_mac;
+    captive_state_t state;
+    uint32_t probes;
+    uint32_t probes_after_release;
+    int64_t last_seen_us;
+} captive_client_t;
+
+static captive_client_t s_clients[CAPTIVE_MAX_CLIENTS];
+static captive_stats_t s_stats;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static probe_kind_t classify_probe(const char *uri)
+{
+    for (int i = 0; i < PROBE_OTHER; i++) {
+        if (strcmp(uri, s_responses[i].uri) == 0) {
+            return (probe_kind_t)i;
+        }
+    }
+    return PROBE_OTHER;
+}
+
+static captive_client_t *find_client_locked(uint32_t ip)
+{
+    for (int i = 0; i < CAPTIVE_MAX_CLIENTS; i++) {
+        if (s_clients[i].ip == ip) {
+            return &s_clients[i];
+        }
+    }
+    return NULL;
+}
+
+// 查找或分配客户端条目，表满时淘汰最久未活动的条目
+static captive_client_t *get_client_locked(uint32_t ip, int64_t now)
+{
+    captive_client_t *client = find_client_locked(ip);
+    if (client != NULL) {
+        return client;
+    }
+
+    captive_client_t *victim = NULL;
+    for (int i = 0; i < CAPTIVE_MAX_CLIENTS; i++) {
+        if (s_clients[i].ip == 0) {
+            victim = &s_clients[i];
+            break;
+        }
+        if (victim == NULL || s_clients[i].last_seen_us < victim->last_seen_us) {
+            victim = &s_clients[i];
+        }
+    }
+
+    if (victim->ip != 0) {
+        s_stats.evictions++;
+    } else {
+        s_stats.clients++;
+    }
+
+    memset(victim, 0, sizeof(*victim));
+    victim->ip = ip;
+    victim->state = CAPTIVE_STATE_NEW;
+    victim->last_seen_us = now;
+    return victim;
+}
+
+static void clear_client_by_mac_locked(const uint8_t *mac)
+{
+    for (int i = 0; i < CAPTIVE_MAX_CLIENTS; i++) {
+        if (s_clients[i].ip != 0 && s_clients[i].has_mac && memcmp(s_clients[i].mac, mac, 6) == 0) {
+            memset(&s_clients[i], 0, sizeof(s_clients[i]));
+            if (s_stats.clients > 0) {
+                s_stats.clients--;
+            }
+        }
+    }
+}
+
+static void captive_event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+{
+    if (event_base == IP_EVENT && event_id == IP_EVENT_AP_STAIPASSIGNED) {
+        // DHCP分配地址时关联IP和MAC；同一MAC换了地址则丢弃旧状态
+        ip_event_ap_staipassigned_t *event = (ip_event_ap_staipassigned_t *)event_data;
+        portENTER_CRITICAL(&s_lock);
+        clear_client_by_mac_locked(event->mac);
+        captive_client_t *client = get_client_locked(event->ip.addr, esp_timer_get_time());
+        memcpy(client->mac, event->mac, 6);
+        client->has_mac = true;
+        portEXIT_CRITICAL(&s_lock);
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_AP_STADISCONNECTED) {
+        // 客户端离开AP后清除其门户状态，重新连接时需要再次登录
+        wifi_event_ap_stadisconnected_t *event = (wifi_event_ap_stadisconnected_t *)event_data;
+        portENTER_CRITICAL(&s_lock);
+        clear_client_by_mac_locked(event->mac);
+        portEXIT_CRITICAL(&s_lock);
+    }
+}
+
+esp_err_t captive_portal_init(void)
+{
+    static bool initialized = false;
+    if (initialized) {
+        return ESP_OK;
+    }
+
+    esp_err_t ret = esp_event_handler_register(IP_EVENT, IP_EVENT_AP_STAIPASSIGNED, captive_event_handler, NULL);
+    if (ret == ESP_OK) {
+        ret = esp_event_handler_register(WIFI_EVENT, WIFI_EVENT_AP_STADISCONNECTED, captive_event_handler, NULL);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "注册AP客户端事件失败: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    initialized = true;
+    return ESP_OK;
+}
+
+esp_err_t captive_portal_handle_probe(httpd_req_t *req)
+{
+    uint32_t ip = conn_manager_get_peer_ip(httpd_req_to_sockfd(req));
+    probe_kind_t kind = classify_probe(req->uri);
+    int64_t now = esp_timer_get_time();
+    bool released = false;
+    uint32_t probes = 0;
+
+    portENTER_CRITICAL(&s_lock);
+    // 取不到来源地址时不建立状态，按未登录处理
+    if (ip != 0) {
+        captive_client_t *client = get_client_locked(ip, now);
+        client->probes++;
+        client->last_seen_us = now;
+        released = client->state == CAPTIVE_STATE_RELEASED;
+        if (released) {
+            client->probes_after_release++;
+        } else {
+            client->state = CAPTIVE_STATE_REDIRECTED;
+        }
+        probes = client->probes;
+    }
+    if (released) {
+        s_stats.success_responses++;
+    } else {
+        s_stats.redirects++;
+    }
+    s_stats.probes++;
+    portEXIT_CRITICAL(&s_lock);
+
+    ESP_LOGD(TAG, "探测 %s 来自 " IPSTR "，第 %lu 次，%s", req->uri, IP2STR((esp_ip4_addr_t *)&ip),
+             (unsigned long)probes, released ? "返回成功" : "重定向");
+
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache, no-store, must-revalidate");
+
+    if (!released) {
+        // 未登录的客户端重定向到登录页面，触发系统弹出门户窗口
+        httpd_resp_set_status(req, "302 Found");
+        httpd_resp_set_hdr(req, "Location", CAPTIVE_LOGIN_URL);
+        return httpd_resp_send(req, NULL, 0);
+    }
+
+    // 已放行的客户端返回系统期望的成功响应，探测循环随之停止
+    const probe_response_t *resp = &s_responses[kind];
+    httpd_resp_set_status(req, resp->status);
+    httpd_resp_set_type(req, resp->type);
+    return httpd_resp_send(req, resp->body, resp->body_len);
+}
+
+void captive_portal_release(httpd_req_t *req)
+{
+    captive_portal_release_ip(conn_manager_get_peer_ip(httpd_req_to_sockfd(req)));
+}
+
+void captive_portal_release_ip(uint32_t ip)
+{
+    if (ip == 0) {
+        return;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    captive_client_t *client = get_client_locked(ip, esp_timer_get_time());
+    client->state = CAPTIVE_STATE_RELEASED;
+    portEXIT_CRITICAL(&s_lock);
+
+    ESP_LOGI(TAG, "客户端 " IPSTR " 已放行", IP2STR((esp_ip4_addr_t *)&ip));
+}
+
+void captive_portal_get_stats(captive_stats_t *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+    portENTER_CRITICAL(&s_lock);
+    *stats = s_stats;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+size_t captive_portal_snapshot(captive_client_info_t *out, size_t max_entries)
+{
+    if (out == NULL) {
+        return 0;
+    }
+
+    int64_t now = esp_timer_get_time();
+    size_t count = 0;
+
+    portENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < CAPTIVE_MAX_CLIENTS && count < max_entries; i++) {
+        const captive_client_t *client = &s_clients[i];
+        if (client->ip == 0) {
+            continue;
+        }
+        captive_client_info_t *info = &out[count++];
+        info->ip = client->ip;
+        memcpy(info->mac, client->mac, 6);
+        info->has_mac = client->has_mac;
+        info->state = client->state;
+        info->probes = client->probes;
+        info->probes_after_release = client->probes_after_release;
+        info->idle_ms = (uint32_t)((now - client->last_seen_us) / 1000);
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    return count;
+}
+
+const char *captive_portal_state_name(captive_state_t state)
+{
+    switch (state) {
+        case CAPTIVE_STATE_NEW: return "new";
+        case CAPTIVE_STATE_REDIRECTED: return "redirected";
+        case CAPTIVE_STATE_RELEASED: return "released";
+        default: return "unknown";
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef CAPTIVE_PORTAL_H
+#define CAPTIVE_PORTAL_H
+
+#include "esp_err.h"
+#include "esp_http_server.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// 客户端门户状态
+typedef enum {
+    CAPTIVE_STATE_NEW = 0,      // 尚未被重定向
+    CAPTIVE_STATE_REDIRECTED,   // 已重定向到登录页面，等待登录或配网
+    CAPTIVE_STATE_RELEASED,     // 已登录或完成配网，探测返回成功响应
+} captive_state_t;
+
+// 单个客户端的快照
+typedef struct {
+    uint32_t ip;                // 网络字节序
+    uint8_t mac[6];
+    bool has_mac;
+    captive_state_t state;
+    uint32_t probes;            // 探测总次数
+    uint32_t probes_after_release; // 放行后仍收到的探测次数
+    uint32_t idle_ms;           // 距上次探测的时间
+} captive_client_info_t;
+
+// 全局统计
+typedef struct {
+    uint32_t probes;
+    uint32_t redirects;
+    uint32_t success_responses;
+    uint32_t evictions;         // 客户端表满时被淘汰的条目数
+    uint16_t clients;
+} captive_stats_t;
+
+// 注册AP客户端上下线事件，用于关联MAC地址和清理状态
+esp_err_t captive_portal_init(void);
+
+// 处理探测请求，注册为检测URL的处理函数
+esp_err_t captive_portal_handle_probe(httpd_req_t *req);
+
+// 登录或配网成功后放行发起请求的客户端
+void captive_portal_release(httpd_req_t *req);
+
+// 按地址放行客户端（异步配网完成时请求已经结束）
+void captive_portal_release_ip(uint32_t ip);
+
+// 获取统计
+void captive_portal_get_stats(captive_stats_t *stats);
+
+// 获取客户端表快照，返回写入的条目数
+size_t captive_portal_snapshot(captive_client_info_t *out, size_t max_entries);
+
+// 状态名称
+const char *captive_portal_state_name(captive_state_t state);
+
+#endif /* CAPTIVE_PORTAL_H */
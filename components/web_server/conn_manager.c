@@ -0,0 +1,420 @@
+#include "conn_manager.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_netif.h"
+#include "freertos/FreeRTOS.h"
+#include "lwip/sockets.h"
+#include "sdkconfig.h"
+#include <string.h>
+
+static const char *TAG = "conn_manager";
+
+// 套接字配置（LWIP_MAX_SOCKETS=10，httpd内部占用3个）
+#define CONN_MAX_SOCKETS            7
+#define CONN_MAX_PER_IP             4       // 单个IP最多同时占用的连接数
+#define CONN_RECV_TIMEOUT_S         10
+#define CONN_SEND_TIMEOUT_S         10
+
+// 自适应空闲超时：连接表越满，空闲连接越早被关闭（WebSocket连接除外）
+#define CONN_IDLE_TIMEOUT_RELAXED_MS  30000  // 使用率不超过一半
+#define CONN_IDLE_TIMEOUT_BUSY_MS     10000  // 使用率超过一半
+#define CONN_IDLE_TIMEOUT_FULL_MS     3000   // 只剩一个空位或已满
+#define CONN_SWEEP_INTERVAL_MS        1000
+
+// 每IP令牌桶（令牌以千分之一为单位）
+#define RATE_TABLE_SIZE             8
+#define RATE_REQ_BURST              20      // 普通请求突发上限
+#define RATE_REQ_PER_SEC            5       // 普通请求每秒补充
+#define RATE_AUTH_BURST             5       // 登录尝试突发上限
+#define RATE_AUTH_REFILL_MS         20000   // 每20秒补充一次登录机会
+#define TOKEN_UNIT                  1000
+
+typedef struct {
+    int fd;
+    httpd_handle_t hd;
+    uint32_t ip;
+    int64_t opened_us;
+    int64_t last_active_us;
+    uint32_t requests;
+} conn_entry_t;
+
+typedef struct {
+    uint32_t ip;
+    int64_t last_seen_us;
+    int64_t req_refill_us;
+    int64_t auth_refill_us;
+    int32_t req_tokens;
+    int32_t auth_tokens;
+} rate_entry_t;
+
+static conn_entry_t s_conns[CONN_MAX_SOCKETS];
+static rate_entry_t s_rates[RATE_TABLE_SIZE];
+static conn_stats_t s_stats;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t s_sweep_timer = NULL;
+
+uint32_t conn_manager_get_peer_ip(int fd)
+{
+    struct sockaddr_storage addr;
+    socklen_t addr_len = sizeof(addr);
+
+    if (getpeername(fd, (struct sockaddr *)&addr, &addr_len) != 0) {
+        return 0;
+    }
+
+    if (addr.ss_family == AF_INET) {
+        return ((struct sockaddr_in *)&addr)->sin_addr.s_addr;
+    }
+#if CONFIG_LWIP_IPV6
+    if (addr.ss_family == AF_INET6) {
+        // IPv4客户端以IPv4映射地址(::ffff:a.b.c.d)出现
+        struct sockaddr_in6 *addr6 = (struct sockaddr_in6 *)&addr;
+        uint32_t ip;
+        memcpy(&ip, &addr6->sin6_addr.s6_addr[12], sizeof(ip));
+        return ip;
+    }
+#endif
+    return 0;
+}
+
+static conn_entry_t *find_conn_locked(int fd)
+{
+    for (int i = 0; i < CONN_MAX_SOCKETS; i++) {
+        if (s_conns[i].fd == fd) {
+            return &s_conns[i];
+        }
+    }
+    return NULL;
+}
+
+static uint32_t idle_timeout_ms_locked(void)
+{
+    if (s_stats.open + 1 >= CONN_MAX_SOCKETS) {
+        return CONN_IDLE_TIMEOUT_FULL_MS;
+    }
+    if (s_stats.open * 2 > CONN_MAX_SOCKETS) {
+        return CONN_IDLE_TIMEOUT_BUSY_MS;
+    }
+    return CONN_IDLE_TIMEOUT_RELAXED_MS;
+}
+
+// 查找或分配IP的令牌桶，表满时替换最久未见的条目
+static rate_entry_t *get_rate_entry_locked(uint32_t ip, int64_t now)
+{
+    rate_entry_t *oldest = &s_rates[0];
+
+    for (int i = 0; i < RATE_TABLE_SIZE; i++) {
+        if (s_rates[i].ip == ip) {
+            s_rates[i].last_seen_us = now;
+            return &s_rates[i];
+        }
+        if (s_rates[i].last_seen_us < oldest->last_seen_us) {
+            oldest = &s_rates[i];
+        }
+    }
+
+    oldest->ip = ip;
+    oldest->last_seen_us = now;
+    oldest->req_refill_us = now;
+    oldest->auth_refill_us = now;
+    oldest->req_tokens = RATE_REQ_BURST * TOKEN_UNIT;
+    oldest->auth_tokens = RATE_AUTH_BURST * TOKEN_UNIT;
+    return oldest;
+}
+
+static void refill_locked(rate_entry_t *rate, int64_t now)
+{
+    int64_t elapsed_ms = (now - rate->req_refill_us) / 1000;
+    if (elapsed_ms > 0) {
+        int64_t tokens = rate->req_tokens + elapsed_ms * RATE_REQ_PER_SEC;
+        rate->req_tokens = tokens > RATE_REQ_BURST * TOKEN_UNIT ? RATE_REQ_BURST * TOKEN_UNIT : (int32_t)tokens;
+        rate->req_refill_us = now;
+    }
+
+    elapsed_ms = (now - rate->auth_refill_us) / 1000;
+    if (elapsed_ms > 0) {
+        int64_t tokens = rate->auth_tokens + elapsed_ms * TOKEN_UNIT / RATE_AUTH_REFILL_MS;
+        if (tokens != rate->auth_tokens) {
+            rate->auth_tokens = tokens > RATE_AUTH_BURST * TOKEN_UNIT ? RATE_AUTH_BURST * TOKEN_UNIT : (int32_t)tokens;
+            rate->auth_refill_us = now;
+        }
+    }
+}
+
+static esp_err_t conn_open_fn(httpd_handle_t hd, int sockfd)
+{
+    uint32_t ip = conn_manager_get_peer_ip(sockfd);
+    int64_t now = esp_timer_get_time();
+    esp_err_t ret = ESP_OK;
+
+    portENTER_CRITICAL(&s_lock);
+    int same_ip = 0;
+    conn_entry_t *slot = NULL;
+    for (int i = 0; i < CONN_MAX_SOCKETS; i++) {
+        if (s_conns[i].fd < 0) {
+            if (slot == NULL) {
+                slot = &s_conns[i];
+            }
+        } else if (s_conns[i].ip == ip) {
+            same_ip++;
+        }
+    }
+
+    if (ip != 0 && same_ip >= CONN_MAX_PER_IP) {
+        s_stats.rejected_per_ip++;
+        ret = ESP_FAIL;
+    } else if (slot != NULL) {
+        slot->fd = sockfd;
+        slot->hd = hd;
+        slot->ip = ip;
+        slot->opened_us = now;
+        slot->last_active_us = now;
+        slot->requests = 0;
+        s_stats.open++;
+        s_stats.accepted++;
+        if (s_stats.open > s_stats.peak) {
+            s_stats.peak = s_stats.open;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "拒绝来自 " IPSTR " 的连接，已占用 %d 个连接", IP2STR((esp_ip4_addr_t *)&ip), same_ip);
+    }
+    return ret;
+}
+
+static void conn_close_fn(httpd_handle_t hd, int sockfd)
+{
+    portENTER_CRITICAL(&s_lock);
+    conn_entry_t *conn = find_conn_locked(sockfd);
+    if (conn != NULL) {
+        conn->fd = -1;
+        if (s_stats.open > 0) {
+            s_stats.open--;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    // 设置close_fn后需要自行关闭套接字
+    close(sockfd);
+}
+
+// 周期性关闭空闲连接
+static void conn_sweep_cb(void *arg)
+{
+    int64_t now = esp_timer_get_time();
+    int victims[CONN_MAX_SOCKETS];
+    httpd_handle_t victim_hds[CONN_MAX_SOCKETS];
+    int victim_count = 0;
+
+    portENTER_CRITICAL(&s_lock);
+    uint32_t idle_limit_ms = idle_timeout_ms_locked();
+    s_stats.idle_timeout_ms = idle_limit_ms;
+    for (int i = 0; i < CONN_MAX_SOCKETS; i++) {
+        if (s_conns[i].fd >= 0 && (now - s_conns[i].last_active_us) / 1000 > idle_limit_ms) {
+            victims[victim_count] = s_conns[i].fd;
+            victim_hds[victim_count] = s_conns[i].hd;
+            victim_count++;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    for (int i = 0; i < victim_count; i++) {
+        // WebSocket连接长期空闲是正常的，不做清理
+        if (httpd_ws_get_fd_info(victim_hds[i], victims[i]) == HTTPD_WS_CLIENT_WEBSOCKET) {
+            continue;
+        }
+        if (httpd_sess_trigger_close(victim_hds[i], victims[i]) == ESP_OK) {
+            portENTER_CRITICAL(&s_lock);
+            s_stats.idle_evicted++;
+            portEXIT_CRITICAL(&s_lock);
+            ESP_LOGD(TAG, "关闭空闲连接 fd=%d (超时 %lu ms)", victims[i], (unsigned long)idle_limit_ms);
+        }
+    }
+}
+
+void conn_manager_configure(httpd_config_t *config)
+{
+    static bool initialized = false;
+    if (!initialized) {
+        for (int i = 0; i < CONN_MAX_SOCKETS; i++) {
+            s_conns[i].fd = -1;
+        }
+        s_stats.max_sockets = CONN_MAX_SOCKETS;
+        s_stats.idle_timeout_ms = CONN_IDLE_TIMEOUT_RELAXED_MS;
+        initialized = true;
+    }
+
+    config->max_open_sockets = CONN_MAX_SOCKETS;
+    config->lru_purge_enable = true;          // 连接表满时由httpd关闭最久未使用的连接
+    config->recv_wait_timeout = CONN_RECV_TIMEOUT_S;
+    config->send_wait_timeout = CONN_SEND_TIMEOUT_S;
+    config->open_fn = conn_open_fn;
+    config->close_fn = conn_close_fn;
+}
+
+esp_err_t conn_manager_start(httpd_handle_t server)
+{
+    if (s_sweep_timer != NULL) {
+        return ESP_OK;
+    }
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = conn_sweep_cb,
+        .name = "conn_sweep",
+    };
+    esp_err_t ret = esp_timer_create(&timer_args, &s_sweep_timer);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "创建连接清理定时器失败: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    return esp_timer_start_periodic(s_sweep_timer, CONN_SWEEP_INTERVAL_MS * 1000);
+}
+
+void conn_manager_stop(httpd_handle_t server)
+{
+    portENTER_CRITICAL(&s_lock);
+    bool others_running = false;
+    for (int i = 0; i < CONN_MAX_SOCKETS; i++) {
+        if (s_conns[i].fd >= 0 && s_conns[i].hd == server) {
+            s_conns[i].fd = -1;
+            if (s_stats.open > 0) {
+                s_stats.open--;
+            }
+        } else if (s_conns[i].fd >= 0) {
+            others_running = true;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (!others_running && s_sweep_timer != NULL) {
+        esp_timer_stop(s_sweep_timer);
+        esp_timer_delete(s_sweep_timer);
+        s_sweep_timer = NULL;
+    }
+}
+
+bool conn_manager_on_request(httpd_req_t *req, bool critical)
+{
+    int fd = httpd_req_to_sockfd(req);
+    int64_t now = esp_timer_get_time();
+    bool allowed = true;
+
+    portENTER_CRITICAL(&s_lock);
+    conn_entry_t *conn = find_conn_locked(fd);
+    uint32_t ip = 0;
+    if (conn != NULL) {
+        conn->last_active_us = now;
+        conn->requests++;
+        ip = conn->ip;
+    }
+
+    // 关键请求（开机、状态）不消耗普通令牌，保证控制操作始终可达
+    if (!critical && ip != 0) {
+        rate_entry_t *rate = get_rate_entry_locked(ip, now);
+        refill_locked(rate, now);
+        if (rate->req_tokens >= TOKEN_UNIT) {
+            rate->req_tokens -= TOKEN_UNIT;
+        } else {
+            s_stats.rate_limited++;
+            allowed = false;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    return allowed;
+}
+
+bool conn_manager_auth_attempt(httpd_req_t *req)
+{
+    uint32_t ip = conn_manager_get_peer_ip(httpd_req_to_sockfd(req));
+    if (ip == 0) {
+        return true;
+    }
+
+    int64_t now = esp_timer_get_time();
+    bool allowed = false;
+
+    portENTER_CRITICAL(&s_lock);
+    rate_entry_t *rate = get_rate_entry_locked(ip, now);
+    refill_locked(rate, now);
+    if (rate->auth_tokens >= TOKEN_UNIT) {
+        rate->auth_tokens -= TOKEN_UNIT;
+        allowed = true;
+    } else {
+        s_stats.auth_limited++;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (!allowed) {
+        ESP_LOGW(TAG, "来自 " IPSTR " 的登录尝试过于频繁", IP2STR((esp_ip4_addr_t *)&ip));
+    }
+    return allowed;
+}
+
+void conn_manager_auth_succeeded(httpd_req_t *req)
+{
+    uint32_t ip = conn_manager_get_peer_ip(httpd_req_to_sockfd(req));
+    if (ip == 0) {
+        return;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    rate_entry_t *rate = get_rate_entry_locked(ip, esp_timer_get_time());
+    rate->auth_tokens = RATE_AUTH_BURST * TOKEN_UNIT;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+esp_err_t conn_manager_send_limited(httpd_req_t *req)
+{
+    httpd_resp_set_status(req, "429 Too Many Requests");
+    httpd_resp_set_hdr(req, "Retry-After", "5");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"请求过于频繁，请稍后重试\"}");
+}
+
+void conn_manager_get_stats(conn_stats_t *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    *stats = s_stats;
+    stats->idle_timeout_ms = idle_timeout_ms_locked();
+    portEXIT_CRITICAL(&s_lock);
+}
+
+size_t conn_manager_snapshot(conn_info_t *out, size_t max_entries)
+{
+    if (out == NULL) {
+        return 0;
+    }
+
+    int64_t now = esp_timer_get_time();
+    httpd_handle_t hds[CONN_MAX_SOCKETS];
+    size_t count = 0;
+
+    portENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < CONN_MAX_SOCKETS && count < max_entries; i++) {
+        if (s_conns[i].fd < 0) {
+            continue;
+        }
+        out[count].fd = s_conns[i].fd;
+        out[count].ip = s_conns[i].ip;
+        out[count].age_ms = (uint32_t)((now - s_conns[i].opened_us) / 1000);
+        out[count].idle_ms = (uint32_t)((now - s_conns[i].last_active_us) / 1000);
+        out[count].requests = s_conns[i].requests;
+        hds[count] = s_conns[i].hd;
+        count++;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    for (size_t i = 0; i < count; i++) {
+        out[i].websocket = httpd_ws_get_fd_info(hds[i], out[i].fd) == HTTPD_WS_CLIENT_WEBSOCKET;
+    }
+    return count;
+}
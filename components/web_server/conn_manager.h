@@ -0,0 +1,62 @@
+#ifndef CONN_MANAGER_H
+#define CONN_MANAGER_H
+
+#include "esp_err.h"
+#include "esp_http_server.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// 连接表统计
+typedef struct {
+    uint16_t open;              // 当前打开的连接数
+    uint16_t max_sockets;       // 连接表容量
+    uint16_t peak;              // 连接数峰值
+    uint32_t accepted;          // 接受的连接总数
+    uint32_t rejected_per_ip;   // 因单IP连接数超限被拒绝的连接数
+    uint32_t idle_evicted;      // 因空闲超时被关闭的连接数
+    uint32_t rate_limited;      // 被令牌桶限流的请求数
+    uint32_t auth_limited;      // 被限流的登录尝试数
+    uint32_t idle_timeout_ms;   // 当前自适应空闲超时
+} conn_stats_t;
+
+// 单个连接的快照
+typedef struct {
+    int fd;
+    uint32_t ip;                // 网络字节序
+    uint32_t age_ms;
+    uint32_t idle_ms;
+    uint32_t requests;
+    bool websocket;
+} conn_info_t;
+
+// 初始化连接管理器，在httpd_start之前调用，会设置config的open_fn/close_fn和套接字参数
+void conn_manager_configure(httpd_config_t *config);
+
+// httpd_start成功后调用，开始空闲连接清理
+esp_err_t conn_manager_start(httpd_handle_t server);
+
+// 停止空闲连接清理
+void conn_manager_stop(httpd_handle_t server);
+
+// 请求到达时调用：刷新连接活跃时间并按来源IP限流，返回false表示应拒绝
+bool conn_manager_on_request(httpd_req_t *req, bool critical);
+
+// 登录尝试限流（防暴力破解），返回false表示应拒绝
+bool conn_manager_auth_attempt(httpd_req_t *req);
+
+// 登录成功后重置该IP的登录令牌桶
+void conn_manager_auth_succeeded(httpd_req_t *req);
+
+// 发送429 Too Many Requests响应
+esp_err_t conn_manager_send_limited(httpd_req_t *req);
+
+// 获取请求来源的IPv4地址（网络字节序），失败返回0
+uint32_t conn_manager_get_peer_ip(int fd);
+
+// 获取统计
+void conn_manager_get_stats(conn_stats_t *stats);
+
+// 获取连接表快照，返回写入的条目数
+size_t conn_manager_snapshot(conn_info_t *out, size_t max_entries);
+
+#endif /* CONN_MANAGER_H */
@@ -0,0 +1,125 @@
+#include "json_stream.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+void json_stream_init(json_stream_t *js, json_stream_flush_t flush, void *ctx)
+{
+    js->flush = flush;
+    js->ctx = ctx;
+    js->err = ESP_OK;
+    js->len = 0;
+}
+
+static void flush_buffer(json_stream_t *js)
+{
+    if (js->len == 0 || js->err != ESP_OK) {
+        js->len = 0;
+        return;
+    }
+    js->err = js->flush(js->ctx, js->buf, js->len);
+    js->len = 0;
+}
+
+static void write_bytes(json_stream_t *js, const char *data, size_t len)
+{
+    while (len > 0 && js->err == ESP_OK) {
+        size_t space = sizeof(js->buf) - js->len;
+        if (space == 0) {
+            flush_buffer(js);
+            continue;
+        }
+        size_t n = len < space ? len : space;
+        memcpy(js->buf + js->len, data, n);
+        js->len += n;
+        data += n;
+        len -= n;
+    }
+}
+
+void json_stream_raw(json_stream_t *js, const char *text)
+{
+    write_bytes(js, text, strlen(text));
+}
+
+// 直接格式化到缓冲区剩余空间，放不下时先flush再格式化一次，从不截断
+void json_stream_printf(json_stream_t *js, const char *fmt, ...)
+{
+    if (js->err != ESP_OK) {
+        return;
+    }
+
+    va_list args;
+    va_start(args, fmt);
+    for (int attempt = 0; attempt < 2; attempt++) {
+        size_t space = sizeof(js->buf) - js->len;
+        va_list copy;
+        va_copy(copy, args);
+        int n = vsnprintf(js->buf + js->len, space, fmt, copy);
+        va_end(copy);
+        if (n < 0) {
+            js->err = ESP_FAIL;
+            break;
+        }
+        // vsnprintf还要写一个结束符
+        if ((size_t)n < space) {
+            js->len += (size_t)n;
+            break;
+        }
+        if (js->len == 0) {
+            // 单次输出超过整个缓冲区
+            js->err = ESP_ERR_INVALID_SIZE;
+            break;
+        }
+        flush_buffer(js);
+        if (js->err != ESP_OK) {
+            break;
+        }
+    }
+    va_end(args);
+}
+
+void json_stream_string(json_stream_t *js, const char *str)
+{
+    write_bytes(js, "\"", 1);
+
+    // 连续的无需转义字符一次写入
+    const char *run = str;
+    for (const char *p = str; *p != '\0'; p++) {
+        unsigned char c = (unsigned char)*p;
+        if (c != '"' && c != '\\' && c >= 0x20) {
+            continue;
+        }
+
+        write_bytes(js, run, p - run);
+        run = p + 1;
+
+        char esc[8];
+        switch (c) {
+            case '"':  write_bytes(js, "\\\"", 2); break;
+            case '\\': write_bytes(js, "\\\\", 2); break;
+            case '\n': write_bytes(js, "\\n", 2); break;
+            case '\r': write_bytes(js, "\\r", 2); break;
+            case '\t': write_bytes(js, "\\t", 2); break;
+            default:
+                snprintf(esc, sizeof(esc), "\\u%04x", c);
+                write_bytes(js, esc, 6);
+                break;
+        }
+    }
+    write_bytes(js, run, strlen(run));
+
+    write_bytes(js, "\"", 1);
+}
+
+void json_stream_key(json_stream_t *js, const char *key)
+{
+    json_stream_string(js, key);
+    write_bytes(js, ":", 1);
+}
+
+esp_err_t json_stream_flush(json_stream_t *js)
+{
+    flush_buffer(js);
+    return js->err;
+}
@@ -0,0 +1,40 @@
+#ifndef JSON_STREAM_H
+#define JSON_STREAM_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+// 流式JSON输出：写入固定大小的缓冲区，满了就交给flush函数（如HTTP分块发送），
+// 用于结构固定、条目较多的响应，避免先在堆上构建整棵cJSON树
+
+#define JSON_STREAM_BUF_SIZE 256
+
+typedef esp_err_t (*json_stream_flush_t)(void *ctx, const char *data, size_t len);
+
+typedef struct {
+    json_stream_flush_t flush;
+    void *ctx;
+    esp_err_t err;              // 第一次flush或格式化失败的错误，之后的写入全部忽略
+    size_t len;
+    char buf[JSON_STREAM_BUF_SIZE];
+} json_stream_t;
+
+void json_stream_init(json_stream_t *js, json_stream_flush_t flush, void *ctx);
+
+// 原样写入（调用者保证是合法的JSON片段）
+void json_stream_raw(json_stream_t *js, const char *text);
+
+// 格式化写入，单次输出须小于缓冲区大小，否则记录ESP_ERR_INVALID_SIZE，由json_stream_flush返回
+void json_stream_printf(json_stream_t *js, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+// 写入带引号并转义的字符串
+void json_stream_string(json_stream_t *js, const char *str);
+
+// "key":
+void json_stream_key(json_stream_t *js, const char *key);
+
+// 输出缓冲区剩余内容，返回整个过程中的第一个错误
+esp_err_t json_stream_flush(json_stream_t *js);
+
+#endif /* JSON_STREAM_H */
@@ -0,0 +1,19 @@
+#include "link_json.h"
+
+void link_json_write_sample(json_stream_t *js, const wifi_link_sample_t *sample)
+{
+    json_stream_printf(js, "{\"t\":%lu,\"rssi\":%d,\"channel\":%d,\"beacon_timeouts\":%d,"
+                       "\"retries\":%d,\"disconnects\":%d,",
+                       (unsigned long)sample->uptime_ms, sample->rssi, sample->channel,
+                       sample->beacon_timeouts, sample->retries, sample->disconnects);
+    json_stream_printf(js, "\"rx_bps\":%lu,\"tx_bps\":%lu}",
+                       (unsigned long)((uint64_t)sample->rx_bytes * 8000 / WIFI_LINK_SAMPLE_INTERVAL_MS),
+                       (unsigned long)((uint64_t)sample->tx_bytes * 8000 / WIFI_LINK_SAMPLE_INTERVAL_MS));
+}
+
+void link_json_write_trend(json_stream_t *js, const wifi_link_stats_t *stats)
+{
+    json_stream_printf(js, "\"trend\":{\"valid\":%s,\"rssi_avg\":%d,\"slope_per_min\":%d,\"predicted\":%d}",
+                       stats->trend_valid ? "true" : "false", stats->rssi_avg,
+                       stats->rssi_slope, stats->rssi_predicted);
+}
@@ -0,0 +1,15 @@
+#ifndef LINK_JSON_H
+#define LINK_JSON_H
+
+#include "json_stream.h"
+#include "wifi_manager/wifi_manager.h"
+
+// /api/wifi/link 和 link 主题WebSocket推送共用的链路JSON片段，不依赖httpd，可在主机上测试
+
+// 输出一个链路采样对象，字节数换算为比特率
+void link_json_write_sample(json_stream_t *js, const wifi_link_sample_t *sample);
+
+// 输出 "trend":{...}
+void link_json_write_trend(json_stream_t *js, const wifi_link_stats_t *stats);
+
+#endif /* LINK_JSON_H */
@@ -2,6 +2,15 @@
 #include "wifi_manager/wifi_manager.h"
 #include "pc_monitor/pc_monitor.h"
 #include "servo_control/servo_control.h"
+#include "sampling_profiler/sampling_profiler.h"
+#include "pm_lock/pm_lock.h"
+#include "i2c_bus/i2c_bus.h"
+#include "edge_capture/edge_capture.h"
+#include "admission_control.h"
+#include "conn_manager.h"
+#include "captive_portal.h"
+#include "json_stream.h"
+#include "link_json.h"
 
 // AP模式配置常量（与wifi_manager.c保持一致）
 #define DEFAULT_AP_SSID "ESP32开机助手"
@@ -17,9 +26,16 @@ static time_t session_created_time = 0;
 #include "esp_spiffs.h"
 #include "esp_random.h"
 #include "esp_wifi.h"
+#include "esp_heap_caps.h"
+#include "esp_event.h"
+#include "esp_netif.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "cJSON.h"
 #include "esp_http_server.h"
 #include <string.h>
+#include <stdlib.h>
 #include <fcntl.h>
 #include <stdbool.h>
 #include <errno.h>
@@ -33,6 +49,15 @@ static time_t session_created_time = 0;
 
 static const char *TAG = "web_server";
 
+// WiFi扫描接口：?fresh=1时可接受的最大结果年龄，以及等待新扫描的上限
+#define SCAN_FRESH_MAX_AGE_MS  3000
+#define SCAN_WAIT_TIMEOUT_MS   5000
+
+// WebSocket扫描进度消息的最大长度（10个网络，SSID全部需要转义时约4KB）
+#define WS_SCAN_MESSAGE_MAX    4608
+// WebSocket链路采样消息的最大长度（一个采样加趋势）
+#define WS_LINK_MESSAGE_MAX    384
+
 // Session管理函数
 static void generate_session_token(char *token, size_t length) {
     const char charset[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
@@ -125,13 +150,61 @@ static bool check_authentication(httpd_req_t *req) {
     return false;
 }
 
+// 服务器实例配置
+// 置1时AP配网和LAN控制使用两套独立的httpd实例：STA未联网时只运行精简的配网实例，
+// STA获得IP后切换为完整的LAN实例。esp_http_server不支持绑定到指定网卡地址，
+// 两个实例无法同时监听80端口，因此按STA状态分时运行
+#define WEB_SERVER_SPLIT_INSTANCES  0
+#define LAN_STACK_SIZE              8192
+#define LAN_TASK_PRIORITY           5
+#define LAN_MAX_URI_HANDLERS        40    // 当前完整路由表为36个
+#define PORTAL_STACK_SIZE           4096
+#define PORTAL_TASK_PRIORITY        4     // 低于LAN实例，探测洪泛不抢占其他任务
+#define PORTAL_MAX_SOCKETS          3
+#define PORTAL_MAX_URI_HANDLERS     20    // 当前配网路由为17个
+#define SWITCH_TO_LAN_DELAY_MS      3000  // 获得IP后等待配网页面拿到连接结果再切换
+#define SWITCH_TO_PORTAL_DELAY_MS   30000 // 断开后防抖，短暂掉线不切回配网实例
+#define SWITCH_RETRY_DELAY_MS       5000
+#define SWITCH_TASK_STACK_SIZE      3072
+#define SWITCH_TASK_PRIORITY        3
+
+typedef enum {
+    WEB_INSTANCE_NONE,
+    WEB_INSTANCE_PORTAL,
+    WEB_INSTANCE_LAN,
+} web_instance_t;
+
 // Web服务器句柄
 static httpd_handle_t s_server = NULL;
+static web_instance_t s_instance = WEB_INSTANCE_NONE;
+#if WEB_SERVER_SPLIT_INSTANCES
+static esp_timer_handle_t s_switch_timer = NULL;
+static TaskHandle_t s_switch_task = NULL;
+#endif
+
+static const char *instance_name(web_instance_t instance)
+{
+    switch (instance) {
+        case WEB_INSTANCE_PORTAL: return "配网";
+        case WEB_INSTANCE_LAN: return "LAN";
+        default: return "无";
+    }
+}
 
 // WebSocket客户端列表
 #define MAX_WS_CLIENTS 4
 static int s_ws_client_fds[MAX_WS_CLIENTS] = {-1, -1, -1, -1};
 
+// WebSocket推送主题，客户端通过 {"type":"subscribe","topic":"scan"} 订阅
+#define WS_TOPIC_PC_STATE  (1 << 0)    // 默认订阅
+#define WS_TOPIC_SCAN      (1 << 1)    // 渐进式WiFi扫描结果
+#define WS_TOPIC_LINK      (1 << 2)    // STA链路质量采样
+static uint8_t s_ws_client_topics[MAX_WS_CLIENTS];
+
+// 扫描进度、链路采样推送是否已排队，避免在httpd队列中堆积
+static volatile bool s_scan_push_pending = false;
+static volatile bool s_link_push_pending = false;
+
 // 用户认证相关常量
 #define AUTH_NVS_NAMESPACE "auth_config"
 #define AUTH_NVS_USERNAME_KEY "username"
@@ -139,15 +212,29 @@ static int s_ws_client_fds[MAX_WS_CLIENTS] = {-1, -1, -1, -1};
 #define DEFAULT_USERNAME "admin"
 #define DEFAULT_PASSWORD "admin"
 
+// WebSocket客户端数变化后通知省电策略（有客户端时不降到省电模式）
+static void ws_clients_changed(void)
+{
+    uint8_t count = 0;
+    for (int i = 0; i < MAX_WS_CLIENTS; i++) {
+        if (s_ws_client_fds[i] != -1) {
+            count++;
+        }
+    }
+    wifi_manager_power_set_ws_clients(count);
+}
+
 // 添加WebSocket客户端
 static void add_ws_client(int fd)
 {
     for (int i = 0; i < MAX_WS_CLIENTS; i++) {
         if (s_ws_client_fds[i] == -1) {
             s_ws_client_fds[i] = fd;
+            s_ws_client_topics[i] = WS_TOPIC_PC_STATE;
             break;
         }
     }
+    ws_clients_changed();
 }
 
 // 删除WebSocket客户端
@@ -159,29 +246,52 @@ static void remove_ws_client(int fd)
             break;
         }
     }
+    ws_clients_changed();
 }
 
-// 广播PC状态到WebSocket客户端
-static void broadcast_pc_state(pc_state_t state)
+// 设置WebSocket客户端订阅的主题
+static void set_ws_client_topic(int fd, uint8_t topic, bool subscribe)
 {
-    // 构建JSON消息
-    cJSON *root = cJSON_CreateObject();
-    cJSON_AddStringToObject(root, "event", "pc_state");
-    cJSON_AddBoolToObject(root, "is_on", state == PC_STATE_ON);
+    for (int i = 0; i < MAX_WS_CLIENTS; i++) {
+        if (s_ws_client_fds[i] == fd) {
+            if (subscribe) {
+                s_ws_client_topics[i] |= topic;
+            } else {
+                s_ws_client_topics[i] &= ~topic;
+            }
+            break;
+        }
+    }
+}
 
-    char *json_str = cJSON_Print(root);
-    if (json_str == NULL) {
-        ESP_LOGE(TAG, "创建JSON字符串失败");
-        cJSON_Delete(root);
-        return;
+// 是否有客户端订阅了指定主题
+static bool ws_topic_has_subscribers(uint8_t topic)
+{
+    for (int i = 0; i < MAX_WS_CLIENTS; i++) {
+        if (s_ws_client_fds[i] != -1 && (s_ws_client_topics[i] & topic)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 把消息发送给订阅了指定主题的WebSocket客户端，返回成功发送的客户端数
+static int ws_broadcast(uint8_t topic, const char *json_str)
+{
+    // 实例切换期间没有WebSocket客户端
+    httpd_handle_t server = s_server;
+    if (server == NULL) {
+        return 0;
     }
 
     // 统计活跃的WebSocket客户端数量
     int active_clients = 0;
+    bool removed = false;
+    pm_lock_acquire(PM_LOCK_WS);
 
-    // 发送到所有连接的客户端
+    // 发送到所有订阅的客户端
     for (int i = 0; i < MAX_WS_CLIENTS; i++) {
-        if (s_ws_client_fds[i] != -1) {
+        if (s_ws_client_fds[i] != -1 && (s_ws_client_topics[i] & topic)) {
             active_clients++;
             httpd_ws_frame_t ws_pkt;
             memset(&ws_pkt, 0, sizeof(httpd_ws_frame_t));
@@ -189,16 +299,52 @@ static void broadcast_pc_state(pc_state_t state)
             ws_pkt.len = strlen(json_str);
             ws_pkt.type = HTTPD_WS_TYPE_TEXT;
 
-            esp_err_t ret = httpd_ws_send_frame_async(s_server, s_ws_client_fds[i], &ws_pkt);
+            esp_err_t ret = httpd_ws_send_frame_async(server, s_ws_client_fds[i], &ws_pkt);
             if (ret != ESP_OK) {
                 ESP_LOGE(TAG, "发送WebSocket消息到客户端 %d 失败: %d", i, ret);
                 // 发送失败，可能客户端已断开，清除该客户端
                 s_ws_client_fds[i] = -1;
                 active_clients--;
+                removed = true;
             }
         }
     }
+    pm_lock_release(PM_LOCK_WS);
+    if (removed) {
+        ws_clients_changed();
+    }
+
+    return active_clients;
+}
+
+// 构建机器状态消息，machine缺省为0的旧页面只看机器0
+static cJSON *create_pc_state_json(uint8_t machine, pc_state_t state)
+{
+    pc_machine_info_t info;
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddStringToObject(root, "event", "pc_state");
+    cJSON_AddNumberToObject(root, "machine", machine);
+    if (pc_monitor_get_machine(machine, &info) == ESP_OK) {
+        cJSON_AddStringToObject(root, "name", info.name);
+    }
+    cJSON_AddBoolToObject(root, "is_on", state == PC_STATE_ON);
+    return root;
+}
+
+// 广播PC状态到WebSocket客户端
+static void broadcast_pc_state(uint8_t machine, pc_state_t state)
+{
+    // 构建JSON消息
+    cJSON *root = create_pc_state_json(machine, state);
+
+    char *json_str = cJSON_Print(root);
+    if (json_str == NULL) {
+        ESP_LOGE(TAG, "创建JSON字符串失败");
+        cJSON_Delete(root);
+        return;
+    }
 
+    int active_clients = ws_broadcast(WS_TOPIC_PC_STATE, json_str);
     ESP_LOGI(TAG, "状态变化广播完成，发送到 %d 个WebSocket客户端", active_clients);
 
     free(json_str);
@@ -206,13 +352,49 @@ static void broadcast_pc_state(pc_state_t state)
 }
 
 // PC状态变化回调（只在状态真正变化时被调用）
-static void pc_state_changed_cb(pc_state_t new_state)
+static void pc_state_changed_cb(uint8_t machine, pc_state_t new_state)
 {
-    ESP_LOGI(TAG, "PC状态发生变化，主动推送到WebSocket客户端: %s",
+    ESP_LOGI(TAG, "机器%d状态发生变化，主动推送到WebSocket客户端: %s", machine,
              new_state == PC_STATE_ON ? "开机" : "关机");
 
     // 广播新状态给WebSocket客户端
-    broadcast_pc_state(new_state);
+    broadcast_pc_state(machine, new_state);
+}
+
+// 机器ID查询参数：ID最多3位（pc_monitor的机器数是uint8_t），查询串留出缓存破坏参数等的余量
+#define MACHINE_QUERY_MAX_LEN   64
+#define MACHINE_ID_MAX_LEN      3
+
+// 请求中的机器ID（?machine=N，没有该参数时为0），无效时返回-1
+// 查询串或ID被截断时同样返回-1，不能退回到机器0，否则会按错机器的电源键
+static int get_machine_id(httpd_req_t *req)
+{
+    char query[MACHINE_QUERY_MAX_LEN + 1];
+    char id_str[MACHINE_ID_MAX_LEN + 1];
+    esp_err_t err = httpd_req_get_url_query_str(req, query, sizeof(query));
+    if (err == ESP_OK) {
+        err = httpd_query_key_value(query, "machine", id_str, sizeof(id_str));
+    }
+    if (err == ESP_ERR_NOT_FOUND) {
+        return 0;
+    }
+    if (err != ESP_OK) {
+        return -1;
+    }
+    char *end = NULL;
+    long id = strtol(id_str, &end, 10);
+    if (end == id_str || *end != '\0' || id < 0 || id >= pc_monitor_machine_count()) {
+        return -1;
+    }
+    return (int)id;
+}
+
+static esp_err_t send_unknown_machine(httpd_req_t *req)
+{
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_status(req, "404 Not Found");
+    httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"机器不存在\"}");
+    return ESP_OK;
 }
 
 // 初始化SPIFFS文件系统
@@ -356,7 +538,13 @@ static const char* backup_setup_html =
 "showStatus('正在连接...',false);"
 "fetch('/api/wifi/connect',{method:'POST',headers:{'Content-Type':'application/json'},body:JSON.stringify({ssid:ssid,password:password})})"
 ".then(response=>response.json()).then(data=>{"
-"if(data.success){showStatus('连接成功！设备将重启并连接到WiFi网络。',false);}else{showStatus('连接失败：'+(data.message||'未知错误'),true);}})"
+"if(!data.success){showStatus('连接失败：'+(data.message||'未知错误'),true);return;}"
+"let polls=0;"
+"const poll=()=>fetch(data.status_url).then(r=>r.json()).then(st=>{"
+"if(!st.done){if(++polls<60){setTimeout(poll,500);}return;}"
+"if(st.success){showStatus('连接成功！IP地址：'+st.ip,false);}else{showStatus('连接失败：'+(st.message||'未知错误'),true);}})"
+".catch(()=>{if(++polls<60){setTimeout(poll,1000);}});"
+"poll();})"
 ".catch(error=>{showStatus('请求失败，请重试',true);});});"
 "</script></body></html>";
 
@@ -630,12 +818,17 @@ static esp_err_t status_get_handler(httpd_req_t *req)
         return ESP_OK;
     }
 
-    // 获取当前PC状态
-    pc_state_t state = pc_monitor_get_state();
+    int machine = get_machine_id(req);
+    pc_machine_info_t info;
+    if (machine < 0 || pc_monitor_get_machine((uint8_t)machine, &info) != ESP_OK) {
+        return send_unknown_machine(req);
+    }
     
     // 构建JSON响应
     cJSON *root = cJSON_CreateObject();
-    cJSON_AddBoolToObject(root, "is_on", state == PC_STATE_ON);
+    cJSON_AddBoolToObject(root, "is_on", info.state == PC_STATE_ON);
+    cJSON_AddNumberToObject(root, "machine", machine);
+    cJSON_AddStringToObject(root, "name", info.name);
     
     char *json_str = cJSON_Print(root);
     httpd_resp_sendstr(req, json_str);
@@ -660,11 +853,14 @@ static esp_err_t power_post_handler(httpd_req_t *req)
         return ESP_OK;
     }
 
-    // 获取当前PC状态
-    pc_state_t state = pc_monitor_get_state();
+    int machine = get_machine_id(req);
+    pc_machine_info_t info;
+    if (machine < 0 || pc_monitor_get_machine((uint8_t)machine, &info) != ESP_OK) {
+        return send_unknown_machine(req);
+    }
     
     // 如果已经开机，则返回错误
-    if (state == PC_STATE_ON) {
+    if (info.state == PC_STATE_ON) {
         httpd_resp_set_type(req, "application/json");
         httpd_resp_set_status(req, "400 Bad Request");
         httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"PC已开机\"}");
@@ -672,12 +868,17 @@ static esp_err_t power_post_handler(httpd_req_t *req)
     }
     
     // 执行开机动作
-    esp_err_t ret = servo_press_power_button();
+    ESP_LOGI(TAG, "机器%d(%s)使用执行器%d", machine, info.name, info.actuator);
+    esp_err_t ret = servo_control_press(info.actuator);
     
     // 返回JSON响应
     httpd_resp_set_type(req, "application/json");
     
     if (ret == ESP_OK) {
+        // 等待PC状态变化期间不降到省电模式，状态推送不被休眠延迟
+        wifi_manager_power_notify_press();
+        // 按键后高频采样，尽快推送状态变化
+        pc_monitor_notify_activity();
         httpd_resp_sendstr(req, "{\"success\":true,\"message\":\"操作成功\"}");
     } else {
         httpd_resp_set_status(req, "500 Internal Server Error");
@@ -711,216 +912,835 @@ static const char* get_auth_mode_desc(wifi_auth_mode_t auth_mode) {
     }
 }
 
-// WiFi扫描API - 优化版
+// 信号强度百分比 (0-100%)
+static int get_signal_percent(int8_t rssi)
+{
+    if (rssi >= -50) return 100;
+    else if (rssi >= -60) return 80;
+    else if (rssi >= -70) return 60;
+    else if (rssi >= -80) return 40;
+    else return 20;
+}
+
+// 输出一个扫描到的网络对象
+static void write_network_json(json_stream_t *js, const wifi_ap_record_t *ap)
+{
+    // 基本信息
+    json_stream_raw(js, "{");
+    json_stream_key(js, "ssid");
+    json_stream_string(js, (const char *)ap->ssid);
+    json_stream_printf(js, ",\"rssi\":%d,\"channel\":%d,", ap->rssi, ap->primary);
+
+    // 附加信息
+    json_stream_key(js, "signal_strength");
+    json_stream_string(js, get_signal_strength_desc(ap->rssi));
+    json_stream_raw(js, ",");
+    json_stream_key(js, "auth_mode");
+    json_stream_string(js, get_auth_mode_desc(ap->authmode));
+    json_stream_printf(js, ",\"authmode\":%d,\"is_open\":%s,\"signal_percent\":%d}",
+                       ap->authmode, ap->authmode == WIFI_AUTH_OPEN ? "true" : "false",
+                       get_signal_percent(ap->rssi));
+}
+
+// 输出网络数组
+static void write_networks_json(json_stream_t *js, const wifi_ap_record_t *records, uint16_t count)
+{
+    json_stream_raw(js, "\"networks\":[");
+    for (uint16_t i = 0; i < count; i++) {
+        if (i > 0) {
+            json_stream_raw(js, ",");
+        }
+        write_network_json(js, &records[i]);
+    }
+    json_stream_raw(js, "]");
+}
+
+// 流式JSON输出到HTTP分块响应
+static esp_err_t http_chunk_flush(void *ctx, const char *data, size_t len)
+{
+    return httpd_resp_send_chunk((httpd_req_t *)ctx, data, len);
+}
+
+// WiFi扫描API - 从缓存直接流式输出，不构建cJSON树
 static esp_err_t wifi_scan_handler(httpd_req_t *req)
 {
     // 设置响应头
     httpd_resp_set_type(req, "application/json");
     httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
     httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
-    httpd_resp_set_hdr(req, "Connection", "close"); // 确保连接关闭
 
-    ESP_LOGI(TAG, "收到WiFi扫描请求");
-
-    // 记录内存使用情况
-    size_t free_heap = esp_get_free_heap_size();
-    size_t min_free_heap = esp_get_minimum_free_heap_size();
-    ESP_LOGI(TAG, "内存状态 - 可用: %d 字节, 最小可用: %d 字节", free_heap, min_free_heap);
+    // 默认直接返回缓存结果（过旧时后台刷新）；?fresh=1时结果超过3秒才等待新扫描
+    bool fresh = false;
+    char query[32];
+    char fresh_str[4];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        httpd_query_key_value(query, "fresh", fresh_str, sizeof(fresh_str)) == ESP_OK) {
+        fresh = strcmp(fresh_str, "1") == 0;
+    }
+
+    wifi_ap_record_t ap_records[WIFI_SCAN_MAX_RESULTS];
+    wifi_scan_info_t info;
+    esp_err_t scan_ret = wifi_manager_scan_get(ap_records, WIFI_SCAN_MAX_RESULTS,
+                                               fresh ? SCAN_FRESH_MAX_AGE_MS : UINT32_MAX,
+                                               SCAN_WAIT_TIMEOUT_MS, &info);
+    uint16_t ap_count = info.count;
+
+    ESP_LOGI(TAG, "WiFi扫描请求: fresh=%d, 结果 %d 个, 年龄 %lu ms, %s",
+             fresh, ap_count, (unsigned long)info.age_ms, esp_err_to_name(scan_ret));
+
+    const char *message = "扫描完成";
+    if (!info.valid) {
+        ESP_LOGW(TAG, "尚无WiFi扫描结果");
+        message = "WiFi扫描失败，请稍后重试";
+    } else if (ap_count == 0) {
+        message = "未发现WiFi网络，请检查周围是否有WiFi信号";
+    }
 
-    // 记录当前WiFi模式
-    wifi_mode_t current_mode;
-    esp_wifi_get_mode(&current_mode);
-    ESP_LOGI(TAG, "当前WiFi模式: %d", current_mode);
+    json_stream_t js;
+    json_stream_init(&js, http_chunk_flush, req);
+    json_stream_printf(&js, "{\"success\":%s,\"count\":%d,\"age_ms\":%lu,\"scanning\":%s,",
+                       info.valid ? "true" : "false", ap_count,
+                       (unsigned long)info.age_ms, info.scanning ? "true" : "false");
+    json_stream_key(&js, "message");
+    json_stream_string(&js, message);
+    json_stream_raw(&js, ",");
+    write_networks_json(&js, ap_records, ap_count);
+    json_stream_raw(&js, "}");
 
-    // 创建响应JSON对象
-    cJSON *root = cJSON_CreateObject();
-    if (root == NULL) {
-        ESP_LOGE(TAG, "创建JSON对象失败");
-        httpd_resp_send_500(req);
-        return ESP_FAIL;
+    esp_err_t ret = json_stream_flush(&js);
+    if (ret == ESP_OK) {
+        ret = httpd_resp_send_chunk(req, NULL, 0);
     }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "发送HTTP响应失败: %s", esp_err_to_name(ret));
+    }
+
+    return ret;
+}
 
-    ESP_LOGI(TAG, "开始执行WiFi扫描...");
+// 扫描进度消息缓冲区（WebSocket帧需要完整消息）
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} ws_message_t;
 
-    // 执行WiFi扫描
-    uint16_t ap_count = 0;
-    wifi_ap_record_t *ap_records = wifi_manager_scan_networks(&ap_count);
-    bool need_free_records = false; // 标记是否需要释放ap_records
+static esp_err_t ws_message_append(void *ctx, const char *data, size_t len)
+{
+    ws_message_t *msg = (ws_message_t *)ctx;
+    if (msg->len + len >= msg->cap) {
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(msg->data + msg->len, data, len);
+    msg->len += len;
+    return ESP_OK;
+}
 
-    ESP_LOGI(TAG, "WiFi扫描完成，结果: ap_count=%d, ap_records=%p", ap_count, ap_records);
+// 在httpd任务中推送当前扫描进度给订阅了scan主题的WebSocket客户端
+static void scan_progress_work(void *arg)
+{
+    s_scan_push_pending = false;
 
-    if (ap_records == NULL) {
-        ESP_LOGE(TAG, "WiFi扫描失败，返回NULL");
+    wifi_ap_record_t ap_records[WIFI_SCAN_MAX_RESULTS];
+    wifi_scan_progress_t progress;
+    if (wifi_manager_scan_get_progress(ap_records, WIFI_SCAN_MAX_RESULTS, &progress) != ESP_OK) {
+        return;
+    }
 
-        cJSON_AddBoolToObject(root, "success", false);
-        cJSON_AddArrayToObject(root, "networks");
-        cJSON_AddStringToObject(root, "message", "WiFi扫描失败，请稍后重试");
-        cJSON_AddNumberToObject(root, "count", 0);
-    } else if (ap_count == 0) {
-        ESP_LOGW(TAG, "WiFi扫描成功但未找到网络");
+    ws_message_t msg = { .data = malloc(WS_SCAN_MESSAGE_MAX), .len = 0, .cap = WS_SCAN_MESSAGE_MAX };
+    if (msg.data == NULL) {
+        ESP_LOGE(TAG, "无法分配内存");
+        return;
+    }
 
-        cJSON_AddBoolToObject(root, "success", true);
-        cJSON_AddArrayToObject(root, "networks");
-        cJSON_AddStringToObject(root, "message", "未发现WiFi网络，请检查周围是否有WiFi信号");
-        cJSON_AddNumberToObject(root, "count", 0);
+    json_stream_t js;
+    json_stream_init(&js, ws_message_append, &msg);
+    json_stream_printf(&js, "{\"event\":\"scan\",\"sweep\":%lu,\"done\":%s,",
+                       (unsigned long)progress.sweep, progress.done ? "true" : "false");
+    json_stream_printf(&js, "\"groups_done\":%d,\"groups_total\":%d,\"elapsed_ms\":%lu,\"count\":%d,",
+                       progress.groups_done, progress.groups_total,
+                       (unsigned long)progress.elapsed_ms, progress.count);
+    write_networks_json(&js, ap_records, progress.count);
+    json_stream_raw(&js, "}");
 
-        need_free_records = true; // 标记需要释放
+    if (json_stream_flush(&js) == ESP_OK) {
+        msg.data[msg.len] = '\0';
+        ws_broadcast(WS_TOPIC_SCAN, msg.data);
     } else {
-        ESP_LOGI(TAG, "WiFi扫描成功，找到 %d 个网络", ap_count);
+        ESP_LOGE(TAG, "扫描进度消息过长");
+    }
+    free(msg.data);
+}
 
-        cJSON_AddBoolToObject(root, "success", true);
-        cJSON_AddNumberToObject(root, "count", ap_count);
-        cJSON_AddStringToObject(root, "message", "扫描完成");
+// 排队一次扫描进度推送，已有推送在排队时合并
+static void queue_scan_push(void)
+{
+    httpd_handle_t server = s_server;
+    if (server == NULL || s_scan_push_pending || !ws_topic_has_subscribers(WS_TOPIC_SCAN)) {
+        return;
+    }
 
-        cJSON *networks = cJSON_AddArrayToObject(root, "networks");
-        if (networks == NULL) {
-            ESP_LOGE(TAG, "创建networks数组失败");
-            cJSON_Delete(root);
-            if (ap_records != NULL) {
-                free(ap_records);
-            }
-            httpd_resp_send_500(req);
-            return ESP_FAIL;
-        }
+    s_scan_push_pending = true;
+    if (httpd_queue_work(server, scan_progress_work, NULL) != ESP_OK) {
+        s_scan_push_pending = false;
+    }
+}
 
-        // 添加网络信息
-        for (int i = 0; i < ap_count; i++) {
-            cJSON *network = cJSON_CreateObject();
-            if (network == NULL) {
-                ESP_LOGE(TAG, "创建network对象失败");
-                continue;
-            }
+// 扫描进度回调（在默认事件循环任务中调用，栈较小，只排队不构建JSON）
+static void scan_progress_cb(const wifi_scan_progress_t *progress)
+{
+    queue_scan_push();
+}
 
-            // 基本信息
-            cJSON_AddStringToObject(network, "ssid", (char *)ap_records[i].ssid);
-            cJSON_AddNumberToObject(network, "rssi", ap_records[i].rssi);
-            cJSON_AddNumberToObject(network, "channel", ap_records[i].primary);
-
-            // 附加信息
-            cJSON_AddStringToObject(network, "signal_strength", get_signal_strength_desc(ap_records[i].rssi));
-            cJSON_AddStringToObject(network, "auth_mode", get_auth_mode_desc(ap_records[i].authmode));
-            cJSON_AddNumberToObject(network, "authmode", ap_records[i].authmode);
-            cJSON_AddBoolToObject(network, "is_open", ap_records[i].authmode == WIFI_AUTH_OPEN);
-
-            // 计算信号强度百分比 (0-100%)
-            int signal_percent = 0;
-            if (ap_records[i].rssi >= -50) signal_percent = 100;
-            else if (ap_records[i].rssi >= -60) signal_percent = 80;
-            else if (ap_records[i].rssi >= -70) signal_percent = 60;
-            else if (ap_records[i].rssi >= -80) signal_percent = 40;
-            else signal_percent = 20;
-            cJSON_AddNumberToObject(network, "signal_percent", signal_percent);
-
-            cJSON_AddItemToArray(networks, network);
-        }
+// 在httpd任务中推送最新的链路采样给订阅了link主题的WebSocket客户端
+static void link_push_work(void *arg)
+{
+    s_link_push_pending = false;
 
-        need_free_records = true; // 标记需要释放
+    wifi_link_sample_t sample;
+    wifi_link_stats_t stats;
+    if (wifi_manager_get_link_history(&sample, 1) == 0) {
+        return;
     }
+    wifi_manager_get_link_stats(&stats);
 
-    // 发送响应
-    char *json_str = cJSON_Print(root);
-    if (json_str == NULL) {
-        ESP_LOGE(TAG, "创建JSON字符串失败");
-        cJSON_Delete(root);
-        if (need_free_records && ap_records != NULL) {
-            free(ap_records);
-        }
-        httpd_resp_send_500(req);
-        return ESP_FAIL;
-    }
+    char buf[WS_LINK_MESSAGE_MAX];
+    ws_message_t msg = { .data = buf, .len = 0, .cap = sizeof(buf) };
+    json_stream_t js;
+    json_stream_init(&js, ws_message_append, &msg);
+    json_stream_raw(&js, "{\"event\":\"link\",\"sample\":");
+    link_json_write_sample(&js, &sample);
+    json_stream_raw(&js, ",");
+    link_json_write_trend(&js, &stats);
+    json_stream_raw(&js, "}");
 
-    esp_err_t ret = httpd_resp_sendstr(req, json_str);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "发送HTTP响应失败: %s", esp_err_to_name(ret));
+    if (json_stream_flush(&js) == ESP_OK) {
+        msg.data[msg.len] = '\0';
+        ws_broadcast(WS_TOPIC_LINK, msg.data);
     }
+}
 
-    // 清理资源
-    free(json_str);
-    cJSON_Delete(root);
-
-    // 统一释放ap_records内存
-    if (need_free_records && ap_records != NULL) {
-        free(ap_records);
-        ESP_LOGI(TAG, "已释放WiFi扫描结果内存");
+// 链路采样回调（在esp_timer任务中调用，只排队不构建JSON）
+static void link_sample_cb(const wifi_link_sample_t *sample)
+{
+    httpd_handle_t server = s_server;
+    if (server == NULL || s_link_push_pending || !ws_topic_has_subscribers(WS_TOPIC_LINK)) {
+        return;
     }
 
-    // 记录最终内存状态
-    size_t final_free_heap = esp_get_free_heap_size();
-    ESP_LOGI(TAG, "WiFi扫描处理完成 - 最终可用内存: %d 字节", final_free_heap);
-
-    return ret;
+    s_link_push_pending = true;
+    if (httpd_queue_work(server, link_push_work, NULL) != ESP_OK) {
+        s_link_push_pending = false;
+    }
 }
 
-// 网络信息API - 获取设备IP地址等网络信息
-static esp_err_t network_info_handler(httpd_req_t *req)
+// 已保存网络列表API
+static esp_err_t wifi_networks_get_handler(httpd_req_t *req)
 {
     httpd_resp_set_type(req, "application/json");
-    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
-    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
 
-    ESP_LOGI(TAG, "收到网络信息请求");
+    if (!check_authentication(req)) {
+        httpd_resp_set_status(req, "401 Unauthorized");
+        httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"未认证，请先登录\"}");
+        return ESP_OK;
+    }
 
-    // 记录内存使用情况
-    size_t free_heap = esp_get_free_heap_size();
-    ESP_LOGI(TAG, "网络信息请求 - 可用内存: %d 字节", free_heap);
+    wifi_saved_network_t networks[WIFI_MAX_NETWORKS];
+    int count = wifi_manager_get_saved_networks(networks, WIFI_MAX_NETWORKS);
+
+    wifi_config_t sta_config;
+    const char *current = "";
+    if (esp_wifi_get_config(WIFI_IF_STA, &sta_config) == ESP_OK) {
+        current = (const char *)sta_config.sta.ssid;
+    }
 
-    // 创建响应JSON对象
     cJSON *root = cJSON_CreateObject();
-    if (root == NULL) {
-        ESP_LOGE(TAG, "创建JSON对象失败");
-        httpd_resp_send_500(req);
-        return ESP_FAIL;
+    cJSON_AddBoolToObject(root, "success", true);
+    cJSON_AddStringToObject(root, "current", current);
+    cJSON *list = cJSON_AddArrayToObject(root, "networks");
+    for (int i = 0; i < count; i++) {
+        cJSON *item = cJSON_CreateObject();
+        cJSON_AddStringToObject(item, "ssid", networks[i].ssid);
+        cJSON_AddNumberToObject(item, "priority", networks[i].priority);
+        cJSON_AddBoolToObject(item, "visible", networks[i].visible);
+        if (networks[i].visible) {
+            cJSON_AddNumberToObject(item, "rssi", networks[i].rssi);
+        }
+        cJSON_AddItemToArray(list, item);
     }
 
-    // 获取WiFi模式
-    wifi_mode_t mode;
-    esp_err_t mode_err = esp_wifi_get_mode(&mode);
+    char *json_str = cJSON_Print(root);
+    httpd_resp_sendstr(req, json_str);
 
-    // 获取STA接口信息
-    esp_netif_t *sta_netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
-    esp_netif_ip_info_t ip_info;
-    char ip_str[16] = "0.0.0.0";
-    char netmask_str[16] = "0.0.0.0";
-    char gateway_str[16] = "0.0.0.0";
-    bool sta_connected = false;
+    free(json_str);
+    cJSON_Delete(root);
 
-    if (sta_netif != NULL) {
-        esp_err_t ip_err = esp_netif_get_ip_info(sta_netif, &ip_info);
-        if (ip_err == ESP_OK && ip_info.ip.addr != 0) {
-            esp_ip4addr_ntoa(&ip_info.ip, ip_str, sizeof(ip_str));
-            esp_ip4addr_ntoa(&ip_info.netmask, netmask_str, sizeof(netmask_str));
-            esp_ip4addr_ntoa(&ip_info.gw, gateway_str, sizeof(gateway_str));
-            sta_connected = true;
-            ESP_LOGI(TAG, "STA IP信息 - IP: %s, 网关: %s", ip_str, gateway_str);
-        }
+    return ESP_OK;
+}
+
+// 删除已保存网络API
+static esp_err_t wifi_forget_post_handler(httpd_req_t *req)
+{
+    httpd_resp_set_type(req, "application/json");
+
+    if (!check_authentication(req)) {
+        httpd_resp_set_status(req, "401 Unauthorized");
+        httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"未认证，请先登录\"}");
+        return ESP_OK;
     }
 
-    // 获取AP接口信息
-    esp_netif_t *ap_netif = esp_netif_get_handle_from_ifkey("WIFI_AP_DEF");
-    esp_netif_ip_info_t ap_ip_info;
-    char ap_ip_str[16] = "192.168.4.1";
+    char buf[96];
+    if (req->content_len <= 0 || req->content_len > sizeof(buf) - 1) {
+        httpd_resp_set_status(req, "400 Bad Request");
+        httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"请求无效\"}");
+        return ESP_OK;
+    }
 
-    if (ap_netif != NULL) {
-        esp_err_t ap_ip_err = esp_netif_get_ip_info(ap_netif, &ap_ip_info);
-        if (ap_ip_err == ESP_OK && ap_ip_info.ip.addr != 0) {
-            esp_ip4addr_ntoa(&ap_ip_info.ip, ap_ip_str, sizeof(ap_ip_str));
+    int ret = httpd_req_recv(req, buf, req->content_len);
+    if (ret <= 0) {
+        if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
+            httpd_resp_send_408(req);
         }
+        return ESP_FAIL;
     }
+    buf[ret] = '\0';
 
-    // 获取连接的WiFi信息
-    wifi_ap_record_t ap_info;
-    char connected_ssid[33] = "";
-    int8_t rssi = 0;
-
-    if (sta_connected && esp_wifi_sta_get_ap_info(&ap_info) == ESP_OK) {
-        strncpy(connected_ssid, (char*)ap_info.ssid, sizeof(connected_ssid) - 1);
-        connected_ssid[sizeof(connected_ssid) - 1] = '\0';
-        rssi = ap_info.rssi;
-        ESP_LOGI(TAG, "已连接WiFi: %s, 信号强度: %d dBm", connected_ssid, rssi);
+    cJSON *root = cJSON_Parse(buf);
+    cJSON *ssid_json = root != NULL ? cJSON_GetObjectItem(root, "ssid") : NULL;
+    if (!cJSON_IsString(ssid_json)) {
+        cJSON_Delete(root);
+        httpd_resp_set_status(req, "400 Bad Request");
+        httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"SSID必须提供\"}");
+        return ESP_OK;
     }
 
-    // 构建响应数据
-    cJSON_AddBoolToObject(root, "success", true);
+    esp_err_t err = wifi_manager_forget_network(ssid_json->valuestring);
+    ESP_LOGI(TAG, "删除已保存网络 %s: %s", ssid_json->valuestring, esp_err_to_name(err));
+    cJSON_Delete(root);
+
+    if (err == ESP_OK) {
+        httpd_resp_sendstr(req, "{\"success\":true,\"message\":\"已删除\"}");
+    } else if (err == ESP_ERR_NOT_FOUND) {
+        httpd_resp_set_status(req, "404 Not Found");
+        httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"网络不存在\"}");
+    } else {
+        httpd_resp_set_status(req, "500 Internal Server Error");
+        httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"删除失败\"}");
+    }
+    return ESP_OK;
+}
+
+// 机器列表API
+static esp_err_t machines_get_handler(httpd_req_t *req)
+{
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+
+    if (!check_authentication(req)) {
+        httpd_resp_set_status(req, "401 Unauthorized");
+        httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"未认证，请先登录\"}");
+        return ESP_OK;
+    }
+
+    json_stream_t js;
+    json_stream_init(&js, http_chunk_flush, req);
+    json_stream_raw(&js, "{\"success\":true,\"machines\":[");
+    for (uint8_t i = 0; i < pc_monitor_machine_count(); i++) {
+        pc_machine_info_t info;
+        if (pc_monitor_get_machine(i, &info) != ESP_OK) {
+            continue;
+        }
+        json_stream_printf(&js, "%s{\"id\":%d,", i > 0 ? "," : "", i);
+        json_stream_key(&js, "name");
+        json_stream_string(&js, info.name);
+        json_stream_printf(&js, ",\"is_on\":%s,\"sensor_ok\":%s,\"source\":\"%s\",\"gpio\":%d,"
+                           "\"pcf_addr\":%d,\"pcf_bit\":%d,\"actuator\":%d}",
+                           info.state == PC_STATE_ON ? "true" : "false", info.sensor_ok ? "true" : "false",
+                           info.source == PC_STATUS_READ_I2C ? "i2c" : "gpio", info.gpio,
+                           info.pcf_addr, info.pcf_bit, info.actuator);
+    }
+    json_stream_raw(&js, "]}");
+
+    esp_err_t ret = json_stream_flush(&js);
+    if (ret == ESP_OK) {
+        ret = httpd_resp_send_chunk(req, NULL, 0);
+    }
+    return ret;
+}
+
+// 边沿捕获API - 电源灯推断的开机/睡眠/关机状态和硬盘灯活动频率
+static esp_err_t capture_get_handler(httpd_req_t *req)
+{
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+
+    if (!check_authentication(req)) {
+        httpd_resp_set_status(req, "401 Unauthorized");
+        httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"未认证，请先登录\"}");
+        return ESP_OK;
+    }
+
+    json_stream_t js;
+    json_stream_init(&js, http_chunk_flush, req);
+    json_stream_raw(&js, "{\"success\":true,\"inputs\":[");
+    for (uint8_t i = 0; i < edge_capture_input_count(); i++) {
+        edge_capture_info_t info;
+        if (edge_capture_get_input(i, &info) != ESP_OK) {
+            continue;
+        }
+        json_stream_printf(&js, "%s{\"id\":%d,", i > 0 ? "," : "", i);
+        json_stream_key(&js, "name");
+        json_stream_string(&js, info.name);
+        json_stream_printf(&js, ",\"machine\":%d,\"gpio\":%d,\"ready\":%s,\"active\":%s,\"edges\":%lu,",
+                           info.machine, info.gpio, info.ready ? "true" : "false",
+                           info.active ? "true" : "false", (unsigned long)info.edges);
+        if (info.kind == EDGE_CAPTURE_POWER_LED) {
+            json_stream_printf(&js, "\"kind\":\"power_led\",\"state\":\"%s\",\"blink_period_ms\":%lu}",
+                               capture_power_state_name(info.power), (unsigned long)info.blink_period_ms);
+        } else {
+            json_stream_printf(&js, "\"kind\":\"activity_led\",\"pulses_per_min\":%lu,\"busy_percent\":%d}",
+                               (unsigned long)info.pulses_per_min, info.busy_percent);
+        }
+    }
+    json_stream_raw(&js, "]}");
+
+    esp_err_t ret = json_stream_flush(&js);
+    if (ret == ESP_OK) {
+        ret = httpd_resp_send_chunk(req, NULL, 0);
+    }
+    return ret;
+}
+
+// 省电模式名称（与wifi_ps_type_t对应）
+static const char *s_power_mode_names[WIFI_POWER_MODES] = { "none", "min_modem", "max_modem" };
+
+static int power_mode_from_name(const char *name)
+{
+    for (int i = 0; i < WIFI_POWER_MODES; i++) {
+        if (strcmp(name, s_power_mode_names[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int power_mode_from_json(const cJSON *item)
+{
+    return cJSON_IsString(item) ? power_mode_from_name(item->valuestring) : -1;
+}
+
+// 省电策略和各模式延迟API
+static esp_err_t wifi_power_get_handler(httpd_req_t *req)
+{
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+
+    if (!check_authentication(req)) {
+        httpd_resp_set_status(req, "401 Unauthorized");
+        httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"未认证，请先登录\"}");
+        return ESP_OK;
+    }
+
+    wifi_power_policy_t policy;
+    wifi_power_stats_t stats;
+    wifi_manager_get_power_policy(&policy);
+    wifi_manager_get_power_stats(&stats);
+
+    json_stream_t js;
+    json_stream_init(&js, http_chunk_flush, req);
+    json_stream_printf(&js, "{\"success\":true,\"policy\":{\"idle_mode\":\"%s\",\"busy_mode\":\"%s\","
+                       "\"listen_interval\":%d,\"boost_ms\":%lu},",
+                       s_power_mode_names[policy.idle_mode], s_power_mode_names[policy.busy_mode],
+                       policy.listen_interval, (unsigned long)policy.boost_ms);
+    json_stream_printf(&js, "\"mode\":\"%s\",\"busy\":%s,\"ws_clients\":%d,\"switches\":%lu,"
+                       "\"boosts\":%lu,\"presses\":%lu,\"modes\":{",
+                       s_power_mode_names[stats.mode], stats.busy ? "true" : "false", stats.ws_clients,
+                       (unsigned long)stats.switches, (unsigned long)stats.boosts, (unsigned long)stats.presses);
+    for (int i = 0; i < WIFI_POWER_MODES; i++) {
+        const wifi_power_latency_t *latency = &stats.latency[i];
+        json_stream_printf(&js, "%s\"%s\":{\"time_ms\":%lu,\"requests\":%lu,\"probes\":%lu,"
+                           "\"last_ms\":%lu,\"avg_ms\":%lu,\"max_ms\":%lu}",
+                           i > 0 ? "," : "", s_power_mode_names[i],
+                           (unsigned long)stats.time_ms[i], (unsigned long)stats.requests[i],
+                           (unsigned long)latency->probes, (unsigned long)latency->last_ms,
+                           (unsigned long)latency->avg_ms, (unsigned long)latency->max_ms);
+    }
+    json_stream_raw(&js, "}}");
+
+    esp_err_t ret = json_stream_flush(&js);
+    if (ret == ESP_OK) {
+        ret = httpd_resp_send_chunk(req, NULL, 0);
+    }
+    return ret;
+}
+
+// 修改省电策略，只更新请求中给出的字段
+static esp_err_t wifi_power_post_handler(httpd_req_t *req)
+{
+    httpd_resp_set_type(req, "application/json");
+
+    if (!check_authentication(req)) {
+        httpd_resp_set_status(req, "401 Unauthorized");
+        httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"未认证，请先登录\"}");
+        return ESP_OK;
+    }
+
+    char buf[160];
+    if (req->content_len <= 0 || req->content_len > sizeof(buf) - 1) {
+        httpd_resp_set_status(req, "400 Bad Request");
+        httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"请求无效\"}");
+        return ESP_OK;
+    }
+
+    int ret = httpd_req_recv(req, buf, req->content_len);
+    if (ret <= 0) {
+        if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
+            httpd_resp_send_408(req);
+        }
+        return ESP_FAIL;
+    }
+    buf[ret] = '\0';
+
+    cJSON *root = cJSON_Parse(buf);
+    if (root == NULL) {
+        httpd_resp_set_status(req, "400 Bad Request");
+        httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"请求无效\"}");
+        return ESP_OK;
+    }
+
+    wifi_power_policy_t policy;
+    wifi_manager_get_power_policy(&policy);
+    bool valid = true;
+
+    cJSON *item = cJSON_GetObjectItem(root, "idle_mode");
+    if (item != NULL) {
+        int mode = power_mode_from_json(item);
+        valid = valid && mode >= 0;
+        policy.idle_mode = mode >= 0 ? (uint8_t)mode : policy.idle_mode;
+    }
+    item = cJSON_GetObjectItem(root, "busy_mode");
+    if (item != NULL) {
+        int mode = power_mode_from_json(item);
+        valid = valid && mode >= 0;
+        policy.busy_mode = mode >= 0 ? (uint8_t)mode : policy.busy_mode;
+    }
+    item = cJSON_GetObjectItem(root, "listen_interval");
+    if (item != NULL) {
+        valid = valid && cJSON_IsNumber(item) && item->valueint > 0 && item->valueint <= UINT16_MAX;
+        policy.listen_interval = valid ? (uint16_t)item->valueint : policy.listen_interval;
+    }
+    item = cJSON_GetObjectItem(root, "boost_ms");
+    if (item != NULL) {
+        valid = valid && cJSON_IsNumber(item) && item->valuedouble >= 0;
+        policy.boost_ms = valid ? (uint32_t)item->valuedouble : policy.boost_ms;
+    }
+    cJSON_Delete(root);
+
+    esp_err_t err = valid ? wifi_manager_set_power_policy(&policy) : ESP_ERR_INVALID_ARG;
+    if (err == ESP_OK) {
+        httpd_resp_sendstr(req, "{\"success\":true,\"message\":\"已保存\"}");
+    } else if (err == ESP_ERR_INVALID_ARG) {
+        httpd_resp_set_status(req, "400 Bad Request");
+        httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"参数无效\"}");
+    } else {
+        httpd_resp_set_status(req, "500 Internal Server Error");
+        httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"保存失败\"}");
+    }
+    return ESP_OK;
+}
+
+// 入站延迟回显：客户端测量本请求的往返时间，在下一次请求中以?mode=&rtt=回报上一次的结果，
+// mode取上一次响应中的值。路由不通知省电模块，请求在到达时的模式下处理，往返时间包含AP缓存
+// 下行帧直到STA醒来的等待（用tools/power_latency.py驱动）
+#define POWER_ECHO_QUERY_MAX_LEN    48
+
+static esp_err_t wifi_power_echo_handler(httpd_req_t *req)
+{
+    uint8_t mode = wifi_manager_power_mode();
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+
+    if (!check_authentication(req)) {
+        httpd_resp_set_status(req, "401 Unauthorized");
+        httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"未认证，请先登录\"}");
+        return ESP_OK;
+    }
+
+    // 没有查询参数时只回显，参数不完整或被截断视为无效
+    char query[POWER_ECHO_QUERY_MAX_LEN + 1];
+    esp_err_t err = httpd_req_get_url_query_str(req, query, sizeof(query));
+    if (err != ESP_ERR_NOT_FOUND) {
+        char mode_str[12];
+        char rtt_str[8];
+        if (err == ESP_OK) {
+            err = httpd_query_key_value(query, "mode", mode_str, sizeof(mode_str));
+        }
+        if (err == ESP_OK) {
+            err = httpd_query_key_value(query, "rtt", rtt_str, sizeof(rtt_str));
+        }
+        int reported = err == ESP_OK ? power_mode_from_name(mode_str) : -1;
+        char *end = NULL;
+        unsigned long rtt = reported >= 0 ? strtoul(rtt_str, &end, 10) : 0;
+        if (reported < 0 || end == rtt_str || *end != '\0' ||
+            wifi_manager_power_record_echo((uint8_t)reported, (uint32_t)rtt) != ESP_OK) {
+            httpd_resp_set_status(req, "400 Bad Request");
+            httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"参数无效\"}");
+            return ESP_OK;
+        }
+    }
+
+    char body[48];
+    snprintf(body, sizeof(body), "{\"success\":true,\"mode\":\"%s\"}", s_power_mode_names[mode]);
+    return httpd_resp_sendstr(req, body);
+}
+
+// PC状态轮询策略和采样统计API
+static esp_err_t monitor_poll_get_handler(httpd_req_t *req)
+{
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+
+    if (!check_authentication(req)) {
+        httpd_resp_set_status(req, "401 Unauthorized");
+        httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"未认证，请先登录\"}");
+        return ESP_OK;
+    }
+
+    pc_poll_policy_t policy;
+    pc_monitor_stats_t stats;
+    pc_monitor_get_poll_policy(&policy);
+    pc_monitor_get_stats(&stats);
+
+    json_stream_t js;
+    json_stream_init(&js, http_chunk_flush, req);
+    json_stream_printf(&js, "{\"success\":true,\"policy\":{\"fast_interval_ms\":%lu,\"fast_window_ms\":%lu,"
+                       "\"min_interval_ms\":%lu,\"max_interval_ms\":%lu},",
+                       (unsigned long)policy.fast_interval_ms, (unsigned long)policy.fast_window_ms,
+                       (unsigned long)policy.min_interval_ms, (unsigned long)policy.max_interval_ms);
+    json_stream_printf(&js, "\"interrupt_driven\":%s,\"interval_ms\":%lu,\"samples\":%lu,\"fast_samples\":%lu,"
+                       "\"sample_requests\":%lu,\"activities\":%lu,",
+                       stats.interrupt_driven ? "true" : "false", (unsigned long)stats.interval_ms,
+                       (unsigned long)stats.polls, (unsigned long)stats.fast_samples,
+                       (unsigned long)stats.sample_requests, (unsigned long)stats.activities);
+    json_stream_printf(&js, "\"detect\":{\"count\":%lu,\"misses\":%lu,\"last_ms\":%lu,\"avg_ms\":%lu,\"max_ms\":%lu}}",
+                       (unsigned long)stats.detects, (unsigned long)stats.detect_misses,
+                       (unsigned long)stats.last_detect_ms, (unsigned long)stats.avg_detect_ms,
+                       (unsigned long)stats.max_detect_ms);
+
+    esp_err_t ret = json_stream_flush(&js);
+    if (ret == ESP_OK) {
+        ret = httpd_resp_send_chunk(req, NULL, 0);
+    }
+    return ret;
+}
+
+// 修改轮询策略（只更新请求中给出的字段），"sample":true请求立即采样
+static esp_err_t monitor_poll_post_handler(httpd_req_t *req)
+{
+    httpd_resp_set_type(req, "application/json");
+
+    if (!check_authentication(req)) {
+        httpd_resp_set_status(req, "401 Unauthorized");
+        httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"未认证，请先登录\"}");
+        return ESP_OK;
+    }
+
+    char buf[160];
+    if (req->content_len <= 0 || req->content_len > sizeof(buf) - 1) {
+        httpd_resp_set_status(req, "400 Bad Request");
+        httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"请求无效\"}");
+        return ESP_OK;
+    }
+
+    int ret = httpd_req_recv(req, buf, req->content_len);
+    if (ret <= 0) {
+        if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
+            httpd_resp_send_408(req);
+        }
+        return ESP_FAIL;
+    }
+    buf[ret] = '\0';
+
+    cJSON *root = cJSON_Parse(buf);
+    if (root == NULL) {
+        httpd_resp_set_status(req, "400 Bad Request");
+        httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"请求无效\"}");
+        return ESP_OK;
+    }
+
+    pc_poll_policy_t policy;
+    pc_monitor_get_poll_policy(&policy);
+    static const struct {
+        const char *name;
+        size_t offset;
+    } fields[] = {
+        { "fast_interval_ms", offsetof(pc_poll_policy_t, fast_interval_ms) },
+        { "fast_window_ms",   offsetof(pc_poll_policy_t, fast_window_ms) },
+        { "min_interval_ms",  offsetof(pc_poll_policy_t, min_interval_ms) },
+        { "max_interval_ms",  offsetof(pc_poll_policy_t, max_interval_ms) },
+    };
+    bool valid = true;
+    bool changed = false;
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+        cJSON *item = cJSON_GetObjectItem(root, fields[i].name);
+        if (item == NULL) {
+            continue;
+        }
+        valid = valid && cJSON_IsNumber(item) && item->valuedouble >= 0 && item->valuedouble <= UINT32_MAX;
+        if (valid) {
+            *(uint32_t *)((uint8_t *)&policy + fields[i].offset) = (uint32_t)item->valuedouble;
+            changed = true;
+        }
+    }
+    bool sample = cJSON_IsTrue(cJSON_GetObjectItem(root, "sample"));
+    cJSON_Delete(root);
+
+    // 修改策略时会重新安排采样，不需要单独请求
+    esp_err_t err = !valid ? ESP_ERR_INVALID_ARG : changed ? pc_monitor_set_poll_policy(&policy) : ESP_OK;
+    if (err == ESP_OK && sample && !changed) {
+        pc_monitor_request_sample();
+    }
+    if (err == ESP_OK) {
+        httpd_resp_sendstr(req, "{\"success\":true,\"message\":\"已保存\"}");
+    } else {
+        httpd_resp_set_status(req, "400 Bad Request");
+        httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"参数无效\"}");
+    }
+    return ESP_OK;
+}
+
+// 链路质量历史API - 按时间顺序流式输出环形缓冲区中的采样，?n=只取最近的n个
+static esp_err_t network_history_handler(httpd_req_t *req)
+{
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+
+    if (!check_authentication(req)) {
+        httpd_resp_set_status(req, "401 Unauthorized");
+        httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"未认证，请先登录\"}");
+        return ESP_OK;
+    }
+
+    uint16_t max = WIFI_LINK_HISTORY_LEN;
+    char query[32];
+    char n_str[8];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        httpd_query_key_value(query, "n", n_str, sizeof(n_str)) == ESP_OK) {
+        int n = atoi(n_str);
+        if (n > 0 && n < WIFI_LINK_HISTORY_LEN) {
+            max = (uint16_t)n;
+        }
+    }
+
+    wifi_link_sample_t *samples = malloc(max * sizeof(wifi_link_sample_t));
+    if (samples == NULL) {
+        ESP_LOGE(TAG, "无法分配内存");
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+    uint16_t count = wifi_manager_get_link_history(samples, max);
+    wifi_link_stats_t stats;
+    wifi_manager_get_link_stats(&stats);
+
+    json_stream_t js;
+    json_stream_init(&js, http_chunk_flush, req);
+    json_stream_printf(&js, "{\"success\":true,\"interval_ms\":%d,\"now_ms\":%lu,\"count\":%d,",
+                       WIFI_LINK_SAMPLE_INTERVAL_MS, (unsigned long)(esp_timer_get_time() / 1000), count);
+    link_json_write_trend(&js, &stats);
+    json_stream_printf(&js, ",\"beacon_timeouts\":%lu,\"early_scans\":%lu,\"predictive_roams\":%lu,"
+                       "\"proactive_reconnects\":%lu,\"samples\":[",
+                       (unsigned long)stats.beacon_timeouts, (unsigned long)stats.early_scans,
+                       (unsigned long)stats.predictive_roams, (unsigned long)stats.proactive_reconnects);
+    for (uint16_t i = 0; i < count; i++) {
+        if (i > 0) {
+            json_stream_raw(&js, ",");
+        }
+        link_json_write_sample(&js, &samples[i]);
+    }
+    json_stream_raw(&js, "]}");
+    free(samples);
+
+    esp_err_t ret = json_stream_flush(&js);
+    if (ret == ESP_OK) {
+        ret = httpd_resp_send_chunk(req, NULL, 0);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "发送HTTP响应失败: %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+// 网络信息API - 获取设备IP地址等网络信息
+static esp_err_t network_info_handler(httpd_req_t *req)
+{
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+
+    ESP_LOGI(TAG, "收到网络信息请求");
+
+    // 记录内存使用情况
+    size_t free_heap = esp_get_free_heap_size();
+    ESP_LOGI(TAG, "网络信息请求 - 可用内存: %d 字节", free_heap);
+
+    // 创建响应JSON对象
+    cJSON *root = cJSON_CreateObject();
+    if (root == NULL) {
+        ESP_LOGE(TAG, "创建JSON对象失败");
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+
+    // 获取WiFi模式
+    wifi_mode_t mode;
+    esp_err_t mode_err = esp_wifi_get_mode(&mode);
+
+    // 获取STA接口信息
+    esp_netif_t *sta_netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+    esp_netif_ip_info_t ip_info;
+    char ip_str[16] = "0.0.0.0";
+    char netmask_str[16] = "0.0.0.0";
+    char gateway_str[16] = "0.0.0.0";
+    bool sta_connected = false;
+
+    if (sta_netif != NULL) {
+        esp_err_t ip_err = esp_netif_get_ip_info(sta_netif, &ip_info);
+        if (ip_err == ESP_OK && ip_info.ip.addr != 0) {
+            esp_ip4addr_ntoa(&ip_info.ip, ip_str, sizeof(ip_str));
+            esp_ip4addr_ntoa(&ip_info.netmask, netmask_str, sizeof(netmask_str));
+            esp_ip4addr_ntoa(&ip_info.gw, gateway_str, sizeof(gateway_str));
+            sta_connected = true;
+            ESP_LOGI(TAG, "STA IP信息 - IP: %s, 网关: %s", ip_str, gateway_str);
+        }
+    }
+
+    // 获取AP接口信息
+    esp_netif_t *ap_netif = esp_netif_get_handle_from_ifkey("WIFI_AP_DEF");
+    esp_netif_ip_info_t ap_ip_info;
+    char ap_ip_str[16] = "192.168.4.1";
+
+    if (ap_netif != NULL) {
+        esp_err_t ap_ip_err = esp_netif_get_ip_info(ap_netif, &ap_ip_info);
+        if (ap_ip_err == ESP_OK && ap_ip_info.ip.addr != 0) {
+            esp_ip4addr_ntoa(&ap_ip_info.ip, ap_ip_str, sizeof(ap_ip_str));
+        }
+    }
+
+    // 获取连接的WiFi信息
+    wifi_ap_record_t ap_info;
+    char connected_ssid[33] = "";
+    int8_t rssi = 0;
+
+    if (sta_connected && esp_wifi_sta_get_ap_info(&ap_info) == ESP_OK) {
+        strncpy(connected_ssid, (char*)ap_info.ssid, sizeof(connected_ssid) - 1);
+        connected_ssid[sizeof(connected_ssid) - 1] = '\0';
+        rssi = ap_info.rssi;
+        ESP_LOGI(TAG, "已连接WiFi: %s, 信号强度: %d dBm", connected_ssid, rssi);
+    }
+
+    // 构建响应数据
+    cJSON_AddBoolToObject(root, "success", true);
     cJSON_AddStringToObject(root, "message", "网络信息获取成功");
 
     // STA信息
@@ -979,6 +1799,14 @@ static esp_err_t network_info_handler(httpd_req_t *req)
     return ret;
 }
 
+// 异步连接完成（在事件循环任务中调用）：配网成功后该客户端的系统探测不再需要重定向
+static void wifi_connect_done_cb(const wifi_connect_status_t *status, void *arg)
+{
+    if (status->result == WIFI_CONNECT_RESULT_OK) {
+        captive_portal_release_ip((uint32_t)(uintptr_t)arg);
+    }
+}
+
 // WiFi连接API
 static esp_err_t wifi_connect_handler(httpd_req_t *req)
 {
@@ -1032,62 +1860,102 @@ static esp_err_t wifi_connect_handler(httpd_req_t *req)
         password = password_json->valuestring;
     }
     
-    // 准备响应
-    httpd_resp_set_type(req, "application/json");
-    
-    // 先尝试连接，如果连接成功再保存凭证
+    // 异步连接：立即返回请求句柄，页面通过状态接口轮询结果，成功后才保存凭证
     ESP_LOGI(TAG, "尝试连接到WiFi: %s", ssid);
-    esp_err_t connect_ret = wifi_manager_start_sta(ssid, password);
-    
+    wifi_connect_request_t request = {
+        .ssid = ssid,
+        .password = password,
+        .save_on_success = true,
+        .callback = wifi_connect_done_cb,
+        .callback_arg = (void *)(uintptr_t)conn_manager_get_peer_ip(httpd_req_to_sockfd(req)),
+    };
+    wifi_connect_op_t op = 0;
+    esp_err_t connect_ret = wifi_manager_connect_async(&request, &op);
+    cJSON_Delete(root);
+
+    httpd_resp_set_type(req, "application/json");
+    cJSON *resp = cJSON_CreateObject();
     if (connect_ret == ESP_OK) {
-        // 连接成功后才保存WiFi凭证
-        esp_err_t save_ret = wifi_manager_save_credentials(ssid, password);
-        if (save_ret != ESP_OK) {
-            ESP_LOGW(TAG, "保存WiFi凭证失败: %s", esp_err_to_name(save_ret));
-            // 连接成功但保存失败，继续处理
-        }
-        
-        // 获取IP地址
-        esp_netif_ip_info_t ip_info;
-        esp_netif_t *netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
-        esp_netif_get_ip_info(netif, &ip_info);
-        
-        cJSON *resp = cJSON_CreateObject();
+        char status_url[48];
+        snprintf(status_url, sizeof(status_url), "/api/wifi/connect/status?op=%lu", (unsigned long)op);
+        httpd_resp_set_status(req, "202 Accepted");
         cJSON_AddBoolToObject(resp, "success", true);
-        char ip_str[16];
-        sprintf(ip_str, IPSTR, IP2STR(&ip_info.ip));
-        cJSON_AddStringToObject(resp, "ip", ip_str);
-        cJSON_AddStringToObject(resp, "message", "连接成功");
-        
-        char *json_str = cJSON_Print(resp);
-        httpd_resp_sendstr(req, json_str);
-        
-        free(json_str);
-        cJSON_Delete(resp);
+        cJSON_AddBoolToObject(resp, "pending", true);
+        cJSON_AddNumberToObject(resp, "op", op);
+        cJSON_AddStringToObject(resp, "status_url", status_url);
+        cJSON_AddStringToObject(resp, "message", "正在连接");
     } else {
-        // 连接失败，提供详细的错误信息
-        const char *error_msg;
-        if (connect_ret == ESP_FAIL) {
-            error_msg = "连接失败，请检查WiFi密码是否正确";
-        } else if (connect_ret == ESP_ERR_TIMEOUT) {
-            error_msg = "连接超时，请确认WiFi网络可用";
-        } else {
-            error_msg = "连接出错，请重试";
-        }
-        
-        cJSON *resp = cJSON_CreateObject();
+        httpd_resp_set_status(req, connect_ret == ESP_ERR_INVALID_ARG ? "400 Bad Request" : "503 Service Unavailable");
         cJSON_AddBoolToObject(resp, "success", false);
-        cJSON_AddStringToObject(resp, "message", error_msg);
+        cJSON_AddStringToObject(resp, "message",
+                                connect_ret == ESP_ERR_INVALID_ARG ? "SSID或密码过长" : "连接出错，请重试");
         cJSON_AddNumberToObject(resp, "error_code", connect_ret);
-        
-        char *json_str = cJSON_Print(resp);
-        httpd_resp_sendstr(req, json_str);
-        
-        free(json_str);
-        cJSON_Delete(resp);
     }
-    
-    cJSON_Delete(root);
+
+    char *json_str = cJSON_PrintUnformatted(resp);
+    httpd_resp_sendstr(req, json_str);
+    free(json_str);
+    cJSON_Delete(resp);
+    return ESP_OK;
+}
+
+// 连接结果对应的提示
+static const char *wifi_connect_message(wifi_connect_result_t result)
+{
+    switch (result) {
+        case WIFI_CONNECT_RESULT_PENDING: return "正在连接...";
+        case WIFI_CONNECT_RESULT_OK: return "连接成功";
+        case WIFI_CONNECT_RESULT_AUTH_FAILED: return "连接失败，请检查WiFi密码是否正确";
+        case WIFI_CONNECT_RESULT_NO_AP_FOUND: return "找不到该WiFi网络，请确认网络可用";
+        case WIFI_CONNECT_RESULT_TIMEOUT: return "连接超时，请确认WiFi网络可用";
+        case WIFI_CONNECT_RESULT_SUPERSEDED: return "已被新的连接请求取代";
+        case WIFI_CONNECT_RESULT_FAILED: return "连接失败，请重试";
+        default: return "连接出错，请重试";
+    }
+}
+
+// WiFi连接状态API：GET /api/wifi/connect/status?op=<句柄>，省略op时返回最近一次请求
+static esp_err_t wifi_connect_status_handler(httpd_req_t *req)
+{
+    char query[32];
+    char op_str[12];
+    wifi_connect_op_t op = 0;
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        httpd_query_key_value(query, "op", op_str, sizeof(op_str)) == ESP_OK) {
+        op = (wifi_connect_op_t)strtoul(op_str, NULL, 10);
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+
+    wifi_connect_status_t status;
+    if (wifi_manager_get_connect_status(op, &status) != ESP_OK) {
+        httpd_resp_set_status(req, "404 Not Found");
+        httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"连接请求不存在\"}");
+        return ESP_OK;
+    }
+
+    bool done = status.result != WIFI_CONNECT_RESULT_PENDING;
+    cJSON *resp = cJSON_CreateObject();
+    cJSON_AddBoolToObject(resp, "success", status.result == WIFI_CONNECT_RESULT_OK);
+    cJSON_AddBoolToObject(resp, "done", done);
+    cJSON_AddNumberToObject(resp, "op", status.op);
+    cJSON_AddStringToObject(resp, "state", wifi_manager_connect_result_name(status.result));
+    cJSON_AddStringToObject(resp, "ssid", status.ssid);
+    cJSON_AddNumberToObject(resp, "reason", status.reason);
+    cJSON_AddNumberToObject(resp, "attempts", status.attempts);
+    cJSON_AddNumberToObject(resp, "elapsed_ms", status.elapsed_ms);
+    if (status.result == WIFI_CONNECT_RESULT_OK) {
+        char ip_str[16];
+        snprintf(ip_str, sizeof(ip_str), IPSTR, IP2STR((esp_ip4_addr_t *)&status.ip));
+        cJSON_AddStringToObject(resp, "ip", ip_str);
+    }
+    cJSON_AddStringToObject(resp, "message", wifi_connect_message(status.result));
+
+    char *json_str = cJSON_PrintUnformatted(resp);
+    httpd_resp_sendstr(req, json_str);
+    free(json_str);
+    cJSON_Delete(resp);
     return ESP_OK;
 }
 
@@ -1106,32 +1974,38 @@ static esp_err_t ws_handler(httpd_req_t *req)
     if (req->method == HTTP_GET) {
         ESP_LOGI(TAG, "WebSocket握手");
         
-        // 添加客户端
+        // 添加客户端，新订阅者到来时高频采样一段时间
         add_ws_client(httpd_req_to_sockfd(req));
+        pc_monitor_notify_subscriber();
         
-        // 初始发送PC状态
-        pc_state_t state = pc_monitor_get_state();
-        
-        httpd_ws_frame_t ws_pkt;
-        memset(&ws_pkt, 0, sizeof(httpd_ws_frame_t));
-        
-        cJSON *root = cJSON_CreateObject();
-        cJSON_AddStringToObject(root, "event", "pc_state");
-        cJSON_AddBoolToObject(root, "is_on", state == PC_STATE_ON);
-        
-        char *json_str = cJSON_Print(root);
-        
-        ws_pkt.payload = (uint8_t *)json_str;
-        ws_pkt.len = strlen(json_str);
-        ws_pkt.type = HTTPD_WS_TYPE_TEXT;
-        
-        esp_err_t ret = httpd_ws_send_frame(req, &ws_pkt);
-        if (ret != ESP_OK) {
-            ESP_LOGE(TAG, "发送WebSocket消息失败: %d", ret);
+        // 初始发送每台机器的状态
+        for (uint8_t i = 0; i < pc_monitor_machine_count(); i++) {
+            pc_machine_info_t info;
+            if (pc_monitor_get_machine(i, &info) != ESP_OK) {
+                continue;
+            }
+
+            httpd_ws_frame_t ws_pkt;
+            memset(&ws_pkt, 0, sizeof(httpd_ws_frame_t));
+            
+            cJSON *root = create_pc_state_json(i, info.state);
+            char *json_str = cJSON_Print(root);
+            cJSON_Delete(root);
+            if (json_str == NULL) {
+                break;
+            }
+            
+            ws_pkt.payload = (uint8_t *)json_str;
+            ws_pkt.len = strlen(json_str);
+            ws_pkt.type = HTTPD_WS_TYPE_TEXT;
+            
+            esp_err_t ret = httpd_ws_send_frame(req, &ws_pkt);
+            free(json_str);
+            if (ret != ESP_OK) {
+                ESP_LOGE(TAG, "发送WebSocket消息失败: %d", ret);
+                break;
+            }
         }
-        
-        free(json_str);
-        cJSON_Delete(root);
     }
     
     httpd_ws_frame_t ws_pkt;
@@ -1210,8 +2084,32 @@ static esp_err_t ws_handler(httpd_req_t *req)
             }
         }
         
-        // 这里可以处理其他客户端发来的消息
-        // ...
+        // 主题订阅：{"type":"subscribe","topic":"scan"|"link"}
+        cJSON *msg = cJSON_Parse((const char *)ws_pkt.payload);
+        if (msg != NULL) {
+            cJSON *type = cJSON_GetObjectItem(msg, "type");
+            cJSON *topic = cJSON_GetObjectItem(msg, "topic");
+            uint8_t topic_bit = 0;
+            if (cJSON_IsString(topic)) {
+                if (strcmp(topic->valuestring, "scan") == 0) {
+                    topic_bit = WS_TOPIC_SCAN;
+                } else if (strcmp(topic->valuestring, "link") == 0) {
+                    topic_bit = WS_TOPIC_LINK;
+                }
+            }
+            if (cJSON_IsString(type) && topic_bit != 0) {
+                bool subscribe = strcmp(type->valuestring, "subscribe") == 0;
+                if (subscribe || strcmp(type->valuestring, "unsubscribe") == 0) {
+                    set_ws_client_topic(httpd_req_to_sockfd(req), topic_bit, subscribe);
+                }
+                if (subscribe && topic_bit == WS_TOPIC_SCAN) {
+                    // 先推送当前结果，再启动（或加入）一轮渐进式扫描
+                    wifi_manager_scan_request();
+                    queue_scan_push();
+                }
+            }
+            cJSON_Delete(msg);
+        }
     } else if (ws_pkt.type == HTTPD_WS_TYPE_PING) {
         // 自动回复PONG
         memset(&ws_pkt, 0, sizeof(httpd_ws_frame_t));
@@ -1225,98 +2123,9 @@ static esp_err_t ws_handler(httpd_req_t *req)
     }
     
     free(buf);
-    return ESP_OK;
-}
-
-// Captive Portal请求处理函数（处理各种设备的连接测试URL）
-static esp_err_t captive_portal_handler(httpd_req_t *req)
-{
-    ESP_LOGI(TAG, "Captive Portal请求: %s", req->uri);
-
-    // 获取User-Agent信息用于调试
-    size_t ua_len = httpd_req_get_hdr_value_len(req, "User-Agent");
-    if (ua_len > 0 && ua_len < 200) {
-        char *ua_buf = malloc(ua_len + 1);
-        if (ua_buf) {
-            if (httpd_req_get_hdr_value_str(req, "User-Agent", ua_buf, ua_len + 1) == ESP_OK) {
-                ESP_LOGI(TAG, "User-Agent: %s", ua_buf);
-            }
-            free(ua_buf);
-        }
-    }
-
-    // 检查WiFi模式
-    wifi_working_mode_t mode = wifi_manager_get_mode();
-
-    // 检查Host头部信息
-    size_t host_len = httpd_req_get_hdr_value_len(req, "Host");
-    if (host_len > 0) {
-        char *host_buf = malloc(host_len + 1);
-        if (host_buf) {
-            if (httpd_req_get_hdr_value_str(req, "Host", host_buf, host_len + 1) == ESP_OK) {
-                ESP_LOGI(TAG, "Host头: %s", host_buf);
-            }
-            free(host_buf);
-        }
-    }
-    
-    // 根据不同的检测URL和模式返回适当的响应
-    // 注意：现在统一使用APSTA模式，通过STA连接状态判断是否需要配网
-
-    // 检查STA是否已连接到WiFi
-    bool sta_connected = false;
-    wifi_ap_record_t ap_info;
-    if (esp_wifi_sta_get_ap_info(&ap_info) == ESP_OK) {
-        sta_connected = true;
-        ESP_LOGI(TAG, "STA已连接到: %s", ap_info.ssid);
-    }
-
-    // 修复逻辑：无论STA是否连接，通过AP访问都应该强制登录
-    // 所有Captive Portal检测都重定向到登录页面，而不是配网页面
-
-    ESP_LOGI(TAG, "Captive Portal检测，重定向到登录页面 (STA连接状态: %s)",
-             sta_connected ? "已连接" : "未连接");
-
-    if (strcmp(req->uri, "/generate_204") == 0) {
-        // Android/Chrome OS检测 - 重定向到登录页面
-        ESP_LOGI(TAG, "Android/Chrome OS检测，重定向到登录页面");
-        httpd_resp_set_status(req, "302 Found");
-        httpd_resp_set_hdr(req, "Location", "http://192.168.4.1/login");
-        httpd_resp_set_hdr(req, "Cache-Control", "no-cache, no-store, must-revalidate");
-        httpd_resp_send(req, NULL, 0);
-        return ESP_OK;
-    }
-    else if (strcmp(req->uri, "/hotspot-detect.html") == 0) {
-        // iOS/macOS检测 - 重定向到登录页面
-        ESP_LOGI(TAG, "iOS/macOS检测，重定向到登录页面");
-        httpd_resp_set_status(req, "302 Found");
-        httpd_resp_set_hdr(req, "Location", "http://192.168.4.1/login");
-        httpd_resp_set_hdr(req, "Cache-Control", "no-cache, no-store, must-revalidate");
-        httpd_resp_send(req, NULL, 0);
-        return ESP_OK;
-    }
-    else if (strcmp(req->uri, "/ncsi.txt") == 0 || strcmp(req->uri, "/connecttest.txt") == 0) {
-        // Windows检测 - 重定向到登录页面
-        ESP_LOGI(TAG, "Windows检测，重定向到登录页面");
-        httpd_resp_set_status(req, "302 Found");
-        httpd_resp_set_hdr(req, "Location", "http://192.168.4.1/login");
-        httpd_resp_set_hdr(req, "Cache-Control", "no-cache, no-store, must-revalidate");
-        httpd_resp_send(req, NULL, 0);
-        return ESP_OK;
-    }
-    else {
-        // 其他Captive Portal请求 - 重定向到登录页面
-        ESP_LOGI(TAG, "其他Captive Portal请求: %s，重定向到登录页面", req->uri);
-        httpd_resp_set_status(req, "302 Found");
-        httpd_resp_set_hdr(req, "Location", "http://192.168.4.1/login");
-        httpd_resp_set_hdr(req, "Cache-Control", "no-cache, no-store, must-revalidate");
-        httpd_resp_send(req, NULL, 0);
-        return ESP_OK;
-    }
+    return ESP_OK;
 }
 
-
-
 // 从NVS中保存用户名和密码
 static esp_err_t save_auth_credentials(const char *username, const char *password)
 {
@@ -1433,6 +2242,11 @@ static esp_err_t auth_post_handler(httpd_req_t *req)
 {
     char buf[128];
     int ret, remaining = req->content_len;
+
+    // 按来源IP限制登录尝试频率，防止暴力破解
+    if (!conn_manager_auth_attempt(req)) {
+        return conn_manager_send_limited(req);
+    }
     
     if (remaining > sizeof(buf) - 1) {
         httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "内容太长");
@@ -1483,6 +2297,8 @@ static esp_err_t auth_post_handler(httpd_req_t *req)
     if (auth_success) {
         // 认证成功，创建新session
         create_new_session();
+        conn_manager_auth_succeeded(req);
+        captive_portal_release(req);
         cJSON_AddStringToObject(resp, "session_token", current_session_token);
         cJSON_AddStringToObject(resp, "message", "登录成功");
 
@@ -1641,15 +2457,451 @@ static esp_err_t test_get_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
+// 采样分析器控制API - 开始采样
+static esp_err_t profiler_start_handler(httpd_req_t *req)
+{
+    httpd_resp_set_type(req, "application/json");
+
+    if (!check_authentication(req)) {
+        httpd_resp_set_status(req, "401 Unauthorized");
+        httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"未认证，请先登录\"}");
+        return ESP_OK;
+    }
+
+    // 可选参数 ?rate=采样频率Hz
+    uint32_t rate_hz = 0;
+    char query[32];
+    char rate_str[8];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        httpd_query_key_value(query, "rate", rate_str, sizeof(rate_str)) == ESP_OK) {
+        rate_hz = (uint32_t)strtoul(rate_str, NULL, 10);
+    }
+
+    esp_err_t ret = sampling_profiler_start(rate_hz);
+    if (ret != ESP_OK) {
+        httpd_resp_set_status(req, "400 Bad Request");
+        httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"无法开始采样\"}");
+        return ESP_OK;
+    }
+
+    httpd_resp_sendstr(req, "{\"success\":true,\"message\":\"采样已开始\"}");
+    return ESP_OK;
+}
+
+// 采样分析器控制API - 停止采样并返回统计
+static esp_err_t profiler_stop_handler(httpd_req_t *req)
+{
+    httpd_resp_set_type(req, "application/json");
+
+    if (!check_authentication(req)) {
+        httpd_resp_set_status(req, "401 Unauthorized");
+        httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"未认证，请先登录\"}");
+        return ESP_OK;
+    }
+
+    sampling_profiler_stop();
+
+    sampling_profiler_stats_t stats;
+    sampling_profiler_get_stats(&stats);
+
+    cJSON *resp = cJSON_CreateObject();
+    cJSON_AddBoolToObject(resp, "success", true);
+    cJSON_AddNumberToObject(resp, "sample_rate_hz", stats.sample_rate_hz);
+    cJSON_AddNumberToObject(resp, "duration_ms", stats.duration_ms);
+    cJSON_AddNumberToObject(resp, "total_samples", stats.total_samples);
+    cJSON_AddNumberToObject(resp, "idle_samples", stats.idle_samples);
+    cJSON_AddNumberToObject(resp, "dropped_samples", stats.dropped_samples);
+    cJSON_AddNumberToObject(resp, "entries", stats.entry_count);
+
+    char *json_str = cJSON_Print(resp);
+    httpd_resp_sendstr(req, json_str);
+
+    free(json_str);
+    cJSON_Delete(resp);
+    return ESP_OK;
+}
+
+// 采样数据分块发送的上下文，started表示已有数据发出，之后不能再改状态码
+typedef struct {
+    httpd_req_t *req;
+    bool started;
+} profiler_dump_ctx_t;
+
+// 采样数据写回调，分块发送到HTTP响应
+static esp_err_t profiler_write_chunk(void *ctx, const void *data, size_t len)
+{
+    profiler_dump_ctx_t *dump = (profiler_dump_ctx_t *)ctx;
+    dump->started = true;
+    return httpd_resp_send_chunk(dump->req, (const char *)data, len);
+}
+
+// 采样分析器控制API - 下载二进制直方图（配合tools/profiler_flamegraph.py使用）
+static esp_err_t profiler_dump_handler(httpd_req_t *req)
+{
+    if (!check_authentication(req)) {
+        httpd_resp_set_status(req, "401 Unauthorized");
+        httpd_resp_set_type(req, "application/json");
+        httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"未认证，请先登录\"}");
+        return ESP_OK;
+    }
+
+    httpd_resp_set_type(req, "application/octet-stream");
+    httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"profile.bin\"");
+
+    profiler_dump_ctx_t dump = { .req = req, .started = false };
+    esp_err_t ret = sampling_profiler_export(profiler_write_chunk, &dump);
+    if (ret == ESP_OK) {
+        return httpd_resp_send_chunk(req, NULL, 0);
+    }
+
+    ESP_LOGW(TAG, "导出采样数据失败: %s", esp_err_to_name(ret));
+    if (dump.started) {
+        // 已经发出部分数据，返回错误让httpd关闭连接，客户端据此发现数据不完整
+        return ret;
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    switch (ret) {
+        case ESP_ERR_INVALID_STATE:
+            httpd_resp_set_status(req, "409 Conflict");
+            httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"请先停止采样\"}");
+            break;
+        case ESP_ERR_NOT_FOUND:
+            httpd_resp_set_status(req, "404 Not Found");
+            httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"没有采样数据\"}");
+            break;
+        default:
+            httpd_resp_set_status(req, "500 Internal Server Error");
+            httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"导出采样数据失败\"}");
+            break;
+    }
+    return ESP_OK;
+}
+
+// 服务器运行统计API - 内存、准入控制、连接表、DNS和门户探测统计
+static esp_err_t server_stats_handler(httpd_req_t *req)
+{
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+
+    if (!check_authentication(req)) {
+        httpd_resp_set_status(req, "401 Unauthorized");
+        httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"未认证，请先登录\"}");
+        return ESP_OK;
+    }
+
+    cJSON *root = cJSON_CreateObject();
+    if (root == NULL) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+    cJSON_AddBoolToObject(root, "success", true);
+
+    cJSON *heap = cJSON_AddObjectToObject(root, "heap");
+    cJSON_AddNumberToObject(heap, "free", heap_caps_get_free_size(MALLOC_CAP_8BIT));
+    cJSON_AddNumberToObject(heap, "largest_block", heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+    cJSON_AddNumberToObject(heap, "min_free", esp_get_minimum_free_heap_size());
+
+    cJSON *admission = cJSON_AddArrayToObject(root, "admission");
+    for (int i = 0; i < ADMISSION_CLASS_COUNT; i++) {
+        admission_stats_t stats;
+        admission_get_stats((admission_class_t)i, &stats);
+
+        cJSON *item = cJSON_CreateObject();
+        cJSON_AddStringToObject(item, "class", admission_class_name((admission_class_t)i));
+        cJSON_AddNumberToObject(item, "admitted", stats.admitted);
+        cJSON_AddNumberToObject(item, "shed_heap", stats.shed_heap);
+        cJSON_AddItemToArray(admission, item);
+    }
+
+    conn_stats_t conn_stats;
+    conn_manager_get_stats(&conn_stats);
+
+    cJSON *conns = cJSON_AddObjectToObject(root, "connections");
+    cJSON_AddNumberToObject(conns, "open", conn_stats.open);
+    cJSON_AddNumberToObject(conns, "max", conn_stats.max_sockets);
+    cJSON_AddNumberToObject(conns, "peak", conn_stats.peak);
+    cJSON_AddNumberToObject(conns, "accepted", conn_stats.accepted);
+    cJSON_AddNumberToObject(conns, "rejected_per_ip", conn_stats.rejected_per_ip);
+    cJSON_AddNumberToObject(conns, "idle_evicted", conn_stats.idle_evicted);
+    cJSON_AddNumberToObject(conns, "rate_limited", conn_stats.rate_limited);
+    cJSON_AddNumberToObject(conns, "auth_limited", conn_stats.auth_limited);
+    cJSON_AddNumberToObject(conns, "idle_timeout_ms", conn_stats.idle_timeout_ms);
+
+    conn_info_t sockets[8];
+    size_t socket_count = conn_manager_snapshot(sockets, sizeof(sockets) / sizeof(sockets[0]));
+    cJSON *socket_list = cJSON_AddArrayToObject(conns, "sockets");
+    for (size_t i = 0; i < socket_count; i++) {
+        char ip_str[16];
+        esp_ip4_addr_t ip = { .addr = sockets[i].ip };
+        esp_ip4addr_ntoa(&ip, ip_str, sizeof(ip_str));
+
+        cJSON *item = cJSON_CreateObject();
+        cJSON_AddNumberToObject(item, "fd", sockets[i].fd);
+        cJSON_AddStringToObject(item, "ip", ip_str);
+        cJSON_AddNumberToObject(item, "age_ms", sockets[i].age_ms);
+        cJSON_AddNumberToObject(item, "idle_ms", sockets[i].idle_ms);
+        cJSON_AddNumberToObject(item, "requests", sockets[i].requests);
+        cJSON_AddBoolToObject(item, "websocket", sockets[i].websocket);
+        cJSON_AddItemToArray(socket_list, item);
+    }
+
+    wifi_dns_stats_t dns_stats;
+    wifi_manager_get_dns_stats(&dns_stats);
+
+    cJSON *dns = cJSON_AddObjectToObject(root, "dns");
+    cJSON_AddBoolToObject(dns, "running", dns_stats.running);
+    cJSON_AddNumberToObject(dns, "queries", dns_stats.queries);
+    cJSON_AddNumberToObject(dns, "responses", dns_stats.responses);
+    cJSON_AddNumberToObject(dns, "dropped", dns_stats.dropped);
+    cJSON_AddNumberToObject(dns, "answers", dns_stats.answers);
+    cJSON_AddNumberToObject(dns, "nodata", dns_stats.nodata);
+    cJSON_AddNumberToObject(dns, "errors", dns_stats.errors);
+    cJSON_AddNumberToObject(dns, "truncated", dns_stats.truncated);
+    cJSON_AddNumberToObject(dns, "last_latency_us", dns_stats.last_latency_us);
+    cJSON_AddNumberToObject(dns, "avg_latency_us", dns_stats.avg_latency_us);
+    cJSON_AddNumberToObject(dns, "max_latency_us", dns_stats.max_latency_us);
+    cJSON_AddBoolToObject(dns, "forwarding", dns_stats.forwarding);
+    if (dns_stats.forwarding) {
+        char upstream_str[16];
+        esp_ip4_addr_t upstream = { .addr = dns_stats.upstream };
+        esp_ip4addr_ntoa(&upstream, upstream_str, sizeof(upstream_str));
+        cJSON_AddStringToObject(dns, "upstream", upstream_str);
+    }
+    cJSON_AddNumberToObject(dns, "cache_entries", dns_stats.cache_entries);
+    cJSON_AddNumberToObject(dns, "cache_hits", dns_stats.cache_hits);
+    cJSON_AddNumberToObject(dns, "cache_negative_hits", dns_stats.cache_negative_hits);
+    cJSON_AddNumberToObject(dns, "cache_misses", dns_stats.cache_misses);
+    cJSON_AddNumberToObject(dns, "forwarded", dns_stats.forwarded);
+    cJSON_AddNumberToObject(dns, "forward_full", dns_stats.forward_full);
+    cJSON_AddNumberToObject(dns, "upstream_responses", dns_stats.upstream_responses);
+    cJSON_AddNumberToObject(dns, "upstream_timeouts", dns_stats.upstream_timeouts);
+    cJSON_AddNumberToObject(dns, "upstream_avg_latency_us", dns_stats.upstream_avg_latency_us);
+
+    wifi_connect_stats_t connect_stats;
+    wifi_manager_get_connect_stats(&connect_stats);
+
+    cJSON *wifi = cJSON_AddObjectToObject(root, "wifi");
+    cJSON_AddNumberToObject(wifi, "boot_to_ip_ms", connect_stats.boot_to_ip_ms);
+    cJSON_AddNumberToObject(wifi, "last_connect_ms", connect_stats.last_connect_ms);
+    cJSON_AddBoolToObject(wifi, "last_fast", connect_stats.last_fast);
+    cJSON_AddNumberToObject(wifi, "connects", connect_stats.connects);
+    cJSON_AddNumberToObject(wifi, "fast_attempts", connect_stats.fast_attempts);
+    cJSON_AddNumberToObject(wifi, "fast_successes", connect_stats.fast_successes);
+    cJSON_AddNumberToObject(wifi, "fast_fallbacks", connect_stats.fast_fallbacks);
+    cJSON_AddNumberToObject(wifi, "network_switches", connect_stats.network_switches);
+    cJSON_AddNumberToObject(wifi, "roams", connect_stats.roams);
+    cJSON_AddBoolToObject(wifi, "fast_hint_valid", connect_stats.fast_hint_valid);
+    cJSON_AddNumberToObject(wifi, "fast_hint_channel", connect_stats.fast_hint_channel);
+    cJSON_AddNumberToObject(wifi, "reconnect_state", connect_stats.reconnect_state);
+    cJSON_AddNumberToObject(wifi, "reconnect_delay_ms", connect_stats.reconnect_delay_ms);
+    cJSON_AddNumberToObject(wifi, "backoff_retries", connect_stats.backoff_retries);
+    cJSON_AddNumberToObject(wifi, "failed_rounds", connect_stats.failed_rounds);
+
+    wifi_channel_stats_t channel_stats;
+    wifi_manager_get_channel_stats(&channel_stats);
+
+    cJSON *channel = cJSON_AddObjectToObject(root, "channel");
+    cJSON_AddNumberToObject(channel, "ap_channel", channel_stats.ap_channel);
+    cJSON_AddNumberToObject(channel, "recommended", channel_stats.recommended_channel);
+    cJSON_AddNumberToObject(channel, "idle_moves", channel_stats.idle_moves);
+    cJSON_AddNumberToObject(channel, "pre_moves", channel_stats.pre_moves);
+    cJSON_AddNumberToObject(channel, "forced_follows", channel_stats.forced_follows);
+    cJSON_AddNumberToObject(channel, "move_failures", channel_stats.move_failures);
+    cJSON_AddNumberToObject(channel, "ap_disconnects", channel_stats.ap_disconnects);
+    cJSON *last_switch = cJSON_AddObjectToObject(channel, "last_switch");
+    cJSON_AddNumberToObject(last_switch, "from", channel_stats.last_from);
+    cJSON_AddNumberToObject(last_switch, "to", channel_stats.last_to);
+    cJSON_AddBoolToObject(last_switch, "settling", channel_stats.settling);
+    cJSON_AddNumberToObject(last_switch, "clients_before", channel_stats.clients_before);
+    cJSON_AddNumberToObject(last_switch, "clients_after", channel_stats.clients_after);
+    cJSON_AddNumberToObject(last_switch, "disconnects_after", channel_stats.disconnects_after);
+    cJSON_AddNumberToObject(last_switch, "rx_bytes_per_s_before", channel_stats.rx_bytes_per_s_before);
+    cJSON_AddNumberToObject(last_switch, "rx_bytes_per_s_after", channel_stats.rx_bytes_per_s_after);
+    cJSON_AddNumberToObject(last_switch, "tx_bytes_per_s_before", channel_stats.tx_bytes_per_s_before);
+    cJSON_AddNumberToObject(last_switch, "tx_bytes_per_s_after", channel_stats.tx_bytes_per_s_after);
+
+    wifi_link_stats_t link_stats;
+    wifi_manager_get_link_stats(&link_stats);
+
+    cJSON *link = cJSON_AddObjectToObject(root, "link");
+    cJSON_AddNumberToObject(link, "samples", link_stats.samples);
+    cJSON_AddBoolToObject(link, "trend_valid", link_stats.trend_valid);
+    cJSON_AddNumberToObject(link, "rssi_avg", link_stats.rssi_avg);
+    cJSON_AddNumberToObject(link, "rssi_slope", link_stats.rssi_slope);
+    cJSON_AddNumberToObject(link, "rssi_predicted", link_stats.rssi_predicted);
+    cJSON_AddNumberToObject(link, "beacon_timeouts", link_stats.beacon_timeouts);
+    cJSON_AddNumberToObject(link, "early_scans", link_stats.early_scans);
+    cJSON_AddNumberToObject(link, "predictive_roams", link_stats.predictive_roams);
+    cJSON_AddNumberToObject(link, "proactive_reconnects", link_stats.proactive_reconnects);
+
+    pc_monitor_stats_t pc_stats;
+    pc_monitor_get_stats(&pc_stats);
+
+    cJSON *pc = cJSON_AddObjectToObject(root, "pc_monitor");
+    cJSON_AddBoolToObject(pc, "interrupt_driven", pc_stats.interrupt_driven);
+    cJSON_AddNumberToObject(pc, "debounce_ms", pc_stats.debounce_ms);
+    cJSON_AddNumberToObject(pc, "edges", pc_stats.edges);
+    cJSON_AddNumberToObject(pc, "edge_overflows", pc_stats.edge_overflows);
+    cJSON_AddNumberToObject(pc, "transitions", pc_stats.transitions);
+    cJSON_AddNumberToObject(pc, "glitches", pc_stats.glitches);
+    cJSON_AddNumberToObject(pc, "polls", pc_stats.polls);
+    cJSON_AddNumberToObject(pc, "fast_samples", pc_stats.fast_samples);
+    cJSON_AddNumberToObject(pc, "poll_interval_ms", pc_stats.interval_ms);
+    cJSON_AddNumberToObject(pc, "detects", pc_stats.detects);
+    cJSON_AddNumberToObject(pc, "detect_misses", pc_stats.detect_misses);
+    cJSON_AddNumberToObject(pc, "avg_detect_ms", pc_stats.avg_detect_ms);
+    cJSON_AddNumberToObject(pc, "poll_corrections", pc_stats.poll_corrections);
+    cJSON_AddNumberToObject(pc, "i2c_reads", pc_stats.i2c_reads);
+    cJSON_AddNumberToObject(pc, "last_latency_us", pc_stats.last_latency_us);
+    cJSON_AddNumberToObject(pc, "avg_latency_us", pc_stats.avg_latency_us);
+    cJSON_AddNumberToObject(pc, "max_latency_us", pc_stats.max_latency_us);
+    cJSON_AddNumberToObject(pc, "last_wake_us", pc_stats.last_wake_us);
+    cJSON_AddNumberToObject(pc, "max_wake_us", pc_stats.max_wake_us);
+
+    pm_lock_status_t pm_status;
+    pm_lock_get_status(&pm_status);
+
+    // httpd锁的平均持有时间即请求处理耗时，用于对比开启调频前后的延迟
+    cJSON *pm = cJSON_AddObjectToObject(root, "pm");
+    cJSON_AddBoolToObject(pm, "enabled", pm_status.enabled);
+    cJSON_AddBoolToObject(pm, "light_sleep", pm_status.light_sleep);
+    cJSON_AddNumberToObject(pm, "max_freq_mhz", pm_status.max_freq_mhz);
+    cJSON_AddNumberToObject(pm, "min_freq_mhz", pm_status.min_freq_mhz);
+    cJSON_AddNumberToObject(pm, "uptime_ms", (double)(pm_status.uptime_us / 1000));
+    cJSON_AddNumberToObject(pm, "any_held_ms", (double)(pm_status.any_held_us / 1000));
+    cJSON *pm_locks = cJSON_AddArrayToObject(pm, "locks");
+    for (int i = 0; i < PM_LOCK_COUNT; i++) {
+        const pm_lock_stats_t *lock = &pm_status.locks[i];
+        cJSON *item = cJSON_CreateObject();
+        cJSON_AddStringToObject(item, "name", pm_lock_name((pm_lock_id_t)i));
+        cJSON_AddNumberToObject(item, "acquires", lock->acquires);
+        cJSON_AddNumberToObject(item, "holds", lock->holds);
+        cJSON_AddNumberToObject(item, "active", lock->active);
+        cJSON_AddNumberToObject(item, "held_ms", (double)(lock->held_us / 1000));
+        cJSON_AddNumberToObject(item, "avg_hold_us", lock->holds > 0 ? (double)(lock->held_us / lock->holds) : 0);
+        cJSON_AddNumberToObject(item, "last_hold_us", lock->last_hold_us);
+        cJSON_AddNumberToObject(item, "max_hold_us", lock->max_hold_us);
+        cJSON_AddItemToArray(pm_locks, item);
+    }
+
+    i2c_bus_stats_t bus_stats;
+    i2c_bus_get_stats(&bus_stats);
+
+    cJSON *bus = cJSON_AddObjectToObject(root, "i2c_bus");
+    cJSON_AddBoolToObject(bus, "installed", bus_stats.installed);
+    cJSON_AddNumberToObject(bus, "transactions", bus_stats.transactions);
+    cJSON_AddNumberToObject(bus, "batches", bus_stats.batches);
+    cJSON_AddNumberToObject(bus, "nacks", bus_stats.nacks);
+    cJSON_AddNumberToObject(bus, "timeouts", bus_stats.timeouts);
+    cJSON_AddNumberToObject(bus, "errors", bus_stats.errors);
+    cJSON_AddNumberToObject(bus, "recoveries", bus_stats.recoveries);
+    cJSON_AddNumberToObject(bus, "recovery_failures", bus_stats.recovery_failures);
+    cJSON_AddNumberToObject(bus, "lock_timeouts", bus_stats.lock_timeouts);
+    cJSON_AddNumberToObject(bus, "max_lock_wait_us", bus_stats.max_lock_wait_us);
+    cJSON *bus_devices = cJSON_AddArrayToObject(bus, "devices");
+    for (uint8_t i = 0; i < bus_stats.devices; i++) {
+        i2c_bus_device_stats_t dev;
+        if (i2c_bus_get_device_stats(i, &dev) != ESP_OK) {
+            continue;
+        }
+        cJSON *item = cJSON_CreateObject();
+        cJSON_AddNumberToObject(item, "addr", dev.addr);
+        cJSON_AddNumberToObject(item, "transactions", dev.transactions);
+        cJSON_AddNumberToObject(item, "nacks", dev.nacks);
+        cJSON_AddNumberToObject(item, "timeouts", dev.timeouts);
+        cJSON_AddNumberToObject(item, "last_latency_us", dev.last_latency_us);
+        cJSON_AddNumberToObject(item, "avg_latency_us", dev.avg_latency_us);
+        cJSON_AddNumberToObject(item, "max_latency_us", dev.max_latency_us);
+        cJSON_AddItemToArray(bus_devices, item);
+    }
+
+    wifi_event_loop_stats_t loop_stats;
+    wifi_manager_get_event_loop_stats(&loop_stats);
+
+    cJSON *event_loop = cJSON_AddObjectToObject(root, "event_loop");
+    cJSON_AddNumberToObject(event_loop, "probes", loop_stats.probes);
+    cJSON_AddNumberToObject(event_loop, "post_failures", loop_stats.post_failures);
+    cJSON_AddNumberToObject(event_loop, "last_latency_us", loop_stats.last_latency_us);
+    cJSON_AddNumberToObject(event_loop, "avg_latency_us", loop_stats.avg_latency_us);
+    cJSON_AddNumberToObject(event_loop, "max_latency_us", loop_stats.max_latency_us);
+    cJSON_AddNumberToObject(event_loop, "handler_calls", loop_stats.handler_calls);
+    cJSON_AddNumberToObject(event_loop, "handler_avg_us", loop_stats.handler_avg_us);
+    cJSON_AddNumberToObject(event_loop, "handler_max_us", loop_stats.handler_max_us);
+
+    wifi_scan_stats_t scan_stats;
+    wifi_manager_get_scan_stats(&scan_stats);
+
+    cJSON *scan = cJSON_AddObjectToObject(root, "scan");
+    cJSON_AddNumberToObject(scan, "requests", scan_stats.requests);
+    cJSON_AddNumberToObject(scan, "cache_hits", scan_stats.cache_hits);
+    cJSON_AddNumberToObject(scan, "waits", scan_stats.waits);
+    cJSON_AddNumberToObject(scan, "coalesced", scan_stats.coalesced);
+    cJSON_AddNumberToObject(scan, "started", scan_stats.started);
+    cJSON_AddNumberToObject(scan, "completed", scan_stats.completed);
+    cJSON_AddNumberToObject(scan, "failed", scan_stats.failed);
+    cJSON_AddNumberToObject(scan, "last_duration_ms", scan_stats.last_duration_ms);
+    cJSON_AddNumberToObject(scan, "last_seen", scan_stats.last_seen);
+    cJSON_AddNumberToObject(scan, "last_unique", scan_stats.last_unique);
+
+    captive_stats_t captive_stats;
+    captive_portal_get_stats(&captive_stats);
+
+    cJSON *captive = cJSON_AddObjectToObject(root, "captive");
+    cJSON_AddNumberToObject(captive, "probes", captive_stats.probes);
+    cJSON_AddNumberToObject(captive, "redirects", captive_stats.redirects);
+    cJSON_AddNumberToObject(captive, "success_responses", captive_stats.success_responses);
+    cJSON_AddNumberToObject(captive, "evictions", captive_stats.evictions);
+
+    captive_client_info_t clients[8];
+    size_t client_count = captive_portal_snapshot(clients, sizeof(clients) / sizeof(clients[0]));
+    cJSON *client_list = cJSON_AddArrayToObject(captive, "clients");
+    for (size_t i = 0; i < client_count; i++) {
+        char ip_str[16];
+        char mac_str[18] = "";
+        esp_ip4_addr_t ip = { .addr = clients[i].ip };
+        esp_ip4addr_ntoa(&ip, ip_str, sizeof(ip_str));
+        if (clients[i].has_mac) {
+            snprintf(mac_str, sizeof(mac_str), MACSTR, MAC2STR(clients[i].mac));
+        }
+
+        cJSON *item = cJSON_CreateObject();
+        cJSON_AddStringToObject(item, "ip", ip_str);
+        cJSON_AddStringToObject(item, "mac", mac_str);
+        cJSON_AddStringToObject(item, "state", captive_portal_state_name(clients[i].state));
+        cJSON_AddNumberToObject(item, "probes", clients[i].probes);
+        cJSON_AddNumberToObject(item, "probes_after_release", clients[i].probes_after_release);
+        cJSON_AddNumberToObject(item, "idle_ms", clients[i].idle_ms);
+        cJSON_AddItemToArray(client_list, item);
+    }
+
+    char *json_str = cJSON_Print(root);
+    cJSON_Delete(root);
+    if (json_str == NULL) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+
+    esp_err_t ret = httpd_resp_sendstr(req, json_str);
+    free(json_str);
+    return ret;
+}
+
 // 404错误处理函数
 static esp_err_t http_404_error_handler(httpd_req_t *req, httpd_err_code_t err)
 {
     ESP_LOGW(TAG, "404错误: %s", req->uri);
 
-    // 对于某些特定的路径，重定向到配网页面
-    if (strstr(req->uri, "/mmtls/") != NULL ||
+    // 对于某些特定的路径，重定向到配网页面（分实例运行时LAN实例不处理探测）
+    bool portal_active = !WEB_SERVER_SPLIT_INSTANCES || s_instance == WEB_INSTANCE_PORTAL;
+    if (portal_active && (strstr(req->uri, "/mmtls/") != NULL ||
         strstr(req->uri, "/wifi/") != NULL ||
-        strstr(req->uri, "/connecttest") != NULL) {
+        strstr(req->uri, "/connecttest") != NULL)) {
+
+        // 探测类请求按低优先级准入
+        if (!admission_try_enter(ADMISSION_CLASS_LOW)) {
+            return admission_send_shed(req, ADMISSION_CLASS_LOW);
+        }
 
         // 重定向到配网页面
         httpd_resp_set_status(req, "302 Found");
@@ -1674,198 +2926,281 @@ static esp_err_t http_404_error_handler(httpd_req_t *req, httpd_err_code_t err)
     return ESP_OK;
 }
 
-// 注册URL处理程序
-static void register_handlers(httpd_handle_t server)
+// 路由准入分类：开机、状态、认证和WebSocket为关键请求，静态页面、扫描和探测为低优先级
+static const admission_route_t s_route_root_get = { ADMISSION_CLASS_LOW, root_get_handler };
+static const admission_route_t s_route_favicon_get = { ADMISSION_CLASS_LOW, favicon_get_handler };
+static const admission_route_t s_route_setup_get = { ADMISSION_CLASS_LOW, setup_get_handler };
+static const admission_route_t s_route_login_get = { ADMISSION_CLASS_LOW, login_get_handler };
+static const admission_route_t s_route_status_get = { ADMISSION_CLASS_CRITICAL, status_get_handler };
+static const admission_route_t s_route_power_post = { ADMISSION_CLASS_CRITICAL, power_post_handler };
+static const admission_route_t s_route_machines_get = { ADMISSION_CLASS_NORMAL, machines_get_handler };
+static const admission_route_t s_route_capture_get = { ADMISSION_CLASS_NORMAL, capture_get_handler };
+static const admission_route_t s_route_wifi_scan = { ADMISSION_CLASS_LOW, wifi_scan_handler };
+static const admission_route_t s_route_wifi_connect = { ADMISSION_CLASS_NORMAL, wifi_connect_handler };
+static const admission_route_t s_route_wifi_connect_status = { ADMISSION_CLASS_CRITICAL, wifi_connect_status_handler };
+static const admission_route_t s_route_network_info = { ADMISSION_CLASS_NORMAL, network_info_handler };
+static const admission_route_t s_route_network_history = { ADMISSION_CLASS_LOW, network_history_handler };
+static const admission_route_t s_route_wifi_networks = { ADMISSION_CLASS_NORMAL, wifi_networks_get_handler };
+static const admission_route_t s_route_wifi_forget = { ADMISSION_CLASS_NORMAL, wifi_forget_post_handler };
+static const admission_route_t s_route_wifi_power_get = { ADMISSION_CLASS_NORMAL, wifi_power_get_handler };
+static const admission_route_t s_route_wifi_power_post = { ADMISSION_CLASS_NORMAL, wifi_power_post_handler };
+static const admission_route_t s_route_wifi_power_echo = { ADMISSION_CLASS_NORMAL, wifi_power_echo_handler, true };
+static const admission_route_t s_route_monitor_poll_get = { ADMISSION_CLASS_NORMAL, monitor_poll_get_handler };
+static const admission_route_t s_route_monitor_poll_post = { ADMISSION_CLASS_NORMAL, monitor_poll_post_handler };
+static const admission_route_t s_route_ws = { ADMISSION_CLASS_CRITICAL, ws_handler };
+static const admission_route_t s_route_captive_portal = { ADMISSION_CLASS_LOW, captive_portal_handle_probe };
+static const admission_route_t s_route_auth_post = { ADMISSION_CLASS_CRITICAL, auth_post_handler };
+static const admission_route_t s_route_logout = { ADMISSION_CLASS_CRITICAL, logout_handler };
+static const admission_route_t s_route_update_auth_post = { ADMISSION_CLASS_NORMAL, update_auth_post_handler };
+static const admission_route_t s_route_get_auth_info = { ADMISSION_CLASS_NORMAL, get_auth_info_handler };
+static const admission_route_t s_route_test_get = { ADMISSION_CLASS_LOW, test_get_handler };
+static const admission_route_t s_route_profiler_start = { ADMISSION_CLASS_NORMAL, profiler_start_handler };
+static const admission_route_t s_route_profiler_stop = { ADMISSION_CLASS_NORMAL, profiler_stop_handler };
+static const admission_route_t s_route_profiler_dump = { ADMISSION_CLASS_NORMAL, profiler_dump_handler };
+static const admission_route_t s_route_server_stats = { ADMISSION_CLASS_NORMAL, server_stats_handler };
+
+// 路由所属实例：LAN实例提供完整控制界面，配网实例只保留配网和探测所需的最小集合
+#define ROUTE_LAN      (1 << 0)
+#define ROUTE_PORTAL   (1 << 1)
+#define ROUTE_ALL      (ROUTE_LAN | ROUTE_PORTAL)
+
+typedef struct {
+    const char *uri;
+    httpd_method_t method;
+    const admission_route_t *route;
+    bool is_websocket;
+    uint8_t instances;
+} route_def_t;
+
+static const route_def_t s_routes[] = {
+    { "/",                    HTTP_GET,  &s_route_root_get,         false, ROUTE_ALL },
+    { "/favicon.ico",         HTTP_GET,  &s_route_favicon_get,      false, ROUTE_ALL },
+    { "/setup",               HTTP_GET,  &s_route_setup_get,        false, ROUTE_ALL },
+    { "/login",               HTTP_GET,  &s_route_login_get,        false, ROUTE_ALL },
+    { "/api/status",          HTTP_GET,  &s_route_status_get,       false, ROUTE_LAN },
+    { "/api/power",           HTTP_POST, &s_route_power_post,       false, ROUTE_LAN },
+    { "/api/machines",        HTTP_GET,  &s_route_machines_get,     false, ROUTE_LAN },
+    { "/api/capture",         HTTP_GET,  &s_route_capture_get,      false, ROUTE_LAN },
+    { "/api/wifi/scan",       HTTP_GET,  &s_route_wifi_scan,        false, ROUTE_ALL },
+    { "/api/wifi/connect",    HTTP_POST, &s_route_wifi_connect,     false, ROUTE_ALL },
+    { "/api/wifi/connect/status", HTTP_GET, &s_route_wifi_connect_status, false, ROUTE_ALL },
+    { "/api/network/info",    HTTP_GET,  &s_route_network_info,     false, ROUTE_ALL },
+    { "/api/network/history", HTTP_GET,  &s_route_network_history,  false, ROUTE_LAN },
+    { "/api/wifi/networks",   HTTP_GET,  &s_route_wifi_networks,    false, ROUTE_LAN },
+    { "/api/wifi/forget",     HTTP_POST, &s_route_wifi_forget,      false, ROUTE_LAN },
+    { "/api/wifi/power",      HTTP_GET,  &s_route_wifi_power_get,   false, ROUTE_LAN },
+    { "/api/wifi/power",      HTTP_POST, &s_route_wifi_power_post,  false, ROUTE_LAN },
+    { "/api/wifi/power/echo", HTTP_GET,  &s_route_wifi_power_echo,  false, ROUTE_LAN },
+    { "/api/monitor/poll",    HTTP_GET,  &s_route_monitor_poll_get, false, ROUTE_LAN },
+    { "/api/monitor/poll",    HTTP_POST, &s_route_monitor_poll_post, false, ROUTE_LAN },
+    { "/ws",                  HTTP_GET,  &s_route_ws,               true,  ROUTE_ALL },
+    // Captive Portal检测URL（Android/Chrome OS、iOS/macOS、Windows、通用）
+    { "/generate_204",        HTTP_GET,  &s_route_captive_portal,   false, ROUTE_PORTAL },
+    { "/hotspot-detect.html", HTTP_GET,  &s_route_captive_portal,   false, ROUTE_PORTAL },
+    { "/ncsi.txt",            HTTP_GET,  &s_route_captive_portal,   false, ROUTE_PORTAL },
+    { "/connecttest.txt",     HTTP_GET,  &s_route_captive_portal,   false, ROUTE_PORTAL },
+    // 认证API
+    { "/api/auth",            HTTP_POST, &s_route_auth_post,        false, ROUTE_ALL },
+    { "/api/logout",          HTTP_POST, &s_route_logout,           false, ROUTE_ALL },
+    { "/api/set_auth",        HTTP_POST, &s_route_update_auth_post, false, ROUTE_LAN },
+    { "/api/auth_info",       HTTP_GET,  &s_route_get_auth_info,    false, ROUTE_LAN },
+    // 测试页面
+    { "/test",                HTTP_GET,  &s_route_test_get,         false, ROUTE_LAN },
+    // 采样分析器API
+    { "/api/profiler/start",  HTTP_POST, &s_route_profiler_start,   false, ROUTE_LAN },
+    { "/api/profiler/stop",   HTTP_POST, &s_route_profiler_stop,    false, ROUTE_LAN },
+    { "/api/profiler/dump",   HTTP_GET,  &s_route_profiler_dump,    false, ROUTE_LAN },
+    // 服务器运行统计API
+    { "/api/server/stats",    HTTP_GET,  &s_route_server_stats,     false, ROUTE_LAN },
+    // 常见的连接性检测路径，以及某些设备使用的mmtls检测路径
+    { "/wifi/cw.html",        HTTP_GET,  &s_route_captive_portal,   false, ROUTE_PORTAL },
+    { "/mmtls/*",             HTTP_GET,  &s_route_captive_portal,   false, ROUTE_PORTAL },
+};
+
+// 注册属于指定实例的URL处理程序
+static void register_handlers(httpd_handle_t server, uint8_t instance_mask)
 {
     ESP_LOGI(TAG, "开始注册URI处理器...");
 
-    httpd_uri_t root = {
-        .uri       = "/",
-        .method    = HTTP_GET,
-        .handler   = root_get_handler,
-        .user_ctx  = NULL
-    };
-    esp_err_t ret = httpd_register_uri_handler(server, &root);
-    ESP_LOGI(TAG, "注册 / : %s", esp_err_to_name(ret));
-    
-    httpd_uri_t favicon = {
-        .uri       = "/favicon.ico",
-        .method    = HTTP_GET,
-        .handler   = favicon_get_handler,
-        .user_ctx  = NULL
-    };
-    httpd_register_uri_handler(server, &favicon);
-    
-    httpd_uri_t setup = {
-        .uri       = "/setup",
-        .method    = HTTP_GET,
-        .handler   = setup_get_handler,
-        .user_ctx  = NULL
-    };
-    httpd_register_uri_handler(server, &setup);
+    int registered = 0;
+    for (size_t i = 0; i < sizeof(s_routes) / sizeof(s_routes[0]); i++) {
+        const route_def_t *def = &s_routes[i];
+        if ((def->instances & instance_mask) == 0) {
+            continue;
+        }
 
-    httpd_uri_t login = {
-        .uri       = "/login",
-        .method    = HTTP_GET,
-        .handler   = login_get_handler,
-        .user_ctx  = NULL
-    };
-    httpd_register_uri_handler(server, &login);
-    
-    httpd_uri_t status = {
-        .uri       = "/api/status",
-        .method    = HTTP_GET,
-        .handler   = status_get_handler,
-        .user_ctx  = NULL
-    };
-    httpd_register_uri_handler(server, &status);
-    
-    httpd_uri_t power = {
-        .uri       = "/api/power",
-        .method    = HTTP_POST,
-        .handler   = power_post_handler,
-        .user_ctx  = NULL
-    };
-    httpd_register_uri_handler(server, &power);
-    
-    httpd_uri_t wifi_scan = {
-        .uri       = "/api/wifi/scan",
-        .method    = HTTP_GET,
-        .handler   = wifi_scan_handler,
-        .user_ctx  = NULL
-    };
-    httpd_register_uri_handler(server, &wifi_scan);
-    
-    httpd_uri_t wifi_connect = {
-        .uri       = "/api/wifi/connect",
-        .method    = HTTP_POST,
-        .handler   = wifi_connect_handler,
-        .user_ctx  = NULL
-    };
-    httpd_register_uri_handler(server, &wifi_connect);
-    
-    httpd_uri_t network_info = {
-        .uri       = "/api/network/info",
-        .method    = HTTP_GET,
-        .handler   = network_info_handler,
-        .user_ctx  = NULL
-    };
-    httpd_register_uri_handler(server, &network_info);
-    
-    httpd_uri_t ws = {
-        .uri       = "/ws",
-        .method    = HTTP_GET,
-        .handler   = ws_handler,
-        .user_ctx  = NULL,
-        .is_websocket = true
-    };
-    httpd_register_uri_handler(server, &ws);
-    
-    // 注册Captive Portal检测URL处理函数
-    
-    // Android/Chrome OS
-    httpd_uri_t generate_204 = {
-        .uri       = "/generate_204",
-        .method    = HTTP_GET,
-        .handler   = captive_portal_handler,
-        .user_ctx  = NULL
-    };
-    httpd_register_uri_handler(server, &generate_204);
-    
-    // iOS/macOS
-    httpd_uri_t hotspot_detect = {
-        .uri       = "/hotspot-detect.html",
-        .method    = HTTP_GET,
-        .handler   = captive_portal_handler,
-        .user_ctx  = NULL
-    };
-    httpd_register_uri_handler(server, &hotspot_detect);
-    
-    // Windows
-    httpd_uri_t ncsi = {
-        .uri       = "/ncsi.txt",
-        .method    = HTTP_GET,
-        .handler   = captive_portal_handler,
-        .user_ctx  = NULL
-    };
-    httpd_register_uri_handler(server, &ncsi);
-    
-    // 通用
-    httpd_uri_t connecttest = {
-        .uri       = "/connecttest.txt",
-        .method    = HTTP_GET,
-        .handler   = captive_portal_handler,
-        .user_ctx  = NULL
-    };
-    httpd_register_uri_handler(server, &connecttest);
-    
-    // 添加认证API
-    httpd_uri_t auth_post_uri = {
-        .uri       = "/api/auth",
-        .method    = HTTP_POST,
-        .handler   = auth_post_handler,
-        .user_ctx  = NULL
-    };
-    httpd_register_uri_handler(server, &auth_post_uri);
-
-    // 添加登出API
-    httpd_uri_t logout_post_uri = {
-        .uri       = "/api/logout",
-        .method    = HTTP_POST,
-        .handler   = logout_handler,
-        .user_ctx  = NULL
-    };
-    httpd_register_uri_handler(server, &logout_post_uri);
-
-    // 添加设置认证凭据API
-    httpd_uri_t update_auth_post_uri = {
-        .uri       = "/api/set_auth",
-        .method    = HTTP_POST,
-        .handler   = update_auth_post_handler,
-        .user_ctx  = NULL
-    };
-    httpd_register_uri_handler(server, &update_auth_post_uri);
-
-    // 添加获取认证信息API
-    httpd_uri_t get_auth_info_uri = {
-        .uri       = "/api/auth_info",
-        .method    = HTTP_GET,
-        .handler   = get_auth_info_handler,
-        .user_ctx  = NULL
-    };
-    ret = httpd_register_uri_handler(server, &get_auth_info_uri);
-    ESP_LOGI(TAG, "注册 /api/auth_info : %s", esp_err_to_name(ret));
-
-    // 添加测试页面
-    httpd_uri_t test_uri = {
-        .uri       = "/test",
-        .method    = HTTP_GET,
-        .handler   = test_get_handler,
-        .user_ctx  = NULL
-    };
-    ret = httpd_register_uri_handler(server, &test_uri);
-    ESP_LOGI(TAG, "注册 /test : %s", esp_err_to_name(ret));
-
-    // 添加一些常见的连接性检测路径
-    httpd_uri_t cw_html = {
-        .uri       = "/wifi/cw.html",
-        .method    = HTTP_GET,
-        .handler   = captive_portal_handler,
-        .user_ctx  = NULL
-    };
-    httpd_register_uri_handler(server, &cw_html);
-
-    // 添加通用的mmtls路径处理（用于某些设备的连接检测）
-    httpd_uri_t mmtls_wildcard = {
-        .uri       = "/mmtls/*",
-        .method    = HTTP_GET,
-        .handler   = captive_portal_handler,
-        .user_ctx  = NULL
+        httpd_uri_t uri = {
+            .uri          = def->uri,
+            .method       = def->method,
+            .handler      = admission_dispatch,
+            .user_ctx     = (void *)def->route,
+            .is_websocket = def->is_websocket
+        };
+        esp_err_t ret = httpd_register_uri_handler(server, &uri);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "注册 %s 失败: %s", def->uri, esp_err_to_name(ret));
+            continue;
+        }
+        registered++;
+    }
+
+    ESP_LOGI(TAG, "已注册 %d 个URI处理器", registered);
+}
+
+// 启动一个服务器实例
+static esp_err_t start_instance(web_instance_t instance)
+{
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    uint8_t route_mask;
+
+    // 套接字上限、LRU清理、收发超时和连接回调由连接管理器统一设置
+    conn_manager_configure(&config);
+    config.keep_alive_enable = true;    // 确保启用keep-alive
+    config.keep_alive_idle = 30;        // 空闲时间30秒
+    config.keep_alive_interval = 5;     // 保活间隔5秒
+    config.keep_alive_count = 3;        // 尝试3次
+
+    if (instance == WEB_INSTANCE_PORTAL) {
+        // 配网实例只服务配网页面和探测请求，用更小的栈和连接表
+        config.stack_size = PORTAL_STACK_SIZE;
+        config.task_priority = PORTAL_TASK_PRIORITY;
+        config.max_open_sockets = PORTAL_MAX_SOCKETS;
+        config.max_uri_handlers = PORTAL_MAX_URI_HANDLERS;
+        route_mask = ROUTE_PORTAL;
+    } else {
+        config.stack_size = LAN_STACK_SIZE;
+        config.task_priority = LAN_TASK_PRIORITY;
+        config.max_uri_handlers = LAN_MAX_URI_HANDLERS;
+        route_mask = WEB_SERVER_SPLIT_INSTANCES ? ROUTE_LAN : ROUTE_ALL;
+    }
+
+    httpd_handle_t server = NULL;
+    esp_err_t ret = httpd_start(&server, &config);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "启动%s实例失败: %d", instance_name(instance), ret);
+        return ret;
+    }
+
+    // 开始空闲连接清理
+    conn_manager_start(server);
+
+    // 注册URI处理函数
+    register_handlers(server, route_mask);
+
+    // 设置错误处理器
+    httpd_register_err_handler(server, HTTPD_404_NOT_FOUND, http_404_error_handler);
+
+    s_server = server;
+    s_instance = instance;
+    ESP_LOGI(TAG, "%s实例启动成功，剩余堆: %lu", instance_name(instance),
+             (unsigned long)esp_get_free_heap_size());
+    return ESP_OK;
+}
+
+// 停止当前服务器实例
+static esp_err_t stop_instance(void)
+{
+    httpd_handle_t server = s_server;
+    if (server == NULL) {
+        return ESP_OK;
+    }
+
+    // 先清空句柄，避免广播在停止过程中使用旧实例
+    s_server = NULL;
+    s_instance = WEB_INSTANCE_NONE;
+
+    esp_err_t ret = httpd_stop(server);
+    conn_manager_stop(server);
+
+    // 重置WebSocket客户端列表
+    for (int i = 0; i < MAX_WS_CLIENTS; i++) {
+        s_ws_client_fds[i] = -1;
+    }
+    ws_clients_changed();
+
+    return ret;
+}
+
+#if WEB_SERVER_SPLIT_INSTANCES
+// STA是否已获得IP
+static bool sta_has_ip(void)
+{
+    esp_netif_t *sta_netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+    esp_netif_ip_info_t ip_info;
+    if (sta_netif == NULL || esp_netif_get_ip_info(sta_netif, &ip_info) != ESP_OK) {
+        return false;
+    }
+    return ip_info.ip.addr != 0;
+}
+
+// 实例切换任务：httpd_stop会等待正在执行的处理函数返回（配网连接可能阻塞十几秒），
+// 因此不能在esp_timer任务中直接切换
+static void instance_switch_task(void *arg)
+{
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        web_instance_t target = sta_has_ip() ? WEB_INSTANCE_LAN : WEB_INSTANCE_PORTAL;
+        if (target == s_instance) {
+            continue;
+        }
+
+        ESP_LOGI(TAG, "切换Web服务器实例: %s -> %s", instance_name(s_instance), instance_name(target));
+        stop_instance();
+        if (start_instance(target) != ESP_OK) {
+            // 新实例启动失败时稍后重试，保证设备始终可以访问
+            esp_timer_start_once(s_switch_timer, (uint64_t)SWITCH_RETRY_DELAY_MS * 1000);
+        }
+    }
+}
+
+// 防抖定时器到期，通知切换任务
+static void instance_switch_timer_cb(void *arg)
+{
+    if (s_switch_task != NULL) {
+        xTaskNotifyGive(s_switch_task);
+    }
+}
+
+// 安排一次切换：获得IP后很快切到LAN实例，断开后等待较长时间以免短暂掉线来回切换
+static void schedule_instance_switch(uint32_t delay_ms)
+{
+    esp_timer_stop(s_switch_timer);
+    esp_timer_start_once(s_switch_timer, (uint64_t)delay_ms * 1000);
+}
+
+static void instance_event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+{
+    if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
+        schedule_instance_switch(SWITCH_TO_LAN_DELAY_MS);
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
+        schedule_instance_switch(SWITCH_TO_PORTAL_DELAY_MS);
+    }
+}
+
+static esp_err_t init_instance_switching(void)
+{
+    const esp_timer_create_args_t timer_args = {
+        .callback = instance_switch_timer_cb,
+        .name = "web_switch",
     };
-    httpd_register_uri_handler(server, &mmtls_wildcard);
+    esp_err_t ret = esp_timer_create(&timer_args, &s_switch_timer);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    if (xTaskCreate(instance_switch_task, "web_switch", SWITCH_TASK_STACK_SIZE, NULL,
+                    SWITCH_TASK_PRIORITY, &s_switch_task) != pdPASS) {
+        esp_timer_delete(s_switch_timer);
+        s_switch_timer = NULL;
+        return ESP_ERR_NO_MEM;
+    }
 
-    ESP_LOGI(TAG, "已注册所有URI处理器");
+    esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, instance_event_handler, NULL);
+    esp_event_handler_register(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, instance_event_handler, NULL);
+    return ESP_OK;
 }
+#endif
 
 esp_err_t web_server_init(void)
 {
@@ -1884,32 +3219,33 @@ esp_err_t web_server_init(void)
     
     // 注册PC状态变化回调
     pc_monitor_register_callback(pc_state_changed_cb);
-    
-    // 配置服务器
-    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
-    config.stack_size = 8192;
-    config.max_uri_handlers = 20;  // 增加URI处理器数量
-    
-    // 增加超时设置，解决WebSocket超时问题
-    config.recv_wait_timeout = 30;      // 增加到30秒
-    config.send_wait_timeout = 30;      // 增加到30秒
-    config.keep_alive_enable = true;    // 确保启用keep-alive
-    config.keep_alive_idle = 30;        // 空闲时间30秒
-    config.keep_alive_interval = 5;     // 保活间隔5秒
-    config.keep_alive_count = 3;        // 尝试3次
-    
-    // 启动服务器
-    ret = httpd_start(&s_server, &config);
+
+    // 跟踪AP客户端的门户状态
+    captive_portal_init();
+
+    // 渐进式扫描每完成一组信道就推送给订阅的WebSocket客户端
+    wifi_manager_set_scan_progress_cb(scan_progress_cb);
+
+    // 链路质量采样推送给订阅了link主题的WebSocket客户端
+    wifi_manager_set_link_sample_cb(link_sample_cb);
+
+#if WEB_SERVER_SPLIT_INSTANCES
+    if (s_switch_timer == NULL) {
+        ret = init_instance_switching();
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "初始化实例切换失败: %s", esp_err_to_name(ret));
+            return ret;
+        }
+    }
+
+    // 根据STA当前状态选择初始实例
+    ret = start_instance(sta_has_ip() ? WEB_INSTANCE_LAN : WEB_INSTANCE_PORTAL);
+#else
+    ret = start_instance(WEB_INSTANCE_LAN);
+#endif
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "启动Web服务器失败: %d", ret);
         return ret;
     }
-    
-    // 注册URI处理函数
-    register_handlers(s_server);
-
-    // 设置错误处理器
-    httpd_register_err_handler(s_server, HTTPD_404_NOT_FOUND, http_404_error_handler);
 
     ESP_LOGI(TAG, "Web服务器启动成功");
     return ESP_OK;
@@ -1917,22 +3253,15 @@ esp_err_t web_server_init(void)
 
 esp_err_t web_server_stop(void)
 {
-    if (s_server == NULL) {
-        return ESP_OK;
-    }
-    
-    esp_err_t ret = httpd_stop(s_server);
-    s_server = NULL;
-    
-    // 重置WebSocket客户端列表
-    for (int i = 0; i < MAX_WS_CLIENTS; i++) {
-        s_ws_client_fds[i] = -1;
+#if WEB_SERVER_SPLIT_INSTANCES
+    if (s_switch_timer != NULL) {
+        esp_timer_stop(s_switch_timer);
     }
-    
-    return ret;
+#endif
+    return stop_instance();
 }
 
 httpd_handle_t web_server_get_handle(void)
 {
     return s_server;
-} 
\ No newline at end of file
+}
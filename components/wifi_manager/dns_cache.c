@@ -0,0 +1,272 @@
+#include "dns_cache.h"
+#include "dns_engine.h"
+#include <string.h>
+
+#define DNS_CACHE_ENTRIES            16
+#define DNS_CACHE_MAX_RESPONSE       288     // 超过此长度的应答不缓存
+#define DNS_CACHE_MAX_TTL            3600    // 正向应答TTL上限（秒）
+#define DNS_CACHE_NEGATIVE_TTL       30      // 否定应答无SOA时的缓存时间
+#define DNS_CACHE_NEGATIVE_MAX_TTL   300     // 否定应答TTL上限
+
+#define DNS_FLAG_QR       0x8000
+#define DNS_FLAG_TC       0x0200
+#define DNS_RCODE_MASK    0x000F
+
+typedef struct {
+    uint32_t hash;              // 0表示空闲
+    uint32_t stored_s;
+    uint32_t expires_s;
+    uint32_t last_used;         // LRU序号
+    uint16_t len;
+    bool negative;
+    uint8_t data[DNS_CACHE_MAX_RESPONSE];
+} dns_cache_entry_t;
+
+static dns_cache_entry_t s_entries[DNS_CACHE_ENTRIES];
+static dns_cache_stats_t s_stats;
+static uint32_t s_use_counter = 0;
+
+static inline uint16_t get_u16(const uint8_t *p)
+{
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static inline uint32_t get_u32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static inline void put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static inline uint8_t lower(uint8_t c)
+{
+    return (c >= 'A' && c <= 'Z') ? (uint8_t)(c - 'A' + 'a') : c;
+}
+
+// 解析单问题报文的问题部分，返回问题结束位置并计算键哈希，不可缓存时返回0
+// 报文中的第一个名称不可能使用压缩指针（指针只能指向之前的位置），可以直接按标签比较
+static size_t question_key(const uint8_t *packet, size_t len, uint32_t *hash)
+{
+    if (len < DNS_ENGINE_HEADER_LEN || get_u16(packet + 4) != 1) {
+        return 0;
+    }
+
+    size_t n = dns_engine_skip_name(packet, len, DNS_ENGINE_HEADER_LEN);
+    size_t end = DNS_ENGINE_HEADER_LEN + n + 4;
+    if (n == 0 || end > len) {
+        return 0;
+    }
+
+    // FNV-1a，名称按小写计算（标签长度不超过63，不受影响），QTYPE/QCLASS按原值
+    uint32_t h = 2166136261u;
+    for (size_t i = DNS_ENGINE_HEADER_LEN; i < end; i++) {
+        h ^= i < end - 4 ? lower(packet[i]) : packet[i];
+        h *= 16777619u;
+    }
+    *hash = h != 0 ? h : 1;
+    return end;
+}
+
+// 名称不区分大小写，QTYPE/QCLASS必须完全相同
+static bool same_question(const uint8_t *a, const uint8_t *b, size_t question_end)
+{
+    for (size_t i = DNS_ENGINE_HEADER_LEN; i < question_end - 4; i++) {
+        if (lower(a[i]) != lower(b[i])) {
+            return false;
+        }
+    }
+    return memcmp(a + question_end - 4, b + question_end - 4, 4) == 0;
+}
+
+// 遍历回答和授权部分，返回结束位置；min_ttl为回答部分的最小TTL，soa_ttl为授权部分SOA给出的否定TTL
+static size_t walk_records(const uint8_t *packet, size_t len, size_t pos, uint16_t count,
+                           uint16_t answer_count, uint32_t *min_ttl, uint32_t *soa_ttl)
+{
+    for (uint16_t i = 0; i < count; i++) {
+        size_t n = dns_engine_skip_name(packet, len, pos);
+        if (n == 0 || pos + n + 10 > len) {
+            return 0;
+        }
+        const uint8_t *rr = packet + pos + n;
+        uint16_t type = get_u16(rr);
+        uint32_t ttl = get_u32(rr + 4);
+        uint16_t rdlength = get_u16(rr + 8);
+        if (pos + n + 10 + rdlength > len) {
+            return 0;
+        }
+
+        if (i < answer_count) {
+            if (min_ttl != NULL && ttl < *min_ttl) {
+                *min_ttl = ttl;
+            }
+        } else if (type == DNS_TYPE_SOA && soa_ttl != NULL && rdlength >= 4) {
+            // RFC 2308：否定应答的TTL取SOA记录TTL与MINIMUM字段中较小者
+            uint32_t minimum = get_u32(rr + 10 + rdlength - 4);
+            uint32_t negative = ttl < minimum ? ttl : minimum;
+            if (negative < *soa_ttl) {
+                *soa_ttl = negative;
+            }
+        }
+
+        pos += n + 10 + rdlength;
+    }
+    return pos;
+}
+
+// 按已缓存时间递减所有记录的TTL
+static void age_records(uint8_t *packet, size_t len, size_t pos, uint16_t count, uint32_t age)
+{
+    for (uint16_t i = 0; i < count; i++) {
+        size_t n = dns_engine_skip_name(packet, len, pos);
+        uint8_t *rr = packet + pos + n;
+        uint32_t ttl = get_u32(rr + 4);
+        put_u32(rr + 4, ttl > age ? ttl - age : 0);
+        pos += n + 10 + get_u16(rr + 8);
+    }
+}
+
+size_t dns_cache_lookup(const uint8_t *query, size_t query_len, uint8_t *out, size_t capacity, uint32_t now_s)
+{
+    uint32_t hash;
+    size_t question_end = question_key(query, query_len, &hash);
+    if (question_end == 0) {
+        return 0;
+    }
+
+    for (int i = 0; i < DNS_CACHE_ENTRIES; i++) {
+        dns_cache_entry_t *entry = &s_entries[i];
+        if (entry->hash != hash || (int32_t)(entry->expires_s - now_s) <= 0 ||
+            entry->len > capacity || !same_question(entry->data, query, question_end)) {
+            continue;
+        }
+
+        // ID和问题部分取自查询（保留客户端的大小写，DNS 0x20），其余取自缓存
+        // out与query相同时前两步不移动数据，之后不再读取query
+        memmove(out, query, 2);
+        memmove(out + DNS_ENGINE_HEADER_LEN, query + DNS_ENGINE_HEADER_LEN, question_end - DNS_ENGINE_HEADER_LEN);
+        memcpy(out + 2, entry->data + 2, DNS_ENGINE_HEADER_LEN - 2);
+        memcpy(out + question_end, entry->data + question_end, entry->len - question_end);
+
+        uint16_t records = (uint16_t)(get_u16(out + 6) + get_u16(out + 8));
+        age_records(out, entry->len, question_end, records, now_s - entry->stored_s);
+
+        entry->last_used = ++s_use_counter;
+        s_stats.hits++;
+        if (entry->negative) {
+            s_stats.negative_hits++;
+        }
+        return entry->len;
+    }
+
+    s_stats.misses++;
+    return 0;
+}
+
+bool dns_cache_store(const uint8_t *response, size_t len, uint32_t now_s)
+{
+    uint32_t hash;
+    size_t question_end = question_key(response, len, &hash);
+    if (question_end == 0) {
+        return false;
+    }
+
+    uint16_t flags = get_u16(response + 2);
+    uint8_t rcode = flags & DNS_RCODE_MASK;
+    uint16_t ancount = get_u16(response + 6);
+    uint16_t nscount = get_u16(response + 8);
+
+    if ((flags & DNS_FLAG_QR) == 0 || (flags & DNS_FLAG_TC) ||
+        (rcode != DNS_RCODE_NOERROR && rcode != DNS_RCODE_NXDOMAIN)) {
+        s_stats.uncacheable++;
+        return false;
+    }
+
+    uint32_t min_ttl = UINT32_MAX;
+    uint32_t soa_ttl = UINT32_MAX;
+    size_t end = walk_records(response, len, question_end, (uint16_t)(ancount + nscount), ancount,
+                              &min_ttl, &soa_ttl);
+    if (end == 0) {
+        s_stats.uncacheable++;
+        return false;
+    }
+
+    bool negative = rcode == DNS_RCODE_NXDOMAIN || ancount == 0;
+    uint32_t ttl;
+    if (negative) {
+        ttl = soa_ttl != UINT32_MAX ? soa_ttl : DNS_CACHE_NEGATIVE_TTL;
+        if (ttl > DNS_CACHE_NEGATIVE_MAX_TTL) {
+            ttl = DNS_CACHE_NEGATIVE_MAX_TTL;
+        }
+    } else {
+        ttl = min_ttl > DNS_CACHE_MAX_TTL ? DNS_CACHE_MAX_TTL : min_ttl;
+    }
+
+    if (ttl == 0 || end > DNS_CACHE_MAX_RESPONSE) {
+        s_stats.uncacheable++;
+        return false;
+    }
+
+    // 优先覆盖同键条目，其次是空闲或过期条目，最后淘汰最久未使用的条目
+    dns_cache_entry_t *slot = NULL;
+    for (int i = 0; i < DNS_CACHE_ENTRIES && slot == NULL; i++) {
+        if (s_entries[i].hash == hash && same_question(s_entries[i].data, response, question_end)) {
+            slot = &s_entries[i];
+        }
+    }
+    for (int i = 0; i < DNS_CACHE_ENTRIES && slot == NULL; i++) {
+        if (s_entries[i].hash == 0 || (int32_t)(s_entries[i].expires_s - now_s) <= 0) {
+            slot = &s_entries[i];
+        }
+    }
+    if (slot == NULL) {
+        slot = &s_entries[0];
+        for (int i = 1; i < DNS_CACHE_ENTRIES; i++) {
+            if (s_entries[i].last_used < slot->last_used) {
+                slot = &s_entries[i];
+            }
+        }
+        s_stats.evictions++;
+    }
+
+    // 去掉附加部分（OPT、胶水记录），缓存的应答对是否使用EDNS的客户端都适用
+    memcpy(slot->data, response, end);
+    slot->data[10] = 0;
+    slot->data[11] = 0;
+    slot->len = (uint16_t)end;
+    slot->hash = hash;
+    slot->stored_s = now_s;
+    slot->expires_s = now_s + ttl;
+    slot->negative = negative;
+    slot->last_used = ++s_use_counter;
+
+    s_stats.stores++;
+    return true;
+}
+
+void dns_cache_flush(void)
+{
+    memset(s_entries, 0, sizeof(s_entries));
+}
+
+void dns_cache_get_stats(dns_cache_stats_t *stats, uint32_t now_s)
+{
+    if (stats == NULL) {
+        return;
+    }
+
+    uint16_t entries = 0;
+    for (int i = 0; i < DNS_CACHE_ENTRIES; i++) {
+        if (s_entries[i].hash != 0 && (int32_t)(s_entries[i].expires_s - now_s) > 0) {
+            entries++;
+        }
+    }
+
+    *stats = s_stats;
+    stats->entries = entries;
+}
@@ -0,0 +1,35 @@
+#ifndef DNS_CACHE_H
+#define DNS_CACHE_H
+
+// DNS转发应答缓存
+// 以(qname, qtype, qclass)为键的LRU缓存，遵循上游TTL并缓存否定应答（NXDOMAIN/NODATA）
+// 纯C实现，时间由调用者传入，可以直接在主机上编译测试
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    uint32_t hits;
+    uint32_t negative_hits;     // 命中的否定应答
+    uint32_t misses;
+    uint32_t stores;
+    uint32_t uncacheable;       // TTL为0、截断、SERVFAIL或超过条目容量的应答
+    uint32_t evictions;         // 因容量不足淘汰的未过期条目
+    uint16_t entries;           // 当前有效条目数
+} dns_cache_stats_t;
+
+// 查找查询对应的缓存应答，命中时写入out（可与query为同一缓冲区）
+// 应答的ID和问题部分取自查询（保留名称大小写），TTL按已缓存时间递减，返回应答长度，未命中返回0
+size_t dns_cache_lookup(const uint8_t *query, size_t query_len, uint8_t *out, size_t capacity, uint32_t now_s);
+
+// 缓存上游应答（附加部分会被去掉），返回是否已缓存
+bool dns_cache_store(const uint8_t *response, size_t len, uint32_t now_s);
+
+// 清空缓存（切换上游时调用）
+void dns_cache_flush(void);
+
+// 获取统计
+void dns_cache_get_stats(dns_cache_stats_t *stats, uint32_t now_s);
+
+#endif /* DNS_CACHE_H */
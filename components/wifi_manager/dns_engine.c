@@ -0,0 +1,345 @@
+#include "dns_engine.h"
+#include <string.h>
+
+// 头部标志位
+#define DNS_FLAG_QR       0x8000
+#define DNS_FLAG_AA       0x0400
+#define DNS_FLAG_TC       0x0200
+#define DNS_FLAG_RD       0x0100
+#define DNS_OPCODE_MASK   0x7800
+
+#define DNS_EDNS_DO       0x8000   // OPT记录TTL字段中的DNSSEC OK位
+#define DNS_EDNS_PAYLOAD  1232     // 通告的UDP负载大小，实际受缓冲区容量限制
+
+#define DNS_MAX_POINTER_JUMPS  16  // 压缩指针最大跳转次数，防止环路
+#define DNS_A_RECORD_LEN       16  // 压缩名(2) + 类型(2) + 类(2) + TTL(4) + 长度(2) + 地址(4)
+#define DNS_OPT_RECORD_LEN     11  // 根名(1) + 类型(2) + 负载(2) + TTL(4) + 长度(2)
+
+static inline uint16_t get_u16(const uint8_t *p)
+{
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static inline void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+static inline void put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+// 校验从offset开始的名称，返回名称在报文中占用的字节数（压缩指针只计2字节），失败返回0
+// 标签不超过63字节，展开后总长不超过255字节，压缩指针只能指向之前出现的位置
+size_t dns_engine_skip_name(const uint8_t *packet, size_t len, size_t offset)
+{
+    size_t pos = offset;
+    size_t consumed = 0;
+    size_t name_len = 0;
+    int jumps = 0;
+
+    while (1) {
+        if (pos >= len) {
+            return 0;
+        }
+
+        uint8_t label = packet[pos];
+
+        if ((label & 0xC0) == 0xC0) {
+            if (pos + 1 >= len) {
+                return 0;
+            }
+            size_t target = ((size_t)(label & 0x3F) << 8) | packet[pos + 1];
+            if (target < DNS_ENGINE_HEADER_LEN || target >= pos || ++jumps > DNS_MAX_POINTER_JUMPS) {
+                return 0;
+            }
+            if (consumed == 0) {
+                consumed = pos + 2 - offset;
+            }
+            pos = target;
+            continue;
+        }
+
+        if ((label & 0xC0) != 0) {
+            // 0x40/0x80为保留的扩展标签类型
+            return 0;
+        }
+
+        if (label == 0) {
+            if (consumed == 0) {
+                consumed = pos + 1 - offset;
+            }
+            return name_len + 1 <= DNS_ENGINE_MAX_NAME_LEN ? consumed : 0;
+        }
+
+        name_len += label + 1;
+        if (name_len > DNS_ENGINE_MAX_NAME_LEN || pos + 1 + label > len) {
+            return 0;
+        }
+        pos += 1 + label;
+    }
+}
+
+bool dns_engine_name_equals(const uint8_t *packet, size_t len, size_t offset, const char *name)
+{
+    if (dns_engine_skip_name(packet, len, offset) == 0) {
+        return false;
+    }
+
+    // 名称已校验，下面可以放心跟随压缩指针
+    size_t pos = offset;
+    const char *p = name;
+
+    while (1) {
+        uint8_t label = packet[pos];
+        if ((label & 0xC0) == 0xC0) {
+            pos = ((size_t)(label & 0x3F) << 8) | packet[pos + 1];
+            continue;
+        }
+        if (label == 0) {
+            return *p == '\0';
+        }
+        if (p != name) {
+            if (*p != '.') {
+                return false;
+            }
+            p++;
+        }
+        for (uint8_t i = 0; i < label; i++, p++) {
+            char c = (char)packet[pos + 1 + i];
+            char expected = *p;
+            if (expected == '\0') {
+                return false;
+            }
+            if (c >= 'A' && c <= 'Z') {
+                c = (char)(c - 'A' + 'a');
+            }
+            if (expected >= 'A' && expected <= 'Z') {
+                expected = (char)(expected - 'A' + 'a');
+            }
+            if (c != expected) {
+                return false;
+            }
+        }
+        pos += 1 + label;
+    }
+}
+
+// 跳过一条资源记录，返回记录结束位置，失败返回0
+static size_t skip_rr(const uint8_t *packet, size_t len, size_t offset,
+                      uint16_t *type, uint16_t *rclass, uint32_t *ttl, size_t *name_len)
+{
+    size_t n = dns_engine_skip_name(packet, len, offset);
+    if (n == 0 || offset + n + 10 > len) {
+        return 0;
+    }
+
+    const uint8_t *p = packet + offset + n;
+    uint16_t rdlength = get_u16(p + 8);
+    if (offset + n + 10 + rdlength > len) {
+        return 0;
+    }
+
+    *type = get_u16(p);
+    *rclass = get_u16(p + 2);
+    *ttl = ((uint32_t)p[4] << 24) | ((uint32_t)p[5] << 16) | ((uint32_t)p[6] << 8) | p[7];
+    *name_len = n;
+    return offset + n + 10 + rdlength;
+}
+
+// 只保留头部，以指定响应码回复
+static size_t reply_header_only(uint8_t *packet, uint16_t flags, uint8_t rcode, dns_engine_result_t *result)
+{
+    put_u16(packet + 2, DNS_FLAG_QR | (flags & (DNS_OPCODE_MASK | DNS_FLAG_RD)) | rcode);
+    memset(packet + 4, 0, 8);
+    result->rcode = rcode;
+    return DNS_ENGINE_HEADER_LEN;
+}
+
+size_t dns_engine_answer(uint8_t *packet, size_t len, size_t capacity,
+                         const uint8_t answer_ip[4], uint32_t ttl,
+                         dns_engine_result_t *result)
+{
+    dns_engine_result_t local_result;
+    if (result == NULL) {
+        result = &local_result;
+    }
+    memset(result, 0, sizeof(*result));
+
+    if (packet == NULL || len < DNS_ENGINE_HEADER_LEN || capacity < len) {
+        return 0;
+    }
+
+    uint16_t flags = get_u16(packet + 2);
+    if (flags & DNS_FLAG_QR) {
+        // 不回应响应报文，避免被用于反射
+        return 0;
+    }
+    if ((flags & DNS_OPCODE_MASK) != 0) {
+        return reply_header_only(packet, flags, DNS_RCODE_NOTIMP, result);
+    }
+
+    uint16_t qdcount = get_u16(packet + 4);
+    uint16_t ancount = get_u16(packet + 6);
+    uint16_t nscount = get_u16(packet + 8);
+    uint16_t arcount = get_u16(packet + 10);
+    if (qdcount == 0 || qdcount > DNS_ENGINE_MAX_QUESTIONS) {
+        return reply_header_only(packet, flags, DNS_RCODE_FORMERR, result);
+    }
+
+    // 解析问题部分，记录每个问题名称的位置用于应答中的压缩指针
+    uint16_t name_offsets[DNS_ENGINE_MAX_QUESTIONS];
+    uint16_t qtypes[DNS_ENGINE_MAX_QUESTIONS];
+    uint16_t qclasses[DNS_ENGINE_MAX_QUESTIONS];
+    size_t pos = DNS_ENGINE_HEADER_LEN;
+
+    for (int i = 0; i < qdcount; i++) {
+        size_t n = dns_engine_skip_name(packet, len, pos);
+        if (n == 0 || pos + n + 4 > len) {
+            return reply_header_only(packet, flags, DNS_RCODE_FORMERR, result);
+        }
+        name_offsets[i] = (uint16_t)pos;
+        qtypes[i] = get_u16(packet + pos + n);
+        qclasses[i] = get_u16(packet + pos + n + 2);
+        pos += n + 4;
+    }
+    size_t question_end = pos;
+    result->questions = (uint8_t)qdcount;
+
+    // 在回答、授权和附加部分中查找OPT记录
+    bool edns = false;
+    uint16_t edns_payload = 512;
+    uint16_t edns_flags = 0;
+    uint8_t edns_version = 0;
+    uint32_t rr_total = (uint32_t)ancount + nscount + arcount;
+
+    for (uint32_t i = 0; i < rr_total; i++) {
+        uint16_t type, rclass;
+        uint32_t rr_ttl;
+        size_t name_len;
+        size_t next = skip_rr(packet, len, pos, &type, &rclass, &rr_ttl, &name_len);
+        if (next == 0) {
+            return reply_header_only(packet, flags, DNS_RCODE_FORMERR, result);
+        }
+        if (type == DNS_TYPE_OPT) {
+            // OPT只能出现一次，且必须位于附加部分、名称为根
+            if (edns || i < (uint32_t)ancount + nscount || name_len != 1 || packet[pos] != 0) {
+                return reply_header_only(packet, flags, DNS_RCODE_FORMERR, result);
+            }
+            edns = true;
+            edns_payload = rclass < 512 ? 512 : rclass;
+            edns_version = (uint8_t)(rr_ttl >> 16);
+            edns_flags = (uint16_t)rr_ttl;
+        }
+        pos = next;
+    }
+    result->edns = edns;
+
+    // 响应不能超过客户端声明的负载大小
+    if (capacity > edns_payload) {
+        capacity = edns_payload;
+    }
+    if (question_end + (edns ? DNS_OPT_RECORD_LEN : 0) > capacity) {
+        return reply_header_only(packet, flags, DNS_RCODE_SERVFAIL, result);
+    }
+
+    uint8_t rcode = DNS_RCODE_NOERROR;
+    size_t out = question_end;
+    size_t limit = capacity - (edns ? DNS_OPT_RECORD_LEN : 0);
+    uint16_t answers = 0;
+
+    if (edns && edns_version != 0) {
+        // 只支持EDNS版本0
+        rcode = DNS_RCODE_BADVERS;
+    } else {
+        for (int i = 0; i < qdcount; i++) {
+            bool want_a = qclasses[i] == DNS_CLASS_IN &&
+                          (qtypes[i] == DNS_TYPE_A || qtypes[i] == DNS_TYPE_ANY);
+            if (!want_a) {
+                // AAAA、HTTPS等以NODATA回答，客户端会立即回退到IPv4
+                result->nodata++;
+                continue;
+            }
+            if (out + DNS_A_RECORD_LEN > limit) {
+                result->truncated = true;
+                break;
+            }
+
+            uint8_t *rr = packet + out;
+            put_u16(rr, (uint16_t)(0xC000 | name_offsets[i]));
+            put_u16(rr + 2, DNS_TYPE_A);
+            put_u16(rr + 4, DNS_CLASS_IN);
+            put_u32(rr + 6, ttl);
+            put_u16(rr + 10, 4);
+            memcpy(rr + 12, answer_ip, 4);
+            out += DNS_A_RECORD_LEN;
+            answers++;
+        }
+    }
+
+    if (edns) {
+        // 回显OPT记录：负载大小为本端能力，扩展响应码放在TTL高8位，保留DO位
+        uint8_t *opt = packet + out;
+        opt[0] = 0;
+        put_u16(opt + 1, DNS_TYPE_OPT);
+        put_u16(opt + 3, (uint16_t)(capacity < DNS_EDNS_PAYLOAD ? capacity : DNS_EDNS_PAYLOAD));
+        opt[5] = (uint8_t)(rcode >> 4);
+        opt[6] = 0;
+        put_u16(opt + 7, edns_flags & DNS_EDNS_DO);
+        put_u16(opt + 9, 0);
+        out += DNS_OPT_RECORD_LEN;
+    }
+
+    uint16_t resp_flags = DNS_FLAG_QR | DNS_FLAG_AA | (flags & DNS_FLAG_RD) | (rcode & 0x0F);
+    if (result->truncated) {
+        resp_flags |= DNS_FLAG_TC;
+    }
+    put_u16(packet + 2, resp_flags);
+    put_u16(packet + 6, answers);
+    put_u16(packet + 8, 0);
+    put_u16(packet + 10, edns ? 1 : 0);
+
+    result->rcode = rcode;
+    result->answers = (uint8_t)answers;
+    return out;
+}
+
+bool dns_engine_clamp_edns(uint8_t *packet, size_t len, uint16_t max_payload)
+{
+    if (packet == NULL || len < DNS_ENGINE_HEADER_LEN) {
+        return false;
+    }
+
+    uint16_t qdcount = get_u16(packet + 4);
+    uint32_t rr_total = (uint32_t)get_u16(packet + 6) + get_u16(packet + 8) + get_u16(packet + 10);
+    size_t pos = DNS_ENGINE_HEADER_LEN;
+
+    for (int i = 0; i < qdcount; i++) {
+        size_t n = dns_engine_skip_name(packet, len, pos);
+        if (n == 0 || pos + n + 4 > len) {
+            return false;
+        }
+        pos += n + 4;
+    }
+
+    for (uint32_t i = 0; i < rr_total; i++) {
+        uint16_t type, rclass;
+        uint32_t rr_ttl;
+        size_t name_len;
+        size_t next = skip_rr(packet, len, pos, &type, &rclass, &rr_ttl, &name_len);
+        if (next == 0) {
+            return false;
+        }
+        if (type == DNS_TYPE_OPT && rclass > max_payload) {
+            put_u16(packet + pos + name_len + 2, max_payload);
+        }
+        pos = next;
+    }
+
+    return true;
+}
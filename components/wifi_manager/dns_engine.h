@@ -0,0 +1,64 @@
+#ifndef DNS_ENGINE_H
+#define DNS_ENGINE_H
+
+// Captive Portal DNS应答引擎
+// 纯C实现，不依赖ESP-IDF和lwIP，可以直接在主机上编译测试
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define DNS_ENGINE_HEADER_LEN     12
+#define DNS_ENGINE_MAX_NAME_LEN   255
+#define DNS_ENGINE_MAX_QUESTIONS  4      // 单个报文最多处理的问题数，超出返回FORMERR
+
+// 记录类型
+#define DNS_TYPE_A        1
+#define DNS_TYPE_SOA      6
+#define DNS_TYPE_AAAA     28
+#define DNS_TYPE_OPT      41
+#define DNS_TYPE_HTTPS    65
+#define DNS_TYPE_ANY      255
+
+#define DNS_CLASS_IN      1
+
+// 响应码
+#define DNS_RCODE_NOERROR   0
+#define DNS_RCODE_FORMERR   1
+#define DNS_RCODE_SERVFAIL  2
+#define DNS_RCODE_NXDOMAIN  3
+#define DNS_RCODE_NOTIMP    4
+#define DNS_RCODE_REFUSED   5
+#define DNS_RCODE_BADVERS   16   // EDNS扩展响应码
+
+// 单次应答的结果，用于统计
+typedef struct {
+    uint8_t rcode;          // 最终响应码（含EDNS扩展部分）
+    uint8_t questions;      // 解析出的问题数
+    uint8_t answers;        // 写入的A记录数
+    uint8_t nodata;         // 以NODATA回答的问题数（AAAA、HTTPS等）
+    bool truncated;         // 响应超出容量，设置了TC位
+    bool edns;              // 请求携带OPT记录
+} dns_engine_result_t;
+
+// 将查询报文就地改写为Captive Portal响应
+// packet: 收到的查询，响应写回同一缓冲区
+// len: 查询长度；capacity: 缓冲区容量
+// answer_ip: A记录地址（网络字节序的4个字节）
+// ttl: A记录TTL（秒）
+// 返回响应长度，返回0表示应丢弃该报文（过短或本身就是响应）
+size_t dns_engine_answer(uint8_t *packet, size_t len, size_t capacity,
+                         const uint8_t answer_ip[4], uint32_t ttl,
+                         dns_engine_result_t *result);
+
+// 校验从offset开始的名称，返回名称在报文中占用的字节数，格式非法返回0
+size_t dns_engine_skip_name(const uint8_t *packet, size_t len, size_t offset);
+
+// 判断报文中offset处的名称是否等于点分格式的name（不区分大小写）
+bool dns_engine_name_equals(const uint8_t *packet, size_t len, size_t offset, const char *name);
+
+// 将查询中OPT记录声明的UDP负载大小限制为max_payload（转发时避免上游应答超出接收缓冲区）
+// 报文格式非法返回false
+bool dns_engine_clamp_edns(uint8_t *packet, size_t len, uint16_t max_payload);
+
+#endif /* DNS_ENGINE_H */
@@ -0,0 +1,99 @@
+#include "dns_forward.h"
+#include "dns_cache.h"
+#include "dns_engine.h"
+#include <string.h>
+
+typedef struct {
+    bool in_use;
+    uint16_t upstream_id;
+    uint16_t client_id;
+    dns_forward_client_t client;
+    int64_t sent_us;
+} dns_pending_t;
+
+static dns_pending_t s_pending[DNS_FORWARD_MAX_PENDING];
+
+dns_forward_status_t dns_forward_begin(uint8_t *packet, size_t len, const dns_forward_client_t *client,
+                                       uint16_t upstream_id, int64_t now_us)
+{
+    if (len < DNS_ENGINE_HEADER_LEN) {
+        return DNS_FORWARD_INVALID;
+    }
+
+    dns_pending_t *slot = NULL;
+    for (int i = 0; i < DNS_FORWARD_MAX_PENDING; i++) {
+        if (!s_pending[i].in_use) {
+            slot = &s_pending[i];
+            break;
+        }
+    }
+    if (slot == NULL) {
+        return DNS_FORWARD_FULL;
+    }
+
+    // 使用随机ID转发，避免不同客户端的ID冲突，也使伪造应答更难命中
+    slot->in_use = true;
+    slot->client_id = (uint16_t)((packet[0] << 8) | packet[1]);
+    slot->upstream_id = upstream_id;
+    slot->client = *client;
+    slot->sent_us = now_us;
+    packet[0] = (uint8_t)(upstream_id >> 8);
+    packet[1] = (uint8_t)upstream_id;
+    return DNS_FORWARD_OK;
+}
+
+void dns_forward_cancel(uint16_t upstream_id)
+{
+    for (int i = 0; i < DNS_FORWARD_MAX_PENDING; i++) {
+        if (s_pending[i].in_use && s_pending[i].upstream_id == upstream_id) {
+            s_pending[i].in_use = false;
+            return;
+        }
+    }
+}
+
+bool dns_forward_complete(uint8_t *packet, size_t len, dns_forward_client_t *client,
+                          uint32_t *rtt_us, int64_t now_us)
+{
+    if (len < DNS_ENGINE_HEADER_LEN) {
+        return false;
+    }
+
+    uint16_t id = (uint16_t)((packet[0] << 8) | packet[1]);
+    dns_pending_t *slot = NULL;
+    for (int i = 0; i < DNS_FORWARD_MAX_PENDING; i++) {
+        if (s_pending[i].in_use && s_pending[i].upstream_id == id) {
+            slot = &s_pending[i];
+            break;
+        }
+    }
+    if (slot == NULL) {
+        return false;
+    }
+    slot->in_use = false;
+
+    dns_cache_store(packet, len, (uint32_t)(now_us / 1000000));
+
+    packet[0] = (uint8_t)(slot->client_id >> 8);
+    packet[1] = (uint8_t)slot->client_id;
+    *client = slot->client;
+    *rtt_us = (uint32_t)(now_us - slot->sent_us);
+    return true;
+}
+
+int dns_forward_expire(int64_t now_us, uint32_t timeout_ms)
+{
+    int expired = 0;
+    for (int i = 0; i < DNS_FORWARD_MAX_PENDING; i++) {
+        if (s_pending[i].in_use && now_us - s_pending[i].sent_us > (int64_t)timeout_ms * 1000) {
+            s_pending[i].in_use = false;
+            expired++;
+        }
+    }
+    return expired;
+}
+
+void dns_forward_reset(void)
+{
+    memset(s_pending, 0, sizeof(s_pending));
+}
@@ -0,0 +1,45 @@
+#ifndef DNS_FORWARD_H
+#define DNS_FORWARD_H
+
+// DNS转发的待应答表
+// 查询改用调用者给出的随机ID发往上游，上游应答按ID找回客户端并还原ID，同时写入dns_cache
+// 纯C实现，收发由调用者完成，可以在主机上对着本地的桩解析器测试
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define DNS_FORWARD_MAX_PENDING 8    // 同时等待上游应答的查询数
+
+// 客户端地址（网络字节序）
+typedef struct {
+    uint32_t addr;
+    uint16_t port;
+} dns_forward_client_t;
+
+typedef enum {
+    DNS_FORWARD_OK = 0,
+    DNS_FORWARD_FULL,           // 待应答表已满
+    DNS_FORWARD_INVALID,        // 报文过短
+} dns_forward_status_t;
+
+// 登记一个待转发的查询，并把报文ID就地改为upstream_id
+// 调用者随后发给上游，发送失败时调用dns_forward_cancel
+dns_forward_status_t dns_forward_begin(uint8_t *packet, size_t len, const dns_forward_client_t *client,
+                                       uint16_t upstream_id, int64_t now_us);
+
+// 撤销dns_forward_begin登记的查询
+void dns_forward_cancel(uint16_t upstream_id);
+
+// 处理上游应答：匹配待应答的查询，写入缓存并就地还原客户端ID
+// 匹配时返回true并给出客户端地址和上游往返时间，无人等待的应答返回false
+bool dns_forward_complete(uint8_t *packet, size_t len, dns_forward_client_t *client,
+                          uint32_t *rtt_us, int64_t now_us);
+
+// 丢弃超时未应答的查询（客户端会自行重试），返回丢弃数
+int dns_forward_expire(int64_t now_us, uint32_t timeout_ms);
+
+// 清空待应答表（切换上游时调用）
+void dns_forward_reset(void);
+
+#endif /* DNS_FORWARD_H */
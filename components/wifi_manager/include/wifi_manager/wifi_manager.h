@@ -3,6 +3,8 @@
 
 #include "esp_wifi.h"
 #include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
 
 // 工作模式枚举
 typedef enum {
@@ -10,6 +12,93 @@ typedef enum {
     WIFI_MANAGER_MODE_STA     // 客户端模式（服务模式）
 } wifi_working_mode_t;
 
+// DNS服务器统计（未联网时为Captive Portal应答，联网后转发到上游并缓存）
+typedef struct {
+    bool running;
+    bool forwarding;            // 是否处于转发模式
+    uint32_t upstream;          // 上游DNS地址（网络字节序）
+    uint32_t queries;           // 收到的查询数
+    uint32_t responses;         // 发出的响应数
+    uint32_t dropped;           // 丢弃数（无法解析、本身是响应或发送失败）
+    uint32_t answers;           // 应答的A记录数
+    uint32_t nodata;            // 以NODATA回答的问题数
+    uint32_t errors;            // 非NOERROR响应数
+    uint32_t truncated;         // 截断的响应数
+    uint32_t last_latency_us;   // 从收到查询到发出响应的耗时
+    uint32_t avg_latency_us;
+    uint32_t max_latency_us;
+    uint32_t cache_hits;        // 由缓存应答的查询数
+    uint32_t cache_negative_hits; // 其中命中否定缓存的次数
+    uint32_t cache_misses;
+    uint16_t cache_entries;
+    uint32_t forwarded;         // 转发到上游的查询数
+    uint32_t forward_full;      // 待应答表满而丢弃的查询数
+    uint32_t upstream_responses;
+    uint32_t upstream_timeouts;
+    uint32_t upstream_avg_latency_us;
+} wifi_dns_stats_t;
+
+// STA重连状态
+typedef enum {
+    WIFI_RECONNECT_IDLE = 0,    // 没有进行中的连接
+    WIFI_RECONNECT_CONNECTING,  // 已发起连接，等待结果
+    WIFI_RECONNECT_BACKOFF,     // 等待退避定时器到期
+    WIFI_RECONNECT_CONNECTED,
+} wifi_reconnect_state_t;
+
+// STA连接统计
+typedef struct {
+    uint32_t boot_to_ip_ms;     // 启动到首次获得IP的时间（0表示尚未获得）
+    uint32_t last_connect_ms;   // 最近一次从发起连接到获得IP的时间
+    bool last_fast;             // 最近一次是否通过定向连接成功
+    uint32_t connects;          // 获得IP的次数
+    uint32_t fast_attempts;     // 定向连接尝试次数
+    uint32_t fast_successes;
+    uint32_t fast_fallbacks;    // 定向连接失败后回退全信道扫描的次数
+    uint32_t network_switches;  // 重试用尽后换到其他已保存网络的次数
+    uint32_t roams;             // 因信号偏弱主动漫游的次数
+    uint32_t backoff_retries;   // 经过退避等待的重试次数
+    uint32_t failed_rounds;     // 所有已保存网络都失败的轮数
+    uint8_t reconnect_state;    // wifi_reconnect_state_t
+    uint32_t reconnect_delay_ms; // 最近一次安排的退避时间
+    bool fast_hint_valid;       // 是否有上次成功连接的记录
+    uint8_t fast_hint_channel;
+} wifi_connect_stats_t;
+
+// AP/STA信道协调统计
+typedef struct {
+    uint8_t ap_channel;         // AP当前信道
+    uint8_t recommended_channel; // 最近一次评估得到的最空闲信道，0表示尚未评估
+    uint32_t idle_moves;        // STA空闲时迁到更空闲信道的次数
+    uint32_t pre_moves;         // STA连接前预先迁到目标信道的次数
+    uint32_t forced_follows;    // 未能预先迁移，STA关联时AP被迫跟随的次数
+    uint32_t move_failures;
+    uint32_t ap_disconnects;    // AP客户端断开总数
+    // 最近一次切换前后的对比（观察窗口结束后填写after字段）
+    bool settling;              // 观察窗口进行中
+    uint8_t last_from;
+    uint8_t last_to;
+    uint8_t clients_before;
+    uint8_t clients_after;
+    uint16_t disconnects_after; // 窗口内AP客户端断开次数
+    uint32_t rx_bytes_per_s_before; // AP接口接收速率（切换前为上次标记到切换时的平均值）
+    uint32_t rx_bytes_per_s_after;
+    uint32_t tx_bytes_per_s_before; // AP接口发送速率
+    uint32_t tx_bytes_per_s_after;
+} wifi_channel_stats_t;
+
+// 默认事件循环分发延迟（周期投递探测事件，测量从投递到被处理的时间）
+typedef struct {
+    uint32_t probes;
+    uint32_t post_failures;     // 事件队列满导致投递失败的次数
+    uint32_t last_latency_us;
+    uint32_t avg_latency_us;
+    uint32_t max_latency_us;
+    uint32_t handler_calls;     // WiFi/IP事件处理次数
+    uint32_t handler_avg_us;    // 事件处理函数的执行时间
+    uint32_t handler_max_us;
+} wifi_event_loop_stats_t;
+
 // WiFi事件回调类型
 typedef void (*wifi_event_callback_t)(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data);
 
@@ -19,22 +108,253 @@ void wifi_manager_init(void);
 // 开始AP模式
 esp_err_t wifi_manager_start_ap(void);
 
-// 开始STA模式
+// 开始STA模式，阻塞等待连接结果（基于wifi_manager_connect_async，不能在事件循环任务中调用）
 esp_err_t wifi_manager_start_sta(const char *ssid, const char *password);
 
+// 异步连接请求句柄，0表示无效
+typedef uint32_t wifi_connect_op_t;
+
+// 异步连接结果
+typedef enum {
+    WIFI_CONNECT_RESULT_PENDING = 0,
+    WIFI_CONNECT_RESULT_OK,             // 已获得IP
+    WIFI_CONNECT_RESULT_AUTH_FAILED,    // 认证或四次握手失败，通常是密码错误
+    WIFI_CONNECT_RESULT_NO_AP_FOUND,    // 找不到该网络（或认证方式不兼容）
+    WIFI_CONNECT_RESULT_FAILED,         // 其他原因，重试用尽
+    WIFI_CONNECT_RESULT_TIMEOUT,        // 超时仍未获得IP（后台重连继续进行）
+    WIFI_CONNECT_RESULT_SUPERSEDED,     // 被新的连接请求取代
+    WIFI_CONNECT_RESULT_ERROR,          // 驱动拒绝了连接请求
+} wifi_connect_result_t;
+
+// 异步连接状态
+typedef struct {
+    wifi_connect_op_t op;
+    wifi_connect_result_t result;
+    uint8_t reason;             // 最近一次断开的wifi_err_reason_t，0表示没有断开过
+    uint8_t attempts;           // 已发起的连接次数
+    uint32_t elapsed_ms;
+    uint32_t ip;                // 获得的IP（网络字节序）
+    char ssid[33];
+} wifi_connect_status_t;
+
+// 连接完成回调，在默认事件循环任务中调用，不能阻塞
+typedef void (*wifi_connect_cb_t)(const wifi_connect_status_t *status, void *arg);
+
+// 异步连接请求
+typedef struct {
+    const char *ssid;
+    const char *password;       // NULL或空字符串表示开放网络
+    bool save_on_success;       // 获得IP后加入已保存网络并设为最高优先级
+    uint32_t timeout_ms;        // 0使用默认值
+    wifi_connect_cb_t callback; // 可为NULL，通过wifi_manager_get_connect_status轮询
+    void *callback_arg;
+} wifi_connect_request_t;
+
+// 发起异步连接，立即返回句柄；结果通过回调或轮询获得，每个请求恰好完成一次
+esp_err_t wifi_manager_connect_async(const wifi_connect_request_t *request, wifi_connect_op_t *op);
+
+// 查询连接请求状态（op为0表示最近一次请求），只保留最近两次请求
+esp_err_t wifi_manager_get_connect_status(wifi_connect_op_t op, wifi_connect_status_t *status);
+
+// 结果名称
+const char *wifi_manager_connect_result_name(wifi_connect_result_t result);
+
 // 注册WiFi事件回调
 void wifi_manager_register_callback(wifi_event_callback_t callback, void *arg);
 
 // 获取当前模式
 wifi_working_mode_t wifi_manager_get_mode(void);
 
-// 保存WiFi凭证到NVS
+// 启动DNS服务器（STA断开时会自动以Captive Portal模式启动）
+esp_err_t wifi_manager_dns_start(void);
+
+// 停止DNS服务器并等待任务退出
+esp_err_t wifi_manager_dns_stop(void);
+
+// 获取DNS服务器统计
+void wifi_manager_get_dns_stats(wifi_dns_stats_t *stats);
+
+// 获取STA连接统计
+void wifi_manager_get_connect_stats(wifi_connect_stats_t *stats);
+
+// 获取信道协调统计
+void wifi_manager_get_channel_stats(wifi_channel_stats_t *stats);
+
+// 获取事件循环分发延迟统计
+void wifi_manager_get_event_loop_stats(wifi_event_loop_stats_t *stats);
+
+// 最多保存的网络数
+#define WIFI_MAX_NETWORKS 4
+
+// 已保存的网络
+typedef struct {
+    char ssid[33];
+    uint8_t priority;           // 0最优先（最近配网的网络）
+    bool visible;               // 是否在扫描缓存中
+    int8_t rssi;                // 扫描缓存中的信号
+} wifi_saved_network_t;
+
+// 保存WiFi凭证到NVS，加入网络列表并设为最高优先级（列表满时丢弃最低优先级的网络）
 esp_err_t wifi_manager_save_credentials(const char *ssid, const char *password);
 
-// 从NVS加载WiFi凭证
+// 从NVS加载优先级最高的WiFi凭证（ssid至少33字节，password至少65字节）
 esp_err_t wifi_manager_load_credentials(char *ssid, char *password);
 
-// 扫描可用的WiFi网络
-wifi_ap_record_t *wifi_manager_scan_networks(uint16_t *ap_count);
+// 获取已保存的网络列表，按优先级排列，返回数量
+int wifi_manager_get_saved_networks(wifi_saved_network_t *networks, int max);
+
+// 删除已保存的网络
+esp_err_t wifi_manager_forget_network(const char *ssid);
+
+// 扫描结果缓存中保留的网络数（按信号排序、按SSID去重后）
+#define WIFI_SCAN_MAX_RESULTS 10
+
+// 扫描结果信息
+typedef struct {
+    uint16_t count;             // 返回的网络数
+    bool valid;                 // 是否已有扫描结果
+    bool scanning;              // 是否有扫描正在进行
+    uint32_t age_ms;            // 结果距今的时间
+    uint32_t generation;        // 扫描代数，每完成一次扫描加1
+} wifi_scan_info_t;
+
+// 扫描服务统计
+typedef struct {
+    uint32_t requests;          // 获取结果的请求数
+    uint32_t cache_hits;        // 无需等待直接由缓存返回的请求数
+    uint32_t waits;             // 需要等待扫描完成的请求数
+    uint32_t coalesced;         // 合并到进行中扫描的请求数
+    uint32_t started;
+    uint32_t completed;
+    uint32_t failed;            // 驱动拒绝启动的扫描数
+    uint32_t last_duration_ms;
+    uint32_t last_seen;         // 上一轮驱动返回的记录数（已过滤弱信号和隐藏网络）
+    uint16_t last_unique;       // 上一轮不同SSID数
+} wifi_scan_stats_t;
+
+// 渐进式扫描进度（一轮扫描按信道组依次进行）
+typedef struct {
+    uint32_t sweep;             // 扫描轮次，完成后等于结果的generation
+    uint16_t count;             // 当前累计的网络数
+    uint8_t groups_done;        // 已完成的信道组数
+    uint8_t groups_total;
+    uint16_t channels_done;     // 本轮已扫描的信道位图（第n位表示信道n）
+    bool done;                  // 本轮是否已完成（此时结果即缓存结果）
+    uint32_t elapsed_ms;
+} wifi_scan_progress_t;
+
+// 扫描进度回调，每组信道完成时在默认事件循环任务中调用，不得阻塞
+typedef void (*wifi_scan_progress_cb_t)(const wifi_scan_progress_t *progress);
+
+// 请求一次后台扫描，不阻塞；已有扫描在进行时合并
+esp_err_t wifi_manager_scan_request(void);
+
+// 获取缓存的扫描结果
+// 结果不超过max_age_ms时立即返回；否则启动（或加入进行中的）扫描并最多等待wait_ms
+// 结果超过10秒时会在后台刷新。等待超时返回ESP_ERR_TIMEOUT，此时records中仍是旧结果
+// 只关心结果是否够新时max_records可以为0，records可以为NULL
+esp_err_t wifi_manager_scan_get(wifi_ap_record_t *records, uint16_t max_records,
+                                uint32_t max_age_ms, uint32_t wait_ms, wifi_scan_info_t *info);
+
+// 设置扫描进度回调（只支持一个，传NULL取消）
+void wifi_manager_set_scan_progress_cb(wifi_scan_progress_cb_t cb);
+
+// 获取扫描进度及当前累计结果；没有扫描在进行时返回缓存结果
+esp_err_t wifi_manager_scan_get_progress(wifi_ap_record_t *records, uint16_t max_records,
+                                         wifi_scan_progress_t *progress);
+
+// 获取扫描服务统计
+void wifi_manager_get_scan_stats(wifi_scan_stats_t *stats);
+
+// 链路质量采样：后台周期记录STA信号、信标丢失、重连和吞吐量
+#define WIFI_LINK_HISTORY_LEN 120
+#define WIFI_LINK_SAMPLE_INTERVAL_MS 2000
+
+// 一个采样周期的链路状态（计数均为本周期内的增量）
+typedef struct {
+    uint32_t uptime_ms;         // 采样时刻（启动以来）
+    int8_t rssi;                // 未连接时为0
+    uint8_t channel;            // STA所在信道，未连接时为0
+    uint8_t beacon_timeouts;    // 信标丢失次数
+    uint8_t retries;            // 发起的重连次数
+    uint8_t disconnects;
+    uint32_t rx_bytes;          // STA接口收发字节数
+    uint32_t tx_bytes;
+} wifi_link_sample_t;
+
+// 链路趋势和主动处理统计
+typedef struct {
+    uint16_t samples;           // 历史中的采样数
+    bool trend_valid;           // 连续已连接的采样足够计算趋势
+    int16_t rssi_avg;           // 平滑后的RSSI (dBm)
+    int16_t rssi_slope;         // RSSI变化趋势 (dB/分钟)
+    int16_t rssi_predicted;     // 按趋势预测的RSSI
+    uint32_t beacon_timeouts;   // 累计信标丢失次数
+    uint32_t early_scans;       // 预测信号走低时提前刷新扫描的次数
+    uint32_t predictive_roams;  // 按预测提前漫游的次数
+    uint32_t proactive_reconnects; // 信标开始丢失且无更好AP时主动重新关联的次数
+} wifi_link_stats_t;
+
+// 采样回调，每个采样周期在esp_timer任务中调用，不得阻塞
+typedef void (*wifi_link_sample_cb_t)(const wifi_link_sample_t *sample);
+
+// 设置采样回调（只支持一个，传NULL取消）
+void wifi_manager_set_link_sample_cb(wifi_link_sample_cb_t cb);
+
+// 按时间顺序复制最近的至多max个采样，返回复制的个数
+uint16_t wifi_manager_get_link_history(wifi_link_sample_t *samples, uint16_t max);
+
+// 获取链路趋势和统计
+void wifi_manager_get_link_stats(wifi_link_stats_t *stats);
+
+// 调制解调器省电策略：有活动（WebSocket客户端、刚收到请求、按键后等待状态变化）时使用busy_mode，
+// 否则降到idle_mode
+typedef struct {
+    uint8_t idle_mode;          // wifi_ps_type_t
+    uint8_t busy_mode;          // wifi_ps_type_t
+    uint16_t listen_interval;   // MAX_MODEM下的监听间隔（AP信标间隔数），下次关联时生效
+    uint32_t boost_ms;          // 最后一个请求之后保持busy_mode的时间
+} wifi_power_policy_t;
+
+// 各省电模式下的入站往返延迟：客户端通过/api/wifi/power/echo测量并在下一次请求中回报，
+// 按请求到达时的模式归类。下行请求要由AP缓存到STA按DTIM/监听间隔醒来，这部分等待包含在内
+typedef struct {
+    uint32_t probes;
+    uint32_t last_ms;
+    uint32_t avg_ms;
+    uint32_t max_ms;
+} wifi_power_latency_t;
+
+#define WIFI_POWER_MODES 3      // WIFI_PS_NONE / MIN_MODEM / MAX_MODEM
+
+typedef struct {
+    uint8_t mode;               // 当前wifi_ps_type_t
+    bool busy;
+    uint8_t ws_clients;
+    uint32_t switches;          // 模式切换次数
+    uint32_t boosts;            // 请求到达时从省电模式切到busy_mode的次数
+    uint32_t presses;           // 按键后保持busy_mode的次数
+    uint32_t requests[WIFI_POWER_MODES];   // 请求到达时所处的模式
+    uint32_t time_ms[WIFI_POWER_MODES];    // 各模式累计时间
+    wifi_power_latency_t latency[WIFI_POWER_MODES];
+} wifi_power_stats_t;
+
+// 设置省电策略并保存到NVS
+esp_err_t wifi_manager_set_power_policy(const wifi_power_policy_t *policy);
+
+// 获取当前省电策略
+void wifi_manager_get_power_policy(wifi_power_policy_t *policy);
+
+// 活动通知（可在任意任务中调用，开销很小）
+void wifi_manager_power_set_ws_clients(uint8_t count);
+void wifi_manager_power_notify_request(void);
+void wifi_manager_power_notify_press(void);
+
+// 入站延迟测量：当前模式（wifi_ps_type_t），以及记录客户端回报的往返时间
+uint8_t wifi_manager_power_mode(void);
+esp_err_t wifi_manager_power_record_echo(uint8_t mode, uint32_t rtt_ms);
+
+// 获取省电统计
+void wifi_manager_get_power_stats(wifi_power_stats_t *stats);
 
 #endif /* WIFI_MANAGER_H */ 
\ No newline at end of file
@@ -0,0 +1,241 @@
+#include "link_monitor.h"
+#include "netif_counter.h"
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include <string.h>
+
+static const char *TAG = "link_monitor";
+
+#define LINK_TREND_SAMPLES      8       // 计算趋势用的最近已连接采样数
+#define LINK_TREND_MIN_SAMPLES  4       // 少于此数不给出趋势
+#define LINK_EWMA_WEIGHT        4       // 平滑系数1/4
+#define LINK_PREDICT_HORIZON_MS 10000   // 预测多长时间之后的信号
+#define LINK_RECENT_SAMPLES     5       // 统计最近信标丢失的采样数
+
+// 环形缓冲区
+static wifi_link_sample_t s_history[WIFI_LINK_HISTORY_LEN];
+static uint16_t s_head = 0;             // 下一个写入位置
+static uint16_t s_count = 0;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// 本周期内的事件计数，采样时清零（受s_lock保护）
+static uint8_t s_beacon_timeouts = 0;
+static uint8_t s_retries = 0;
+static uint8_t s_disconnects = 0;
+
+// 趋势：连续已连接采样的信号（断开时清空）和平滑值（×16定点）
+static int8_t s_trend_rssi[LINK_TREND_SAMPLES];
+static uint8_t s_trend_len = 0;
+static int32_t s_avg_x16 = 0;
+static link_trend_t s_trend;
+static wifi_link_stats_t s_stats;
+
+static esp_timer_handle_t s_sample_timer = NULL;
+static link_trend_hook_t s_hook = NULL;
+static volatile wifi_link_sample_cb_t s_sample_cb = NULL;
+
+// STA接口吞吐量，采样时取差值；未能统计时为NULL
+static const netif_counter_t *s_sta_counter = NULL;
+static uint32_t s_rx_mark = 0;
+static uint32_t s_tx_mark = 0;
+
+static uint8_t saturate_u8(uint32_t value)
+{
+    return value > UINT8_MAX ? UINT8_MAX : (uint8_t)value;
+}
+
+// 最小二乘斜率（dB/采样，×16定点），采样等间隔
+static int32_t trend_slope_x16(void)
+{
+    int32_t n = s_trend_len;
+    int32_t sum_x = 0, sum_y = 0, sum_xy = 0, sum_xx = 0;
+    for (int32_t x = 0; x < n; x++) {
+        int32_t y = s_trend_rssi[x];
+        sum_x += x;
+        sum_y += y;
+        sum_xy += x * y;
+        sum_xx += x * x;
+    }
+    int32_t denom = n * sum_xx - sum_x * sum_x;
+    if (denom == 0) {
+        return 0;
+    }
+    return (n * sum_xy - sum_x * sum_y) * 16 / denom;
+}
+
+static void update_trend(bool connected, int8_t rssi)
+{
+    s_trend.connected = connected;
+    s_trend.rssi = rssi;
+    if (!connected) {
+        s_trend_len = 0;
+        s_trend.valid = false;
+        s_trend.slope = 0;
+        return;
+    }
+
+    if (s_trend_len == 0) {
+        s_avg_x16 = rssi * 16;
+    } else {
+        s_avg_x16 += (rssi * 16 - s_avg_x16) / LINK_EWMA_WEIGHT;
+    }
+    if (s_trend_len == LINK_TREND_SAMPLES) {
+        memmove(s_trend_rssi, s_trend_rssi + 1, LINK_TREND_SAMPLES - 1);
+        s_trend_len--;
+    }
+    s_trend_rssi[s_trend_len++] = rssi;
+
+    s_trend.avg = (int16_t)(s_avg_x16 / 16);
+    s_trend.valid = s_trend_len >= LINK_TREND_MIN_SAMPLES;
+    if (!s_trend.valid) {
+        s_trend.slope = 0;
+        s_trend.predicted = s_trend.avg;
+        return;
+    }
+    int32_t slope_x16 = trend_slope_x16();
+    s_trend.slope = (int16_t)(slope_x16 * (60000 / WIFI_LINK_SAMPLE_INTERVAL_MS) / 16);
+    s_trend.predicted = (int16_t)(s_trend.avg +
+                                  slope_x16 * (LINK_PREDICT_HORIZON_MS / WIFI_LINK_SAMPLE_INTERVAL_MS) / 16);
+}
+
+static void sample_timer_cb(void *arg)
+{
+    wifi_link_sample_t sample = {
+        .uptime_ms = (uint32_t)(esp_timer_get_time() / 1000),
+    };
+
+    wifi_ap_record_t ap;
+    bool connected = esp_wifi_sta_get_ap_info(&ap) == ESP_OK;
+    if (connected) {
+        sample.rssi = ap.rssi;
+        sample.channel = ap.primary;
+    }
+
+    uint32_t rx, tx;
+    netif_counter_read(s_sta_counter, &rx, &tx);
+    sample.rx_bytes = rx - s_rx_mark;
+    sample.tx_bytes = tx - s_tx_mark;
+    s_rx_mark = rx;
+    s_tx_mark = tx;
+
+    update_trend(connected, sample.rssi);
+
+    portENTER_CRITICAL(&s_lock);
+    sample.beacon_timeouts = s_beacon_timeouts;
+    sample.retries = s_retries;
+    sample.disconnects = s_disconnects;
+    s_beacon_timeouts = 0;
+    s_retries = 0;
+    s_disconnects = 0;
+
+    s_history[s_head] = sample;
+    s_head = (s_head + 1) % WIFI_LINK_HISTORY_LEN;
+    if (s_count < WIFI_LINK_HISTORY_LEN) {
+        s_count++;
+    }
+
+    uint32_t recent = 0;
+    for (uint16_t i = 1; i <= LINK_RECENT_SAMPLES && i <= s_count; i++) {
+        recent += s_history[(s_head + WIFI_LINK_HISTORY_LEN - i) % WIFI_LINK_HISTORY_LEN].beacon_timeouts;
+    }
+    s_trend.recent_beacon_timeouts = saturate_u8(recent);
+
+    s_stats.samples = s_count;
+    s_stats.trend_valid = s_trend.valid;
+    s_stats.rssi_avg = connected ? s_trend.avg : 0;
+    s_stats.rssi_slope = s_trend.slope;
+    s_stats.rssi_predicted = connected ? s_trend.predicted : 0;
+    s_stats.beacon_timeouts += sample.beacon_timeouts;
+    link_trend_t trend = s_trend;
+    portEXIT_CRITICAL(&s_lock);
+
+    if (s_hook != NULL) {
+        s_hook(&trend);
+    }
+    wifi_link_sample_cb_t cb = s_sample_cb;
+    if (cb != NULL) {
+        cb(&sample);
+    }
+}
+
+esp_err_t link_monitor_init(esp_netif_t *sta_netif, link_trend_hook_t hook)
+{
+    if (s_sample_timer != NULL) {
+        return ESP_OK;
+    }
+
+    s_hook = hook;
+    if (netif_counter_attach(sta_netif, &s_sta_counter) != ESP_OK) {
+        ESP_LOGW(TAG, "无法获取STA接口，不统计吞吐量");
+    }
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = sample_timer_cb,
+        .name = "link_mon",
+    };
+    esp_err_t err = esp_timer_create(&timer_args, &s_sample_timer);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return esp_timer_start_periodic(s_sample_timer, (uint64_t)WIFI_LINK_SAMPLE_INTERVAL_MS * 1000);
+}
+
+void link_monitor_note_beacon_timeout(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    if (s_beacon_timeouts < UINT8_MAX) {
+        s_beacon_timeouts++;
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void link_monitor_note_retry(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    if (s_retries < UINT8_MAX) {
+        s_retries++;
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void link_monitor_note_disconnect(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    if (s_disconnects < UINT8_MAX) {
+        s_disconnects++;
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void link_monitor_set_sample_cb(wifi_link_sample_cb_t cb)
+{
+    s_sample_cb = cb;
+}
+
+uint16_t link_monitor_get_history(wifi_link_sample_t *samples, uint16_t max)
+{
+    if (samples == NULL || max == 0) {
+        return 0;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    uint16_t n = s_count < max ? s_count : max;
+    uint16_t start = (s_head + WIFI_LINK_HISTORY_LEN - n) % WIFI_LINK_HISTORY_LEN;
+    for (uint16_t i = 0; i < n; i++) {
+        samples[i] = s_history[(start + i) % WIFI_LINK_HISTORY_LEN];
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return n;
+}
+
+void link_monitor_get_stats(wifi_link_stats_t *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+    portENTER_CRITICAL(&s_lock);
+    *stats = s_stats;
+    portEXIT_CRITICAL(&s_lock);
+}
@@ -0,0 +1,45 @@
+#ifndef LINK_MONITOR_H
+#define LINK_MONITOR_H
+
+// STA链路质量监测
+// 周期采样信号、信标丢失、重连次数和STA接口吞吐量，保存在环形缓冲区中，
+// 并由最近的信号计算平滑值和变化趋势，供wifi_manager在断线之前提前漫游或重新关联
+
+#include "esp_err.h"
+#include "esp_netif.h"
+#include "wifi_manager/wifi_manager.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// 每次采样后的链路趋势
+typedef struct {
+    bool connected;
+    bool valid;                 // 连续已连接的采样足够计算趋势
+    int8_t rssi;                // 本次采样的信号
+    int16_t avg;                // 平滑后的信号 (dBm)
+    int16_t slope;              // 变化趋势 (dB/分钟)
+    int16_t predicted;          // 按趋势预测的信号
+    uint8_t recent_beacon_timeouts; // 最近几个采样周期内的信标丢失次数
+} link_trend_t;
+
+// 采样钩子，在esp_timer任务中调用，不得阻塞
+typedef void (*link_trend_hook_t)(const link_trend_t *trend);
+
+// 初始化并开始周期采样；sta_netif用于统计吞吐量，需在启动WiFi前调用
+esp_err_t link_monitor_init(esp_netif_t *sta_netif, link_trend_hook_t hook);
+
+// 事件计数（在事件循环任务中调用）
+void link_monitor_note_beacon_timeout(void);
+void link_monitor_note_retry(void);
+void link_monitor_note_disconnect(void);
+
+// 设置采样回调
+void link_monitor_set_sample_cb(wifi_link_sample_cb_t cb);
+
+// 按时间顺序复制最近的至多max个采样
+uint16_t link_monitor_get_history(wifi_link_sample_t *samples, uint16_t max);
+
+// 填充统计中的采样和趋势部分
+void link_monitor_get_stats(wifi_link_stats_t *stats);
+
+#endif /* LINK_MONITOR_H */
@@ -0,0 +1,84 @@
+#include "netif_counter.h"
+#include "esp_netif_net_stack.h"
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+#include <stddef.h>
+
+#define NETIF_COUNTER_MAX 2     // STA和AP
+
+typedef struct {
+    struct netif *netif;
+    netif_input_fn orig_input;
+    netif_linkoutput_fn orig_linkoutput;
+    netif_counter_t counter;
+} counter_slot_t;
+
+static counter_slot_t s_slots[NETIF_COUNTER_MAX];
+static volatile int s_slot_count = 0;
+
+// 包装函数只安装在已登记的接口上，总能找到
+static counter_slot_t *find_slot(const struct netif *netif)
+{
+    for (int i = 0; i < s_slot_count; i++) {
+        if (s_slots[i].netif == netif) {
+            return &s_slots[i];
+        }
+    }
+    return NULL;
+}
+
+static err_t counting_input(struct pbuf *p, struct netif *netif)
+{
+    counter_slot_t *slot = find_slot(netif);
+    slot->counter.rx_bytes += p->tot_len;
+    return slot->orig_input(p, netif);
+}
+
+static err_t counting_linkoutput(struct netif *netif, struct pbuf *p)
+{
+    counter_slot_t *slot = find_slot(netif);
+    slot->counter.tx_bytes += p->tot_len;
+    return slot->orig_linkoutput(netif, p);
+}
+
+esp_err_t netif_counter_attach(esp_netif_t *esp_netif, const netif_counter_t **counter)
+{
+    if (counter == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *counter = NULL;
+
+    struct netif *netif = esp_netif != NULL ? esp_netif_get_netif_impl(esp_netif) : NULL;
+    if (netif == NULL || netif->input == NULL || netif->linkoutput == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    counter_slot_t *slot = find_slot(netif);
+    if (slot != NULL) {
+        *counter = &slot->counter;
+        return ESP_OK;
+    }
+    if (s_slot_count >= NETIF_COUNTER_MAX) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // 先登记再替换函数，包装函数被调用时一定能找到自己的槽
+    slot = &s_slots[s_slot_count];
+    slot->netif = netif;
+    slot->orig_input = netif->input;
+    slot->orig_linkoutput = netif->linkoutput;
+    slot->counter.rx_bytes = 0;
+    slot->counter.tx_bytes = 0;
+    s_slot_count++;
+    netif->input = counting_input;
+    netif->linkoutput = counting_linkoutput;
+
+    *counter = &slot->counter;
+    return ESP_OK;
+}
+
+void netif_counter_read(const netif_counter_t *counter, uint32_t *rx_bytes, uint32_t *tx_bytes)
+{
+    *rx_bytes = counter != NULL ? counter->rx_bytes : 0;
+    *tx_bytes = counter != NULL ? counter->tx_bytes : 0;
+}
@@ -0,0 +1,23 @@
+#ifndef NETIF_COUNTER_H
+#define NETIF_COUNTER_H
+
+// 接口收发字节计数
+// 包装lwIP netif的input/linkoutput累计字节数，供link_monitor（STA）和wifi_channel（AP）取差值计算吞吐量。
+// 接收只在WiFi驱动任务、发送只在tcpip任务中调用，各自只有一个写者
+
+#include "esp_err.h"
+#include "esp_netif.h"
+#include <stdint.h>
+
+typedef struct {
+    volatile uint32_t rx_bytes;
+    volatile uint32_t tx_bytes;
+} netif_counter_t;
+
+// 开始统计esp_netif的收发字节数，同一接口重复调用返回同一个计数器；在启动WiFi前调用
+esp_err_t netif_counter_attach(esp_netif_t *esp_netif, const netif_counter_t **counter);
+
+// 读取累计字节数（会回绕，调用者取差值），counter为NULL时均为0
+void netif_counter_read(const netif_counter_t *counter, uint32_t *rx_bytes, uint32_t *tx_bytes);
+
+#endif /* NETIF_COUNTER_H */
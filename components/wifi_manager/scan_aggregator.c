@@ -0,0 +1,258 @@
+#include "scan_aggregator.h"
+#include <string.h>
+
+#define SLOT_NONE      SCAN_AGGREGATOR_SLOTS    // 堆元素不对应任何槽位（哈希表满时）
+#define HEAP_NONE      0xFF                     // 槽位对应的SSID不在堆中
+
+_Static_assert((SCAN_AGGREGATOR_SLOTS & (SCAN_AGGREGATOR_SLOTS - 1)) == 0, "槽数必须为2的幂");
+_Static_assert(SCAN_AGGREGATOR_TOP_K < HEAP_NONE, "K过大");
+
+// 哈希槽：只记录SSID的哈希和见过的最强信号，SSID本身只保存在堆中
+// 被挤出堆的SSID无法再比较名称，用hash和check两个独立的哈希共同作为键
+typedef struct {
+    uint32_t hash;              // 0表示空槽
+    int8_t best_rssi;
+    uint8_t heap_index;         // 在堆中的位置，不在堆中为HEAP_NONE
+    uint16_t check;             // 第二个哈希（占用原有的填充字节）
+} agg_slot_t;
+
+static agg_slot_t s_slots[SCAN_AGGREGATOR_SLOTS];
+
+// 按rssi的最小堆，堆顶是当前保留的最弱网络
+static scan_ap_t s_heap[SCAN_AGGREGATOR_TOP_K];
+static uint16_t s_heap_slot[SCAN_AGGREGATOR_TOP_K];
+static uint8_t s_heap_count = 0;
+
+static scan_aggregator_stats_t s_stats;
+static scan_channel_load_t s_channel_load;
+
+// FNV-1a，0保留给空槽
+static uint32_t ssid_hash(const char *ssid)
+{
+    uint32_t hash = 2166136261u;
+    for (const uint8_t *p = (const uint8_t *)ssid; *p != '\0'; p++) {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    return hash != 0 ? hash : 1;
+}
+
+// djb2，与FNV-1a无关，用于区分主哈希冲突的SSID
+static uint16_t ssid_check(const char *ssid)
+{
+    uint32_t hash = 5381;
+    for (const uint8_t *p = (const uint8_t *)ssid; *p != '\0'; p++) {
+        hash = hash * 33 + *p;
+    }
+    return (uint16_t)(hash ^ (hash >> 16));
+}
+
+static void heap_set(uint8_t index, const scan_ap_t *ap, uint16_t slot)
+{
+    s_heap[index] = *ap;
+    s_heap_slot[index] = slot;
+    if (slot != SLOT_NONE) {
+        s_slots[slot].heap_index = index;
+    }
+}
+
+static void heap_swap(uint8_t a, uint8_t b)
+{
+    scan_ap_t ap = s_heap[a];
+    uint16_t slot = s_heap_slot[a];
+    heap_set(a, &s_heap[b], s_heap_slot[b]);
+    heap_set(b, &ap, slot);
+}
+
+static void sift_up(uint8_t index)
+{
+    while (index > 0) {
+        uint8_t parent = (index - 1) / 2;
+        if (s_heap[parent].rssi <= s_heap[index].rssi) {
+            break;
+        }
+        heap_swap(parent, index);
+        index = parent;
+    }
+}
+
+static void sift_down(uint8_t index)
+{
+    for (;;) {
+        uint8_t smallest = index;
+        uint8_t left = 2 * index + 1;
+        uint8_t right = left + 1;
+        if (left < s_heap_count && s_heap[left].rssi < s_heap[smallest].rssi) {
+            smallest = left;
+        }
+        if (right < s_heap_count && s_heap[right].rssi < s_heap[smallest].rssi) {
+            smallest = right;
+        }
+        if (smallest == index) {
+            break;
+        }
+        heap_swap(index, smallest);
+        index = smallest;
+    }
+}
+
+// 尝试让一个新的SSID进入前K名
+static void offer(const scan_ap_t *ap, uint16_t slot)
+{
+    if (s_heap_count < SCAN_AGGREGATOR_TOP_K) {
+        heap_set(s_heap_count, ap, slot);
+        s_heap_count++;
+        sift_up(s_heap_count - 1);
+        return;
+    }
+
+    // 信号相同时先到者优先
+    if (ap->rssi <= s_heap[0].rssi) {
+        return;
+    }
+
+    if (s_heap_slot[0] != SLOT_NONE) {
+        s_slots[s_heap_slot[0]].heap_index = HEAP_NONE;
+    }
+    heap_set(0, ap, slot);
+    sift_down(0);
+    s_stats.evictions++;
+}
+
+// 已在堆中的SSID出现了更强的BSS，原地替换（最小堆中键变大需要下沉）
+static void replace(uint8_t index, const scan_ap_t *ap)
+{
+    heap_set(index, ap, s_heap_slot[index]);
+    sift_down(index);
+}
+
+// 哈希表已满或两个哈希都冲突时在堆中线性查重
+static void add_linear(const scan_ap_t *ap)
+{
+    s_stats.table_full++;
+    for (uint8_t i = 0; i < s_heap_count; i++) {
+        if (strcmp(s_heap[i].ssid, ap->ssid) == 0) {
+            s_stats.duplicates++;
+            if (ap->rssi > s_heap[i].rssi) {
+                replace(i, ap);
+            }
+            return;
+        }
+    }
+    offer(ap, SLOT_NONE);
+}
+
+void scan_aggregator_reset(void)
+{
+    memset(s_slots, 0, sizeof(s_slots));
+    s_heap_count = 0;
+    memset(&s_stats, 0, sizeof(s_stats));
+    memset(&s_channel_load, 0, sizeof(s_channel_load));
+}
+
+void scan_aggregator_add_channel(uint8_t channel, int8_t rssi)
+{
+    if (channel == 0 || channel > SCAN_AGGREGATOR_CHANNELS) {
+        return;
+    }
+
+    int weight = rssi + 100;
+    if (weight < 1) {
+        weight = 1;
+    } else if (weight > 70) {
+        weight = 70;
+    }
+    if (s_channel_load.bss[channel] < UINT8_MAX) {
+        s_channel_load.bss[channel]++;
+    }
+    if (s_channel_load.weight[channel] <= UINT16_MAX - weight) {
+        s_channel_load.weight[channel] += weight;
+    }
+}
+
+void scan_aggregator_channel_load(scan_channel_load_t *load)
+{
+    *load = s_channel_load;
+}
+
+void scan_aggregator_add(const scan_ap_t *ap)
+{
+    s_stats.seen++;
+
+    uint32_t hash = ssid_hash(ap->ssid);
+    uint16_t check = ssid_check(ap->ssid);
+    uint16_t slot = hash & (SCAN_AGGREGATOR_SLOTS - 1);
+
+    for (uint16_t probe = 0; probe < SCAN_AGGREGATOR_SLOTS; probe++) {
+        agg_slot_t *entry = &s_slots[slot];
+
+        if (entry->hash == 0) {
+            // 新的SSID
+            entry->hash = hash;
+            entry->check = check;
+            entry->best_rssi = ap->rssi;
+            entry->heap_index = HEAP_NONE;
+            s_stats.unique++;
+            offer(ap, slot);
+            return;
+        }
+
+        // 只有主哈希相同的是另一个SSID，继续探测下一个槽
+        if (entry->hash == hash && entry->check == check) {
+            if (entry->heap_index != HEAP_NONE &&
+                strcmp(s_heap[entry->heap_index].ssid, ap->ssid) != 0) {
+                // 两个哈希都冲突，不能按同名处理
+                add_linear(ap);
+                return;
+            }
+
+            s_stats.duplicates++;
+            if (ap->rssi <= entry->best_rssi) {
+                return;
+            }
+            entry->best_rssi = ap->rssi;
+            if (entry->heap_index != HEAP_NONE) {
+                replace(entry->heap_index, ap);
+            } else {
+                // 之前被挤出前K名，信号变强后重新参与
+                offer(ap, slot);
+            }
+            return;
+        }
+
+        slot = (slot + 1) & (SCAN_AGGREGATOR_SLOTS - 1);
+    }
+
+    add_linear(ap);
+}
+
+uint16_t scan_aggregator_sorted(scan_ap_t *out, uint16_t max)
+{
+    uint16_t count = 0;
+
+    // 插入排序（K很小），信号相同时保持堆中顺序
+    for (uint8_t i = 0; i < s_heap_count; i++) {
+        const scan_ap_t *ap = &s_heap[i];
+        uint16_t pos = count < max ? count : max;
+        while (pos > 0 && out[pos - 1].rssi < ap->rssi) {
+            if (pos < max) {
+                out[pos] = out[pos - 1];
+            }
+            pos--;
+        }
+        if (pos < max) {
+            out[pos] = *ap;
+            if (count < max) {
+                count++;
+            }
+        }
+    }
+
+    return count;
+}
+
+void scan_aggregator_get_stats(scan_aggregator_stats_t *stats)
+{
+    *stats = s_stats;
+    stats->kept = s_heap_count;
+}
@@ -0,0 +1,58 @@
+#ifndef SCAN_AGGREGATOR_H
+#define SCAN_AGGREGATOR_H
+
+// 单遍扫描结果聚合
+// 逐条输入扫描记录，按SSID去重（保留信号最强的BSS），只保留信号最强的K个网络
+// 去重使用开放寻址哈希表，前K名使用最小堆，全部为静态内存，不排序、不分配
+// 纯C实现，可以直接在主机上编译测试
+
+#include <stdint.h>
+
+#define SCAN_AGGREGATOR_TOP_K      10
+#define SCAN_AGGREGATOR_SLOTS      256     // SSID哈希表槽数，必须为2的幂
+#define SCAN_AGGREGATOR_SSID_LEN   32
+#define SCAN_AGGREGATOR_CHANNELS   14      // 2.4GHz信道1-14
+
+// 精简的扫描记录
+typedef struct {
+    char ssid[SCAN_AGGREGATOR_SSID_LEN + 1];
+    uint8_t bssid[6];
+    int8_t rssi;
+    uint8_t channel;
+    uint8_t authmode;
+} scan_ap_t;
+
+typedef struct {
+    uint32_t seen;              // 输入的记录数
+    uint16_t unique;            // 不同的SSID数
+    uint16_t kept;              // 当前保留的网络数
+    uint32_t duplicates;        // 被同名更强记录覆盖或丢弃的记录数
+    uint32_t evictions;         // 被更强网络挤出前K名的次数
+    uint32_t table_full;        // 哈希表满（或两个哈希都冲突）时退化为线性查重的次数
+} scan_aggregator_stats_t;
+
+// 各信道的占用情况，下标为信道号（0不用），统计所有BSS（包括隐藏和弱信号的网络）
+typedef struct {
+    uint8_t bss[SCAN_AGGREGATOR_CHANNELS + 1];     // BSS数量
+    uint16_t weight[SCAN_AGGREGATOR_CHANNELS + 1]; // 按信号加权的占用，每个BSS计(rssi+100)，限制在1-70
+} scan_channel_load_t;
+
+// 开始新一轮聚合
+void scan_aggregator_reset(void);
+
+// 输入一条记录（调用者负责过滤隐藏网络和弱信号）
+void scan_aggregator_add(const scan_ap_t *ap);
+
+// 记录一个BSS对信道的占用（对每条记录调用，不受过滤影响）
+void scan_aggregator_add_channel(uint8_t channel, int8_t rssi);
+
+// 获取本轮的信道占用
+void scan_aggregator_channel_load(scan_channel_load_t *load);
+
+// 按信号从强到弱输出当前保留的网络，返回条数
+uint16_t scan_aggregator_sorted(scan_ap_t *out, uint16_t max);
+
+// 获取本轮统计
+void scan_aggregator_get_stats(scan_aggregator_stats_t *stats);
+
+#endif /* SCAN_AGGREGATOR_H */
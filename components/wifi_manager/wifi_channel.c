@@ -0,0 +1,261 @@
+#include "wifi_channel.h"
+#include "wifi_scan.h"
+#include "netif_counter.h"
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "wifi_channel";
+
+// 空闲时的候选信道（2.4GHz互不重叠的信道）
+static const uint8_t s_idle_candidates[] = { 1, 6, 11 };
+
+#define CHANNEL_MAX                  13
+#define CHANNEL_OVERLAP_SPAN         5       // 相距小于5个信道的BSS频谱重叠，按距离线性衰减
+#define CHANNEL_MOVE_MIN_GAIN        30      // 目标信道的占用至少比当前低这么多（加权单位）才迁移
+#define CHANNEL_MOVE_MAX_RATIO       70      // 且不超过当前占用的70%
+#define CHANNEL_SCAN_MAX_AGE_MS      60000   // 评估时可接受的扫描结果年龄
+#define CHANNEL_IDLE_MIN_INTERVAL_MS 300000  // 空闲迁移的最小间隔，避免AP客户端频繁切换
+#define CHANNEL_SETTLE_MS            10000   // 切换后的观察窗口
+
+static uint8_t s_ap_channel = 0;
+static int64_t s_last_idle_move_us = 0;
+static esp_timer_handle_t s_settle_timer = NULL;
+
+// 切换前后对比：切换时记下断开计数和AP收发字节数，窗口结束时计算差值
+static wifi_channel_stats_t s_stats;
+static uint32_t s_disconnects_at_switch = 0;
+static uint32_t s_rx_mark = 0;
+static uint32_t s_tx_mark = 0;
+static int64_t s_mark_us = 0;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// AP接口吞吐量，未能统计时为NULL
+static const netif_counter_t *s_ap_counter = NULL;
+
+static uint8_t ap_client_count(void)
+{
+    wifi_sta_list_t list;
+    if (esp_wifi_ap_get_sta_list(&list) != ESP_OK) {
+        return 0;
+    }
+    return (uint8_t)list.num;
+}
+
+static uint32_t per_second(uint32_t count, int64_t elapsed_us)
+{
+    if (elapsed_us <= 0) {
+        return 0;
+    }
+    return (uint32_t)((uint64_t)count * 1000000ULL / (uint64_t)elapsed_us);
+}
+
+// 加权占用：同信道的BSS全额计入，相邻信道按距离衰减
+static uint32_t channel_score(const scan_channel_load_t *load, uint8_t channel)
+{
+    uint32_t score = 0;
+    for (int k = 1; k <= SCAN_AGGREGATOR_CHANNELS; k++) {
+        int distance = abs(k - (int)channel);
+        if (distance < CHANNEL_OVERLAP_SPAN) {
+            score += (uint32_t)load->weight[k] * (CHANNEL_OVERLAP_SPAN - distance);
+        }
+    }
+    return score / CHANNEL_OVERLAP_SPAN;
+}
+
+// 观察窗口结束，记录切换后的客户端数、断开次数和AP收发速率
+static void settle_timer_cb(void *arg)
+{
+    int64_t now = esp_timer_get_time();
+    uint32_t rx, tx;
+    netif_counter_read(s_ap_counter, &rx, &tx);
+    uint8_t clients = ap_client_count();
+
+    portENTER_CRITICAL(&s_lock);
+    s_stats.clients_after = clients;
+    s_stats.disconnects_after = (uint16_t)(s_stats.ap_disconnects - s_disconnects_at_switch);
+    s_stats.rx_bytes_per_s_after = per_second(rx - s_rx_mark, now - s_mark_us);
+    s_stats.tx_bytes_per_s_after = per_second(tx - s_tx_mark, now - s_mark_us);
+    s_stats.settling = false;
+    s_rx_mark = rx;
+    s_tx_mark = tx;
+    s_mark_us = now;
+    wifi_channel_stats_t stats = s_stats;
+    portEXIT_CRITICAL(&s_lock);
+
+    ESP_LOGI(TAG, "信道 %d -> %d 切换后: 客户端 %d -> %d，断开 %d 次，AP接收 %lu -> %lu B/s，发送 %lu -> %lu B/s",
+             stats.last_from, stats.last_to, stats.clients_before, stats.clients_after,
+             stats.disconnects_after, (unsigned long)stats.rx_bytes_per_s_before,
+             (unsigned long)stats.rx_bytes_per_s_after, (unsigned long)stats.tx_bytes_per_s_before,
+             (unsigned long)stats.tx_bytes_per_s_after);
+}
+
+// 记录切换前的状态并开始观察窗口
+static void begin_settle(uint8_t from, uint8_t to, uint8_t clients)
+{
+    int64_t now = esp_timer_get_time();
+    uint32_t rx, tx;
+    netif_counter_read(s_ap_counter, &rx, &tx);
+
+    esp_timer_stop(s_settle_timer);
+    portENTER_CRITICAL(&s_lock);
+    s_stats.ap_channel = to;
+    s_stats.last_from = from;
+    s_stats.last_to = to;
+    s_stats.clients_before = clients;
+    s_stats.clients_after = 0;
+    s_stats.disconnects_after = 0;
+    s_stats.rx_bytes_per_s_before = per_second(rx - s_rx_mark, now - s_mark_us);
+    s_stats.tx_bytes_per_s_before = per_second(tx - s_tx_mark, now - s_mark_us);
+    s_stats.rx_bytes_per_s_after = 0;
+    s_stats.tx_bytes_per_s_after = 0;
+    s_stats.settling = true;
+    s_rx_mark = rx;
+    s_tx_mark = tx;
+    s_mark_us = now;
+    s_disconnects_at_switch = s_stats.ap_disconnects;
+    portEXIT_CRITICAL(&s_lock);
+    esp_timer_start_once(s_settle_timer, (uint64_t)CHANNEL_SETTLE_MS * 1000);
+}
+
+// 把AP迁到channel；csa_count使AP先在信标中通告切换，客户端随之切换而不必重新关联
+static bool move_ap(uint8_t channel, const char *why)
+{
+    if (channel == 0 || channel > CHANNEL_MAX || channel == s_ap_channel) {
+        return false;
+    }
+
+    wifi_config_t ap_config;
+    esp_err_t err = esp_wifi_get_config(WIFI_IF_AP, &ap_config);
+    if (err == ESP_OK) {
+        ap_config.ap.channel = channel;
+        ap_config.ap.csa_count = WIFI_CHANNEL_CSA_COUNT;
+        err = esp_wifi_set_config(WIFI_IF_AP, &ap_config);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "AP迁到信道 %d 失败: %s", channel, esp_err_to_name(err));
+        portENTER_CRITICAL(&s_lock);
+        s_stats.move_failures++;
+        portEXIT_CRITICAL(&s_lock);
+        return false;
+    }
+
+    uint8_t clients = ap_client_count();
+    ESP_LOGI(TAG, "AP信道 %d -> %d（%s），%d 个客户端", s_ap_channel, channel, why, clients);
+    begin_settle(s_ap_channel, channel, clients);
+    s_ap_channel = channel;
+    return true;
+}
+
+esp_err_t wifi_channel_init(uint8_t ap_channel, esp_netif_t *ap_netif)
+{
+    if (s_settle_timer == NULL) {
+        const esp_timer_create_args_t timer_args = {
+            .callback = settle_timer_cb,
+            .name = "ch_settle",
+        };
+        esp_err_t err = esp_timer_create(&timer_args, &s_settle_timer);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    if (netif_counter_attach(ap_netif, &s_ap_counter) != ESP_OK) {
+        ESP_LOGW(TAG, "无法获取AP接口，不统计切换前后的吞吐量");
+    }
+    s_ap_channel = ap_channel;
+    netif_counter_read(s_ap_counter, &s_rx_mark, &s_tx_mark);
+    s_mark_us = esp_timer_get_time();
+    portENTER_CRITICAL(&s_lock);
+    s_stats.ap_channel = ap_channel;
+    portEXIT_CRITICAL(&s_lock);
+    return ESP_OK;
+}
+
+void wifi_channel_evaluate_idle(void)
+{
+    scan_channel_load_t load;
+    uint32_t age_ms = 0;
+    if (s_ap_channel == 0 || wifi_scan_get_channel_load(&load, &age_ms) != ESP_OK ||
+        age_ms > CHANNEL_SCAN_MAX_AGE_MS) {
+        return;
+    }
+
+    uint8_t best = s_idle_candidates[0];
+    uint32_t best_score = UINT32_MAX;
+    for (size_t i = 0; i < sizeof(s_idle_candidates); i++) {
+        uint32_t score = channel_score(&load, s_idle_candidates[i]);
+        if (score < best_score) {
+            best_score = score;
+            best = s_idle_candidates[i];
+        }
+    }
+    uint32_t current_score = channel_score(&load, s_ap_channel);
+
+    portENTER_CRITICAL(&s_lock);
+    s_stats.recommended_channel = best;
+    portEXIT_CRITICAL(&s_lock);
+
+    // 差别不明显时不打扰AP客户端
+    if (best == s_ap_channel || current_score < best_score + CHANNEL_MOVE_MIN_GAIN ||
+        best_score * 100 > current_score * CHANNEL_MOVE_MAX_RATIO) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+    if (s_last_idle_move_us > 0 && now - s_last_idle_move_us < (int64_t)CHANNEL_IDLE_MIN_INTERVAL_MS * 1000) {
+        return;
+    }
+
+    ESP_LOGI(TAG, "信道 %d 占用 %lu，信道 %d 占用 %lu", s_ap_channel, (unsigned long)current_score,
+             best, (unsigned long)best_score);
+    if (move_ap(best, "空闲时选择最空闲信道")) {
+        s_last_idle_move_us = now;
+        portENTER_CRITICAL(&s_lock);
+        s_stats.idle_moves++;
+        portEXIT_CRITICAL(&s_lock);
+    }
+}
+
+void wifi_channel_prepare_sta(uint8_t channel)
+{
+    if (move_ap(channel, "STA连接前预先迁移")) {
+        portENTER_CRITICAL(&s_lock);
+        s_stats.pre_moves++;
+        portEXIT_CRITICAL(&s_lock);
+    }
+}
+
+void wifi_channel_sta_connected(uint8_t channel)
+{
+    if (channel == 0 || channel == s_ap_channel) {
+        return;
+    }
+
+    // 目标信道事先未知（或预先迁移失败），驱动已把AP切到STA的信道
+    ESP_LOGW(TAG, "STA关联在信道 %d，AP从信道 %d 被迫跟随", channel, s_ap_channel);
+    begin_settle(s_ap_channel, channel, ap_client_count());
+    s_ap_channel = channel;
+    portENTER_CRITICAL(&s_lock);
+    s_stats.forced_follows++;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void wifi_channel_ap_client_left(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    s_stats.ap_disconnects++;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void wifi_channel_get_stats(wifi_channel_stats_t *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+    portENTER_CRITICAL(&s_lock);
+    *stats = s_stats;
+    portEXIT_CRITICAL(&s_lock);
+}
@@ -0,0 +1,34 @@
+#ifndef WIFI_CHANNEL_H
+#define WIFI_CHANNEL_H
+
+// APSTA信道协调
+// 单射频下AP必须与STA同信道：STA连接前预先把AP迁到目标信道，STA空闲时按扫描缓存
+// 把AP放到最空闲的信道；切换时AP在信标中发送信道切换通告（CSA），客户端无需重新关联
+
+#include "esp_err.h"
+#include "esp_netif.h"
+#include "wifi_manager/wifi_manager.h"
+#include <stdint.h>
+
+// AP切换信道前发送CSA的信标数（写入wifi_ap_config_t.csa_count）
+#define WIFI_CHANNEL_CSA_COUNT 5
+
+// 初始化，AP配置完成后由wifi_manager_init调用；ap_netif用于统计切换前后的AP收发字节数
+esp_err_t wifi_channel_init(uint8_t ap_channel, esp_netif_t *ap_netif);
+
+// STA空闲时按扫描缓存评估并迁到最空闲的信道（在事件循环任务中调用）
+void wifi_channel_evaluate_idle(void);
+
+// STA即将在channel上连接，预先把AP迁过去；0表示目标信道未知
+void wifi_channel_prepare_sta(uint8_t channel);
+
+// STA已关联到channel
+void wifi_channel_sta_connected(uint8_t channel);
+
+// AP客户端断开
+void wifi_channel_ap_client_left(void);
+
+// 获取统计
+void wifi_channel_get_stats(wifi_channel_stats_t *stats);
+
+#endif /* WIFI_CHANNEL_H */
@@ -2,6 +2,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
+#include "freertos/semphr.h"
 #include "esp_system.h"
 #include "esp_wifi.h"
 #include "esp_event.h"
@@ -9,6 +10,8 @@
 #include "nvs_flash.h"
 #include "nvs.h"
 #include "esp_netif.h"
+#include "esp_timer.h"
+#include "esp_random.h"
 #include "lwip/err.h"
 #include "lwip/sys.h"
 #include "lwip/dns.h"
@@ -17,6 +20,15 @@
 #include <errno.h>
 
 #include "wifi_manager/wifi_manager.h"
+#include "pm_lock/pm_lock.h"
+#include "dns_engine.h"
+#include "dns_cache.h"
+#include "dns_forward.h"
+#include "wifi_scan.h"
+#include "wifi_networks.h"
+#include "wifi_channel.h"
+#include "link_monitor.h"
+#include "wifi_power.h"
 
 static const char *TAG = "wifi_manager";
 
@@ -24,8 +36,36 @@ static const char *TAG = "wifi_manager";
 #define MAX_PASSWORD_LEN 64
 #define MAX_CONNECTION_RETRIES 5
 #define WIFI_NVS_NAMESPACE "wifi_config"
-#define WIFI_NVS_SSID_KEY "ssid"
-#define WIFI_NVS_PASS_KEY "password"
+#define WIFI_NVS_FAST_KEY "fast_conn"  // 上次成功连接的AP（BSSID、信道、认证方式）
+#define WIFI_FAST_CONNECT_VERSION 1
+#define WIFI_FAST_CONNECT_ENABLED 1    // 有上次成功连接的记录时先在该信道上定向连接
+
+// 漫游：链路监测预测信号将低于阈值时用扫描缓存寻找更好的已保存网络（或同名的其他AP）
+#define ROAM_RSSI_THRESHOLD -75       // 预测信号低于此值才考虑漫游
+#define ROAM_HYSTERESIS_DB 8          // 目标AP至少比当前（平滑后）强这么多才切换
+#define ROAM_SCAN_MAX_AGE_MS 15000    // 评估漫游时可接受的扫描结果年龄
+#define ROAM_MIN_INTERVAL_MS 30000    // 两次漫游的最小间隔，避免在两个AP之间来回切换
+
+// 主动重新关联：没有更好的AP、信号已很差且开始丢信标时，不等驱动判定断线（数秒的信标超时
+// 再加退避重试），主动断开并全信道扫描重新选择BSS
+#define LINK_CRITICAL_RSSI -85
+#define LINK_RECONNECT_MIN_INTERVAL_MS 60000
+
+// 重连退避：第n次重试前等待 BASE*2^(n-1)（不超过MAX），再叠加±JITTER%的随机抖动
+// 重连由esp_timer驱动，事件处理函数中不等待
+#define RECONNECT_BACKOFF_BASE_MS 500
+#define RECONNECT_BACKOFF_MAX_MS 30000
+#define RECONNECT_JITTER_PERCENT 25
+#define RECONNECT_ROUND_DELAY_MS 60000   // 所有已保存网络都失败后，下一轮连接前的等待
+#define RECONNECT_POST_RETRY_MS 50       // 事件队列满时重新投递的间隔
+
+// 事件循环分发延迟探测
+#define EVENT_LOOP_PROBE_INTERVAL_MS 2000
+
+// 异步连接
+#define CONNECT_OP_TIMEOUT_MS 20000      // 默认超时，超时后结束请求但后台重连继续
+#define CONNECT_POST_TIMEOUT_MS 100      // 投递请求到事件循环的最长等待
+#define START_STA_WAIT_MARGIN_MS 2000    // 同步接口在请求超时之外多等的时间
 
 // AP模式配置
 #define DEFAULT_AP_SSID "ESP32开机助手"
@@ -37,6 +77,15 @@ static const char *TAG = "wifi_manager";
 #define DNS_PORT 53
 #define DNS_TASK_STACK_SIZE 4096
 #define DNS_TASK_PRIORITY 5
+#define DNS_MAX_PACKET_SIZE 512      // 未协商EDNS时的UDP报文上限
+#define DNS_ANSWER_TTL 60            // Captive Portal应答TTL，联网后客户端能较快重新解析
+#define DNS_SELECT_TIMEOUT_MS 200    // select超时，决定停止请求的最长响应时间
+#define DNS_STOP_TIMEOUT_MS 1000     // 等待DNS任务退出的上限
+// STA联网后转发到上游DNS；为0则联网后关闭DNS服务器。AP客户端拿到上游地址后还需要经本机路由，
+// 须先启用CONFIG_LWIP_IP_FORWARD和CONFIG_LWIP_IPV4_NAPT，否则转发只会让客户端解析到无法访问的地址
+#define DNS_FORWARD_WHEN_CONNECTED 0
+#define DNS_FORWARD_TIMEOUT_MS 3000  // 上游应答超时
+#define DNS_LOCAL_HOSTNAME "esp32-butler" // 转发模式下仍解析到AP地址的本机名称
 
 // 事件组位
 #define WIFI_CONNECTED_BIT BIT0
@@ -52,132 +101,314 @@ static void *s_event_callback_arg = NULL;
 // 重连尝试次数
 static int s_retry_num = 0;
 
+// 定向快速连接：保存上次成功连接的AP，下次只在该信道上连接指定BSSID，失败再回退全信道扫描
+// PMK由WiFi驱动随STA配置缓存在NVS中（CONFIG_ESP_WIFI_NVS_ENABLED），SSID和密码不变时无需重新计算
+typedef struct {
+    uint8_t version;
+    uint8_t channel;
+    uint8_t authmode;
+    uint8_t bssid[6];
+    char ssid[MAX_SSID_LEN + 1];
+} wifi_fast_connect_t;
+
+static wifi_fast_connect_t s_fast_hint;
+static bool s_fast_hint_valid = false;
+static bool s_sta_directed = false;          // 当前STA配置为定向连接
+static bool s_fast_attempt = false;          // 正在进行定向连接尝试
+static int64_t s_connect_start_us = 0;       // 本次连接开始时间，0表示没有进行中的连接
+static wifi_connect_stats_t s_connect_stats;
+
+// 多网络选择：本轮连接中已失败的网络（按优先级索引的位图）
+static uint32_t s_failed_networks = 0;
+
+// 漫游和主动重新关联（在事件循环任务中按链路趋势评估）
+static bool s_roaming = false;               // 已为漫游主动断开，等待重连到目标
+static scan_ap_t s_roam_target;
+static int64_t s_last_roam_us = 0;
+static bool s_link_reconnect = false;        // 已为重新关联主动断开
+static int64_t s_last_link_reconnect_us = 0;
+static uint32_t s_early_scans = 0;
+static uint32_t s_early_scan_gen = UINT32_MAX;
+static uint32_t s_predictive_roams = 0;
+static uint32_t s_proactive_reconnects = 0;
+
+// 重连状态机：定时器到期后向默认事件循环投递内部事件，所有状态转换都在事件循环任务中完成
+ESP_EVENT_DEFINE_BASE(WIFI_MANAGER_EVENT);
+
+enum {
+    WIFI_MANAGER_EVENT_RECONNECT,   // 退避结束，事件数据为发起时的代数
+    WIFI_MANAGER_EVENT_PROBE,       // 延迟探测，事件数据为投递时间
+    WIFI_MANAGER_EVENT_CONNECT,     // 异步连接请求，事件数据为connect_msg_t
+    WIFI_MANAGER_EVENT_CONNECT_TIMEOUT, // 异步连接超时，事件数据为请求句柄
+    WIFI_MANAGER_EVENT_LINK_CHECK,  // 链路趋势走低，事件数据为link_trend_t
+};
+
+static esp_timer_handle_t s_reconnect_timer = NULL;
+static wifi_reconnect_state_t s_reconnect_state = WIFI_RECONNECT_IDLE;
+static uint32_t s_reconnect_gen = 0;         // 每次安排或取消重连时递增，丢弃过期的定时器事件
+static bool s_round_pending = false;         // 下一次重连开始新的一轮（重新选择网络）
+
+// 异步连接：请求投递到事件循环中执行，每个请求恰好完成（回调）一次
+typedef struct {
+    wifi_connect_op_t op;
+    char ssid[MAX_SSID_LEN + 1];
+    char password[MAX_PASSWORD_LEN + 1];
+    bool save_on_success;
+    uint32_t timeout_ms;
+    wifi_connect_cb_t callback;
+    void *callback_arg;
+} connect_msg_t;
+
+typedef struct {
+    wifi_connect_status_t status;
+    char password[MAX_PASSWORD_LEN + 1]; // 仅在需要成功后保存时保留，完成时清除
+    bool save_on_success;
+    wifi_connect_cb_t callback;
+    void *callback_arg;
+    int64_t start_us;
+} connect_op_t;
+
+static connect_op_t s_connect_op;                   // 当前（或最近完成的）请求
+static wifi_connect_status_t s_prev_connect_status; // 上一个请求的最终状态
+static wifi_connect_op_t s_next_connect_op = 0;
+static esp_timer_handle_t s_connect_op_timer = NULL;
+static bool s_switch_pending = false;               // 已断开旧链路，断开事件到达后连接新网络
+static portMUX_TYPE s_connect_op_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// 事件循环延迟统计
+static esp_timer_handle_t s_probe_timer = NULL;
+static wifi_event_loop_stats_t s_loop_stats;
+static uint64_t s_loop_latency_total_us = 0;
+static uint64_t s_loop_handler_total_us = 0;
+static portMUX_TYPE s_loop_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
 // ESP-NETIF实例
 static esp_netif_t *s_sta_netif = NULL;
 static esp_netif_t *s_ap_netif = NULL;
 
 // DNS服务器任务句柄
 static TaskHandle_t s_dns_server_task_handle = NULL;
-static bool s_dns_server_running = false;
+static volatile bool s_dns_stop_requested = false;
+static SemaphoreHandle_t s_dns_lock = NULL;       // 串行化启动和停止
+static SemaphoreHandle_t s_dns_exit_sem = NULL;   // 任务退出时释放
+
+// DNS转发的上游地址（网络字节序，0表示Captive Portal模式），待应答表见dns_forward.c
+static volatile uint32_t s_dns_upstream = 0;
+
+// 转发模式下仍由本机应答的名称：本机名称和各系统的联网检测域名（检测请求交给本机的门户页面处理）
+static const char *s_dns_local_names[] = {
+    DNS_LOCAL_HOSTNAME,
+    DNS_LOCAL_HOSTNAME ".lan",
+    "connectivitycheck.gstatic.com",
+    "captive.apple.com",
+    "www.msftconnecttest.com",
+    "dns.msftncsi.com",
+};
+
+// DNS统计
+static wifi_dns_stats_t s_dns_stats;
+static uint64_t s_dns_latency_total_us = 0;
+static uint64_t s_dns_upstream_total_us = 0;
+static portMUX_TYPE s_dns_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// 取得AP接口地址作为Captive Portal的应答地址
+static void get_portal_ip(uint8_t ip[4])
+{
+    esp_netif_ip_info_t ip_info;
+    if (s_ap_netif != NULL && esp_netif_get_ip_info(s_ap_netif, &ip_info) == ESP_OK && ip_info.ip.addr != 0) {
+        memcpy(ip, &ip_info.ip.addr, 4);
+        return;
+    }
+    // 默认AP地址192.168.4.1
+    ip[0] = 192;
+    ip[1] = 168;
+    ip[2] = 4;
+    ip[3] = 1;
+}
 
-// WiFi连接任务的参数结构
-typedef struct {
-    char ssid[MAX_SSID_LEN];
-    char password[MAX_PASSWORD_LEN];
-} wifi_connect_params_t;
+// 记录一次查询的处理结果（本地应答时result非NULL）
+static void dns_record_stats(const dns_engine_result_t *result, bool sent, bool cache_hit, uint32_t latency_us)
+{
+    portENTER_CRITICAL(&s_dns_stats_lock);
+    if (!sent) {
+        s_dns_stats.dropped++;
+    } else {
+        s_dns_stats.responses++;
+        if (result != NULL) {
+            s_dns_stats.answers += result->answers;
+            s_dns_stats.nodata += result->nodata;
+            if (result->rcode != DNS_RCODE_NOERROR) {
+                s_dns_stats.errors++;
+            }
+            if (result->truncated) {
+                s_dns_stats.truncated++;
+            }
+        }
+        if (cache_hit) {
+            s_dns_stats.cache_hits++;
+        }
+        s_dns_stats.last_latency_us = latency_us;
+        s_dns_latency_total_us += latency_us;
+        s_dns_stats.avg_latency_us = (uint32_t)(s_dns_latency_total_us / s_dns_stats.responses);
+        if (latency_us > s_dns_stats.max_latency_us) {
+            s_dns_stats.max_latency_us = latency_us;
+        }
+    }
+    portEXIT_CRITICAL(&s_dns_stats_lock);
+}
 
-// WiFi连接任务
-static void wifi_connect_task(void *pvParameters)
+// 本地应答的Captive Portal查询，响应就地写回packet
+static void dns_answer_locally(uint8_t *packet, size_t len, size_t capacity, const uint8_t portal_ip[4],
+                               struct sockaddr_in *from_addr, int sockfd, int64_t received_us)
 {
-    wifi_connect_params_t *params = (wifi_connect_params_t *)pvParameters;
-    
-    ESP_LOGI(TAG, "开始连接到保存的WiFi: %s", params->ssid);
-    esp_err_t ret = wifi_manager_start_sta(params->ssid, params->password);
-    
-    if (ret != ESP_OK) {
-        ESP_LOGW(TAG, "连接到保存的WiFi失败: %s", esp_err_to_name(ret));
+    dns_engine_result_t result;
+    size_t response_len = dns_engine_answer(packet, len, capacity, portal_ip, DNS_ANSWER_TTL, &result);
+    bool sent = false;
+
+    if (response_len > 0) {
+        sent = sendto(sockfd, packet, response_len, 0, (struct sockaddr *)from_addr, sizeof(*from_addr)) >= 0;
+    }
+
+    dns_record_stats(&result, sent, false, (uint32_t)(esp_timer_get_time() - received_us));
+
+    if (sent) {
+        ESP_LOGD(TAG, "已发送DNS响应: rcode=%d, A记录=%d, NODATA=%d%s",
+                 result.rcode, result.answers, result.nodata, result.truncated ? ", 已截断" : "");
     }
-    
-    // 释放参数内存
-    free(params);
-    vTaskDelete(NULL);
 }
 
-// 处理DNS查询包
-static void dns_process_query(uint8_t *packet, size_t len, struct sockaddr_in *from_addr, int sockfd)
+// 是否为本机名称（转发模式下仍在本地应答）
+static bool dns_is_local_name(const uint8_t *packet, size_t len)
 {
-    // 定义DNS头部结构
-    typedef struct {
-        uint16_t id;
-        uint16_t flags;
-        uint16_t qdcount;
-        uint16_t ancount;
-        uint16_t nscount;
-        uint16_t arcount;
-    } __attribute__((packed)) dns_header_t;
+    for (size_t i = 0; i < sizeof(s_dns_local_names) / sizeof(s_dns_local_names[0]); i++) {
+        if (dns_engine_name_equals(packet, len, DNS_ENGINE_HEADER_LEN, s_dns_local_names[i])) {
+            return true;
+        }
+    }
+    return false;
+}
 
-    // 确保长度至少包含DNS头部
-    if (len < sizeof(dns_header_t)) {
-        return;
+// 转发查询到上游，失败返回false
+static bool dns_forward_query(uint8_t *packet, size_t len, struct sockaddr_in *from_addr,
+                              int upstream_fd, uint32_t upstream_ip, int64_t now_us)
+{
+    // 上游应答最多接收DNS_MAX_PACKET_SIZE字节
+    if (!dns_engine_clamp_edns(packet, len, DNS_MAX_PACKET_SIZE)) {
+        return false;
     }
 
-    dns_header_t *header = (dns_header_t *)packet;
-    
-    // 转换为主机字节序
-    uint16_t id = ntohs(header->id);
-    uint16_t flags = ntohs(header->flags);
-    uint16_t qdcount = ntohs(header->qdcount);
-
-    // 只处理查询包
-    if ((flags & 0x8000) == 0 && qdcount > 0) {
-        ESP_LOGD(TAG, "收到DNS查询请求");
-        
-        // 构建响应包
-        uint8_t response[512];
-        memcpy(response, packet, len);
-        
-        // 修改响应标志 (应答 + 授权回答)
-        header = (dns_header_t *)response;
-        flags = 0x8400; // 10000100 00000000 (应答 + 授权回答)
-        header->flags = htons(flags);
-        header->ancount = htons(1); // 一个回答记录
-        
-        // 找到查询问题的结尾位置
-        size_t qname_len = 0;
-        size_t i = sizeof(dns_header_t);
-        while (i < len && packet[i] != 0) {
-            qname_len += packet[i] + 1;
-            i += packet[i] + 1;
+    dns_forward_client_t client = {
+        .addr = from_addr->sin_addr.s_addr,
+        .port = from_addr->sin_port,
+    };
+    uint16_t upstream_id = (uint16_t)esp_random();
+    dns_forward_status_t status = dns_forward_begin(packet, len, &client, upstream_id, now_us);
+    if (status != DNS_FORWARD_OK) {
+        if (status == DNS_FORWARD_FULL) {
+            portENTER_CRITICAL(&s_dns_stats_lock);
+            s_dns_stats.forward_full++;
+            portEXIT_CRITICAL(&s_dns_stats_lock);
         }
-        
-        // 跳过qname和qtype/qclass (qname + 1字节0结束符 + 2字节qtype + 2字节qclass)
-        size_t answer_start = sizeof(dns_header_t) + qname_len + 1 + 4;
-        
-        // 添加应答记录
-        // 设置域名指针 (指向查询问题的域名)
-        response[answer_start] = 0xC0; // 指针标记
-        response[answer_start + 1] = sizeof(dns_header_t); // 指向问题部分的域名
-        
-        // 类型: A记录
-        response[answer_start + 2] = 0;
-        response[answer_start + 3] = 1;
-        
-        // 类: IN
-        response[answer_start + 4] = 0;
-        response[answer_start + 5] = 1;
-        
-        // TTL: 300秒
-        response[answer_start + 6] = 0;
-        response[answer_start + 7] = 0;
-        response[answer_start + 8] = 1;
-        response[answer_start + 9] = 44;
-        
-        // 数据长度: 4字节 (IPv4地址)
-        response[answer_start + 10] = 0;
-        response[answer_start + 11] = 4;
-        
-        // IPv4地址 (192.168.4.1)
-        response[answer_start + 12] = 192;
-        response[answer_start + 13] = 168;
-        response[answer_start + 14] = 4;
-        response[answer_start + 15] = 1;
-        
-        // 发送响应
-        size_t response_len = answer_start + 16;
-        sendto(sockfd, response, response_len, 0, (struct sockaddr *)from_addr, sizeof(*from_addr));
-        
-        ESP_LOGD(TAG, "已发送DNS响应，将所有域名指向192.168.4.1");
+        return false;
+    }
+
+    struct sockaddr_in upstream_addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(DNS_PORT),
+        .sin_addr.s_addr = upstream_ip,
+    };
+    if (sendto(upstream_fd, packet, len, 0, (struct sockaddr *)&upstream_addr, sizeof(upstream_addr)) < 0) {
+        dns_forward_cancel(upstream_id);
+        return false;
     }
+
+    portENTER_CRITICAL(&s_dns_stats_lock);
+    s_dns_stats.forwarded++;
+    portEXIT_CRITICAL(&s_dns_stats_lock);
+    return true;
 }
 
-// DNS服务器任务
-static void dns_server_task(void *pvParameters)
+// 处理客户端查询
+static void dns_handle_query(uint8_t *packet, size_t len, size_t capacity, const uint8_t portal_ip[4],
+                             struct sockaddr_in *from_addr, int sockfd,
+                             int upstream_fd, uint32_t upstream_ip, int64_t received_us)
+{
+    // 门户模式、格式非法、响应报文和本机名称都交给本地应答
+    bool forwardable = upstream_fd >= 0 && len >= DNS_ENGINE_HEADER_LEN && (packet[2] & 0x80) == 0 &&
+                       dns_engine_skip_name(packet, len, DNS_ENGINE_HEADER_LEN) != 0 &&
+                       !dns_is_local_name(packet, len);
+    if (!forwardable) {
+        dns_answer_locally(packet, len, capacity, portal_ip, from_addr, sockfd, received_us);
+        return;
+    }
+
+    size_t cached_len = dns_cache_lookup(packet, len, packet, capacity, (uint32_t)(received_us / 1000000));
+    if (cached_len > 0) {
+        bool sent = sendto(sockfd, packet, cached_len, 0, (struct sockaddr *)from_addr, sizeof(*from_addr)) >= 0;
+        dns_record_stats(NULL, sent, true, (uint32_t)(esp_timer_get_time() - received_us));
+        return;
+    }
+
+    if (!dns_forward_query(packet, len, from_addr, upstream_fd, upstream_ip, received_us)) {
+        dns_record_stats(NULL, false, false, 0);
+    }
+}
+
+// 处理上游应答：还原客户端ID、转发给客户端并写入缓存
+static void dns_handle_upstream(uint8_t *packet, size_t len, const struct sockaddr_in *from_addr,
+                                int sockfd, uint32_t upstream_ip, int64_t now_us)
+{
+    if (len < DNS_ENGINE_HEADER_LEN || from_addr->sin_addr.s_addr != upstream_ip ||
+        from_addr->sin_port != htons(DNS_PORT)) {
+        return;
+    }
+
+    dns_forward_client_t client;
+    uint32_t rtt_us;
+    if (!dns_forward_complete(packet, len, &client, &rtt_us, now_us)) {
+        return;
+    }
+
+    struct sockaddr_in client_addr = {
+        .sin_family = AF_INET,
+        .sin_port = client.port,
+        .sin_addr.s_addr = client.addr,
+    };
+    bool sent = sendto(sockfd, packet, len, 0, (struct sockaddr *)&client_addr, sizeof(client_addr)) >= 0;
+
+    portENTER_CRITICAL(&s_dns_stats_lock);
+    s_dns_stats.upstream_responses++;
+    s_dns_upstream_total_us += rtt_us;
+    s_dns_stats.upstream_avg_latency_us = (uint32_t)(s_dns_upstream_total_us / s_dns_stats.upstream_responses);
+    portEXIT_CRITICAL(&s_dns_stats_lock);
+
+    dns_record_stats(NULL, sent, false, rtt_us);
+}
+
+// 丢弃超时未应答的转发请求（客户端会自行重试）
+static void dns_expire_pending(int64_t now_us)
+{
+    int expired = dns_forward_expire(now_us, DNS_FORWARD_TIMEOUT_MS);
+    if (expired > 0) {
+        portENTER_CRITICAL(&s_dns_stats_lock);
+        s_dns_stats.upstream_timeouts += expired;
+        s_dns_stats.dropped += expired;
+        portEXIT_CRITICAL(&s_dns_stats_lock);
+    }
+}
+
+// 处理DNS查询直到收到停止请求，socket出错时返回false
+// 用select()带超时同时等待客户端查询和上游应答，停止请求在一个超时周期内生效
+static bool dns_serve(void)
 {
+    int upstream_fd = -1;
+    uint32_t active_upstream = 0;
+    bool ok = true;
+
     int sockfd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
     if (sockfd < 0) {
         ESP_LOGE(TAG, "无法创建DNS服务器socket: %d", errno);
-        vTaskDelete(NULL);
-        return;
+        return false;
     }
     
     // 绑定socket到DNS端口
@@ -190,87 +421,875 @@ static void dns_server_task(void *pvParameters)
     if (bind(sockfd, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
         ESP_LOGE(TAG, "DNS服务器绑定失败: %d", errno);
         close(sockfd);
-        vTaskDelete(NULL);
-        return;
+        return false;
     }
     
-    ESP_LOGI(TAG, "DNS服务器已启动，处理所有DNS查询");
+    ESP_LOGI(TAG, "DNS服务器已启动");
     
-    uint8_t rx_buffer[512];
-    s_dns_server_running = true;
+    uint8_t rx_buffer[DNS_MAX_PACKET_SIZE];
+    uint8_t portal_ip[4];
+    get_portal_ip(portal_ip);
     
     // 等待并处理DNS查询
-    while (s_dns_server_running) {
-        struct sockaddr_in client_addr;
-        socklen_t addr_len = sizeof(client_addr);
-        
-        int len = recvfrom(sockfd, rx_buffer, sizeof(rx_buffer), 0, 
-                           (struct sockaddr *)&client_addr, &addr_len);
-                           
-        if (len > 0) {
-            dns_process_query(rx_buffer, len, &client_addr, sockfd);
+    while (!s_dns_stop_requested) {
+        // 上游变化时重建转发socket，并清空待答表和缓存
+        uint32_t upstream = s_dns_upstream;
+        if (upstream != active_upstream) {
+            if (upstream_fd >= 0) {
+                close(upstream_fd);
+                upstream_fd = -1;
+            }
+            dns_forward_reset();
+            dns_cache_flush();
+            active_upstream = upstream;
+
+            if (upstream != 0) {
+                upstream_fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+                if (upstream_fd < 0) {
+                    ESP_LOGE(TAG, "无法创建DNS转发socket: %d，继续本地应答", errno);
+                } else {
+                    ESP_LOGI(TAG, "DNS切换为转发模式，上游: " IPSTR, IP2STR((esp_ip4_addr_t *)&upstream));
+                }
+            } else {
+                ESP_LOGI(TAG, "DNS切换为Captive Portal模式");
+            }
+        }
+
+        fd_set read_fds;
+        FD_ZERO(&read_fds);
+        FD_SET(sockfd, &read_fds);
+        int max_fd = sockfd;
+        if (upstream_fd >= 0) {
+            FD_SET(upstream_fd, &read_fds);
+            if (upstream_fd > max_fd) {
+                max_fd = upstream_fd;
+            }
+        }
+        struct timeval timeout = {
+            .tv_sec = 0,
+            .tv_usec = DNS_SELECT_TIMEOUT_MS * 1000,
+        };
+
+        int ready = select(max_fd + 1, &read_fds, NULL, NULL, &timeout);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ESP_LOGE(TAG, "DNS select失败: %d", errno);
+            ok = false;
+            break;
+        }
+
+        // 有数据时升频处理，select超时的空转不持锁
+        if (ready > 0) {
+            pm_lock_acquire(PM_LOCK_DNS);
+        }
+
+        if (ready > 0 && FD_ISSET(sockfd, &read_fds)) {
+            struct sockaddr_in client_addr;
+            socklen_t addr_len = sizeof(client_addr);
+            int len = recvfrom(sockfd, rx_buffer, sizeof(rx_buffer), MSG_DONTWAIT,
+                               (struct sockaddr *)&client_addr, &addr_len);
+            if (len > 0) {
+                int64_t received_us = esp_timer_get_time();
+                portENTER_CRITICAL(&s_dns_stats_lock);
+                s_dns_stats.queries++;
+                portEXIT_CRITICAL(&s_dns_stats_lock);
+
+                dns_handle_query(rx_buffer, len, sizeof(rx_buffer), portal_ip, &client_addr, sockfd,
+                                 upstream_fd, active_upstream, received_us);
+            }
+        }
+
+        if (ready > 0 && upstream_fd >= 0 && FD_ISSET(upstream_fd, &read_fds)) {
+            struct sockaddr_in from_addr;
+            socklen_t addr_len = sizeof(from_addr);
+            int len = recvfrom(upstream_fd, rx_buffer, sizeof(rx_buffer), MSG_DONTWAIT,
+                               (struct sockaddr *)&from_addr, &addr_len);
+            if (len > 0) {
+                dns_handle_upstream(rx_buffer, len, &from_addr, sockfd, active_upstream, esp_timer_get_time());
+            }
+        }
+
+        if (upstream_fd >= 0) {
+            dns_expire_pending(esp_timer_get_time());
+        }
+        if (ready > 0) {
+            pm_lock_release(PM_LOCK_DNS);
         }
     }
     
-    // 关闭socket并删除任务
+    // 关闭socket
+    if (upstream_fd >= 0) {
+        close(upstream_fd);
+    }
     close(sockfd);
-    s_dns_server_running = false;
-    s_dns_server_task_handle = NULL;
+    ESP_LOGI(TAG, "DNS服务器已停止");
+    return ok;
+}
+
+// DNS服务器任务
+static void dns_server_task(void *pvParameters)
+{
+    for (;;) {
+        bool ok = dns_serve();
+
+        xSemaphoreTake(s_dns_lock, portMAX_DELAY);
+        if (ok && !s_dns_stop_requested) {
+            // 退出期间start撤销了停止请求（联网后立即断开或漫游），重新打开socket继续服务
+            xSemaphoreGive(s_dns_lock);
+            ESP_LOGI(TAG, "停止请求已撤销，DNS服务器重新启动");
+            continue;
+        }
+        // 在锁内清除句柄并通知等待者，stop返回时任务已不再使用任何资源，start可以直接创建新任务
+        s_dns_server_task_handle = NULL;
+        xSemaphoreGive(s_dns_exit_sem);
+        xSemaphoreGive(s_dns_lock);
+        break;
+    }
     vTaskDelete(NULL);
 }
 
-// 启动DNS服务器
-static void start_dns_server(void)
+// 启动DNS服务器（可在事件循环中调用，不等待）
+static esp_err_t start_dns_server(void)
 {
+    if (s_dns_lock == NULL || s_dns_exit_sem == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(s_dns_lock, portMAX_DELAY);
+
     if (s_dns_server_task_handle != NULL) {
-        ESP_LOGI(TAG, "DNS服务器已经在运行");
-        return;
+        // 上一个任务还没退出：撤销停止请求，由它继续服务（或在退出检查时重新打开socket）
+        if (s_dns_stop_requested) {
+            s_dns_stop_requested = false;
+            ESP_LOGI(TAG, "撤销DNS服务器的停止请求");
+        } else {
+            ESP_LOGD(TAG, "DNS服务器已经在运行");
+        }
+        xSemaphoreGive(s_dns_lock);
+        return ESP_OK;
     }
-    
+
+    // 清除上一次退出留下的信号
+    xSemaphoreTake(s_dns_exit_sem, 0);
+    s_dns_stop_requested = false;
+
     // 创建DNS服务器任务
-    xTaskCreate(dns_server_task, "dns_server", DNS_TASK_STACK_SIZE, NULL, 
-                DNS_TASK_PRIORITY, &s_dns_server_task_handle);
-                
-    if (s_dns_server_task_handle == NULL) {
+    esp_err_t ret = ESP_OK;
+    if (xTaskCreate(dns_server_task, "dns_server", DNS_TASK_STACK_SIZE, NULL,
+                    DNS_TASK_PRIORITY, &s_dns_server_task_handle) != pdPASS) {
         ESP_LOGE(TAG, "创建DNS服务器任务失败");
+        s_dns_server_task_handle = NULL;
+        ret = ESP_ERR_NO_MEM;
+    }
+
+    xSemaphoreGive(s_dns_lock);
+    return ret;
+}
+
+// 停止DNS服务器，wait为true时等待任务退出（任务栈随之释放），事件循环中只能用wait=false
+static esp_err_t stop_dns_server(bool wait)
+{
+    if (s_dns_lock == NULL) {
+        return ESP_OK;
+    }
+
+    xSemaphoreTake(s_dns_lock, portMAX_DELAY);
+    bool running = s_dns_server_task_handle != NULL;
+    if (running) {
+        s_dns_stop_requested = true;
     }
+    xSemaphoreGive(s_dns_lock);
+
+    // 等待时不持锁：任务退出前要取锁确认停止请求仍然有效
+    if (wait && running && xSemaphoreTake(s_dns_exit_sem, pdMS_TO_TICKS(DNS_STOP_TIMEOUT_MS)) != pdTRUE) {
+        ESP_LOGE(TAG, "等待DNS任务退出超时");
+        return ESP_ERR_TIMEOUT;
+    }
+    return ESP_OK;
 }
 
-// 停止DNS服务器
-static void stop_dns_server(void)
+// 从NVS读取上次成功连接的AP
+static void load_fast_connect_hint(void)
 {
-    if (s_dns_server_running) {
-        s_dns_server_running = false;
-        // 等待任务自行结束
-        vTaskDelay(pdMS_TO_TICKS(100));
+    nvs_handle_t nvs_handle;
+    if (nvs_open(WIFI_NVS_NAMESPACE, NVS_READONLY, &nvs_handle) != ESP_OK) {
+        return;
     }
+    size_t len = sizeof(s_fast_hint);
+    esp_err_t err = nvs_get_blob(nvs_handle, WIFI_NVS_FAST_KEY, &s_fast_hint, &len);
+    nvs_close(nvs_handle);
+
+    s_fast_hint_valid = err == ESP_OK && len == sizeof(s_fast_hint) &&
+                        s_fast_hint.version == WIFI_FAST_CONNECT_VERSION &&
+                        s_fast_hint.channel >= 1 && s_fast_hint.channel <= 14;
 }
 
-// WiFi事件处理函数
-static void wifi_event_handler(void *arg, esp_event_base_t event_base,
-                               int32_t event_id, void *event_data)
+// 记录本次成功连接的AP，只在变化时写入flash
+static void save_fast_connect_hint(const char *ssid)
+{
+    wifi_ap_record_t ap_info;
+    if (esp_wifi_sta_get_ap_info(&ap_info) != ESP_OK) {
+        return;
+    }
+
+    wifi_fast_connect_t hint = {
+        .version = WIFI_FAST_CONNECT_VERSION,
+        .channel = ap_info.primary,
+        .authmode = ap_info.authmode,
+    };
+    memcpy(hint.bssid, ap_info.bssid, sizeof(hint.bssid));
+    strlcpy(hint.ssid, ssid, sizeof(hint.ssid));
+
+    if (s_fast_hint_valid && memcmp(&hint, &s_fast_hint, sizeof(hint)) == 0) {
+        return;
+    }
+
+    nvs_handle_t nvs_handle;
+    if (nvs_open(WIFI_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle) != ESP_OK) {
+        return;
+    }
+    esp_err_t err = nvs_set_blob(nvs_handle, WIFI_NVS_FAST_KEY, &hint, sizeof(hint));
+    if (err == ESP_OK) {
+        err = nvs_commit(nvs_handle);
+    }
+    nvs_close(nvs_handle);
+
+    if (err == ESP_OK) {
+        s_fast_hint = hint;
+        s_fast_hint_valid = true;
+        ESP_LOGI(TAG, "保存快速连接信息: " MACSTR ", 信道 %d", MAC2STR(hint.bssid), hint.channel);
+    }
+}
+
+// 有匹配当前SSID的快速连接记录时，把STA配置改为定向连接
+static bool apply_fast_connect(wifi_config_t *sta_config)
+{
+#if WIFI_FAST_CONNECT_ENABLED
+    if (!s_fast_hint_valid || strcmp(s_fast_hint.ssid, (const char *)sta_config->sta.ssid) != 0) {
+        return false;
+    }
+
+    sta_config->sta.bssid_set = true;
+    memcpy(sta_config->sta.bssid, s_fast_hint.bssid, sizeof(sta_config->sta.bssid));
+    sta_config->sta.channel = s_fast_hint.channel;
+    sta_config->sta.scan_method = WIFI_FAST_SCAN;
+
+    // 以上次的认证方式作为最低要求，混合模式取较低的一种
+    wifi_auth_mode_t authmode = (wifi_auth_mode_t)s_fast_hint.authmode;
+    if (authmode == WIFI_AUTH_WPA_WPA2_PSK) {
+        authmode = WIFI_AUTH_WPA_PSK;
+    } else if (authmode == WIFI_AUTH_WPA2_WPA3_PSK) {
+        authmode = WIFI_AUTH_WPA2_PSK;
+    }
+    sta_config->sta.threshold.authmode = authmode;
+
+    s_sta_directed = true;
+    s_fast_attempt = true;
+    s_connect_stats.fast_attempts++;
+    ESP_LOGI(TAG, "定向连接 " MACSTR "，信道 %d", MAC2STR(s_fast_hint.bssid), s_fast_hint.channel);
+    return true;
+#else
+    return false;
+#endif
+}
+
+// 清除STA配置中的BSSID和信道，下次连接时全信道扫描
+static void clear_directed_config(void)
+{
+    wifi_config_t sta_config;
+    if (esp_wifi_get_config(WIFI_IF_STA, &sta_config) != ESP_OK) {
+        return;
+    }
+    sta_config.sta.bssid_set = false;
+    memset(sta_config.sta.bssid, 0, sizeof(sta_config.sta.bssid));
+    sta_config.sta.channel = 0;
+    sta_config.sta.threshold.authmode = WIFI_AUTH_OPEN;
+    esp_wifi_set_config(WIFI_IF_STA, &sta_config);
+
+    s_sta_directed = false;
+    s_fast_attempt = false;
+}
+
+// 定向连接失败，恢复为全信道扫描的STA配置
+static void fallback_full_scan(void)
+{
+    clear_directed_config();
+    s_connect_stats.fast_fallbacks++;
+}
+
+// 把已保存的网络写入STA配置；target不为NULL时定向连接到该BSS
+static esp_err_t configure_sta_network(int index, const scan_ap_t *target)
+{
+    const wifi_network_t *network = wifi_networks_get(index);
+    if (network == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    wifi_config_t sta_config = {0};
+    strlcpy((char *)sta_config.sta.ssid, network->ssid, sizeof(sta_config.sta.ssid));
+    strlcpy((char *)sta_config.sta.password, network->password, sizeof(sta_config.sta.password));
+    sta_config.sta.listen_interval = wifi_power_listen_interval();
+
+    s_sta_directed = false;
+    s_fast_attempt = false;
+    if (target != NULL) {
+        sta_config.sta.bssid_set = true;
+        memcpy(sta_config.sta.bssid, target->bssid, sizeof(sta_config.sta.bssid));
+        sta_config.sta.channel = target->channel;
+        s_sta_directed = true;
+        s_fast_attempt = true;
+    } else {
+        apply_fast_connect(&sta_config);
+    }
+
+    return esp_wifi_set_config(WIFI_IF_STA, &sta_config);
+}
+
+// 当前STA配置对应的已保存网络索引
+static int current_network_index(void)
+{
+    wifi_config_t sta_config;
+    if (esp_wifi_get_config(WIFI_IF_STA, &sta_config) != ESP_OK) {
+        return -1;
+    }
+    return wifi_networks_find((const char *)sta_config.sta.ssid);
+}
+
+// 在基准时间上叠加随机抖动，避免多台设备在AP恢复后同时重连
+static uint32_t add_jitter(uint32_t delay_ms)
+{
+    uint32_t span = delay_ms / 100 * RECONNECT_JITTER_PERCENT;
+    if (span == 0) {
+        return delay_ms;
+    }
+    return delay_ms - span + esp_random() % (2 * span + 1);
+}
+
+// 第attempt次重试前的退避时间
+static uint32_t reconnect_backoff_ms(int attempt)
+{
+    uint32_t delay_ms = RECONNECT_BACKOFF_BASE_MS;
+    for (int i = 1; i < attempt && delay_ms < RECONNECT_BACKOFF_MAX_MS; i++) {
+        delay_ms *= 2;
+    }
+    if (delay_ms > RECONNECT_BACKOFF_MAX_MS) {
+        delay_ms = RECONNECT_BACKOFF_MAX_MS;
+    }
+    return add_jitter(delay_ms);
+}
+
+// 退避定时器到期：不在定时器任务中操作WiFi，投递到事件循环处理
+static void reconnect_timer_cb(void *arg)
+{
+    uint32_t gen = s_reconnect_gen;
+    if (esp_event_post(WIFI_MANAGER_EVENT, WIFI_MANAGER_EVENT_RECONNECT, &gen, sizeof(gen), 0) != ESP_OK) {
+        esp_timer_start_once(s_reconnect_timer, (uint64_t)RECONNECT_POST_RETRY_MS * 1000);
+    }
+}
+
+static void reconnect_schedule(uint32_t delay_ms);
+
+// STA即将连接的信道：定向连接取配置中的信道，否则查扫描缓存，未知返回0
+static uint8_t sta_target_channel(void)
+{
+    wifi_config_t sta_config;
+    if (esp_wifi_get_config(WIFI_IF_STA, &sta_config) != ESP_OK) {
+        return 0;
+    }
+    if (sta_config.sta.channel != 0) {
+        return sta_config.sta.channel;
+    }
+    return wifi_scan_find_channel((const char *)sta_config.sta.ssid);
+}
+
+// 立即发起连接；驱动暂时拒绝时（例如扫描进行中）短暂退避后再试
+static void reconnect_now(void)
+{
+    s_reconnect_state = WIFI_RECONNECT_CONNECTING;
+    if (s_connect_op.status.result == WIFI_CONNECT_RESULT_PENDING && s_connect_op.status.op != 0) {
+        s_connect_op.status.attempts++;
+    }
+    link_monitor_note_retry();
+    // AP先迁到STA的目标信道，关联时AP客户端不会被驱动强制切换
+    wifi_channel_prepare_sta(sta_target_channel());
+    esp_err_t err = esp_wifi_connect();
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "发起连接失败: %s，稍后重试", esp_err_to_name(err));
+        reconnect_schedule(add_jitter(RECONNECT_BACKOFF_BASE_MS));
+    }
+}
+
+// 安排一次连接：delay_ms为0时立即发起，否则等待退避定时器
+static void reconnect_schedule(uint32_t delay_ms)
+{
+    s_reconnect_gen++;
+    esp_timer_stop(s_reconnect_timer);
+    if (delay_ms == 0) {
+        reconnect_now();
+        return;
+    }
+    s_reconnect_state = WIFI_RECONNECT_BACKOFF;
+    s_connect_stats.reconnect_delay_ms = delay_ms;
+    esp_timer_start_once(s_reconnect_timer, (uint64_t)delay_ms * 1000);
+}
+
+// 取消等待中的重连（获得IP或由外部发起新的连接）
+static void reconnect_cancel(wifi_reconnect_state_t state)
+{
+    s_reconnect_gen++;
+    esp_timer_stop(s_reconnect_timer);
+    s_round_pending = false;
+    s_reconnect_state = state;
+}
+
+// 当前网络重试用尽，按扫描缓存换到下一个最佳网络；所有网络都失败过返回false
+static bool try_next_network(void)
+{
+    int current = current_network_index();
+    if (current >= 0) {
+        s_failed_networks |= 1U << current;
+    }
+
+    int next = wifi_networks_select(s_failed_networks, NULL);
+    if (next < 0) {
+        s_failed_networks = 0;
+        return false;
+    }
+
+    ESP_LOGI(TAG, "切换到已保存的网络: %s", wifi_networks_get(next)->ssid);
+    if (configure_sta_network(next, NULL) != ESP_OK) {
+        return false;
+    }
+    s_connect_stats.network_switches++;
+    s_retry_num = 0;
+    reconnect_schedule(0);
+    return true;
+}
+
+// 记录连接耗时
+static void record_connect_time(void)
+{
+    int64_t now = esp_timer_get_time();
+    if (s_connect_stats.boot_to_ip_ms == 0) {
+        s_connect_stats.boot_to_ip_ms = (uint32_t)(now / 1000);
+    }
+    if (s_connect_start_us > 0) {
+        s_connect_stats.last_connect_ms = (uint32_t)((now - s_connect_start_us) / 1000);
+        s_connect_start_us = 0;
+    }
+    s_connect_stats.last_fast = s_fast_attempt;
+    if (s_fast_attempt) {
+        s_connect_stats.fast_successes++;
+        s_fast_attempt = false;
+    }
+    s_connect_stats.connects++;
+
+    ESP_LOGI(TAG, "连接耗时 %lu ms（%s），启动到获得IP %lu ms",
+             (unsigned long)s_connect_stats.last_connect_ms,
+             s_connect_stats.last_fast ? "定向连接" : "全信道扫描",
+             (unsigned long)s_connect_stats.boot_to_ip_ms);
+}
+
+// 当前请求是否还在进行
+static bool connect_op_pending(void)
+{
+    return s_connect_op.status.op != 0 && s_connect_op.status.result == WIFI_CONNECT_RESULT_PENDING;
+}
+
+// 按断开原因归类失败结果
+static wifi_connect_result_t connect_result_for_reason(uint8_t reason)
+{
+    switch (reason) {
+        case WIFI_REASON_AUTH_FAIL:
+        case WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT:
+        case WIFI_REASON_HANDSHAKE_TIMEOUT:
+            return WIFI_CONNECT_RESULT_AUTH_FAILED;
+        case WIFI_REASON_NO_AP_FOUND:
+        case WIFI_REASON_NO_AP_FOUND_W_COMPATIBLE_SECURITY:
+        case WIFI_REASON_NO_AP_FOUND_IN_AUTHMODE_THRESHOLD:
+        case WIFI_REASON_NO_AP_FOUND_IN_RSSI_THRESHOLD:
+            return WIFI_CONNECT_RESULT_NO_AP_FOUND;
+        default:
+            return WIFI_CONNECT_RESULT_FAILED;
+    }
+}
+
+// 结束当前请求并回调（在事件循环任务中调用）
+static void connect_op_complete(wifi_connect_result_t result, uint8_t reason)
+{
+    if (!connect_op_pending()) {
+        return;
+    }
+    esp_timer_stop(s_connect_op_timer);
+
+    portENTER_CRITICAL(&s_connect_op_lock);
+    s_connect_op.status.result = result;
+    if (reason != 0) {
+        s_connect_op.status.reason = reason;
+    }
+    s_connect_op.status.elapsed_ms = (uint32_t)((esp_timer_get_time() - s_connect_op.start_us) / 1000);
+    wifi_connect_status_t status = s_connect_op.status;
+    portEXIT_CRITICAL(&s_connect_op_lock);
+
+    if (result == WIFI_CONNECT_RESULT_OK && s_connect_op.save_on_success) {
+        esp_err_t err = wifi_networks_add(status.ssid, s_connect_op.password);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "保存WiFi凭证失败: %s", esp_err_to_name(err));
+        }
+    }
+    memset(s_connect_op.password, 0, sizeof(s_connect_op.password));
+
+    ESP_LOGI(TAG, "连接请求 #%lu (%s) 完成: %s，原因 %d，尝试 %d 次，耗时 %lu ms",
+             (unsigned long)status.op, status.ssid, wifi_manager_connect_result_name(result),
+             status.reason, status.attempts, (unsigned long)status.elapsed_ms);
+
+    if (s_connect_op.callback != NULL) {
+        s_connect_op.callback(&status, s_connect_op.callback_arg);
+    }
+}
+
+// 连接超时定时器：投递到事件循环处理
+static void connect_op_timer_cb(void *arg)
+{
+    portENTER_CRITICAL(&s_connect_op_lock);
+    wifi_connect_op_t op = s_connect_op.status.op;
+    portEXIT_CRITICAL(&s_connect_op_lock);
+
+    if (esp_event_post(WIFI_MANAGER_EVENT, WIFI_MANAGER_EVENT_CONNECT_TIMEOUT, &op, sizeof(op), 0) != ESP_OK) {
+        esp_timer_start_once(s_connect_op_timer, (uint64_t)RECONNECT_POST_RETRY_MS * 1000);
+    }
+}
+
+// 开始执行异步连接请求（在事件循环任务中调用）
+static void connect_op_start(const connect_msg_t *msg)
+{
+    // 新请求取代尚未完成的请求
+    connect_op_complete(WIFI_CONNECT_RESULT_SUPERSEDED, 0);
+
+    portENTER_CRITICAL(&s_connect_op_lock);
+    s_prev_connect_status = s_connect_op.status;
+    memset(&s_connect_op.status, 0, sizeof(s_connect_op.status));
+    s_connect_op.status.op = msg->op;
+    s_connect_op.status.result = WIFI_CONNECT_RESULT_PENDING;
+    strlcpy(s_connect_op.status.ssid, msg->ssid, sizeof(s_connect_op.status.ssid));
+    portEXIT_CRITICAL(&s_connect_op_lock);
+
+    s_connect_op.save_on_success = msg->save_on_success;
+    if (msg->save_on_success) {
+        strlcpy(s_connect_op.password, msg->password, sizeof(s_connect_op.password));
+    }
+    s_connect_op.callback = msg->callback;
+    s_connect_op.callback_arg = msg->callback_arg;
+    s_connect_op.start_us = esp_timer_get_time();
+    esp_timer_stop(s_connect_op_timer);
+    esp_timer_start_once(s_connect_op_timer, (uint64_t)msg->timeout_ms * 1000);
+
+    ESP_LOGI(TAG, "连接请求 #%lu: %s (保持APSTA模式)", (unsigned long)msg->op, msg->ssid);
+
+    // 新配置的网络使用全信道扫描，成功后再记录快速连接信息
+    wifi_reconnect_state_t prev_state = s_reconnect_state;
+    reconnect_cancel(WIFI_RECONNECT_CONNECTING);
+    s_retry_num = 0;
+    s_failed_networks = 0;
+    s_roaming = false;
+    s_sta_directed = false;
+    s_fast_attempt = false;
+    s_switch_pending = false;
+    s_connect_start_us = s_connect_op.start_us;
+    xEventGroupClearBits(s_wifi_event_group, WIFI_CONNECTED_BIT | WIFI_FAIL_BIT);
+
+    wifi_config_t sta_config = {0};
+    strlcpy((char *)sta_config.sta.ssid, msg->ssid, sizeof(sta_config.sta.ssid));
+    strlcpy((char *)sta_config.sta.password, msg->password, sizeof(sta_config.sta.password));
+    sta_config.sta.listen_interval = wifi_power_listen_interval();
+
+    wifi_mode_t mode;
+    esp_err_t err = esp_wifi_get_mode(&mode);
+    if (err == ESP_OK && mode != WIFI_MODE_APSTA) {
+        ESP_LOGI(TAG, "当前模式不是APSTA，切换到APSTA模式");
+        err = esp_wifi_set_mode(WIFI_MODE_APSTA);
+    }
+    if (err == ESP_OK && prev_state == WIFI_RECONNECT_CONNECTED) {
+        // 先断开当前链路，断开事件中再发起连接，旧链路的断开不计入本次请求的失败
+        s_switch_pending = esp_wifi_disconnect() == ESP_OK;
+    }
+    if (err == ESP_OK) {
+        err = esp_wifi_set_config(WIFI_IF_STA, &sta_config);
+    }
+    memset(&sta_config, 0, sizeof(sta_config));
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "设置STA配置失败: %s", esp_err_to_name(err));
+        s_switch_pending = false;
+        reconnect_cancel(WIFI_RECONNECT_IDLE);
+        connect_op_complete(WIFI_CONNECT_RESULT_ERROR, 0);
+        return;
+    }
+
+    if (s_switch_pending) {
+        return;
+    }
+    wifi_channel_prepare_sta(sta_target_channel());
+    if (esp_wifi_connect() == ESP_ERR_WIFI_NOT_STARTED) {
+        // WiFi尚未启动，STA_START事件中发起连接
+        ESP_LOGI(TAG, "启动APSTA模式WiFi...");
+        err = esp_wifi_start();
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "启动WiFi失败: %s", esp_err_to_name(err));
+            reconnect_cancel(WIFI_RECONNECT_IDLE);
+            connect_op_complete(WIFI_CONNECT_RESULT_ERROR, 0);
+        }
+        return;
+    }
+    s_connect_op.status.attempts++;
+}
+
+// 链路趋势走低（在事件循环任务中评估）：先找更好的AP提前漫游，没有则在开始丢信标时主动重新关联
+static void link_check(const link_trend_t *trend)
+{
+    if (!(xEventGroupGetBits(s_wifi_event_group) & WIFI_CONNECTED_BIT) || s_roaming || s_link_reconnect ||
+        connect_op_pending()) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+
+    // 扫描结果过旧时只触发后台扫描，下一个采样周期再评估
+    wifi_scan_info_t info;
+    if (wifi_manager_scan_get(NULL, 0, ROAM_SCAN_MAX_AGE_MS, 0, &info) != ESP_OK) {
+        // 同一轮刷新只计一次
+        if (info.generation != s_early_scan_gen) {
+            s_early_scan_gen = info.generation;
+            s_early_scans++;
+        }
+        return;
+    }
+
+    scan_ap_t best;
+    wifi_ap_record_t current;
+    if (esp_wifi_sta_get_ap_info(&current) != ESP_OK) {
+        return;
+    }
+    bool roam_ready = s_last_roam_us == 0 || now - s_last_roam_us >= (int64_t)ROAM_MIN_INTERVAL_MS * 1000;
+    if (roam_ready && wifi_networks_select(0, &best) >= 0 && best.ssid[0] != '\0' &&
+        memcmp(best.bssid, current.bssid, sizeof(best.bssid)) != 0 &&
+        best.rssi >= trend->avg + ROAM_HYSTERESIS_DB) {
+        ESP_LOGI(TAG, "信号走低(%d dBm，%d dB/分钟，预测 %d dBm)，漫游到 %s " MACSTR " (%d dBm, 信道 %d)",
+                 trend->avg, trend->slope, trend->predicted, best.ssid,
+                 MAC2STR(best.bssid), best.rssi, best.channel);
+        s_roam_target = best;
+        s_roaming = true;
+        s_last_roam_us = now;
+        s_connect_stats.roams++;
+        s_predictive_roams++;
+        if (esp_wifi_disconnect() != ESP_OK) {
+            s_roaming = false;
+        }
+        return;
+    }
+
+    if (trend->avg > LINK_CRITICAL_RSSI || trend->recent_beacon_timeouts == 0) {
+        return;
+    }
+    if (s_last_link_reconnect_us != 0 &&
+        now - s_last_link_reconnect_us < (int64_t)LINK_RECONNECT_MIN_INTERVAL_MS * 1000) {
+        return;
+    }
+    ESP_LOGW(TAG, "信号 %d dBm，最近丢失 %d 个信标，主动重新关联",
+             trend->avg, trend->recent_beacon_timeouts);
+    s_link_reconnect = true;
+    s_last_link_reconnect_us = now;
+    s_proactive_reconnects++;
+    if (esp_wifi_disconnect() != ESP_OK) {
+        s_link_reconnect = false;
+    }
+}
+
+// 链路采样钩子（esp_timer任务）：只在预测信号低于漫游阈值时投递到事件循环评估
+static void link_trend_hook(const link_trend_t *trend)
+{
+    if (!trend->valid || trend->predicted >= ROAM_RSSI_THRESHOLD) {
+        return;
+    }
+    esp_event_post(WIFI_MANAGER_EVENT, WIFI_MANAGER_EVENT_LINK_CHECK, trend, sizeof(*trend), 0);
+}
+
+// 内部事件：退避结束后发起连接、异步连接请求、链路趋势评估、事件循环延迟探测
+static void wifi_manager_event_handler(void *arg, esp_event_base_t event_base,
+                                       int32_t event_id, void *event_data)
+{
+    if (event_id == WIFI_MANAGER_EVENT_PROBE) {
+        uint32_t latency_us = (uint32_t)(esp_timer_get_time() - *(const int64_t *)event_data);
+        portENTER_CRITICAL(&s_loop_stats_lock);
+        s_loop_stats.probes++;
+        s_loop_stats.last_latency_us = latency_us;
+        if (latency_us > s_loop_stats.max_latency_us) {
+            s_loop_stats.max_latency_us = latency_us;
+        }
+        s_loop_latency_total_us += latency_us;
+        portEXIT_CRITICAL(&s_loop_stats_lock);
+        return;
+    }
+
+    if (event_id == WIFI_MANAGER_EVENT_CONNECT) {
+        connect_op_start((const connect_msg_t *)event_data);
+        return;
+    }
+
+    if (event_id == WIFI_MANAGER_EVENT_CONNECT_TIMEOUT) {
+        if (*(const wifi_connect_op_t *)event_data == s_connect_op.status.op) {
+            connect_op_complete(WIFI_CONNECT_RESULT_TIMEOUT, 0);
+        }
+        return;
+    }
+
+    if (event_id == WIFI_MANAGER_EVENT_LINK_CHECK) {
+        link_check((const link_trend_t *)event_data);
+        return;
+    }
+
+    if (event_id != WIFI_MANAGER_EVENT_RECONNECT) {
+        return;
+    }
+    // 定时器事件投递后重连已被取消或重新安排
+    if (*(const uint32_t *)event_data != s_reconnect_gen || s_reconnect_state != WIFI_RECONNECT_BACKOFF) {
+        return;
+    }
+
+    if (s_round_pending) {
+        // 上一轮所有网络都失败了，按最新的扫描结果重新选择网络
+        s_round_pending = false;
+        xEventGroupClearBits(s_wifi_event_group, WIFI_FAIL_BIT);
+        int index = wifi_networks_select(0, NULL);
+        if (index >= 0) {
+            ESP_LOGI(TAG, "开始新一轮连接: %s", wifi_networks_get(index)->ssid);
+            configure_sta_network(index, NULL);
+        }
+    }
+    reconnect_now();
+}
+
+// 周期向事件循环投递探测事件，测量分发延迟
+static void probe_timer_cb(void *arg)
+{
+    int64_t now_us = esp_timer_get_time();
+    if (esp_event_post(WIFI_MANAGER_EVENT, WIFI_MANAGER_EVENT_PROBE, &now_us, sizeof(now_us), 0) != ESP_OK) {
+        portENTER_CRITICAL(&s_loop_stats_lock);
+        s_loop_stats.post_failures++;
+        portEXIT_CRITICAL(&s_loop_stats_lock);
+    }
+}
+
+// 扫描完成：STA空闲（未配网或已放弃连接）时为AP选择最空闲的信道
+static void scan_done_hook(void)
+{
+    if (s_reconnect_state == WIFI_RECONNECT_IDLE) {
+        wifi_channel_evaluate_idle();
+    }
+}
+
+// STA是否有可以连接的配置
+static bool sta_has_config(void)
+{
+    wifi_config_t sta_config;
+    return wifi_networks_count() > 0 ||
+           (esp_wifi_get_config(WIFI_IF_STA, &sta_config) == ESP_OK && sta_config.sta.ssid[0] != '\0');
+}
+
+// WiFi事件处理函数（在默认事件循环任务中运行，不能阻塞）
+static void handle_wifi_event(void *arg, esp_event_base_t event_base,
+                              int32_t event_id, void *event_data)
 {
     if (event_base == WIFI_EVENT) {
         if (event_id == WIFI_EVENT_STA_START) {
-            ESP_LOGI(TAG, "STA模式启动，尝试连接到AP");
-            esp_wifi_connect();
+            if (sta_has_config()) {
+                ESP_LOGI(TAG, "STA模式启动，尝试连接到AP");
+                reconnect_schedule(0);
+            }
+        } else if (event_id == WIFI_EVENT_STA_CONNECTED) {
+            wifi_event_sta_connected_t *event = (wifi_event_sta_connected_t *)event_data;
+            wifi_channel_sta_connected(event->channel);
+        } else if (event_id == WIFI_EVENT_STA_BEACON_TIMEOUT) {
+            link_monitor_note_beacon_timeout();
         } else if (event_id == WIFI_EVENT_STA_DISCONNECTED) {
             wifi_event_sta_disconnected_t *event = (wifi_event_sta_disconnected_t *)event_data;
             ESP_LOGW(TAG, "WiFi断开连接，原因: %d", event->reason);
-            
-            if (s_retry_num < MAX_CONNECTION_RETRIES) {
-                esp_wifi_connect();
+            link_monitor_note_disconnect();
+
+            // STA未联网时需要Captive Portal DNS引导配网
+            s_dns_upstream = 0;
+            start_dns_server();
+            wifi_scan_set_sta_connected(false);
+
+            xEventGroupClearBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
+            if (s_connect_start_us == 0) {
+                s_connect_start_us = esp_timer_get_time();
+            }
+
+            int roam_index = s_roaming ? wifi_networks_find(s_roam_target.ssid) : -1;
+            bool link_reconnect = s_link_reconnect;
+            s_roaming = false;
+            s_link_reconnect = false;
+
+            if (connect_op_pending() && !s_switch_pending) {
+                portENTER_CRITICAL(&s_connect_op_lock);
+                s_connect_op.status.reason = event->reason;
+                portEXIT_CRITICAL(&s_connect_op_lock);
+                if (connect_result_for_reason(event->reason) == WIFI_CONNECT_RESULT_AUTH_FAILED) {
+                    // 密码错误时重试没有意义，立即结束请求并换回已保存的网络
+                    connect_op_complete(WIFI_CONNECT_RESULT_AUTH_FAILED, event->reason);
+                    s_retry_num = MAX_CONNECTION_RETRIES;
+                }
+            }
+
+            if (s_switch_pending) {
+                // 为新的连接请求断开了旧链路
+                s_switch_pending = false;
+                reconnect_schedule(0);
+            } else if (roam_index >= 0 && configure_sta_network(roam_index, &s_roam_target) == ESP_OK) {
+                // 为漫游主动断开，定向连接到目标AP，失败时按定向连接失败回退
+                reconnect_schedule(0);
+            } else if (link_reconnect) {
+                // 主动重新关联：全信道扫描选择当前最强的BSS，不计入重试次数
+                clear_directed_config();
+                reconnect_schedule(0);
+            } else if (s_fast_attempt) {
+                // 定向连接失败（AP换了信道或BSSID），回退全信道扫描，不计入重试次数
+                ESP_LOGI(TAG, "定向连接失败，回退到全信道扫描");
+                fallback_full_scan();
+                reconnect_schedule(0);
+            } else if (s_sta_directed && s_retry_num == 0) {
+                // 已连接的链路断开，先按原BSSID和信道定向重连
+                s_fast_attempt = true;
+                s_connect_stats.fast_attempts++;
+                reconnect_schedule(0);
+            } else if (s_retry_num < MAX_CONNECTION_RETRIES) {
                 s_retry_num++;
-                ESP_LOGI(TAG, "重新连接到AP，尝试次数: %d/%d", s_retry_num, MAX_CONNECTION_RETRIES);
+                uint32_t delay_ms = reconnect_backoff_ms(s_retry_num);
+                s_connect_stats.backoff_retries++;
+                ESP_LOGI(TAG, "%lu ms后重新连接到AP，尝试次数: %d/%d",
+                         (unsigned long)delay_ms, s_retry_num, MAX_CONNECTION_RETRIES);
+                reconnect_schedule(delay_ms);
             } else {
-                xEventGroupSetBits(s_wifi_event_group, WIFI_FAIL_BIT);
-                
-                // 不需要切换到纯AP模式，保持APSTA模式使配网和STA可以同时工作
-                ESP_LOGI(TAG, "连接AP失败 (已尝试%d次)，维持APSTA模式等待配网", MAX_CONNECTION_RETRIES);
-                
-                // 重置重试计数器，允许后续尝试重新连接
-                vTaskDelay(pdMS_TO_TICKS(10000)); // 等待10秒后重置
-                s_retry_num = 0;
+                // 重试用尽，进行中的连接请求以最后一次断开原因结束
+                connect_op_complete(connect_result_for_reason(event->reason), event->reason);
+                if (!try_next_network()) {
+                    xEventGroupSetBits(s_wifi_event_group, WIFI_FAIL_BIT);
+                    s_retry_num = 0;
+                    s_connect_stats.failed_rounds++;
+
+                    // 不需要切换到纯AP模式，保持APSTA模式使配网和STA可以同时工作
+                    if (sta_has_config()) {
+                        uint32_t delay_ms = add_jitter(RECONNECT_ROUND_DELAY_MS);
+                        ESP_LOGI(TAG, "连接AP失败 (已尝试%d次)，维持APSTA模式，%lu 秒后重新尝试",
+                                 MAX_CONNECTION_RETRIES, (unsigned long)(delay_ms / 1000));
+                        s_round_pending = true;
+                        reconnect_schedule(delay_ms);
+                    } else {
+                        ESP_LOGI(TAG, "连接AP失败 (已尝试%d次)，维持APSTA模式等待配网", MAX_CONNECTION_RETRIES);
+                        reconnect_cancel(WIFI_RECONNECT_IDLE);
+                    }
+                }
             }
         } else if (event_id == WIFI_EVENT_AP_STACONNECTED) {
             wifi_event_ap_staconnected_t *event = (wifi_event_ap_staconnected_t *) event_data;
@@ -279,6 +1298,7 @@ static void wifi_event_handler(void *arg, esp_event_base_t event_base,
                      event->mac[3], event->mac[4], event->mac[5]);
         } else if (event_id == WIFI_EVENT_AP_STADISCONNECTED) {
             wifi_event_ap_stadisconnected_t *event = (wifi_event_ap_stadisconnected_t *) event_data;
+            wifi_channel_ap_client_left();
             ESP_LOGI(TAG, "客户端 %02x:%02x:%02x:%02x:%02x:%02x 断开连接", 
                      event->mac[0], event->mac[1], event->mac[2], 
                      event->mac[3], event->mac[4], event->mac[5]);
@@ -287,7 +1307,37 @@ static void wifi_event_handler(void *arg, esp_event_base_t event_base,
         ip_event_got_ip_t *event = (ip_event_got_ip_t *) event_data;
         ESP_LOGI(TAG, "获取IP地址:" IPSTR, IP2STR(&event->ip_info.ip));
         s_retry_num = 0;
+        s_failed_networks = 0;
+        reconnect_cancel(WIFI_RECONNECT_CONNECTED);
+        if (connect_op_pending()) {
+            portENTER_CRITICAL(&s_connect_op_lock);
+            s_connect_op.status.ip = event->ip_info.ip.addr;
+            portEXIT_CRITICAL(&s_connect_op_lock);
+            connect_op_complete(WIFI_CONNECT_RESULT_OK, 0);
+        }
         xEventGroupSetBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
+        wifi_scan_set_sta_connected(true);
+
+        record_connect_time();
+        wifi_config_t sta_config;
+        if (esp_wifi_get_config(WIFI_IF_STA, &sta_config) == ESP_OK) {
+            save_fast_connect_hint((const char *)sta_config.sta.ssid);
+        }
+
+#if DNS_FORWARD_WHEN_CONNECTED
+        // 配网完成，AP客户端的查询改为转发到STA租约中的DNS服务器（没有则使用网关）
+        esp_netif_dns_info_t dns_info;
+        uint32_t upstream = event->ip_info.gw.addr;
+        if (esp_netif_get_dns_info(s_sta_netif, ESP_NETIF_DNS_MAIN, &dns_info) == ESP_OK &&
+            dns_info.ip.u_addr.ip4.addr != 0) {
+            upstream = dns_info.ip.u_addr.ip4.addr;
+        }
+        s_dns_upstream = upstream;
+        start_dns_server();
+#else
+        // 配网完成，关闭Captive Portal DNS（不在事件循环中等待任务退出）
+        stop_dns_server(false);
+#endif
     }
     
     // 调用用户注册的回调
@@ -296,6 +1346,23 @@ static void wifi_event_handler(void *arg, esp_event_base_t event_base,
     }
 }
 
+// 记录事件处理耗时，与分发延迟一起反映事件循环是否被阻塞
+static void wifi_event_handler(void *arg, esp_event_base_t event_base,
+                               int32_t event_id, void *event_data)
+{
+    int64_t start_us = esp_timer_get_time();
+    handle_wifi_event(arg, event_base, event_id, event_data);
+    uint32_t elapsed_us = (uint32_t)(esp_timer_get_time() - start_us);
+
+    portENTER_CRITICAL(&s_loop_stats_lock);
+    s_loop_stats.handler_calls++;
+    if (elapsed_us > s_loop_stats.handler_max_us) {
+        s_loop_stats.handler_max_us = elapsed_us;
+    }
+    s_loop_handler_total_us += elapsed_us;
+    portEXIT_CRITICAL(&s_loop_stats_lock);
+}
+
 void wifi_manager_init(void)
 {
     ESP_LOGI(TAG, "初始化WiFi管理器 - 统一APSTA模式");
@@ -309,6 +1376,16 @@ void wifi_manager_init(void)
         }
     }
 
+    // 创建DNS服务器启停所需的同步对象
+    if (s_dns_lock == NULL) {
+        s_dns_lock = xSemaphoreCreateMutex();
+        s_dns_exit_sem = xSemaphoreCreateBinary();
+        if (s_dns_lock == NULL || s_dns_exit_sem == NULL) {
+            ESP_LOGE(TAG, "创建DNS同步对象失败");
+            return;
+        }
+    }
+
     // 创建默认netif实例
     s_sta_netif = esp_netif_create_default_wifi_sta();
     s_ap_netif = esp_netif_create_default_wifi_ap();
@@ -332,15 +1409,71 @@ void wifi_manager_init(void)
                                                         &wifi_event_handler,
                                                         NULL,
                                                         NULL));
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_MANAGER_EVENT,
+                                                        ESP_EVENT_ANY_ID,
+                                                        &wifi_manager_event_handler,
+                                                        NULL,
+                                                        NULL));
+
+    // 重连退避定时器（STA_START时就可能用到，需在启动WiFi前创建）
+    if (s_reconnect_timer == NULL) {
+        const esp_timer_create_args_t reconnect_timer_args = {
+            .callback = reconnect_timer_cb,
+            .name = "wifi_reconnect",
+        };
+        ESP_ERROR_CHECK(esp_timer_create(&reconnect_timer_args, &s_reconnect_timer));
+    }
 
-    // 尝试加载WiFi凭证
-    char ssid[MAX_SSID_LEN] = {0};
-    char password[MAX_PASSWORD_LEN] = {0};
-    bool has_credentials = false;
+    // 异步连接超时定时器
+    if (s_connect_op_timer == NULL) {
+        const esp_timer_create_args_t connect_timer_args = {
+            .callback = connect_op_timer_cb,
+            .name = "wifi_conn_op",
+        };
+        ESP_ERROR_CHECK(esp_timer_create(&connect_timer_args, &s_connect_op_timer));
+    }
+
+    // 事件循环分发延迟探测
+    if (s_probe_timer == NULL) {
+        const esp_timer_create_args_t probe_timer_args = {
+            .callback = probe_timer_cb,
+            .name = "evt_probe",
+        };
+        if (esp_timer_create(&probe_timer_args, &s_probe_timer) == ESP_OK) {
+            esp_timer_start_periodic(s_probe_timer, (uint64_t)EVENT_LOOP_PROBE_INTERVAL_MS * 1000);
+        }
+    }
+
+    // 链路质量采样，信号走低时提前漫游或重新关联（需在STA接口收发之前接管计数）
+    if (link_monitor_init(s_sta_netif, link_trend_hook) != ESP_OK) {
+        ESP_LOGW(TAG, "初始化链路监测失败");
+    }
+
+    // 省电策略（STA配置中的监听间隔取自策略，需在配置STA之前加载）
+    if (wifi_power_init() != ESP_OK) {
+        ESP_LOGW(TAG, "初始化省电策略失败");
+    }
 
-    if (wifi_manager_load_credentials(ssid, password) == ESP_OK && strlen(ssid) > 0) {
-        has_credentials = true;
-        ESP_LOGI(TAG, "找到保存的WiFi凭证，将尝试连接到 %s", ssid);
+    // 后台扫描服务
+    if (wifi_scan_init() != ESP_OK) {
+        ESP_LOGW(TAG, "初始化扫描服务失败");
+    }
+    wifi_scan_set_done_hook(scan_done_hook);
+
+    // 加载已保存的网络（旧版本的单组凭证会自动迁移）
+    wifi_networks_load();
+    load_fast_connect_hint();
+
+    // 启动时还没有扫描结果：优先连接上次成功的网络（可以定向快速连接），否则按优先级
+    int boot_network = s_fast_hint_valid ? wifi_networks_find(s_fast_hint.ssid) : -1;
+    if (boot_network < 0 && wifi_networks_count() > 0) {
+        boot_network = 0;
+    }
+    bool has_credentials = boot_network >= 0;
+
+    if (has_credentials) {
+        ESP_LOGI(TAG, "已保存 %d 个网络，将尝试连接到 %s",
+                 wifi_networks_count(), wifi_networks_get(boot_network)->ssid);
     } else {
         ESP_LOGI(TAG, "未找到保存的WiFi凭证");
     }
@@ -356,36 +1489,38 @@ void wifi_manager_init(void)
             .channel = DEFAULT_AP_CHANNEL,
             .password = DEFAULT_AP_PASSWORD,
             .max_connection = DEFAULT_AP_MAX_CONNECTIONS,
-            .authmode = strlen(DEFAULT_AP_PASSWORD) > 0 ? WIFI_AUTH_WPA_WPA2_PSK : WIFI_AUTH_OPEN
+            .authmode = strlen(DEFAULT_AP_PASSWORD) > 0 ? WIFI_AUTH_WPA_WPA2_PSK : WIFI_AUTH_OPEN,
+            .csa_count = WIFI_CHANNEL_CSA_COUNT,
         },
     };
 
-    // 配置STA（如果有保存的凭证）
-    wifi_config_t sta_config = {0};
+    // 设置为APSTA模式
+    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_APSTA));
+    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_AP, &ap_config));
+    wifi_channel_init(DEFAULT_AP_CHANNEL, s_ap_netif);
+
+    // 配置STA（如果有保存的凭证）；断电恢复后尽快上线：先在上次的信道上定向连接
     if (has_credentials) {
-        strlcpy((char *)sta_config.sta.ssid, ssid, sizeof(sta_config.sta.ssid));
-        strlcpy((char *)sta_config.sta.password, password, sizeof(sta_config.sta.password));
-        ESP_LOGI(TAG, "配置STA连接到: %s", ssid);
+        ESP_ERROR_CHECK(configure_sta_network(boot_network, NULL));
+        s_connect_start_us = esp_timer_get_time();
     } else {
+        wifi_config_t sta_config = {0};
         ESP_LOGI(TAG, "无保存凭证，STA配置为空");
+        ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &sta_config));
     }
-
-    // 设置为APSTA模式
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_APSTA));
-    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_AP, &ap_config));
-    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &sta_config));
     ESP_ERROR_CHECK(esp_wifi_start());
 
     // 启动DNS服务器，实现Captive Portal功能
     start_dns_server();
 
-    // 如果有保存的凭证，尝试连接
+    // 如果有保存的凭证，STA_START事件中由重连状态机发起连接
     if (has_credentials) {
-        ESP_LOGI(TAG, "尝试连接到保存的WiFi: %s", ssid);
-        esp_wifi_connect();
+        ESP_LOGI(TAG, "尝试连接到保存的WiFi: %s", wifi_networks_get(boot_network)->ssid);
         s_current_mode = WIFI_MANAGER_MODE_STA; // 标记为STA模式（实际是APSTA）
     } else {
         s_current_mode = WIFI_MANAGER_MODE_AP; // 标记为AP模式（实际是APSTA）
+        // 预先扫描，配网页面打开时即可从缓存返回
+        wifi_manager_scan_request();
     }
 
     ESP_LOGI(TAG, "WiFi管理器初始化完成 - APSTA模式运行，AP: %s", DEFAULT_AP_SSID);
@@ -402,7 +1537,8 @@ esp_err_t wifi_manager_start_ap(void)
             .channel = DEFAULT_AP_CHANNEL,
             .password = DEFAULT_AP_PASSWORD,
             .max_connection = DEFAULT_AP_MAX_CONNECTIONS,
-            .authmode = WIFI_AUTH_WPA_WPA2_PSK
+            .authmode = WIFI_AUTH_WPA_WPA2_PSK,
+            .csa_count = WIFI_CHANNEL_CSA_COUNT,
         },
     };
 
@@ -416,6 +1552,7 @@ esp_err_t wifi_manager_start_ap(void)
     // 设置为APSTA模式
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_APSTA));
     ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_AP, &ap_config));
+    wifi_channel_init(DEFAULT_AP_CHANNEL, s_ap_netif);
     ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &sta_config));
     ESP_ERROR_CHECK(esp_wifi_start());
 
@@ -428,121 +1565,139 @@ esp_err_t wifi_manager_start_ap(void)
     return ESP_OK;
 }
 
+// 同步接口的完成回调：唤醒等待的任务
+static void start_sta_done_cb(const wifi_connect_status_t *status, void *arg)
+{
+    xTaskNotifyGive((TaskHandle_t)arg);
+}
+
 esp_err_t wifi_manager_start_sta(const char *ssid, const char *password)
 {
     if (ssid == NULL || strlen(ssid) == 0) {
         return ESP_ERR_INVALID_ARG;
     }
 
-    ESP_LOGI(TAG, "连接到WiFi: %s (保持APSTA模式)", ssid);
-
-    wifi_config_t sta_config = {0};
-    strlcpy((char *)sta_config.sta.ssid, ssid, sizeof(sta_config.sta.ssid));
-
-    if (password != NULL) {
-        strlcpy((char *)sta_config.sta.password, password, sizeof(sta_config.sta.password));
+    wifi_connect_request_t request = {
+        .ssid = ssid,
+        .password = password,
+        .timeout_ms = CONNECT_OP_TIMEOUT_MS,
+        .callback = start_sta_done_cb,
+        .callback_arg = xTaskGetCurrentTaskHandle(),
+    };
+    wifi_connect_op_t op;
+    esp_err_t err = wifi_manager_connect_async(&request, &op);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "WiFi连接失败: %s", esp_err_to_name(err));
+        return err;
     }
 
-    s_retry_num = 0;
+    // 请求超时后一定会回调，这里只是防止事件循环异常时永久等待
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CONNECT_OP_TIMEOUT_MS + START_STA_WAIT_MARGIN_MS));
 
-    // 检查WiFi是否已初始化
-    esp_err_t err;
-    wifi_mode_t mode;
+    wifi_connect_status_t status;
+    if (wifi_manager_get_connect_status(op, &status) != ESP_OK) {
+        return ESP_ERR_TIMEOUT;
+    }
+    if (status.result == WIFI_CONNECT_RESULT_OK) {
+        ESP_LOGI(TAG, "成功连接到WiFi: %s (AP仍然可用)", ssid);
+        return ESP_OK;
+    } else if (status.result == WIFI_CONNECT_RESULT_PENDING || status.result == WIFI_CONNECT_RESULT_TIMEOUT) {
+        ESP_LOGI(TAG, "连接超时 (AP仍然可用)");
+        return ESP_ERR_TIMEOUT;
+    } else {
+        ESP_LOGI(TAG, "连接到WiFi: %s 失败: %s (AP仍然可用)", ssid,
+                 wifi_manager_connect_result_name(status.result));
+        return ESP_FAIL;
+    }
+}
 
-    // 先检查WiFi状态
-    err = esp_wifi_get_mode(&mode);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "获取WiFi模式失败: %s", esp_err_to_name(err));
-        if (err == ESP_ERR_WIFI_NOT_INIT) {
-            ESP_LOGI(TAG, "WiFi未初始化，重新初始化WiFi");
-            wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
-            err = esp_wifi_init(&cfg);
-            if (err != ESP_OK) {
-                ESP_LOGE(TAG, "WiFi初始化失败: %s", esp_err_to_name(err));
-                return err;
-            }
-        } else {
-            return err;
-        }
+esp_err_t wifi_manager_connect_async(const wifi_connect_request_t *request, wifi_connect_op_t *op)
+{
+    if (request == NULL || request->ssid == NULL || request->ssid[0] == '\0' ||
+        strlen(request->ssid) > MAX_SSID_LEN ||
+        (request->password != NULL && strlen(request->password) > MAX_PASSWORD_LEN)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_wifi_event_group == NULL || s_connect_op_timer == NULL) {
+        return ESP_ERR_INVALID_STATE;
     }
 
-    // 确保为APSTA模式
-    if (mode != WIFI_MODE_APSTA) {
-        ESP_LOGI(TAG, "当前模式不是APSTA，切换到APSTA模式");
-        err = esp_wifi_set_mode(WIFI_MODE_APSTA);
-        if (err != ESP_OK) {
-            ESP_LOGE(TAG, "设置APSTA模式失败: %s", esp_err_to_name(err));
-            return err;
-        }
+    connect_msg_t msg = {0};
+    portENTER_CRITICAL(&s_connect_op_lock);
+    if (++s_next_connect_op == 0) {
+        s_next_connect_op = 1;
     }
+    msg.op = s_next_connect_op;
+    portEXIT_CRITICAL(&s_connect_op_lock);
 
-    // 设置STA配置
-    err = esp_wifi_set_config(WIFI_IF_STA, &sta_config);
+    strlcpy(msg.ssid, request->ssid, sizeof(msg.ssid));
+    if (request->password != NULL) {
+        strlcpy(msg.password, request->password, sizeof(msg.password));
+    }
+    msg.save_on_success = request->save_on_success;
+    msg.timeout_ms = request->timeout_ms > 0 ? request->timeout_ms : CONNECT_OP_TIMEOUT_MS;
+    msg.callback = request->callback;
+    msg.callback_arg = request->callback_arg;
+
+    // 所有连接状态都在事件循环任务中修改，这里只投递请求
+    esp_err_t err = esp_event_post(WIFI_MANAGER_EVENT, WIFI_MANAGER_EVENT_CONNECT, &msg, sizeof(msg),
+                                   pdMS_TO_TICKS(CONNECT_POST_TIMEOUT_MS));
+    memset(msg.password, 0, sizeof(msg.password));
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "设置STA配置失败: %s", esp_err_to_name(err));
+        ESP_LOGE(TAG, "投递连接请求失败: %s", esp_err_to_name(err));
         return err;
     }
 
-    // 确保WiFi已启动
-    bool wifi_started = false;
-    err = esp_wifi_get_mode(&mode);
-    if (err == ESP_OK) {
-        if (mode != WIFI_MODE_NULL) {
-            // 检查WiFi是否已启动
-            uint8_t mac[6];
-            if (esp_wifi_get_mac(WIFI_IF_STA, mac) == ESP_OK) {
-                wifi_started = true;
-                ESP_LOGI(TAG, "WiFi已启动，STA MAC: %02x:%02x:%02x:%02x:%02x:%02x",
-                         mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
-            }
-        }
+    s_current_mode = WIFI_MANAGER_MODE_STA; // 标记为STA模式（实际运行APSTA）
+    if (op != NULL) {
+        *op = msg.op;
     }
+    return ESP_OK;
+}
 
-    // 如果WiFi尚未启动，则启动它
-    if (!wifi_started) {
-        ESP_LOGI(TAG, "启动APSTA模式WiFi...");
-        err = esp_wifi_start();
-        if (err != ESP_OK) {
-            ESP_LOGE(TAG, "启动WiFi失败: %s", esp_err_to_name(err));
-            return err;
-        }
+esp_err_t wifi_manager_get_connect_status(wifi_connect_op_t op, wifi_connect_status_t *status)
+{
+    if (status == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
 
-        // 启动DNS服务器（如果尚未启动）
-        if (s_dns_server_task_handle == NULL) {
-            start_dns_server();
+    esp_err_t ret = ESP_OK;
+    portENTER_CRITICAL(&s_connect_op_lock);
+    if (op == 0 || op == s_connect_op.status.op) {
+        *status = s_connect_op.status;
+        if (status->result == WIFI_CONNECT_RESULT_PENDING && status->op != 0) {
+            status->elapsed_ms = (uint32_t)((esp_timer_get_time() - s_connect_op.start_us) / 1000);
         }
-
-        // 添加短暂延迟，确保WiFi完全启动
-        vTaskDelay(pdMS_TO_TICKS(500));
+    } else if (op == s_prev_connect_status.op) {
+        *status = s_prev_connect_status;
+    } else if (op == s_next_connect_op) {
+        // 已投递但事件循环尚未处理
+        memset(status, 0, sizeof(*status));
+        status->op = op;
+        status->result = WIFI_CONNECT_RESULT_PENDING;
+    } else {
+        ret = ESP_ERR_NOT_FOUND;
     }
+    portEXIT_CRITICAL(&s_connect_op_lock);
 
-    // 尝试连接到AP
-    ESP_LOGI(TAG, "尝试连接到WiFi: %s", ssid);
-    err = esp_wifi_connect();
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "WiFi连接失败: %s", esp_err_to_name(err));
-        return err;
+    if (ret == ESP_OK && status->op == 0) {
+        ret = ESP_ERR_NOT_FOUND;
     }
+    return ret;
+}
 
-    s_current_mode = WIFI_MANAGER_MODE_STA; // 标记为STA模式（实际运行APSTA）
-    ESP_LOGI(TAG, "APSTA模式运行，尝试连接到: %s", ssid);
-
-    // 等待连接结果（带超时）
-    EventBits_t bits = xEventGroupWaitBits(s_wifi_event_group,
-                                          WIFI_CONNECTED_BIT | WIFI_FAIL_BIT,
-                                          pdFALSE,
-                                          pdFALSE,
-                                          pdMS_TO_TICKS(15000)); // 增加超时时间
-
-    if (bits & WIFI_CONNECTED_BIT) {
-        ESP_LOGI(TAG, "成功连接到WiFi: %s (AP仍然可用)", ssid);
-        return ESP_OK;
-    } else if (bits & WIFI_FAIL_BIT) {
-        ESP_LOGI(TAG, "连接到WiFi: %s 失败 (AP仍然可用)", ssid);
-        return ESP_FAIL;
-    } else {
-        ESP_LOGI(TAG, "连接超时 (AP仍然可用)");
-        return ESP_ERR_TIMEOUT;
+const char *wifi_manager_connect_result_name(wifi_connect_result_t result)
+{
+    switch (result) {
+        case WIFI_CONNECT_RESULT_PENDING: return "pending";
+        case WIFI_CONNECT_RESULT_OK: return "connected";
+        case WIFI_CONNECT_RESULT_AUTH_FAILED: return "auth_failed";
+        case WIFI_CONNECT_RESULT_NO_AP_FOUND: return "no_ap_found";
+        case WIFI_CONNECT_RESULT_FAILED: return "failed";
+        case WIFI_CONNECT_RESULT_TIMEOUT: return "timeout";
+        case WIFI_CONNECT_RESULT_SUPERSEDED: return "superseded";
+        case WIFI_CONNECT_RESULT_ERROR: return "error";
+        default: return "unknown";
     }
 }
 
@@ -557,394 +1712,187 @@ wifi_working_mode_t wifi_manager_get_mode(void)
     return s_current_mode;
 }
 
-esp_err_t wifi_manager_save_credentials(const char *ssid, const char *password)
+esp_err_t wifi_manager_dns_start(void)
 {
-    if (ssid == NULL) {
-        return ESP_ERR_INVALID_ARG;
-    }
-    
-    nvs_handle_t nvs_handle;
-    esp_err_t err;
-    
-    err = nvs_open(WIFI_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
-    if (err != ESP_OK) {
-        return err;
-    }
-    
-    err = nvs_set_str(nvs_handle, WIFI_NVS_SSID_KEY, ssid);
-    if (err != ESP_OK) {
-        nvs_close(nvs_handle);
-        return err;
-    }
-    
-    if (password != NULL) {
-        err = nvs_set_str(nvs_handle, WIFI_NVS_PASS_KEY, password);
-        if (err != ESP_OK) {
-            nvs_close(nvs_handle);
-            return err;
-        }
-    }
-    
-    err = nvs_commit(nvs_handle);
-    nvs_close(nvs_handle);
-    
-    return err;
+    return start_dns_server();
 }
 
-esp_err_t wifi_manager_load_credentials(char *ssid, char *password)
+esp_err_t wifi_manager_dns_stop(void)
 {
-    if (ssid == NULL) {
-        return ESP_ERR_INVALID_ARG;
-    }
-    
-    nvs_handle_t nvs_handle;
-    esp_err_t err;
-    
-    err = nvs_open(WIFI_NVS_NAMESPACE, NVS_READONLY, &nvs_handle);
-    if (err != ESP_OK) {
-        return err;
-    }
-    
-    size_t ssid_len = MAX_SSID_LEN;
-    err = nvs_get_str(nvs_handle, WIFI_NVS_SSID_KEY, ssid, &ssid_len);
-    if (err != ESP_OK) {
-        nvs_close(nvs_handle);
-        return err;
-    }
-    
-    if (password != NULL) {
-        size_t pass_len = MAX_PASSWORD_LEN;
-        err = nvs_get_str(nvs_handle, WIFI_NVS_PASS_KEY, password, &pass_len);
-        // 密码读取失败不算错误，可能没有密码
-        if (err != ESP_OK) {
-            password[0] = '\0';
-        }
-    }
-    
-    nvs_close(nvs_handle);
-    return ESP_OK;
+    return stop_dns_server(true);
 }
 
-// 检查并打印WiFi状态
-static void wifi_manager_print_status(void)
+void wifi_manager_get_dns_stats(wifi_dns_stats_t *stats)
 {
-    wifi_mode_t mode;
-    esp_err_t mode_err = esp_wifi_get_mode(&mode);
-    
-    if (mode_err != ESP_OK) {
-        ESP_LOGE(TAG, "获取WiFi模式失败: %s", esp_err_to_name(mode_err));
+    if (stats == NULL) {
         return;
     }
-    
-    ESP_LOGI(TAG, "当前WiFi模式: %s", 
-             mode == WIFI_MODE_NULL ? "NULL" : 
-             mode == WIFI_MODE_STA ? "STA" : 
-             mode == WIFI_MODE_AP ? "AP" : 
-             mode == WIFI_MODE_APSTA ? "APSTA" : "未知");
-    
-    // 检查STA模式连接状态
-    if (mode == WIFI_MODE_STA || mode == WIFI_MODE_APSTA) {
-        wifi_ap_record_t ap_info;
-        esp_err_t sta_err = esp_wifi_sta_get_ap_info(&ap_info);
-        
-        if (sta_err == ESP_OK) {
-            ESP_LOGI(TAG, "STA已连接到AP: %s, RSSI: %d", ap_info.ssid, ap_info.rssi);
-        } else {
-            ESP_LOGI(TAG, "STA未连接到AP: %s", esp_err_to_name(sta_err));
-        }
-    }
-    
-    // 检查扫描状态 - 这里无法直接检查扫描状态，只能尝试获取扫描结果
-    uint16_t ap_count = 0;
-    esp_err_t scan_err = esp_wifi_scan_get_ap_num(&ap_count);
-    if (scan_err == ESP_OK) {
-        ESP_LOGI(TAG, "上次扫描发现的AP数量: %d", ap_count);
-    } else if (scan_err == ESP_ERR_WIFI_NOT_INIT) {
-        ESP_LOGI(TAG, "WiFi未初始化，无法获取扫描状态");
-    } else if (scan_err == ESP_ERR_WIFI_NOT_STARTED) {
-        ESP_LOGI(TAG, "WiFi未启动，无法获取扫描状态");
-    } else if (scan_err == ESP_ERR_WIFI_NOT_STOPPED) {
-        ESP_LOGI(TAG, "WiFi扫描正在进行中");
-    } else {
-        ESP_LOGI(TAG, "获取扫描状态失败: %s", esp_err_to_name(scan_err));
-    }
-    
-    // 检查电源管理模式
-    wifi_ps_type_t ps_type;
-    esp_err_t ps_err = esp_wifi_get_ps(&ps_type);
-    
-    if (ps_err == ESP_OK) {
-        ESP_LOGI(TAG, "电源管理模式: %s", 
-                 ps_type == WIFI_PS_NONE ? "NONE" : 
-                 ps_type == WIFI_PS_MIN_MODEM ? "MIN_MODEM" : 
-                 ps_type == WIFI_PS_MAX_MODEM ? "MAX_MODEM" : "未知");
-    } else {
-        ESP_LOGE(TAG, "获取电源管理模式失败: %s", esp_err_to_name(ps_err));
-    }
-}
-
-// 比较函数，用于按信号强度排序（从强到弱）
-static int compare_rssi(const void *a, const void *b) {
-    wifi_ap_record_t *ap_a = (wifi_ap_record_t *)a;
-    wifi_ap_record_t *ap_b = (wifi_ap_record_t *)b;
-    return ap_b->rssi - ap_a->rssi; // 降序排列
+    portENTER_CRITICAL(&s_dns_stats_lock);
+    *stats = s_dns_stats;
+    portEXIT_CRITICAL(&s_dns_stats_lock);
+    stats->running = s_dns_server_task_handle != NULL && !s_dns_stop_requested;
+    stats->forwarding = stats->running && s_dns_upstream != 0;
+    stats->upstream = s_dns_upstream;
+
+    dns_cache_stats_t cache_stats;
+    dns_cache_get_stats(&cache_stats, (uint32_t)(esp_timer_get_time() / 1000000));
+    stats->cache_entries = cache_stats.entries;
+    stats->cache_misses = cache_stats.misses;
+    stats->cache_negative_hits = cache_stats.negative_hits;
 }
 
-// 去重函数，移除相同SSID的重复项，保留信号最强的
-static uint16_t remove_duplicates(wifi_ap_record_t *ap_records, uint16_t count) {
-    if (count <= 1) return count;
-
-    uint16_t unique_count = 0;
-    for (uint16_t i = 0; i < count; i++) {
-        bool is_duplicate = false;
-
-        // 检查是否已经存在相同的SSID
-        for (uint16_t j = 0; j < unique_count; j++) {
-            if (strcmp((char*)ap_records[i].ssid, (char*)ap_records[j].ssid) == 0) {
-                is_duplicate = true;
-                break;
-            }
-        }
-
-        // 如果不是重复项，添加到结果中
-        if (!is_duplicate) {
-            if (unique_count != i) {
-                memcpy(&ap_records[unique_count], &ap_records[i], sizeof(wifi_ap_record_t));
-            }
-            unique_count++;
-        }
+void wifi_manager_get_connect_stats(wifi_connect_stats_t *stats)
+{
+    if (stats == NULL) {
+        return;
     }
+    *stats = s_connect_stats;
+    stats->fast_hint_valid = s_fast_hint_valid;
+    stats->fast_hint_channel = s_fast_hint_valid ? s_fast_hint.channel : 0;
+    stats->reconnect_state = (uint8_t)s_reconnect_state;
+}
 
-    return unique_count;
+void wifi_manager_get_channel_stats(wifi_channel_stats_t *stats)
+{
+    wifi_channel_get_stats(stats);
 }
 
-// 简化的WiFi扫描函数，不切换模式
-static wifi_ap_record_t *simple_wifi_scan(uint16_t *ap_count) {
-    if (ap_count == NULL) {
-        return NULL;
+void wifi_manager_get_event_loop_stats(wifi_event_loop_stats_t *stats)
+{
+    if (stats == NULL) {
+        return;
     }
+    portENTER_CRITICAL(&s_loop_stats_lock);
+    *stats = s_loop_stats;
+    stats->avg_latency_us = s_loop_stats.probes > 0 ?
+                            (uint32_t)(s_loop_latency_total_us / s_loop_stats.probes) : 0;
+    stats->handler_avg_us = s_loop_stats.handler_calls > 0 ?
+                            (uint32_t)(s_loop_handler_total_us / s_loop_stats.handler_calls) : 0;
+    portEXIT_CRITICAL(&s_loop_stats_lock);
+}
 
-    *ap_count = 0;
-    ESP_LOGI(TAG, "使用简化扫描模式");
-
-    // 停止任何正在进行的扫描
-    esp_wifi_scan_stop();
-    vTaskDelay(pdMS_TO_TICKS(100));
-
-    // 配置简单的扫描参数
-    wifi_scan_config_t scan_config = {
-        .ssid = NULL,
-        .bssid = NULL,
-        .channel = 0,
-        .show_hidden = false,
-        .scan_type = WIFI_SCAN_TYPE_ACTIVE,
-        .scan_time.active.min = 120,
-        .scan_time.active.max = 200,
-    };
+void wifi_manager_set_link_sample_cb(wifi_link_sample_cb_t cb)
+{
+    link_monitor_set_sample_cb(cb);
+}
 
-    // 开始扫描
-    esp_err_t scan_result = esp_wifi_scan_start(&scan_config, true);
-    if (scan_result != ESP_OK) {
-        ESP_LOGE(TAG, "简化扫描失败: %s", esp_err_to_name(scan_result));
-        return NULL;
-    }
+uint16_t wifi_manager_get_link_history(wifi_link_sample_t *samples, uint16_t max)
+{
+    return link_monitor_get_history(samples, max);
+}
 
-    // 获取扫描结果
-    esp_err_t get_num_result = esp_wifi_scan_get_ap_num(ap_count);
-    if (get_num_result != ESP_OK || *ap_count == 0) {
-        ESP_LOGW(TAG, "简化扫描未找到网络");
-        return NULL;
+void wifi_manager_get_link_stats(wifi_link_stats_t *stats)
+{
+    if (stats == NULL) {
+        return;
     }
+    link_monitor_get_stats(stats);
+    stats->early_scans = s_early_scans;
+    stats->predictive_roams = s_predictive_roams;
+    stats->proactive_reconnects = s_proactive_reconnects;
+}
 
-    wifi_ap_record_t *ap_records = (wifi_ap_record_t *)malloc(*ap_count * sizeof(wifi_ap_record_t));
-    if (ap_records == NULL) {
-        ESP_LOGE(TAG, "简化扫描内存分配失败");
-        *ap_count = 0;
-        return NULL;
-    }
+esp_err_t wifi_manager_set_power_policy(const wifi_power_policy_t *policy)
+{
+    return wifi_power_set_policy(policy);
+}
 
-    esp_err_t get_ap_result = esp_wifi_scan_get_ap_records(ap_count, ap_records);
-    if (get_ap_result != ESP_OK) {
-        ESP_LOGE(TAG, "简化扫描获取记录失败");
-        free(ap_records);
-        *ap_count = 0;
-        return NULL;
-    }
+void wifi_manager_get_power_policy(wifi_power_policy_t *policy)
+{
+    wifi_power_get_policy(policy);
+}
 
-    ESP_LOGI(TAG, "简化扫描成功，找到 %d 个网络", *ap_count);
-    return ap_records;
+void wifi_manager_power_set_ws_clients(uint8_t count)
+{
+    wifi_power_set_ws_clients(count);
 }
 
-wifi_ap_record_t *wifi_manager_scan_networks(uint16_t *ap_count)
+void wifi_manager_power_notify_request(void)
 {
-    if (ap_count == NULL) {
-        ESP_LOGE(TAG, "ap_count参数为NULL");
-        return NULL;
-    }
+    wifi_power_notify_request();
+}
 
-    *ap_count = 0;
+void wifi_manager_power_notify_press(void)
+{
+    wifi_power_notify_press();
+}
 
-    // 打印当前WiFi状态
-    wifi_manager_print_status();
+uint8_t wifi_manager_power_mode(void)
+{
+    return wifi_power_current_mode();
+}
 
-    // 确保WiFi已初始化
-    wifi_mode_t current_mode;
-    esp_err_t mode_err = esp_wifi_get_mode(&current_mode);
-    if (mode_err != ESP_OK) {
-        ESP_LOGE(TAG, "WiFi未初始化或获取模式失败: %s", esp_err_to_name(mode_err));
-        return NULL;
-    }
+esp_err_t wifi_manager_power_record_echo(uint8_t mode, uint32_t rtt_ms)
+{
+    return wifi_power_record_echo(mode, rtt_ms);
+}
 
-    ESP_LOGI(TAG, "开始WiFi扫描，当前模式: %s (%d)",
-             current_mode == WIFI_MODE_NULL ? "NULL" :
-             current_mode == WIFI_MODE_STA ? "STA" :
-             current_mode == WIFI_MODE_AP ? "AP" :
-             current_mode == WIFI_MODE_APSTA ? "APSTA" : "未知", current_mode);
+void wifi_manager_get_power_stats(wifi_power_stats_t *stats)
+{
+    wifi_power_get_stats(stats);
+}
 
-    // 统一APSTA模式下，无需模式切换，直接扫描
-    if (current_mode != WIFI_MODE_APSTA && current_mode != WIFI_MODE_STA) {
-        ESP_LOGE(TAG, "当前模式不支持扫描: %d", current_mode);
-        return NULL;
+esp_err_t wifi_manager_save_credentials(const char *ssid, const char *password)
+{
+    if (ssid == NULL) {
+        return ESP_ERR_INVALID_ARG;
     }
 
-    ESP_LOGI(TAG, "APSTA模式下直接扫描，无需切换模式");
-
-    // 停止任何正在进行的扫描
-    ESP_LOGI(TAG, "停止之前的扫描...");
-    esp_wifi_scan_stop();
-    vTaskDelay(pdMS_TO_TICKS(300));
-
-    // 配置扫描参数
-    wifi_scan_config_t scan_config = {
-        .ssid = NULL,
-        .bssid = NULL,
-        .channel = 0,  // 扫描所有信道
-        .show_hidden = false,  // 不显示隐藏网络
-        .scan_type = WIFI_SCAN_TYPE_ACTIVE,
-        .scan_time.active.min = 100,   // 优化扫描时间
-        .scan_time.active.max = 300,   // 优化扫描时间
-    };
-
-    // 开始扫描（阻塞模式）
-    ESP_LOGI(TAG, "开始WiFi扫描（阻塞模式）...");
-    esp_err_t scan_result = esp_wifi_scan_start(&scan_config, true);
-
-    if (scan_result != ESP_OK) {
-        ESP_LOGE(TAG, "WiFi扫描失败: %s", esp_err_to_name(scan_result));
-
-        // 尝试简化扫描作为备用方案
-        ESP_LOGW(TAG, "尝试简化扫描作为备用方案");
-        return simple_wifi_scan(ap_count);
-    }
-    
-    ESP_LOGI(TAG, "WiFi扫描完成，获取结果...");
+    // 新配置的网络优先级最高
+    return wifi_networks_add(ssid, password);
+}
 
-    // 获取扫描到的AP数量
-    esp_err_t get_num_result = esp_wifi_scan_get_ap_num(ap_count);
-    if (get_num_result != ESP_OK) {
-        ESP_LOGE(TAG, "获取AP数量失败: %s", esp_err_to_name(get_num_result));
-        *ap_count = 0;
-        return NULL;
+esp_err_t wifi_manager_load_credentials(char *ssid, char *password)
+{
+    if (ssid == NULL) {
+        return ESP_ERR_INVALID_ARG;
     }
 
-    ESP_LOGI(TAG, "扫描到 %d 个WiFi网络", *ap_count);
-
-    if (*ap_count == 0) {
-        ESP_LOGW(TAG, "未找到任何WiFi网络");
-        // 返回空数组而不是NULL，让上层知道扫描成功但没有结果
-        wifi_ap_record_t *empty_records = (wifi_ap_record_t *)malloc(sizeof(wifi_ap_record_t));
-        if (empty_records != NULL) {
-            *ap_count = 0;
-            return empty_records;
-        }
-        return NULL;
+    // 返回优先级最高的网络
+    const wifi_network_t *network = wifi_networks_get(0);
+    if (network == NULL) {
+        return ESP_ERR_NVS_NOT_FOUND;
     }
 
-    // 分配内存存储扫描结果
-    wifi_ap_record_t *ap_records = (wifi_ap_record_t *)malloc(*ap_count * sizeof(wifi_ap_record_t));
-    if (ap_records == NULL) {
-        ESP_LOGE(TAG, "内存分配失败，需要 %d 字节", *ap_count * sizeof(wifi_ap_record_t));
-        *ap_count = 0;
-        return NULL;
+    strlcpy(ssid, network->ssid, MAX_SSID_LEN + 1);
+    if (password != NULL) {
+        strlcpy(password, network->password, MAX_PASSWORD_LEN + 1);
     }
+    return ESP_OK;
+}
 
-    // 获取扫描结果
-    uint16_t actual_count = *ap_count;
-    esp_err_t get_ap_result = esp_wifi_scan_get_ap_records(&actual_count, ap_records);
-    if (get_ap_result != ESP_OK) {
-        ESP_LOGE(TAG, "获取AP记录失败: %s", esp_err_to_name(get_ap_result));
-        free(ap_records);
-        *ap_count = 0;
-        return NULL;
+int wifi_manager_get_saved_networks(wifi_saved_network_t *networks, int max)
+{
+    if (networks == NULL) {
+        return 0;
     }
 
-    *ap_count = actual_count;
-    ESP_LOGI(TAG, "成功获取 %d 个AP记录", *ap_count);
-
-    ESP_LOGI(TAG, "原始扫描结果: %d 个网络", *ap_count);
-
-    // 过滤掉信号太弱的网络（RSSI < -90dBm）
-    uint16_t filtered_count = 0;
-    for (uint16_t i = 0; i < *ap_count; i++) {
-        if (ap_records[i].rssi >= -90 && strlen((char*)ap_records[i].ssid) > 0) {
-            if (filtered_count != i) {
-                memcpy(&ap_records[filtered_count], &ap_records[i], sizeof(wifi_ap_record_t));
+    wifi_ap_record_t records[WIFI_SCAN_MAX_RESULTS];
+    wifi_scan_info_t info;
+    wifi_manager_scan_get(records, WIFI_SCAN_MAX_RESULTS, UINT32_MAX, 0, &info);
+
+    int count = 0;
+    for (int i = 0; i < wifi_networks_count() && count < max; i++) {
+        const wifi_network_t *network = wifi_networks_get(i);
+        wifi_saved_network_t *out = &networks[count++];
+        memset(out, 0, sizeof(*out));
+        strlcpy(out->ssid, network->ssid, sizeof(out->ssid));
+        out->priority = i;
+        for (int r = 0; r < info.count; r++) {
+            if (strcmp((const char *)records[r].ssid, network->ssid) == 0) {
+                out->visible = true;
+                out->rssi = records[r].rssi;
+                break;
             }
-            filtered_count++;
-        }
-    }
-    *ap_count = filtered_count;
-
-    if (*ap_count == 0) {
-        ESP_LOGW(TAG, "过滤后没有可用的WiFi网络");
-        free(ap_records);
-        // 返回空数组而不是NULL
-        wifi_ap_record_t *empty_records = (wifi_ap_record_t *)malloc(sizeof(wifi_ap_record_t));
-        if (empty_records != NULL) {
-            *ap_count = 0;
-            return empty_records;
         }
-        return NULL;
     }
+    return count;
+}
 
-    ESP_LOGI(TAG, "过滤后: %d 个网络", *ap_count);
-
-    // 按信号强度排序（从强到弱）
-    qsort(ap_records, *ap_count, sizeof(wifi_ap_record_t), compare_rssi);
-
-    // 去除重复的SSID，保留信号最强的
-    *ap_count = remove_duplicates(ap_records, *ap_count);
-
-    ESP_LOGI(TAG, "去重后: %d 个网络", *ap_count);
-
-    // 限制返回的网络数量为前10个
-    const uint16_t MAX_NETWORKS = 10;
-    if (*ap_count > MAX_NETWORKS) {
-        *ap_count = MAX_NETWORKS;
-        ESP_LOGI(TAG, "限制为前 %d 个信号最强的网络", MAX_NETWORKS);
-    }
-
-    // 重新分配内存以节省空间
-    wifi_ap_record_t *final_records = (wifi_ap_record_t *)malloc(*ap_count * sizeof(wifi_ap_record_t));
-    if (final_records == NULL) {
-        ESP_LOGE(TAG, "重新分配内存失败");
-        free(ap_records);
-        *ap_count = 0;
-        return NULL;
-    }
-
-    memcpy(final_records, ap_records, *ap_count * sizeof(wifi_ap_record_t));
-    free(ap_records);
-
-    // APSTA模式下无需恢复模式，保持当前状态
-    ESP_LOGI(TAG, "WiFi扫描完成，保持APSTA模式");
-
-    // 打印扫描结果
-    ESP_LOGI(TAG, "WiFi扫描成功完成，返回 %d 个网络:", *ap_count);
-    for (uint16_t i = 0; i < *ap_count; i++) {
-        ESP_LOGI(TAG, "  %d. SSID: %s, RSSI: %d dBm, 信道: %d",
-                 i + 1, final_records[i].ssid, final_records[i].rssi, final_records[i].primary);
+esp_err_t wifi_manager_forget_network(const char *ssid)
+{
+    if (ssid == NULL) {
+        return ESP_ERR_INVALID_ARG;
     }
-
-    return final_records;
-} 
\ No newline at end of file
+    return wifi_networks_remove(ssid);
+}
@@ -0,0 +1,192 @@
+#include "wifi_networks.h"
+#include "wifi_scan.h"
+#include "esp_log.h"
+#include "nvs.h"
+#include <string.h>
+
+static const char *TAG = "wifi_networks";
+
+#define NETWORKS_NVS_NAMESPACE   "wifi_config"
+#define NETWORKS_NVS_KEY         "networks"
+#define NETWORKS_LEGACY_SSID_KEY "ssid"        // 旧版本的单组凭证
+#define NETWORKS_LEGACY_PASS_KEY "password"
+#define NETWORKS_VERSION         1
+
+// 优先级每低一级，相当于信号弱这么多dB
+#define NETWORKS_PRIORITY_STEP_DB 8
+
+typedef struct {
+    uint8_t version;
+    uint8_t count;
+    wifi_network_t networks[WIFI_MAX_NETWORKS];
+} networks_blob_t;
+
+static networks_blob_t s_store;
+
+static esp_err_t save_store(void)
+{
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(NETWORKS_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = nvs_set_blob(nvs_handle, NETWORKS_NVS_KEY, &s_store, sizeof(s_store));
+    if (err == ESP_OK) {
+        err = nvs_commit(nvs_handle);
+    }
+    nvs_close(nvs_handle);
+    return err;
+}
+
+// 把旧版本的ssid/password键迁移为列表的第一项
+static void migrate_legacy(nvs_handle_t nvs_handle)
+{
+    wifi_network_t network = {0};
+    size_t len = sizeof(network.ssid);
+    if (nvs_get_str(nvs_handle, NETWORKS_LEGACY_SSID_KEY, network.ssid, &len) != ESP_OK ||
+        network.ssid[0] == '\0') {
+        return;
+    }
+    len = sizeof(network.password);
+    if (nvs_get_str(nvs_handle, NETWORKS_LEGACY_PASS_KEY, network.password, &len) != ESP_OK) {
+        network.password[0] = '\0';
+    }
+
+    s_store.networks[0] = network;
+    s_store.count = 1;
+    if (save_store() != ESP_OK) {
+        ESP_LOGW(TAG, "迁移旧凭证失败，保留旧格式");
+        return;
+    }
+
+    nvs_erase_key(nvs_handle, NETWORKS_LEGACY_SSID_KEY);
+    nvs_erase_key(nvs_handle, NETWORKS_LEGACY_PASS_KEY);
+    nvs_commit(nvs_handle);
+    ESP_LOGI(TAG, "已将旧凭证 %s 迁移到网络列表", network.ssid);
+}
+
+esp_err_t wifi_networks_load(void)
+{
+    memset(&s_store, 0, sizeof(s_store));
+    s_store.version = NETWORKS_VERSION;
+
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(NETWORKS_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    networks_blob_t blob;
+    size_t len = sizeof(blob);
+    err = nvs_get_blob(nvs_handle, NETWORKS_NVS_KEY, &blob, &len);
+    if (err == ESP_OK && len == sizeof(blob) && blob.version == NETWORKS_VERSION &&
+        blob.count <= WIFI_MAX_NETWORKS) {
+        s_store = blob;
+    } else if (err == ESP_ERR_NVS_NOT_FOUND) {
+        migrate_legacy(nvs_handle);
+    } else {
+        ESP_LOGW(TAG, "网络列表无效，已忽略");
+    }
+    nvs_close(nvs_handle);
+
+    ESP_LOGI(TAG, "已加载 %d 个网络", s_store.count);
+    return ESP_OK;
+}
+
+int wifi_networks_count(void)
+{
+    return s_store.count;
+}
+
+const wifi_network_t *wifi_networks_get(int index)
+{
+    if (index < 0 || index >= s_store.count) {
+        return NULL;
+    }
+    return &s_store.networks[index];
+}
+
+int wifi_networks_find(const char *ssid)
+{
+    for (int i = 0; i < s_store.count; i++) {
+        if (strcmp(s_store.networks[i].ssid, ssid) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+esp_err_t wifi_networks_add(const char *ssid, const char *password)
+{
+    if (ssid == NULL || ssid[0] == '\0' || strlen(ssid) >= sizeof(s_store.networks[0].ssid)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    wifi_network_t network = {0};
+    strlcpy(network.ssid, ssid, sizeof(network.ssid));
+    if (password != NULL) {
+        strlcpy(network.password, password, sizeof(network.password));
+    }
+
+    // 已存在则从原位置移除，否则列表满时丢弃最后一个
+    int index = wifi_networks_find(ssid);
+    if (index < 0) {
+        index = s_store.count < WIFI_MAX_NETWORKS ? s_store.count++ : WIFI_MAX_NETWORKS - 1;
+    }
+    memmove(&s_store.networks[1], &s_store.networks[0], index * sizeof(wifi_network_t));
+    s_store.networks[0] = network;
+
+    return save_store();
+}
+
+esp_err_t wifi_networks_remove(const char *ssid)
+{
+    int index = wifi_networks_find(ssid);
+    if (index < 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    s_store.count--;
+    memmove(&s_store.networks[index], &s_store.networks[index + 1],
+            (s_store.count - index) * sizeof(wifi_network_t));
+    memset(&s_store.networks[s_store.count], 0, sizeof(wifi_network_t));
+
+    return save_store();
+}
+
+int wifi_networks_select(uint32_t exclude_mask, scan_ap_t *ap)
+{
+    if (ap != NULL) {
+        memset(ap, 0, sizeof(*ap));
+    }
+
+    // 只读缓存，不等待扫描
+    int best = -1;
+    int best_score = INT32_MIN;
+    scan_ap_t found;
+    for (int i = 0; i < s_store.count; i++) {
+        if ((exclude_mask & (1U << i)) || !wifi_scan_find(s_store.networks[i].ssid, &found)) {
+            continue;
+        }
+        int score = found.rssi - i * NETWORKS_PRIORITY_STEP_DB;
+        if (score > best_score) {
+            best = i;
+            best_score = score;
+            if (ap != NULL) {
+                *ap = found;
+            }
+        }
+    }
+
+    if (best >= 0) {
+        return best;
+    }
+
+    // 扫描结果中没有已保存的网络（或尚未扫描），按优先级尝试
+    for (int i = 0; i < s_store.count; i++) {
+        if (!(exclude_mask & (1U << i))) {
+            return i;
+        }
+    }
+    return -1;
+}
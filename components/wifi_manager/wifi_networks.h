@@ -0,0 +1,40 @@
+#ifndef WIFI_NETWORKS_H
+#define WIFI_NETWORKS_H
+
+#include "esp_err.h"
+#include "scan_aggregator.h"
+#include "wifi_manager/wifi_manager.h"
+#include <stdint.h>
+
+// 已保存的网络，按优先级排列（索引0最优先，最近配网的排在最前）
+typedef struct {
+    char ssid[33];
+    char password[65];
+} wifi_network_t;
+
+// 从NVS加载网络列表，旧版本的单组凭证会迁移到列表中
+esp_err_t wifi_networks_load(void);
+
+// 已保存的网络数
+int wifi_networks_count(void);
+
+// 按优先级取网络，超出范围返回NULL
+const wifi_network_t *wifi_networks_get(int index);
+
+// 查找SSID对应的索引，未找到返回-1
+int wifi_networks_find(const char *ssid);
+
+// 添加或更新网络并移到最前，列表满时丢弃优先级最低的
+esp_err_t wifi_networks_add(const char *ssid, const char *password);
+
+// 删除网络
+esp_err_t wifi_networks_remove(const char *ssid);
+
+// 按扫描缓存中的信号和优先级选出最佳网络，跳过exclude_mask中的索引
+// 扫描缓存中没有任何已保存网络时按优先级返回第一个未排除的
+// ap不为NULL时返回该网络最强BSS的扫描记录（不在扫描结果中时ssid[0]为0）
+// 逐个按SSID查扫描缓存，不复制整个结果列表，可以在栈较小的事件循环任务中调用
+// 返回网络索引，没有可选网络返回-1
+int wifi_networks_select(uint32_t exclude_mask, scan_ap_t *ap);
+
+#endif /* WIFI_NETWORKS_H */
@@ -0,0 +1,306 @@
+#include "wifi_power.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "nvs.h"
+#include <string.h>
+
+static const char *TAG = "wifi_power";
+
+#define POWER_NVS_NAMESPACE     "wifi_config"
+#define POWER_NVS_KEY           "ps_policy"
+#define POWER_POLICY_VERSION    1
+
+// 默认策略：空闲时MIN_MODEM（按DTIM唤醒），有活动时不休眠
+#define POWER_DEFAULT_IDLE_MODE     WIFI_PS_MIN_MODEM
+#define POWER_DEFAULT_BUSY_MODE     WIFI_PS_NONE
+#define POWER_DEFAULT_LISTEN_INTERVAL 3
+#define POWER_DEFAULT_BOOST_MS      5000
+#define POWER_MAX_LISTEN_INTERVAL   10
+#define POWER_MAX_BOOST_MS          600000
+#define POWER_PRESS_HOLD_MS         30000   // 按键后等待PC状态变化的时间
+
+// 客户端回报的入站往返时间上限，超过的样本视为无效（MAX_MODEM监听间隔最长约1秒）
+#define POWER_ECHO_MAX_RTT_MS       10000
+
+typedef struct {
+    uint8_t version;
+    wifi_power_policy_t policy;
+} power_policy_blob_t;
+
+static wifi_power_policy_t s_policy = {
+    .idle_mode = POWER_DEFAULT_IDLE_MODE,
+    .busy_mode = POWER_DEFAULT_BUSY_MODE,
+    .listen_interval = POWER_DEFAULT_LISTEN_INTERVAL,
+    .boost_ms = POWER_DEFAULT_BOOST_MS,
+};
+
+// 活动状态和统计（受s_lock保护）；模式切换由s_mutex串行化
+static wifi_power_stats_t s_stats;
+static uint64_t s_latency_total_ms[WIFI_POWER_MODES];
+static int64_t s_busy_until_us = 0;
+static int64_t s_mode_since_us = 0;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static SemaphoreHandle_t s_mutex = NULL;
+static esp_timer_handle_t s_idle_timer = NULL;
+
+static const char *mode_name(uint8_t mode)
+{
+    switch (mode) {
+    case WIFI_PS_NONE: return "NONE";
+    case WIFI_PS_MIN_MODEM: return "MIN_MODEM";
+    case WIFI_PS_MAX_MODEM: return "MAX_MODEM";
+    default: return "?";
+    }
+}
+
+static bool policy_valid(const wifi_power_policy_t *policy)
+{
+    return policy->idle_mode < WIFI_POWER_MODES && policy->busy_mode < WIFI_POWER_MODES &&
+           policy->listen_interval >= 1 && policy->listen_interval <= POWER_MAX_LISTEN_INTERVAL &&
+           policy->boost_ms <= POWER_MAX_BOOST_MS;
+}
+
+static void load_policy(void)
+{
+    nvs_handle_t nvs_handle;
+    if (nvs_open(POWER_NVS_NAMESPACE, NVS_READONLY, &nvs_handle) != ESP_OK) {
+        return;
+    }
+    power_policy_blob_t blob;
+    size_t len = sizeof(blob);
+    esp_err_t err = nvs_get_blob(nvs_handle, POWER_NVS_KEY, &blob, &len);
+    nvs_close(nvs_handle);
+
+    if (err == ESP_OK && len == sizeof(blob) && blob.version == POWER_POLICY_VERSION &&
+        policy_valid(&blob.policy)) {
+        s_policy = blob.policy;
+    }
+}
+
+static esp_err_t save_policy(const wifi_power_policy_t *policy)
+{
+    power_policy_blob_t blob = {
+        .version = POWER_POLICY_VERSION,
+        .policy = *policy,
+    };
+
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(POWER_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = nvs_set_blob(nvs_handle, POWER_NVS_KEY, &blob, sizeof(blob));
+    if (err == ESP_OK) {
+        err = nvs_commit(nvs_handle);
+    }
+    nvs_close(nvs_handle);
+    return err;
+}
+
+// 按当前活动选择模式并切换；仍处于boost窗口时在窗口结束时再评估
+static void power_evaluate(void)
+{
+    if (s_mutex == NULL) {
+        return;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&s_lock);
+    bool busy = s_stats.ws_clients > 0 || now < s_busy_until_us;
+    int64_t remaining_us = s_busy_until_us - now;
+    uint8_t target = busy ? s_policy.busy_mode : s_policy.idle_mode;
+    uint8_t current = s_stats.mode;
+    s_stats.busy = busy;
+    portEXIT_CRITICAL(&s_lock);
+
+    if (target != current) {
+        esp_err_t err = esp_wifi_set_ps((wifi_ps_type_t)target);
+        if (err == ESP_OK) {
+            portENTER_CRITICAL(&s_lock);
+            s_stats.time_ms[current] += (uint32_t)((now - s_mode_since_us) / 1000);
+            s_stats.mode = target;
+            s_stats.switches++;
+            s_mode_since_us = now;
+            portEXIT_CRITICAL(&s_lock);
+            ESP_LOGD(TAG, "省电模式 %s -> %s", mode_name(current), mode_name(target));
+        } else {
+            ESP_LOGW(TAG, "设置省电模式 %s 失败: %s", mode_name(target), esp_err_to_name(err));
+        }
+    }
+
+    esp_timer_stop(s_idle_timer);
+    if (remaining_us > 0) {
+        esp_timer_start_once(s_idle_timer, (uint64_t)remaining_us);
+    }
+
+    xSemaphoreGive(s_mutex);
+}
+
+static void idle_timer_cb(void *arg)
+{
+    power_evaluate();
+}
+
+// 延长busy窗口，当前不在busy_mode时立即切换
+static void extend_busy(uint32_t hold_ms, uint32_t *counter)
+{
+    int64_t until = esp_timer_get_time() + (int64_t)hold_ms * 1000;
+
+    portENTER_CRITICAL(&s_lock);
+    if (until > s_busy_until_us) {
+        s_busy_until_us = until;
+    }
+    bool need_switch = s_stats.mode != s_policy.busy_mode;
+    if (need_switch && counter != NULL) {
+        (*counter)++;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (need_switch) {
+        power_evaluate();
+    }
+}
+
+esp_err_t wifi_power_init(void)
+{
+    if (s_mutex == NULL) {
+        s_mutex = xSemaphoreCreateMutex();
+        if (s_mutex == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+        const esp_timer_create_args_t timer_args = {
+            .callback = idle_timer_cb,
+            .name = "wifi_ps_idle",
+        };
+        esp_err_t err = esp_timer_create(&timer_args, &s_idle_timer);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    load_policy();
+
+    // 驱动默认MIN_MODEM，以实际读到的模式为起点
+    wifi_ps_type_t mode = WIFI_PS_MIN_MODEM;
+    esp_wifi_get_ps(&mode);
+    portENTER_CRITICAL(&s_lock);
+    s_stats.mode = mode < WIFI_POWER_MODES ? (uint8_t)mode : WIFI_PS_MIN_MODEM;
+    s_mode_since_us = esp_timer_get_time();
+    portEXIT_CRITICAL(&s_lock);
+
+    ESP_LOGI(TAG, "省电策略: 空闲 %s，活动 %s，监听间隔 %d，保持 %lu ms",
+             mode_name(s_policy.idle_mode), mode_name(s_policy.busy_mode),
+             s_policy.listen_interval, (unsigned long)s_policy.boost_ms);
+    power_evaluate();
+    return ESP_OK;
+}
+
+uint16_t wifi_power_listen_interval(void)
+{
+    return s_policy.listen_interval;
+}
+
+uint8_t wifi_power_current_mode(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    uint8_t mode = s_stats.mode;
+    portEXIT_CRITICAL(&s_lock);
+    return mode;
+}
+
+esp_err_t wifi_power_record_echo(uint8_t mode, uint32_t rtt_ms)
+{
+    if (mode >= WIFI_POWER_MODES || rtt_ms > POWER_ECHO_MAX_RTT_MS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    wifi_power_latency_t *latency = &s_stats.latency[mode];
+    latency->probes++;
+    latency->last_ms = rtt_ms;
+    if (rtt_ms > latency->max_ms) {
+        latency->max_ms = rtt_ms;
+    }
+    s_latency_total_ms[mode] += rtt_ms;
+    portEXIT_CRITICAL(&s_lock);
+    return ESP_OK;
+}
+
+esp_err_t wifi_power_set_policy(const wifi_power_policy_t *policy)
+{
+    if (policy == NULL || !policy_valid(policy)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // 监听间隔在关联请求中协商，写入下一次的STA配置，不打断当前连接
+    portENTER_CRITICAL(&s_lock);
+    s_policy = *policy;
+    portEXIT_CRITICAL(&s_lock);
+
+    ESP_LOGI(TAG, "省电策略更新: 空闲 %s，活动 %s，监听间隔 %d，保持 %lu ms",
+             mode_name(policy->idle_mode), mode_name(policy->busy_mode),
+             policy->listen_interval, (unsigned long)policy->boost_ms);
+    power_evaluate();
+    return save_policy(policy);
+}
+
+void wifi_power_get_policy(wifi_power_policy_t *policy)
+{
+    if (policy == NULL) {
+        return;
+    }
+    portENTER_CRITICAL(&s_lock);
+    *policy = s_policy;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void wifi_power_set_ws_clients(uint8_t count)
+{
+    portENTER_CRITICAL(&s_lock);
+    bool changed = count != s_stats.ws_clients;
+    s_stats.ws_clients = count;
+    portEXIT_CRITICAL(&s_lock);
+
+    if (changed) {
+        power_evaluate();
+    }
+}
+
+void wifi_power_notify_request(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    s_stats.requests[s_stats.mode]++;
+    uint32_t boost_ms = s_policy.boost_ms;
+    portEXIT_CRITICAL(&s_lock);
+
+    extend_busy(boost_ms, &s_stats.boosts);
+}
+
+void wifi_power_notify_press(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    s_stats.presses++;
+    portEXIT_CRITICAL(&s_lock);
+
+    extend_busy(POWER_PRESS_HOLD_MS, NULL);
+}
+
+void wifi_power_get_stats(wifi_power_stats_t *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&s_lock);
+    *stats = s_stats;
+    stats->time_ms[s_stats.mode] += (uint32_t)((now - s_mode_since_us) / 1000);
+    for (int i = 0; i < WIFI_POWER_MODES; i++) {
+        stats->latency[i].avg_ms = s_stats.latency[i].probes > 0 ?
+                                   (uint32_t)(s_latency_total_ms[i] / s_stats.latency[i].probes) : 0;
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
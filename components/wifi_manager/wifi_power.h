@@ -0,0 +1,31 @@
+#ifndef WIFI_POWER_H
+#define WIFI_POWER_H
+
+// 调制解调器省电策略
+// 按活动在WIFI_PS_NONE/MIN_MODEM/MAX_MODEM之间切换：有WebSocket客户端、刚收到请求或按键后
+// 等待PC状态变化时保持busy_mode，空闲后降到idle_mode；按请求到达时的模式统计客户端回报的入站往返延迟
+
+#include "esp_err.h"
+#include "wifi_manager/wifi_manager.h"
+#include <stdint.h>
+
+// 加载策略并应用初始模式，在esp_wifi_start之后调用
+esp_err_t wifi_power_init(void);
+
+// STA配置使用的监听间隔
+uint16_t wifi_power_listen_interval(void);
+
+// 当前省电模式（wifi_ps_type_t）
+uint8_t wifi_power_current_mode(void);
+
+// 记录客户端测得的一次入站往返时间，mode为该请求到达时的模式
+esp_err_t wifi_power_record_echo(uint8_t mode, uint32_t rtt_ms);
+
+esp_err_t wifi_power_set_policy(const wifi_power_policy_t *policy);
+void wifi_power_get_policy(wifi_power_policy_t *policy);
+void wifi_power_set_ws_clients(uint8_t count);
+void wifi_power_notify_request(void);
+void wifi_power_notify_press(void);
+void wifi_power_get_stats(wifi_power_stats_t *stats);
+
+#endif /* WIFI_POWER_H */
@@ -0,0 +1,457 @@
+#include "wifi_scan.h"
+#include "scan_aggregator.h"
+#include "wifi_manager/wifi_manager.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+#include "esp_event.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include <string.h>
+
+static const char *TAG = "wifi_scan";
+
+// 扫描策略
+#define SCAN_CACHE_FRESH_MS        10000   // 结果在此时间内视为新鲜，不触发新扫描
+#define SCAN_PERIODIC_INTERVAL_MS  30000   // 未联网（配网）期间的后台刷新周期
+#define SCAN_MIN_RSSI              -90     // 过滤过弱的网络
+#define SCAN_ACTIVE_MIN_MS         60
+#define SCAN_ACTIVE_MAX_MS         160
+#define SCAN_HOME_DWELL_MS         30      // 每扫完一个信道回到AP信道停留的时间，避免AP客户端断流
+
+#define SCAN_DONE_BIT              BIT0
+
+// 渐进式扫描：一轮扫描按信道组依次进行，最常用的1/6/11信道最先扫描，
+// 每组完成后通知进度回调，配网页面可以在几百毫秒内看到最强的网络
+#define SCAN_CHANNEL(ch)           (1U << (ch))    // 与wifi_2g_channel_bit_t的位定义一致
+
+static const uint16_t s_channel_groups[] = {
+    SCAN_CHANNEL(1) | SCAN_CHANNEL(6) | SCAN_CHANNEL(11),
+    SCAN_CHANNEL(2) | SCAN_CHANNEL(3) | SCAN_CHANNEL(4) | SCAN_CHANNEL(5),
+    SCAN_CHANNEL(7) | SCAN_CHANNEL(8) | SCAN_CHANNEL(9) | SCAN_CHANNEL(10),
+    SCAN_CHANNEL(12) | SCAN_CHANNEL(13),
+};
+#define SCAN_GROUP_COUNT           (sizeof(s_channel_groups) / sizeof(s_channel_groups[0]))
+
+_Static_assert(SCAN_AGGREGATOR_TOP_K == WIFI_SCAN_MAX_RESULTS, "聚合器K值应与缓存容量一致");
+
+// 缓存的扫描结果（已过滤、按信号排序、按SSID去重）
+static scan_ap_t s_cache[WIFI_SCAN_MAX_RESULTS];
+static uint16_t s_cache_count = 0;
+static int64_t s_cache_time_us = 0;        // 0表示尚无结果
+static uint32_t s_generation = 0;
+static scan_channel_load_t s_cache_load;   // 与缓存同一轮扫描的信道占用
+
+// 扫描状态
+static bool s_in_flight = false;
+static bool s_sta_connected = false;
+static wifi_scan_stats_t s_stats;
+static int64_t s_scan_start_us = 0;
+
+// 本轮扫描的进度，累计结果保存在scan_aggregator中，整轮完成后才写入缓存
+static uint8_t s_sweep_groups_done = 0;
+static uint16_t s_sweep_channels_done = 0;
+static wifi_scan_progress_cb_t s_progress_cb = NULL;
+static wifi_scan_done_hook_t s_done_hook = NULL;
+
+static SemaphoreHandle_t s_lock = NULL;
+static EventGroupHandle_t s_events = NULL;
+static esp_timer_handle_t s_refresh_timer = NULL;
+
+static void to_scan_ap(const wifi_ap_record_t *record, scan_ap_t *ap)
+{
+    memcpy(ap->ssid, record->ssid, SCAN_AGGREGATOR_SSID_LEN);
+    ap->ssid[SCAN_AGGREGATOR_SSID_LEN] = '\0';
+    memcpy(ap->bssid, record->bssid, sizeof(ap->bssid));
+    ap->rssi = record->rssi;
+    ap->channel = record->primary;
+    ap->authmode = record->authmode;
+}
+
+static void to_ap_record(const scan_ap_t *ap, wifi_ap_record_t *record)
+{
+    memset(record, 0, sizeof(*record));
+    memcpy(record->ssid, ap->ssid, sizeof(ap->ssid));
+    memcpy(record->bssid, ap->bssid, sizeof(ap->bssid));
+    record->rssi = ap->rssi;
+    record->primary = ap->channel;
+    record->authmode = (wifi_auth_mode_t)ap->authmode;
+}
+
+// 启动指定信道组的非阻塞扫描，调用者需持有s_lock
+static esp_err_t start_group_locked(uint8_t group)
+{
+    wifi_scan_config_t scan_config = {
+        .ssid = NULL,
+        .bssid = NULL,
+        .channel = 0,
+        .show_hidden = false,
+        .scan_type = WIFI_SCAN_TYPE_ACTIVE,
+        .scan_time.active.min = SCAN_ACTIVE_MIN_MS,
+        .scan_time.active.max = SCAN_ACTIVE_MAX_MS,
+        .home_chan_dwell_time = SCAN_HOME_DWELL_MS,
+        .channel_bitmap.ghz_2_channels = s_channel_groups[group],
+    };
+    return esp_wifi_scan_start(&scan_config, false);
+}
+
+// 开始一轮非阻塞扫描，调用者需持有s_lock；已有扫描在进行时直接合并
+static esp_err_t start_scan_locked(void)
+{
+    if (s_in_flight) {
+        s_stats.coalesced++;
+        return ESP_OK;
+    }
+
+    xEventGroupClearBits(s_events, SCAN_DONE_BIT);
+    esp_err_t ret = start_group_locked(0);
+    if (ret != ESP_OK) {
+        // STA正在连接时驱动会拒绝扫描，等下次请求或定时刷新再试
+        ESP_LOGW(TAG, "启动扫描失败: %s", esp_err_to_name(ret));
+        s_stats.failed++;
+        xEventGroupSetBits(s_events, SCAN_DONE_BIT);
+        return ret;
+    }
+
+    s_in_flight = true;
+    scan_aggregator_reset();
+    s_sweep_groups_done = 0;
+    s_sweep_channels_done = 0;
+    s_scan_start_us = esp_timer_get_time();
+    s_stats.started++;
+    return ESP_OK;
+}
+
+// 逐条取出驱动中本组的扫描结果送入聚合器，不分配内存
+static void merge_group_results(void)
+{
+    wifi_ap_record_t record;
+    scan_ap_t ap;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    // 每取一条驱动就释放一条，取完即释放了整个列表
+    while (esp_wifi_scan_get_ap_record(&record) == ESP_OK) {
+        // 信道占用统计所有BSS
+        scan_aggregator_add_channel(record.primary, record.rssi);
+        // 过滤掉信号太弱和隐藏的网络
+        if (record.rssi < SCAN_MIN_RSSI || record.ssid[0] == '\0') {
+            continue;
+        }
+        to_scan_ap(&record, &ap);
+        scan_aggregator_add(&ap);
+    }
+    xSemaphoreGive(s_lock);
+}
+
+// 本轮扫描结束，将累计结果写入缓存
+static void finish_sweep_locked(void)
+{
+    scan_aggregator_stats_t agg_stats;
+    scan_aggregator_get_stats(&agg_stats);
+
+    s_cache_count = scan_aggregator_sorted(s_cache, WIFI_SCAN_MAX_RESULTS);
+    scan_aggregator_channel_load(&s_cache_load);
+    s_stats.last_seen = agg_stats.seen;
+    s_stats.last_unique = agg_stats.unique;
+    s_cache_time_us = esp_timer_get_time();
+    s_generation++;
+    s_in_flight = false;
+    s_stats.completed++;
+    s_stats.last_duration_ms = (uint32_t)((s_cache_time_us - s_scan_start_us) / 1000);
+}
+
+// 填充进度信息，调用者需持有s_lock
+static void fill_progress_locked(wifi_scan_progress_t *progress)
+{
+    progress->sweep = s_in_flight ? s_generation + 1 : s_generation;
+    if (s_in_flight) {
+        scan_aggregator_stats_t agg_stats;
+        scan_aggregator_get_stats(&agg_stats);
+        progress->count = agg_stats.kept;
+    } else {
+        progress->count = s_cache_count;
+    }
+    progress->groups_done = s_in_flight ? s_sweep_groups_done : SCAN_GROUP_COUNT;
+    progress->groups_total = SCAN_GROUP_COUNT;
+    progress->channels_done = s_sweep_channels_done;
+    progress->done = !s_in_flight;
+    progress->elapsed_ms = s_in_flight ? (uint32_t)((esp_timer_get_time() - s_scan_start_us) / 1000)
+                                       : s_stats.last_duration_ms;
+}
+
+// 一组信道扫描完成：合并结果，启动下一组或结束本轮
+static void handle_group_done(void)
+{
+    merge_group_results();
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_sweep_channels_done |= s_channel_groups[s_sweep_groups_done];
+    s_sweep_groups_done++;
+
+    bool finished = s_sweep_groups_done >= SCAN_GROUP_COUNT;
+    if (!finished) {
+        esp_err_t ret = start_group_locked(s_sweep_groups_done);
+        if (ret != ESP_OK) {
+            // 扫描中途被打断（如STA开始连接），以已扫描的信道结束本轮
+            ESP_LOGW(TAG, "启动第 %d 组信道扫描失败: %s", s_sweep_groups_done + 1, esp_err_to_name(ret));
+            s_stats.failed++;
+            finished = true;
+        }
+    }
+    if (finished) {
+        finish_sweep_locked();
+    }
+
+    wifi_scan_progress_t progress;
+    fill_progress_locked(&progress);
+    wifi_scan_progress_cb_t cb = s_progress_cb;
+    wifi_scan_done_hook_t hook = s_done_hook;
+    xSemaphoreGive(s_lock);
+
+    if (finished) {
+        xEventGroupSetBits(s_events, SCAN_DONE_BIT);
+        ESP_LOGI(TAG, "扫描完成: 保留 %d 个网络，耗时 %lu ms",
+                 progress.count, (unsigned long)progress.elapsed_ms);
+        if (hook != NULL) {
+            hook();
+        }
+    }
+
+    if (cb != NULL) {
+        cb(&progress);
+    }
+}
+
+static void scan_event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+{
+    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_SCAN_DONE) {
+        wifi_event_sta_scan_done_t *event = (wifi_event_sta_scan_done_t *)event_data;
+        if (event->status != 0) {
+            ESP_LOGW(TAG, "扫描未成功完成: %lu", (unsigned long)event->status);
+        }
+        if (!s_in_flight) {
+            // 不是本模块发起的扫描，只释放结果
+            esp_wifi_clear_ap_list();
+            return;
+        }
+        handle_group_done();
+    }
+}
+
+// 配网期间周期刷新，让配网页面打开时就有较新的结果
+static void refresh_timer_cb(void *arg)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (!s_sta_connected) {
+        start_scan_locked();
+    }
+    xSemaphoreGive(s_lock);
+}
+
+esp_err_t wifi_scan_init(void)
+{
+    if (s_lock != NULL) {
+        return ESP_OK;
+    }
+
+    s_lock = xSemaphoreCreateMutex();
+    s_events = xEventGroupCreate();
+    if (s_lock == NULL || s_events == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    // 初始状态下没有扫描在进行，等待者不应阻塞
+    xEventGroupSetBits(s_events, SCAN_DONE_BIT);
+
+    esp_err_t ret = esp_event_handler_register(WIFI_EVENT, WIFI_EVENT_SCAN_DONE, scan_event_handler, NULL);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = refresh_timer_cb,
+        .name = "wifi_scan",
+    };
+    ret = esp_timer_create(&timer_args, &s_refresh_timer);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    return esp_timer_start_periodic(s_refresh_timer, (uint64_t)SCAN_PERIODIC_INTERVAL_MS * 1000);
+}
+
+void wifi_scan_set_sta_connected(bool connected)
+{
+    if (s_lock == NULL) {
+        return;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_sta_connected = connected;
+    xSemaphoreGive(s_lock);
+}
+
+esp_err_t wifi_manager_scan_request(void)
+{
+    if (s_lock == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    esp_err_t ret = start_scan_locked();
+    xSemaphoreGive(s_lock);
+    return ret;
+}
+
+esp_err_t wifi_manager_scan_get(wifi_ap_record_t *records, uint16_t max_records,
+                                uint32_t max_age_ms, uint32_t wait_ms, wifi_scan_info_t *info)
+{
+    if ((records == NULL && max_records > 0) || info == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_lock == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_stats.requests++;
+    int64_t now = esp_timer_get_time();
+    bool have_cache = s_cache_time_us > 0;
+    uint32_t age_ms = have_cache ? (uint32_t)((now - s_cache_time_us) / 1000) : UINT32_MAX;
+
+    bool need_wait = !have_cache || age_ms > max_age_ms;
+    if (need_wait || age_ms > SCAN_CACHE_FRESH_MS) {
+        // 结果过旧时后台刷新；调用方可接受当前结果时不等待
+        start_scan_locked();
+    }
+    if (!need_wait) {
+        s_stats.cache_hits++;
+    } else if (s_in_flight && wait_ms > 0) {
+        s_stats.waits++;
+    }
+    uint32_t generation = s_generation;
+    bool in_flight = s_in_flight;
+    xSemaphoreGive(s_lock);
+
+    if (need_wait && in_flight && wait_ms > 0) {
+        xEventGroupWaitBits(s_events, SCAN_DONE_BIT, pdFALSE, pdFALSE, pdMS_TO_TICKS(wait_ms));
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    uint16_t count = s_cache_count < max_records ? s_cache_count : max_records;
+    for (uint16_t i = 0; i < count; i++) {
+        to_ap_record(&s_cache[i], &records[i]);
+    }
+    info->count = count;
+    info->valid = s_cache_time_us > 0;
+    info->age_ms = info->valid ? (uint32_t)((esp_timer_get_time() - s_cache_time_us) / 1000) : 0;
+    info->scanning = s_in_flight;
+    info->generation = s_generation;
+    xSemaphoreGive(s_lock);
+
+    if (!info->valid) {
+        return ESP_ERR_TIMEOUT;
+    }
+    if (need_wait && info->generation == generation) {
+        // 等待超时或扫描启动失败，返回旧结果
+        return ESP_ERR_TIMEOUT;
+    }
+    return ESP_OK;
+}
+
+void wifi_manager_set_scan_progress_cb(wifi_scan_progress_cb_t cb)
+{
+    if (s_lock == NULL) {
+        return;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_progress_cb = cb;
+    xSemaphoreGive(s_lock);
+}
+
+esp_err_t wifi_manager_scan_get_progress(wifi_ap_record_t *records, uint16_t max_records,
+                                         wifi_scan_progress_t *progress)
+{
+    if (records == NULL || progress == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_lock == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    scan_ap_t sweep[WIFI_SCAN_MAX_RESULTS];
+    const scan_ap_t *source = s_cache;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    fill_progress_locked(progress);
+    if (s_in_flight) {
+        progress->count = scan_aggregator_sorted(sweep, WIFI_SCAN_MAX_RESULTS);
+        source = sweep;
+    }
+    if (progress->count > max_records) {
+        progress->count = max_records;
+    }
+    for (uint16_t i = 0; i < progress->count; i++) {
+        to_ap_record(&source[i], &records[i]);
+    }
+    xSemaphoreGive(s_lock);
+
+    return ESP_OK;
+}
+
+void wifi_manager_get_scan_stats(wifi_scan_stats_t *stats)
+{
+    if (stats == NULL || s_lock == NULL) {
+        return;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    *stats = s_stats;
+    xSemaphoreGive(s_lock);
+}
+
+void wifi_scan_set_done_hook(wifi_scan_done_hook_t hook)
+{
+    s_done_hook = hook;
+}
+
+esp_err_t wifi_scan_get_channel_load(scan_channel_load_t *load, uint32_t *age_ms)
+{
+    if (load == NULL || s_lock == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (s_cache_time_us > 0) {
+        *load = s_cache_load;
+        if (age_ms != NULL) {
+            *age_ms = (uint32_t)((esp_timer_get_time() - s_cache_time_us) / 1000);
+        }
+        ret = ESP_OK;
+    }
+    xSemaphoreGive(s_lock);
+    return ret;
+}
+
+uint8_t wifi_scan_find_channel(const char *ssid)
+{
+    scan_ap_t ap;
+    return wifi_scan_find(ssid, &ap) ? ap.channel : 0;
+}
+
+bool wifi_scan_find(const char *ssid, scan_ap_t *ap)
+{
+    if (ssid == NULL || ssid[0] == '\0' || ap == NULL || s_lock == NULL) {
+        return false;
+    }
+
+    // 缓存已按SSID去重，每个SSID只有信号最强的一条
+    bool found = false;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (uint16_t i = 0; i < s_cache_count; i++) {
+        if (strcmp(s_cache[i].ssid, ssid) == 0) {
+            *ap = s_cache[i];
+            found = true;
+            break;
+        }
+    }
+    xSemaphoreGive(s_lock);
+    return found;
+}
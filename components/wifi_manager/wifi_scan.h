@@ -0,0 +1,30 @@
+#ifndef WIFI_SCAN_H
+#define WIFI_SCAN_H
+
+#include "esp_err.h"
+#include "scan_aggregator.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// 一轮扫描完成时在事件循环任务中调用
+typedef void (*wifi_scan_done_hook_t)(void);
+
+// 初始化后台扫描服务（注册SCAN_DONE事件和定时刷新），由wifi_manager_init调用
+esp_err_t wifi_scan_init(void);
+
+// STA联网状态变化时调用，联网后停止周期刷新
+void wifi_scan_set_sta_connected(bool connected);
+
+// 设置扫描完成钩子（供信道协调使用）
+void wifi_scan_set_done_hook(wifi_scan_done_hook_t hook);
+
+// 获取缓存对应那一轮扫描的信道占用，尚无结果返回ESP_ERR_NOT_FOUND
+esp_err_t wifi_scan_get_channel_load(scan_channel_load_t *load, uint32_t *age_ms);
+
+// 在扫描缓存中查找SSID所在信道（信号最强的BSS），找不到返回0
+uint8_t wifi_scan_find_channel(const char *ssid);
+
+// 在扫描缓存中查找SSID信号最强的BSS，只复制这一条，找不到返回false
+bool wifi_scan_find(const char *ssid, scan_ap_t *ap);
+
+#endif /* WIFI_SCAN_H */
@@ -16,8 +16,10 @@
 #include "driver/gpio.h"
 #include "driver/ledc.h"
 
+#include "pm_lock/pm_lock.h"
 #include "wifi_manager/wifi_manager.h"
 #include "pc_monitor/pc_monitor.h"
+#include "edge_capture/edge_capture.h"
 #include "servo_control/servo_control.h"
 #include "web_server/web_server.h"
 
@@ -37,6 +39,9 @@ void app_main(void)
     ESP_ERROR_CHECK(ret);
     
     ESP_LOGI(TAG, "ESP32远程开机助手启动");
+
+    // 开启动态调频，需在WiFi和其他组件初始化之前配置
+    pm_lock_init();
     
     // 初始化netif
     ESP_ERROR_CHECK(esp_netif_init());
@@ -50,6 +55,9 @@ void app_main(void)
     // 初始化PC状态监控
     pc_monitor_init();
     
+    // 初始化电源灯/硬盘灯边沿捕获
+    edge_capture_init();
+    
     // 初始化舵机控制
     servo_control_init();
     
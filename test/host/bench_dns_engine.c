@@ -0,0 +1,103 @@
+#include "pcap_reader.h"
+#include "dns_engine.h"
+#include <time.h>
+
+// dns_engine吞吐量：反复回放pcap语料，每个查询先复制到512字节缓冲区再就地应答（与设备上的处理一致）
+//   bench_dns_engine [-n 轮数] capture.pcap...
+// 分别统计全部报文和能正常应答（NOERROR）的查询，后者代表配网时的实际负载
+
+#define BENCH_BUFFER_SIZE   512
+#define BENCH_DEFAULT_ROUNDS 2000
+
+static const uint8_t s_portal_ip[4] = { 192, 168, 4, 1 };
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// 运行rounds轮，返回耗时（秒）；checksum防止编译器把应答优化掉
+static double run(const pcap_payload_t *payloads, size_t count, int rounds, size_t *checksum)
+{
+    uint8_t packet[BENCH_BUFFER_SIZE];
+    double start = now_s();
+    for (int r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < count; i++) {
+            size_t len = payloads[i].len > sizeof(packet) ? sizeof(packet) : payloads[i].len;
+            memcpy(packet, payloads[i].data, len);
+            *checksum += dns_engine_answer(packet, len, sizeof(packet), s_portal_ip, 60, NULL);
+        }
+    }
+    return now_s() - start;
+}
+
+static void report(const char *label, size_t count, int rounds, double seconds)
+{
+    double queries = (double)count * rounds;
+    printf("%-10s %6zu packets x %d rounds: %.3f s, %.0f qps, %.0f ns/query\n",
+           label, count, rounds, seconds, queries / seconds, seconds * 1e9 / queries);
+}
+
+int main(int argc, char **argv)
+{
+    int rounds = BENCH_DEFAULT_ROUNDS;
+    int first = 1;
+    if (argc > 2 && strcmp(argv[1], "-n") == 0) {
+        rounds = atoi(argv[2]);
+        first = 3;
+    }
+    if (first >= argc || rounds <= 0) {
+        fprintf(stderr, "usage: %s [-n rounds] capture.pcap...\n", argv[0]);
+        return 2;
+    }
+
+    // 合并所有文件的报文，并挑出能正常应答的查询
+    pcap_capture_t captures[argc];
+    size_t total = 0;
+    for (int f = first; f < argc; f++) {
+        if (!pcap_load(argv[f], 53, &captures[f])) {
+            return 2;
+        }
+        total += captures[f].count;
+    }
+    if (total == 0) {
+        fprintf(stderr, "no DNS packets\n");
+        return 2;
+    }
+    pcap_payload_t *all = malloc(total * sizeof(pcap_payload_t));
+    pcap_payload_t *valid = malloc(total * sizeof(pcap_payload_t));
+    size_t valid_count = 0;
+    size_t n = 0;
+    for (int f = first; f < argc; f++) {
+        for (size_t i = 0; i < captures[f].count; i++) {
+            const pcap_payload_t *payload = &captures[f].payloads[i];
+            all[n++] = *payload;
+
+            uint8_t packet[BENCH_BUFFER_SIZE];
+            size_t len = payload->len > sizeof(packet) ? sizeof(packet) : payload->len;
+            memcpy(packet, payload->data, len);
+            dns_engine_result_t result;
+            if (dns_engine_answer(packet, len, sizeof(packet), s_portal_ip, 60, &result) > 0 &&
+                result.rcode == DNS_RCODE_NOERROR) {
+                valid[valid_count++] = *payload;
+            }
+        }
+    }
+
+    size_t checksum = 0;
+    run(all, total, rounds / 10 + 1, &checksum);    // 预热
+    report("all", total, rounds, run(all, total, rounds, &checksum));
+    if (valid_count > 0) {
+        report("noerror", valid_count, rounds, run(valid, valid_count, rounds, &checksum));
+    }
+    printf("checksum %zu\n", checksum);
+
+    free(all);
+    free(valid);
+    for (int f = first; f < argc; f++) {
+        pcap_free(&captures[f]);
+    }
+    return 0;
+}
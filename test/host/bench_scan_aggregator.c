@@ -0,0 +1,299 @@
+#include "host_test.h"
+#include "scan_aggregator.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// scan_aggregator在密集环境（100-200个AP）下的正确性和耗时
+//   bench_scan_aggregator [-n 轮数]
+// 每个场景先与逐条暴力计算的结果比较，再反复运行计时。场景包括主哈希冲突的SSID、
+// 被挤出前K名后变强重新出现的SSID，以及超过哈希表槽数的线性查重
+
+#define BENCH_MAX_APS           400
+#define BENCH_DEFAULT_ROUNDS    20000
+#define BENCH_COLLISION_PAIRS   8
+
+typedef struct {
+    const char *name;
+    scan_ap_t aps[BENCH_MAX_APS];
+    int count;
+} scenario_t;
+
+// 与scan_aggregator.c中的主哈希相同
+static uint32_t fnv1a(const char *ssid)
+{
+    uint32_t hash = 2166136261u;
+    for (const uint8_t *p = (const uint8_t *)ssid; *p != '\0'; p++) {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    return hash != 0 ? hash : 1;
+}
+
+// 穷举"c-%x"形式的名称，找出FNV-1a完全相同的SSID对
+static int find_collisions(char pairs[][2][SCAN_AGGREGATOR_SSID_LEN + 1], int wanted)
+{
+    const uint32_t table_bits = 21;
+    const uint32_t table_size = 1u << table_bits;
+    uint32_t *hashes = calloc(table_size, sizeof(uint32_t));
+    uint32_t *ids = calloc(table_size, sizeof(uint32_t));
+    int found = 0;
+    char name[SCAN_AGGREGATOR_SSID_LEN + 1];
+
+    for (uint32_t i = 1; i < table_size / 2 && found < wanted; i++) {
+        snprintf(name, sizeof(name), "c-%x", i);
+        uint32_t hash = fnv1a(name);
+        uint32_t slot = (hash * 2654435761u) >> (32 - table_bits);
+        while (hashes[slot] != 0 && hashes[slot] != hash) {
+            slot = (slot + 1) & (table_size - 1);
+        }
+        if (hashes[slot] == hash) {
+            snprintf(pairs[found][0], sizeof(pairs[found][0]), "c-%x", ids[slot]);
+            snprintf(pairs[found][1], sizeof(pairs[found][1]), "%s", name);
+            found++;
+            continue;
+        }
+        hashes[slot] = hash;
+        ids[slot] = i;
+    }
+    free(hashes);
+    free(ids);
+    return found;
+}
+
+static void add_ap(scenario_t *sc, const char *ssid, int rssi)
+{
+    scan_ap_t *ap = &sc->aps[sc->count];
+    memset(ap, 0, sizeof(*ap));
+    snprintf(ap->ssid, sizeof(ap->ssid), "%s", ssid);
+    ap->bssid[5] = (uint8_t)sc->count;
+    ap->bssid[4] = (uint8_t)(sc->count >> 8);
+    ap->rssi = (int8_t)rssi;
+    ap->channel = (uint8_t)(1 + sc->count % 13);
+    sc->count++;
+}
+
+static void shuffle(scenario_t *sc)
+{
+    for (int i = sc->count - 1; i > 0; i--) {
+        int j = rand() % (i + 1);
+        scan_ap_t tmp = sc->aps[i];
+        sc->aps[i] = sc->aps[j];
+        sc->aps[j] = tmp;
+    }
+}
+
+// 公寓楼：bss个BSS分属约60%的SSID（多频段、Mesh），信号-95到-30
+static void build_dense(scenario_t *sc, const char *name, int bss)
+{
+    sc->name = name;
+    sc->count = 0;
+    int ssids = bss * 3 / 5;
+    char ssid[SCAN_AGGREGATOR_SSID_LEN + 1];
+    for (int i = 0; i < bss; i++) {
+        snprintf(ssid, sizeof(ssid), "%s-%d", i % 7 == 0 ? "ChinaNet" : "TP-LINK", i % ssids);
+        add_ap(sc, ssid, -95 + rand() % 66);
+    }
+    shuffle(sc);
+}
+
+// 信号递增输入：每个新SSID都挤掉堆顶
+static void build_ascending(scenario_t *sc)
+{
+    sc->name = "ascending";
+    sc->count = 0;
+    char ssid[SCAN_AGGREGATOR_SSID_LEN + 1];
+    for (int i = 0; i < 200; i++) {
+        snprintf(ssid, sizeof(ssid), "asc-%d", i);
+        add_ap(sc, ssid, -100 + i * 70 / 200);
+    }
+}
+
+// 先以弱信号出现、被挤出前K名，再以更强的BSS出现
+static void build_evicted(scenario_t *sc)
+{
+    sc->name = "evicted";
+    sc->count = 0;
+    char ssid[SCAN_AGGREGATOR_SSID_LEN + 1];
+    for (int i = 0; i < 60; i++) {
+        snprintf(ssid, sizeof(ssid), "ev-%d", i);
+        add_ap(sc, ssid, -90 + rand() % 10);
+    }
+    for (int i = 0; i < 60; i++) {
+        snprintf(ssid, sizeof(ssid), "mid-%d", i);
+        add_ap(sc, ssid, -70 + rand() % 10);
+    }
+    for (int i = 0; i < 60; i++) {
+        snprintf(ssid, sizeof(ssid), "ev-%d", (i * 7) % 60);
+        add_ap(sc, ssid, -60 + rand() % 30);
+    }
+}
+
+// 主哈希冲突的SSID对，混在密集环境中，其中一部分先被挤出堆
+static void build_collisions(scenario_t *sc, char pairs[][2][SCAN_AGGREGATOR_SSID_LEN + 1], int pair_count)
+{
+    build_dense(sc, "collisions", 120);
+    sc->name = "collisions";
+    for (int i = 0; i < pair_count; i++) {
+        // 偶数对：两个都比密集环境中的所有AP强，同时在堆中；
+        // 奇数对：前者先弱、没有进入前K名，后者中等，前者再以强信号出现
+        if (i % 2 == 0) {
+            add_ap(sc, pairs[i][0], -20 - i);
+            add_ap(sc, pairs[i][1], -21 - i);
+            add_ap(sc, pairs[i][0], -50);
+        } else {
+            add_ap(sc, pairs[i][0], -94);
+        }
+    }
+    for (int i = 1; i < pair_count; i += 2) {
+        add_ap(sc, pairs[i][1], -80);
+        add_ap(sc, pairs[i][1], -96);
+        add_ap(sc, pairs[i][0], -31);
+    }
+}
+
+// 超过哈希表槽数的不同SSID，多出的走线性查重
+static void build_table_full(scenario_t *sc)
+{
+    sc->name = "table_full";
+    sc->count = 0;
+    char ssid[SCAN_AGGREGATOR_SSID_LEN + 1];
+    for (int i = 0; i < 300; i++) {
+        snprintf(ssid, sizeof(ssid), "full-%d", i);
+        add_ap(sc, ssid, -95 + rand() % 66);
+    }
+    for (int i = 0; i < 60; i++) {
+        snprintf(ssid, sizeof(ssid), "full-%d", 299 - i);
+        add_ap(sc, ssid, -30);
+    }
+}
+
+static void run_once(const scenario_t *sc)
+{
+    scan_aggregator_reset();
+    for (int i = 0; i < sc->count; i++) {
+        scan_aggregator_add(&sc->aps[i]);
+    }
+}
+
+// 暴力计算每个SSID的最强信号，检查输出是前K强、各自信号正确且按信号排序
+// 哈希表能容纳时unique是准确的不同SSID数，表满后多出的SSID不计入
+static void verify(const scenario_t *sc)
+{
+    static char names[BENCH_MAX_APS][SCAN_AGGREGATOR_SSID_LEN + 1];
+    static int best[BENCH_MAX_APS];
+    int unique = 0;
+    for (int i = 0; i < sc->count; i++) {
+        int j = 0;
+        while (j < unique && strcmp(names[j], sc->aps[i].ssid) != 0) {
+            j++;
+        }
+        if (j == unique) {
+            strcpy(names[unique], sc->aps[i].ssid);
+            best[unique++] = sc->aps[i].rssi;
+        } else if (sc->aps[i].rssi > best[j]) {
+            best[j] = sc->aps[i].rssi;
+        }
+    }
+
+    run_once(sc);
+    scan_ap_t out[SCAN_AGGREGATOR_TOP_K];
+    uint16_t count = scan_aggregator_sorted(out, SCAN_AGGREGATOR_TOP_K);
+    int expected_count = unique < SCAN_AGGREGATOR_TOP_K ? unique : SCAN_AGGREGATOR_TOP_K;
+    CHECK(count == expected_count, "%s: kept %u of %d", sc->name, count, expected_count);
+
+    for (uint16_t i = 0; i < count; i++) {
+        int j = 0;
+        while (j < unique && strcmp(names[j], out[i].ssid) != 0) {
+            j++;
+        }
+        CHECK(j < unique && best[j] == out[i].rssi, "%s: %s reported %d", sc->name, out[i].ssid, out[i].rssi);
+        CHECK(i == 0 || out[i - 1].rssi >= out[i].rssi, "%s: output not sorted at %u", sc->name, i);
+        for (uint16_t k = 0; k < i; k++) {
+            CHECK(strcmp(out[k].ssid, out[i].ssid) != 0, "%s: %s listed twice", sc->name, out[i].ssid);
+        }
+    }
+    // 没有输出的SSID都不比第K名强
+    if (count > 0) {
+        for (int j = 0; j < unique; j++) {
+            if (best[j] <= out[count - 1].rssi) {
+                continue;
+            }
+            bool listed = false;
+            for (uint16_t i = 0; i < count && !listed; i++) {
+                listed = strcmp(out[i].ssid, names[j]) == 0;
+            }
+            CHECK(listed, "%s: %s (%d) missing", sc->name, names[j], best[j]);
+        }
+    }
+
+    scan_aggregator_stats_t stats;
+    scan_aggregator_get_stats(&stats);
+    CHECK(stats.seen == (uint32_t)sc->count, "%s: seen %u", sc->name, (unsigned)stats.seen);
+    uint16_t expected_unique = unique < SCAN_AGGREGATOR_SLOTS ? unique : SCAN_AGGREGATOR_SLOTS;
+    CHECK(stats.unique == expected_unique, "%s: unique %u, expected %u", sc->name, stats.unique, expected_unique);
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench(const scenario_t *sc, int rounds)
+{
+    double start = now_s();
+    for (int r = 0; r < rounds; r++) {
+        run_once(sc);
+    }
+    double seconds = now_s() - start;
+
+    scan_aggregator_stats_t stats;
+    scan_aggregator_get_stats(&stats);
+    printf("%-12s %3d APs %3u SSIDs: %7.1f ns/AP, %6.2f us/scan  evictions %3u  linear %3u\n",
+           sc->name, sc->count, stats.unique, seconds * 1e9 / ((double)rounds * sc->count),
+           seconds * 1e6 / rounds, (unsigned)stats.evictions, (unsigned)stats.table_full);
+}
+
+int main(int argc, char **argv)
+{
+    int rounds = BENCH_DEFAULT_ROUNDS;
+    if (argc > 2 && strcmp(argv[1], "-n") == 0) {
+        rounds = atoi(argv[2]);
+    }
+    srand(36);
+
+    static char pairs[BENCH_COLLISION_PAIRS][2][SCAN_AGGREGATOR_SSID_LEN + 1];
+    int pair_count = find_collisions(pairs, BENCH_COLLISION_PAIRS);
+    CHECK(pair_count == BENCH_COLLISION_PAIRS, "found only %d hash collisions", pair_count);
+
+    static scenario_t scenarios[7];
+    build_dense(&scenarios[0], "dense_100", 100);
+    build_dense(&scenarios[1], "dense_150", 150);
+    build_dense(&scenarios[2], "dense_200", 200);
+    build_ascending(&scenarios[3]);
+    build_evicted(&scenarios[4]);
+    build_collisions(&scenarios[5], pairs, pair_count);
+    build_table_full(&scenarios[6]);
+
+    for (int i = 0; i < 7; i++) {
+        verify(&scenarios[i]);
+    }
+
+    // 冲突的SSID应各占一个槽，不需要线性查重
+    scan_aggregator_stats_t stats;
+    run_once(&scenarios[5]);
+    scan_aggregator_get_stats(&stats);
+    CHECK(stats.table_full == 0, "collisions fell back to linear search %u times", (unsigned)stats.table_full);
+    run_once(&scenarios[6]);
+    scan_aggregator_get_stats(&stats);
+    // 多出的44个SSID首次出现和再次出现都走线性查重
+    CHECK(stats.table_full == 2 * (300 - SCAN_AGGREGATOR_SLOTS), "table_full %u", (unsigned)stats.table_full);
+
+    for (int i = 0; i < 7; i++) {
+        bench(&scenarios[i], rounds);
+    }
+    return TEST_RESULT();
+}
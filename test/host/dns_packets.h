@@ -0,0 +1,123 @@
+#ifndef DNS_PACKETS_H
+#define DNS_PACKETS_H
+
+// 构造测试用的DNS报文
+
+#include "dns_engine.h"
+#include <stdint.h>
+#include <string.h>
+
+static inline size_t put16(uint8_t *p, size_t pos, uint16_t v)
+{
+    p[pos] = (uint8_t)(v >> 8);
+    p[pos + 1] = (uint8_t)v;
+    return pos + 2;
+}
+
+static inline size_t put32(uint8_t *p, size_t pos, uint32_t v)
+{
+    pos = put16(p, pos, (uint16_t)(v >> 16));
+    return put16(p, pos, (uint16_t)v);
+}
+
+static inline uint16_t get16(const uint8_t *p, size_t pos)
+{
+    return (uint16_t)((p[pos] << 8) | p[pos + 1]);
+}
+
+static inline uint32_t get32(const uint8_t *p, size_t pos)
+{
+    return ((uint32_t)get16(p, pos) << 16) | get16(p, pos + 2);
+}
+
+// 点分名称转为标签格式
+static inline size_t put_name(uint8_t *p, size_t pos, const char *name)
+{
+    while (*name != '\0') {
+        const char *dot = strchr(name, '.');
+        size_t n = dot != NULL ? (size_t)(dot - name) : strlen(name);
+        p[pos++] = (uint8_t)n;
+        memcpy(p + pos, name, n);
+        pos += n;
+        name += n;
+        if (*name == '.') {
+            name++;
+        }
+    }
+    p[pos++] = 0;
+    return pos;
+}
+
+// 单问题查询，返回长度
+static inline size_t build_query(uint8_t *p, uint16_t id, const char *name, uint16_t qtype)
+{
+    memset(p, 0, DNS_ENGINE_HEADER_LEN);
+    put16(p, 0, id);
+    put16(p, 2, 0x0100);    // RD
+    put16(p, 4, 1);
+    size_t pos = put_name(p, DNS_ENGINE_HEADER_LEN, name);
+    pos = put16(p, pos, qtype);
+    return put16(p, pos, DNS_CLASS_IN);
+}
+
+// 把查询改写为应答头部，返回问题部分结束位置
+static inline size_t begin_response(uint8_t *p, size_t query_len, uint8_t rcode)
+{
+    put16(p, 2, (uint16_t)(0x8180 | rcode));
+    put16(p, 6, 0);
+    put16(p, 8, 0);
+    put16(p, 10, 0);
+    return query_len;
+}
+
+// 追加指向问题名称的A记录
+static inline size_t add_a(uint8_t *p, size_t pos, uint32_t ttl, const uint8_t ip[4])
+{
+    pos = put16(p, pos, 0xC00C);
+    pos = put16(p, pos, DNS_TYPE_A);
+    pos = put16(p, pos, DNS_CLASS_IN);
+    pos = put32(p, pos, ttl);
+    pos = put16(p, pos, 4);
+    memcpy(p + pos, ip, 4);
+    put16(p, 6, (uint16_t)(get16(p, 6) + 1));
+    return pos + 4;
+}
+
+// 追加授权部分的SOA记录（MNAME和RNAME为根）
+static inline size_t add_soa(uint8_t *p, size_t pos, uint32_t ttl, uint32_t minimum)
+{
+    pos = put16(p, pos, 0xC00C);
+    pos = put16(p, pos, DNS_TYPE_SOA);
+    pos = put16(p, pos, DNS_CLASS_IN);
+    pos = put32(p, pos, ttl);
+    pos = put16(p, pos, 22);
+    p[pos++] = 0;
+    p[pos++] = 0;
+    pos = put32(p, pos, 1);       // serial
+    pos = put32(p, pos, 3600);    // refresh
+    pos = put32(p, pos, 600);     // retry
+    pos = put32(p, pos, 86400);   // expire
+    pos = put32(p, pos, minimum);
+    put16(p, 8, (uint16_t)(get16(p, 8) + 1));
+    return pos;
+}
+
+// 追加附加部分的OPT记录
+static inline size_t add_opt(uint8_t *p, size_t pos, uint16_t payload)
+{
+    p[pos++] = 0;
+    pos = put16(p, pos, DNS_TYPE_OPT);
+    pos = put16(p, pos, payload);
+    pos = put32(p, pos, 0);
+    pos = put16(p, pos, 0);
+    put16(p, 10, (uint16_t)(get16(p, 10) + 1));
+    return pos;
+}
+
+// 应答中第一个回答记录的TTL（问题部分之后，名称为压缩指针）
+static inline uint32_t first_answer_ttl(const uint8_t *p, size_t question_end)
+{
+    return get32(p, question_end + 6);
+}
+
+#endif /* DNS_PACKETS_H */
@@ -0,0 +1,22 @@
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+// 主机测试的断言：失败时打印位置并计数，main返回失败数
+
+#include <stdio.h>
+
+static int s_test_failures = 0;
+
+#define CHECK(cond, ...) do { \
+    if (!(cond)) { \
+        s_test_failures++; \
+        printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+    } \
+} while (0)
+
+#define TEST_RESULT() (printf("%s: %d failures\n", s_test_failures ? "FAILED" : "OK", s_test_failures), \
+                       s_test_failures != 0)
+
+#endif /* HOST_TEST_H */
@@ -0,0 +1,158 @@
+#ifndef PCAP_READER_H
+#define PCAP_READER_H
+
+// 读取pcap抓包中发往指定UDP端口的IPv4报文负载
+// 支持两种字节序和纳秒时间戳格式，链路类型为以太网（含802.1Q）、Linux cooked和裸IP
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PCAP_LINKTYPE_ETHERNET  1
+#define PCAP_LINKTYPE_RAW       101
+#define PCAP_LINKTYPE_LINUX_SLL 113
+#define PCAP_LINKTYPE_IPV4      228
+
+typedef struct {
+    const uint8_t *data;
+    size_t len;
+} pcap_payload_t;
+
+typedef struct {
+    uint8_t *file;              // 整个文件，负载指向其中
+    pcap_payload_t *payloads;
+    size_t count;
+    size_t skipped;             // 不是IPv4 UDP或端口不符的记录
+} pcap_capture_t;
+
+static inline uint32_t pcap_u32(const uint8_t *p, bool swap)
+{
+    return swap ? ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3]
+                : ((uint32_t)p[3] << 24) | ((uint32_t)p[2] << 16) | ((uint32_t)p[1] << 8) | p[0];
+}
+
+static inline uint16_t pcap_be16(const uint8_t *p)
+{
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+// 从链路层帧中取出UDP负载，不符合时返回false
+static inline bool pcap_udp_payload(const uint8_t *frame, size_t len, uint32_t linktype, uint16_t port,
+                                    pcap_payload_t *payload)
+{
+    size_t ip = 0;
+    uint16_t ethertype = 0x0800;
+    switch (linktype) {
+        case PCAP_LINKTYPE_ETHERNET:
+            if (len < 14) {
+                return false;
+            }
+            ethertype = pcap_be16(frame + 12);
+            ip = 14;
+            if (ethertype == 0x8100 && len >= 18) {
+                ethertype = pcap_be16(frame + 16);
+                ip = 18;
+            }
+            break;
+        case PCAP_LINKTYPE_LINUX_SLL:
+            if (len < 16) {
+                return false;
+            }
+            ethertype = pcap_be16(frame + 14);
+            ip = 16;
+            break;
+        case PCAP_LINKTYPE_RAW:
+        case PCAP_LINKTYPE_IPV4:
+            break;
+        default:
+            return false;
+    }
+
+    if (ethertype != 0x0800 || len < ip + 20 || (frame[ip] >> 4) != 4 || frame[ip + 9] != 17) {
+        return false;
+    }
+    // 只取未分片的报文
+    if ((pcap_be16(frame + ip + 6) & 0x3FFF) != 0) {
+        return false;
+    }
+    size_t udp = ip + (size_t)(frame[ip] & 0x0F) * 4;
+    if (len < udp + 8 || pcap_be16(frame + udp + 2) != port) {
+        return false;
+    }
+    size_t udp_len = pcap_be16(frame + udp + 4);
+    if (udp_len < 8 || udp + udp_len > len) {
+        return false;
+    }
+    payload->data = frame + udp + 8;
+    payload->len = udp_len - 8;
+    return true;
+}
+
+static inline void pcap_free(pcap_capture_t *capture)
+{
+    free(capture->file);
+    free(capture->payloads);
+    memset(capture, 0, sizeof(*capture));
+}
+
+// 读取整个文件，失败时打印原因并返回false
+static inline bool pcap_load(const char *path, uint16_t port, pcap_capture_t *capture)
+{
+    memset(capture, 0, sizeof(*capture));
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        perror(path);
+        return false;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    capture->file = malloc(size > 0 ? (size_t)size : 1);
+    size_t len = fread(capture->file, 1, (size_t)size, f);
+    fclose(f);
+
+    if (len < 24) {
+        fprintf(stderr, "%s: 文件太短\n", path);
+        pcap_free(capture);
+        return false;
+    }
+    uint32_t magic = pcap_u32(capture->file, false);
+    bool swap;
+    if (magic == 0xA1B2C3D4 || magic == 0xA1B23C4D) {
+        swap = false;
+    } else if (magic == 0xD4C3B2A1 || magic == 0x4D3CB2A1) {
+        swap = true;
+    } else {
+        fprintf(stderr, "%s: 不是pcap文件（pcapng需先用editcap -F pcap转换）\n", path);
+        pcap_free(capture);
+        return false;
+    }
+    uint32_t linktype = pcap_u32(capture->file + 20, swap) & 0xFFFF;
+
+    size_t capacity = 64;
+    capture->payloads = malloc(capacity * sizeof(pcap_payload_t));
+    size_t pos = 24;
+    while (pos + 16 <= len) {
+        uint32_t caplen = pcap_u32(capture->file + pos + 8, swap);
+        pos += 16;
+        if (caplen > len - pos) {
+            break;
+        }
+        pcap_payload_t payload;
+        if (pcap_udp_payload(capture->file + pos, caplen, linktype, port, &payload)) {
+            if (capture->count == capacity) {
+                capacity *= 2;
+                capture->payloads = realloc(capture->payloads, capacity * sizeof(pcap_payload_t));
+            }
+            capture->payloads[capture->count++] = payload;
+        } else {
+            capture->skipped++;
+        }
+        pos += caplen;
+    }
+    return true;
+}
+
+#endif /* PCAP_READER_H */
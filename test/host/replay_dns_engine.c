@@ -0,0 +1,165 @@
+#include "host_test.h"
+#include "pcap_reader.h"
+#include "dns_engine.h"
+
+// 回放pcap中的DNS查询，按设备上的方式（512字节缓冲区）就地生成应答并检查报文结构
+//   replay_dns_engine [--record FILE | --expect FILE] capture.pcap...
+// --record把每个报文的应答摘要写入FILE，--expect与FILE逐行比较，用于发现行为变化
+
+#define REPLAY_BUFFER_SIZE  512     // 与DNS_MAX_PACKET_SIZE一致，recvfrom会截断更长的报文
+#define REPLAY_TTL          60
+
+static const uint8_t s_portal_ip[4] = { 192, 168, 4, 1 };
+
+static uint16_t be16(const uint8_t *p)
+{
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+// 检查应答结构，返回问题描述，正常返回NULL
+static const char *check_response(const uint8_t *query, size_t query_len, const uint8_t *resp, size_t len,
+                                  const dns_engine_result_t *result)
+{
+    if (len == 0) {
+        return query_len < DNS_ENGINE_HEADER_LEN || (query[2] & 0x80) ? NULL : "valid query dropped";
+    }
+    if (len < DNS_ENGINE_HEADER_LEN || len > REPLAY_BUFFER_SIZE) {
+        return "response length";
+    }
+    if (be16(resp) != be16(query)) {
+        return "response id";
+    }
+    if ((resp[2] & 0x80) == 0) {
+        return "QR not set";
+    }
+    if ((resp[3] & 0x0F) != (result->rcode & 0x0F)) {
+        return "rcode differs from result";
+    }
+    uint16_t qdcount = be16(resp + 4);
+    uint16_t ancount = be16(resp + 6);
+    uint16_t arcount = be16(resp + 10);
+    if (be16(resp + 8) != 0 || ancount != result->answers || arcount != (result->edns && len > 12 ? 1 : 0)) {
+        return "section counts";
+    }
+    if (qdcount == 0) {
+        return len == DNS_ENGINE_HEADER_LEN && ancount == 0 ? NULL : "header-only reply has a body";
+    }
+
+    size_t pos = DNS_ENGINE_HEADER_LEN;
+    for (uint16_t i = 0; i < qdcount; i++) {
+        size_t n = dns_engine_skip_name(resp, len, pos);
+        if (n == 0 || pos + n + 4 > len) {
+            return "question section";
+        }
+        pos += n + 4;
+    }
+    size_t question_end = pos;
+    for (uint16_t i = 0; i < ancount; i++) {
+        if (pos + 16 > len || (resp[pos] & 0xC0) != 0xC0) {
+            return "answer record";
+        }
+        size_t target = ((size_t)(resp[pos] & 0x3F) << 8) | resp[pos + 1];
+        if (target < DNS_ENGINE_HEADER_LEN || target >= question_end || be16(resp + pos + 2) != DNS_TYPE_A ||
+            be16(resp + pos + 10) != 4 || memcmp(resp + pos + 12, s_portal_ip, 4) != 0) {
+            return "answer record";
+        }
+        pos += 16;
+    }
+    if (arcount == 1) {
+        if (pos + 11 != len || resp[pos] != 0 || be16(resp + pos + 1) != DNS_TYPE_OPT) {
+            return "OPT record";
+        }
+        pos += 11;
+    }
+    return pos == len ? NULL : "trailing bytes";
+}
+
+int main(int argc, char **argv)
+{
+    const char *record_path = NULL;
+    const char *expect_path = NULL;
+    int first = 1;
+    while (first + 1 < argc && strncmp(argv[first], "--", 2) == 0) {
+        if (strcmp(argv[first], "--record") == 0) {
+            record_path = argv[first + 1];
+        } else if (strcmp(argv[first], "--expect") == 0) {
+            expect_path = argv[first + 1];
+        } else {
+            break;
+        }
+        first += 2;
+    }
+    if (first >= argc) {
+        fprintf(stderr, "usage: %s [--record FILE | --expect FILE] capture.pcap...\n", argv[0]);
+        return 2;
+    }
+
+    FILE *record = record_path != NULL ? fopen(record_path, "w") : NULL;
+    FILE *expect = expect_path != NULL ? fopen(expect_path, "r") : NULL;
+    if ((record_path != NULL && record == NULL) || (expect_path != NULL && expect == NULL)) {
+        perror(record_path != NULL ? record_path : expect_path);
+        return 2;
+    }
+
+    size_t total = 0, dropped = 0, answered = 0, mismatches = 0;
+    size_t rcodes[32] = { 0 };
+    for (int f = first; f < argc; f++) {
+        pcap_capture_t capture;
+        if (!pcap_load(argv[f], 53, &capture)) {
+            return 2;
+        }
+        for (size_t i = 0; i < capture.count; i++, total++) {
+            const pcap_payload_t *payload = &capture.payloads[i];
+            size_t len = payload->len > REPLAY_BUFFER_SIZE ? REPLAY_BUFFER_SIZE : payload->len;
+            uint8_t packet[REPLAY_BUFFER_SIZE];
+            memcpy(packet, payload->data, len);
+
+            dns_engine_result_t result;
+            size_t resp_len = dns_engine_answer(packet, len, sizeof(packet), s_portal_ip, REPLAY_TTL, &result);
+            const char *problem = check_response(payload->data, len, packet, resp_len, &result);
+            CHECK(problem == NULL, "%s #%zu: %s", argv[f], i, problem);
+
+            char line[128];
+            if (resp_len == 0) {
+                snprintf(line, sizeof(line), "%zu drop\n", total);
+                dropped++;
+            } else {
+                snprintf(line, sizeof(line), "%zu len=%zu rcode=%u q=%u an=%u nodata=%u tc=%d edns=%d\n", total,
+                         resp_len, result.rcode, result.questions, result.answers, result.nodata,
+                         result.truncated, result.edns);
+                answered++;
+                rcodes[result.rcode & 31]++;
+            }
+            if (record != NULL) {
+                fputs(line, record);
+            }
+            if (expect != NULL) {
+                char want[128];
+                if (fgets(want, sizeof(want), expect) == NULL || strcmp(want, line) != 0) {
+                    if (mismatches++ < 10) {
+                        printf("#%zu: expected %s         got %s", total, want, line);
+                    }
+                }
+            }
+        }
+        if (capture.skipped > 0) {
+            printf("%s: skipped %zu non-DNS records\n", argv[f], capture.skipped);
+        }
+        pcap_free(&capture);
+    }
+
+    if (expect != NULL) {
+        char extra[128];
+        CHECK(fgets(extra, sizeof(extra), expect) == NULL, "expected file has more packets than the capture");
+        CHECK(mismatches == 0, "%zu packets differ from %s", mismatches, expect_path);
+        fclose(expect);
+    }
+    if (record != NULL) {
+        fclose(record);
+    }
+
+    printf("%zu packets: %zu answered, %zu dropped; NOERROR %zu, FORMERR %zu, SERVFAIL %zu, NOTIMP %zu, BADVERS %zu\n",
+           total, answered, dropped, rcodes[DNS_RCODE_NOERROR], rcodes[DNS_RCODE_FORMERR],
+           rcodes[DNS_RCODE_SERVFAIL], rcodes[DNS_RCODE_NOTIMP], rcodes[DNS_RCODE_BADVERS]);
+    return TEST_RESULT();
+}
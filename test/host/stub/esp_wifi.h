@@ -0,0 +1,11 @@
+#ifndef HOST_STUB_ESP_WIFI_H
+#define HOST_STUB_ESP_WIFI_H
+
+// 主机测试用的最小esp_wifi.h：只声明wifi_manager.h中出现的类型，测试不使用它们
+
+#include "esp_err.h"
+
+typedef const char *esp_event_base_t;
+typedef struct wifi_ap_record_t wifi_ap_record_t;
+
+#endif /* HOST_STUB_ESP_WIFI_H */
@@ -0,0 +1,296 @@
+#include "host_test.h"
+#include "edge_capture/capture_classifier.h"
+#include <stdlib.h>
+
+// 用合成波形驱动分类器：以100us分辨率模拟LED电平，每250ms（可加抖动）采样一次边沿数和电平，
+// 参数与edge_capture.c一致
+
+#define SIM_RESOLUTION_US   100
+#define SIM_SAMPLE_US       250000
+
+static const capture_led_params_t s_led_params = {
+    .window_ms = 11000,
+    .blink_min_ms = 200,
+    .blink_max_ms = 5000,
+    .blink_min_pulses = 2,
+};
+
+static const capture_activity_params_t s_activity_params = {
+    .window_ms = 2000,
+};
+
+typedef int (*wave_fn_t)(uint32_t t_us);
+
+typedef struct {
+    capture_history_t history;
+    wave_fn_t wave;
+    uint32_t t_us;
+    int level;
+    int jitter_ms;
+} sim_t;
+
+typedef void (*sample_cb_t)(sim_t *sim, uint32_t now_ms);
+
+static void sim_init(sim_t *sim, wave_fn_t wave, int jitter_ms)
+{
+    capture_history_reset(&sim->history);
+    sim->wave = wave;
+    sim->t_us = 0;
+    sim->level = wave(0);
+    sim->jitter_ms = jitter_ms;
+    capture_sample_t sample = { .t_ms = 0, .edges = 0, .active = sim->level };
+    capture_history_push(&sim->history, &sample);
+}
+
+static void sim_run(sim_t *sim, uint32_t until_ms, sample_cb_t cb)
+{
+    while (sim->t_us / 1000 < until_ms) {
+        uint32_t step = SIM_SAMPLE_US;
+        if (sim->jitter_ms > 0) {
+            step += (rand() % (2 * sim->jitter_ms + 1) - sim->jitter_ms) * 1000;
+        }
+        uint32_t end = sim->t_us + step;
+        uint32_t edges = 0;
+        for (uint32_t t = sim->t_us + SIM_RESOLUTION_US; t <= end; t += SIM_RESOLUTION_US) {
+            int level = sim->wave(t);
+            if (level != sim->level) {
+                edges++;
+                sim->level = level;
+            }
+        }
+        sim->t_us = end;
+        capture_sample_t sample = {
+            .t_ms = end / 1000,
+            .edges = edges > UINT16_MAX ? UINT16_MAX : (uint16_t)edges,
+            .active = sim->level,
+        };
+        capture_history_push(&sim->history, &sample);
+        if (cb != NULL) {
+            cb(sim, end / 1000);
+        }
+    }
+}
+
+static capture_led_result_t classify_led(const sim_t *sim)
+{
+    capture_led_result_t result;
+    capture_classify_power_led(&sim->history, &s_led_params, &result);
+    return result;
+}
+
+static capture_activity_result_t classify_activity(const sim_t *sim)
+{
+    capture_activity_result_t result;
+    capture_classify_activity(&sim->history, &s_activity_params, &result);
+    return result;
+}
+
+// 波形，t_us为微秒
+static int wave_on(uint32_t t) { (void)t; return 1; }
+static int wave_off(uint32_t t) { (void)t; return 0; }
+static int wave_blink_1hz(uint32_t t) { return (t / 500000) % 2 == 0; }
+static int wave_blink_2s(uint32_t t) { return (t / 1000000) % 2 == 0; }
+static int wave_flash_4s(uint32_t t) { return t % 4000000 < 200000; }        // 4秒闪一下，亮200ms
+static int wave_flash_4_5s(uint32_t t) { return t % 4500000 < 100000; }
+static int wave_flash_2hz(uint32_t t) { return t % 500000 < 50000; }
+static int wave_pwm(uint32_t t) { return t % 1000 < 300; }                   // 1kHz 30%调光
+static int wave_blink_10hz(uint32_t t) { return (t / 50000) % 2; }
+static int wave_on_then_blink(uint32_t t) { return t < 20000000 ? 1 : wave_blink_1hz(t); }
+static int wave_blink_then_on(uint32_t t) { return t < 20000000 ? wave_blink_1hz(t) : 1; }
+static int wave_on_then_off(uint32_t t) { return t < 20000000; }
+static int wave_hdd_5hz(uint32_t t) { return t % 200000 < 20000; }
+static int wave_hdd_burst(uint32_t t) { return t % 10000000 < 1000000 && t % 100000 < 30000; }   // 每10秒忙1秒
+
+// 窗口填满之后每个采样的分类都应稳定，不能在闪烁的间隙跳到常亮或熄灭
+static capture_power_state_t s_stable_state;
+static uint32_t s_stable_period;
+static int s_unstable;
+
+static void check_stable(sim_t *sim, uint32_t now_ms)
+{
+    if (now_ms < 13000) {
+        return;
+    }
+    capture_led_result_t result = classify_led(sim);
+    uint32_t tolerance = s_stable_period / 8 + 250;
+    bool period_ok = s_stable_period == 0 ||
+                     (result.blink_period_ms + tolerance >= s_stable_period &&
+                      result.blink_period_ms <= s_stable_period + tolerance);
+    if (result.state != s_stable_state || !period_ok) {
+        if (s_unstable++ < 3) {
+            printf("  unstable at %u ms: %s %u\n", (unsigned)now_ms, capture_power_state_name(result.state),
+                   (unsigned)result.blink_period_ms);
+        }
+    }
+}
+
+static void expect_stable(wave_fn_t wave, capture_power_state_t state, uint32_t period_ms)
+{
+    for (int jitter = 0; jitter <= 30; jitter += 30) {
+        sim_t sim;
+        s_stable_state = state;
+        s_stable_period = period_ms;
+        s_unstable = 0;
+        sim_init(&sim, wave, jitter);
+        sim_run(&sim, 60000, check_stable);
+        CHECK(s_unstable == 0, "%s period %u jitter %d: %d unstable samples",
+              capture_power_state_name(state), (unsigned)period_ms, jitter, s_unstable);
+    }
+}
+
+// 波形在20秒处切换，记录第一次得到目标状态的时间
+static capture_power_state_t s_wanted_state;
+static uint32_t s_first_ms;
+
+static void record_first(sim_t *sim, uint32_t now_ms)
+{
+    if (s_first_ms == 0 && classify_led(sim).state == s_wanted_state) {
+        s_first_ms = now_ms;
+    }
+}
+
+static uint32_t switch_latency(wave_fn_t wave, capture_power_state_t state, sim_t *sim)
+{
+    sim_init(sim, wave, 0);
+    sim_run(sim, 20000, NULL);
+    s_wanted_state = state;
+    s_first_ms = 0;
+    sim_run(sim, 40000, record_first);
+    return s_first_ms == 0 ? UINT32_MAX : s_first_ms - 20000;
+}
+
+static void test_power_led(void)
+{
+    sim_t sim;
+    capture_led_result_t result;
+
+    // 常亮要等窗口填满才能和慢速闪烁区分
+    sim_init(&sim, wave_on, 0);
+    sim_run(&sim, 4000, NULL);
+    result = classify_led(&sim);
+    CHECK(result.state == CAPTURE_POWER_UNKNOWN, "steady on before window: %s", capture_power_state_name(result.state));
+    sim_run(&sim, 20000, NULL);
+    result = classify_led(&sim);
+    CHECK(result.state == CAPTURE_POWER_ON, "steady on: %s", capture_power_state_name(result.state));
+
+    sim_init(&sim, wave_off, 0);
+    sim_run(&sim, 20000, NULL);
+    result = classify_led(&sim);
+    CHECK(result.state == CAPTURE_POWER_OFF, "steady off: %s", capture_power_state_name(result.state));
+
+    sim_init(&sim, wave_blink_1hz, 0);
+    sim_run(&sim, 20000, NULL);
+    result = classify_led(&sim);
+    CHECK(result.state == CAPTURE_POWER_SLEEP && result.blink_period_ms > 900 && result.blink_period_ms < 1100,
+          "1Hz blink: %s %u", capture_power_state_name(result.state), (unsigned)result.blink_period_ms);
+
+    // 看到两次点亮就能判断闪烁，不用等窗口填满
+    sim_init(&sim, wave_blink_1hz, 0);
+    sim_run(&sim, 2000, NULL);
+    result = classify_led(&sim);
+    CHECK(result.state == CAPTURE_POWER_SLEEP, "1Hz blink early: %s", capture_power_state_name(result.state));
+
+    expect_stable(wave_flash_4s, CAPTURE_POWER_SLEEP, 4000);
+    expect_stable(wave_flash_4_5s, CAPTURE_POWER_SLEEP, 4500);
+    expect_stable(wave_blink_2s, CAPTURE_POWER_SLEEP, 2000);
+    expect_stable(wave_blink_1hz, CAPTURE_POWER_SLEEP, 1000);
+    expect_stable(wave_flash_2hz, CAPTURE_POWER_SLEEP, 500);
+    expect_stable(wave_on, CAPTURE_POWER_ON, 0);
+    expect_stable(wave_off, CAPTURE_POWER_OFF, 0);
+    expect_stable(wave_pwm, CAPTURE_POWER_ON, 0);
+
+    // 比最短闪烁周期还快的翻转按常亮处理
+    sim_init(&sim, wave_blink_10hz, 0);
+    sim_run(&sim, 10000, NULL);
+    result = classify_led(&sim);
+    CHECK(result.state == CAPTURE_POWER_ON, "10Hz: %s", capture_power_state_name(result.state));
+
+    uint32_t latency = switch_latency(wave_on_then_blink, CAPTURE_POWER_SLEEP, &sim);
+    CHECK(latency <= 3000, "on->sleep latency %u ms", (unsigned)latency);
+    result = classify_led(&sim);
+    CHECK(result.blink_period_ms > 900 && result.blink_period_ms < 1100, "on->sleep period %u",
+          (unsigned)result.blink_period_ms);
+
+    latency = switch_latency(wave_blink_then_on, CAPTURE_POWER_ON, &sim);
+    CHECK(latency <= 5500, "sleep->on latency %u ms", (unsigned)latency);
+
+    latency = switch_latency(wave_on_then_off, CAPTURE_POWER_OFF, &sim);
+    CHECK(latency <= 250, "on->off latency %u ms", (unsigned)latency);
+
+    // 采样定时器抖动
+    srand(1);
+    sim_init(&sim, wave_blink_1hz, 40);
+    sim_run(&sim, 30000, NULL);
+    result = classify_led(&sim);
+    CHECK(result.state == CAPTURE_POWER_SLEEP && result.blink_period_ms > 850 && result.blink_period_ms < 1150,
+          "1Hz with jitter: %s %u", capture_power_state_name(result.state), (unsigned)result.blink_period_ms);
+    sim_init(&sim, wave_on, 40);
+    sim_run(&sim, 30000, NULL);
+    result = classify_led(&sim);
+    CHECK(result.state == CAPTURE_POWER_ON, "on with jitter: %s", capture_power_state_name(result.state));
+}
+
+static void test_activity_led(void)
+{
+    sim_t sim;
+    capture_activity_result_t result;
+
+    sim_init(&sim, wave_off, 0);
+    sim_run(&sim, 5000, NULL);
+    result = classify_activity(&sim);
+    CHECK(result.pulses_per_min == 0 && result.busy_percent == 0, "idle: %u %u",
+          (unsigned)result.pulses_per_min, result.busy_percent);
+
+    sim_init(&sim, wave_hdd_5hz, 0);
+    sim_run(&sim, 5000, NULL);
+    result = classify_activity(&sim);
+    CHECK(result.pulses_per_min >= 285 && result.pulses_per_min <= 315 && result.busy_percent == 100,
+          "5Hz: %u %u", (unsigned)result.pulses_per_min, result.busy_percent);
+
+    // 常亮没有脉冲但一直在忙
+    sim_init(&sim, wave_on, 0);
+    sim_run(&sim, 5000, NULL);
+    result = classify_activity(&sim);
+    CHECK(result.pulses_per_min == 0 && result.busy_percent == 100, "solid: %u %u",
+          (unsigned)result.pulses_per_min, result.busy_percent);
+
+    sim_init(&sim, wave_hdd_burst, 0);
+    sim_run(&sim, 9000, NULL);
+    result = classify_activity(&sim);
+    CHECK(result.pulses_per_min == 0 && result.busy_percent == 0, "after burst: %u %u",
+          (unsigned)result.pulses_per_min, result.busy_percent);
+
+    sim_init(&sim, wave_hdd_burst, 0);
+    sim_run(&sim, 11000, NULL);
+    result = classify_activity(&sim);
+    CHECK(result.pulses_per_min >= 200 && result.busy_percent > 0 && result.busy_percent < 100,
+          "in burst: %u %u", (unsigned)result.pulses_per_min, result.busy_percent);
+}
+
+static void test_empty_history(void)
+{
+    capture_history_t history;
+    capture_history_reset(&history);
+
+    capture_led_result_t led;
+    capture_classify_power_led(&history, &s_led_params, &led);
+    CHECK(led.state == CAPTURE_POWER_UNKNOWN && led.blink_period_ms == 0, "empty led");
+
+    capture_activity_result_t activity;
+    capture_classify_activity(&history, &s_activity_params, &activity);
+    CHECK(activity.pulses_per_min == 0 && activity.busy_percent == 0, "empty activity");
+
+    // 只有一个采样时没有间隔可以统计
+    capture_sample_t sample = { .t_ms = 0, .edges = 5, .active = true };
+    capture_history_push(&history, &sample);
+    capture_classify_power_led(&history, &s_led_params, &led);
+    CHECK(led.state == CAPTURE_POWER_UNKNOWN, "single sample led");
+}
+
+int main(void)
+{
+    test_power_led();
+    test_activity_led();
+    test_empty_history();
+    return TEST_RESULT();
+}
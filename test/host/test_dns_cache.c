@@ -0,0 +1,212 @@
+#include "host_test.h"
+#include "dns_packets.h"
+#include "dns_cache.h"
+
+static const uint8_t s_ip[4] = { 93, 184, 216, 34 };
+
+// 缓存一个A应答，返回问题部分结束位置
+static size_t store_a(const char *name, uint16_t qtype, uint32_t ttl, uint32_t now_s)
+{
+    uint8_t packet[512];
+    size_t len = build_query(packet, 0x1111, name, qtype);
+    size_t question_end = begin_response(packet, len, DNS_RCODE_NOERROR);
+    len = add_a(packet, question_end, ttl, s_ip);
+    CHECK(dns_cache_store(packet, len, now_s), "store %s", name);
+    return question_end;
+}
+
+static size_t lookup(uint8_t *out, uint16_t id, const char *name, uint16_t qtype, uint32_t now_s)
+{
+    uint8_t query[512];
+    size_t len = build_query(query, id, name, qtype);
+    return dns_cache_lookup(query, len, out, 512, now_s);
+}
+
+static void test_positive(void)
+{
+    dns_cache_flush();
+    size_t question_end = store_a("example.com", DNS_TYPE_A, 60, 1000);
+
+    uint8_t out[512];
+    size_t len = lookup(out, 0xABCD, "example.com", DNS_TYPE_A, 1010);
+    CHECK(len > 0, "positive miss");
+    CHECK(get16(out, 0) == 0xABCD, "reply id %04x", get16(out, 0));
+    CHECK(get16(out, 6) == 1, "ancount %u", get16(out, 6));
+    CHECK(memcmp(out + question_end + 12, s_ip, 4) == 0, "answer address");
+
+    // TTL按已缓存时间递减，到期后不再命中
+    CHECK(first_answer_ttl(out, question_end) == 50, "aged ttl %u", first_answer_ttl(out, question_end));
+    len = lookup(out, 1, "example.com", DNS_TYPE_A, 1059);
+    CHECK(len > 0 && first_answer_ttl(out, question_end) == 1, "ttl at 59s");
+    CHECK(lookup(out, 1, "example.com", DNS_TYPE_A, 1060) == 0, "hit after expiry");
+
+    // 正向TTL上限
+    dns_cache_flush();
+    store_a("long.example", DNS_TYPE_A, 86400, 0);
+    CHECK(lookup(out, 1, "long.example", DNS_TYPE_A, 3599) > 0, "capped ttl expired early");
+    CHECK(lookup(out, 1, "long.example", DNS_TYPE_A, 3600) == 0, "ttl not capped");
+}
+
+static void test_negative(void)
+{
+    dns_cache_flush();
+    dns_cache_stats_t before, after;
+    dns_cache_get_stats(&before, 0);
+
+    // NXDOMAIN的TTL取SOA的TTL和MINIMUM中较小者
+    uint8_t packet[512];
+    size_t len = build_query(packet, 1, "nx.example", DNS_TYPE_A);
+    size_t pos = begin_response(packet, len, DNS_RCODE_NXDOMAIN);
+    pos = add_soa(packet, pos, 120, 45);
+    CHECK(dns_cache_store(packet, pos, 100), "store nxdomain");
+
+    uint8_t out[512];
+    len = lookup(out, 7, "nx.example", DNS_TYPE_A, 144);
+    CHECK(len > 0 && (get16(out, 2) & 0x000F) == DNS_RCODE_NXDOMAIN, "nxdomain miss");
+    // SOA记录共34字节，TTL位于记录第6字节
+    CHECK(get16(out, 8) == 1 && get32(out, len - 28) == 76, "soa ttl not aged: %u", get32(out, len - 28));
+    CHECK(lookup(out, 7, "nx.example", DNS_TYPE_A, 145) == 0, "nxdomain outlived soa minimum");
+
+    // 没有SOA的NODATA使用默认的否定TTL（30秒）
+    len = build_query(packet, 1, "v4only.example", DNS_TYPE_AAAA);
+    pos = begin_response(packet, len, DNS_RCODE_NOERROR);
+    CHECK(dns_cache_store(packet, pos, 100), "store nodata");
+    CHECK(lookup(out, 8, "v4only.example", DNS_TYPE_AAAA, 129) > 0, "nodata miss");
+    CHECK(lookup(out, 8, "v4only.example", DNS_TYPE_AAAA, 130) == 0, "nodata outlived default ttl");
+
+    // 否定TTL上限
+    len = build_query(packet, 1, "nx2.example", DNS_TYPE_A);
+    pos = begin_response(packet, len, DNS_RCODE_NXDOMAIN);
+    pos = add_soa(packet, pos, 86400, 86400);
+    CHECK(dns_cache_store(packet, pos, 0), "store long nxdomain");
+    CHECK(lookup(out, 9, "nx2.example", DNS_TYPE_A, 300) == 0, "negative ttl not capped");
+
+    dns_cache_get_stats(&after, 0);
+    CHECK(after.negative_hits - before.negative_hits == 2, "negative hits %u",
+          (unsigned)(after.negative_hits - before.negative_hits));
+}
+
+static void test_qtype_separation(void)
+{
+    dns_cache_flush();
+    store_a("example.com", DNS_TYPE_A, 60, 0);
+
+    uint8_t out[512];
+    CHECK(lookup(out, 1, "example.com", DNS_TYPE_AAAA, 1) == 0, "AAAA answered from A entry");
+    CHECK(lookup(out, 1, "example.com", DNS_TYPE_A, 1) > 0, "A miss");
+
+    // 类型值只差大小写位（0x41/0x61）也不能混用
+    store_a("svc.example", DNS_TYPE_HTTPS, 60, 0);
+    CHECK(lookup(out, 1, "svc.example", 0x0061, 1) == 0, "type 0x61 answered from 0x41 entry");
+    CHECK(lookup(out, 1, "svc.example", DNS_TYPE_HTTPS, 1) > 0, "HTTPS miss");
+
+    // 同名不同类型各占一个条目
+    store_a("svc.example", 0x0061, 30, 0);
+    CHECK(lookup(out, 1, "svc.example", DNS_TYPE_HTTPS, 40) > 0, "HTTPS entry overwritten");
+    CHECK(lookup(out, 1, "svc.example", 0x0061, 40) == 0, "type 0x61 ttl");
+}
+
+static void test_case_preserved(void)
+{
+    dns_cache_flush();
+    store_a("ExAmPle.com", DNS_TYPE_A, 60, 0);
+
+    // 名称不区分大小写命中，应答的问题部分是客户端的写法（DNS 0x20）
+    uint8_t query[512];
+    size_t query_len = build_query(query, 0x2020, "eXaMPLE.CoM", DNS_TYPE_A);
+    uint8_t out[512];
+    size_t len = dns_cache_lookup(query, query_len, out, sizeof(out), 1);
+    CHECK(len > 0, "case-insensitive miss");
+    CHECK(memcmp(out + DNS_ENGINE_HEADER_LEN, query + DNS_ENGINE_HEADER_LEN,
+                 query_len - DNS_ENGINE_HEADER_LEN) == 0, "question case not preserved");
+
+    // 就地应答
+    uint8_t packet[512];
+    memcpy(packet, query, query_len);
+    len = dns_cache_lookup(packet, query_len, packet, sizeof(packet), 1);
+    CHECK(len > 0 && memcmp(packet, out, len) == 0, "in-place lookup differs");
+}
+
+static void test_uncacheable(void)
+{
+    dns_cache_flush();
+    dns_cache_stats_t before, after;
+    dns_cache_get_stats(&before, 0);
+
+    uint8_t packet[512];
+    uint8_t out[512];
+    size_t len = build_query(packet, 1, "zero.example", DNS_TYPE_A);
+    size_t pos = add_a(packet, begin_response(packet, len, DNS_RCODE_NOERROR), 0, s_ip);
+    CHECK(!dns_cache_store(packet, pos, 0), "ttl 0 cached");
+
+    len = build_query(packet, 1, "fail.example", DNS_TYPE_A);
+    pos = begin_response(packet, len, DNS_RCODE_SERVFAIL);
+    CHECK(!dns_cache_store(packet, pos, 0), "servfail cached");
+
+    len = build_query(packet, 1, "tc.example", DNS_TYPE_A);
+    pos = add_a(packet, begin_response(packet, len, DNS_RCODE_NOERROR), 60, s_ip);
+    packet[2] |= 0x02;
+    CHECK(!dns_cache_store(packet, pos, 0), "truncated response cached");
+
+    // 查询本身不能写入缓存
+    len = build_query(packet, 1, "query.example", DNS_TYPE_A);
+    CHECK(!dns_cache_store(packet, len, 0), "query cached");
+
+    dns_cache_get_stats(&after, 0);
+    CHECK(after.uncacheable - before.uncacheable == 4, "uncacheable %u",
+          (unsigned)(after.uncacheable - before.uncacheable));
+    CHECK(lookup(out, 1, "zero.example", DNS_TYPE_A, 0) == 0, "ttl 0 hit");
+
+    // 附加部分（OPT）不缓存
+    len = build_query(packet, 1, "edns.example", DNS_TYPE_A);
+    pos = add_a(packet, begin_response(packet, len, DNS_RCODE_NOERROR), 60, s_ip);
+    size_t without_opt = pos;
+    pos = add_opt(packet, pos, 1232);
+    CHECK(dns_cache_store(packet, pos, 0), "store with opt");
+    size_t hit = lookup(out, 1, "edns.example", DNS_TYPE_A, 0);
+    CHECK(hit == without_opt && get16(out, 10) == 0, "additional section kept: len %zu arcount %u",
+          hit, get16(out, 10));
+}
+
+static void test_eviction(void)
+{
+    dns_cache_flush();
+    dns_cache_stats_t before, after;
+    dns_cache_get_stats(&before, 0);
+
+    char name[32];
+    for (int i = 0; i < 16; i++) {
+        snprintf(name, sizeof(name), "host%d.example", i);
+        store_a(name, DNS_TYPE_A, 600, 0);
+    }
+    dns_cache_get_stats(&after, 1);
+    CHECK(after.entries == 16, "entries %u", after.entries);
+
+    // 访问host0使host1成为最久未使用的条目
+    uint8_t out[512];
+    CHECK(lookup(out, 1, "host0.example", DNS_TYPE_A, 1) > 0, "host0 miss");
+    store_a("host16.example", DNS_TYPE_A, 600, 1);
+    CHECK(lookup(out, 1, "host0.example", DNS_TYPE_A, 2) > 0, "recently used entry evicted");
+    CHECK(lookup(out, 1, "host1.example", DNS_TYPE_A, 2) == 0, "LRU entry kept");
+    CHECK(lookup(out, 1, "host16.example", DNS_TYPE_A, 2) > 0, "new entry miss");
+
+    // 过期条目优先复用，不计为淘汰
+    store_a("short.example", DNS_TYPE_A, 5, 2);
+    store_a("host17.example", DNS_TYPE_A, 600, 100);
+    CHECK(lookup(out, 1, "host3.example", DNS_TYPE_A, 100) > 0, "live entry evicted instead of expired");
+
+    dns_cache_get_stats(&after, 100);
+    CHECK(after.evictions - before.evictions == 2, "evictions %u",
+          (unsigned)(after.evictions - before.evictions));
+}
+
+int main(void)
+{
+    test_positive();
+    test_negative();
+    test_qtype_separation();
+    test_case_preserved();
+    test_uncacheable();
+    test_eviction();
+    return TEST_RESULT();
+}
@@ -0,0 +1,289 @@
+#include "host_test.h"
+#include "dns_packets.h"
+#include "dns_cache.h"
+#include "dns_forward.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// 转发器对着本机回环地址上的桩解析器运行：
+// 客户端 -> relay_fd(转发器) -> upstream_fd -> stub_fd(桩解析器) -> upstream_fd -> relay_fd -> 客户端
+// 与wifi_manager.c中DNS任务的处理顺序一致：先查缓存，未命中登记待应答表后转发；时间由测试控制
+
+#define FORWARD_TIMEOUT_MS  3000
+
+static int s_relay_fd;
+static int s_upstream_fd;
+static int s_stub_fd;
+static struct sockaddr_in s_relay_addr;
+static struct sockaddr_in s_stub_addr;
+static int64_t s_now_us = 1000000;
+static uint16_t s_next_upstream_id = 0xBEE0;
+
+static int open_udp(struct sockaddr_in *bound)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+    socklen_t addr_len = sizeof(addr);
+    getsockname(fd, (struct sockaddr *)&addr, &addr_len);
+    if (bound != NULL) {
+        *bound = addr;
+    }
+    struct timeval timeout = { .tv_sec = 1 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return fd;
+}
+
+// 不等待的接收，没有数据返回0
+static ssize_t recv_now(int fd, uint8_t *buf, size_t size, struct sockaddr_in *from)
+{
+    socklen_t addr_len = sizeof(*from);
+    ssize_t n = recvfrom(fd, buf, size, MSG_DONTWAIT, (struct sockaddr *)from, &addr_len);
+    return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : n;
+}
+
+static ssize_t recv_wait(int fd, uint8_t *buf, size_t size, struct sockaddr_in *from)
+{
+    socklen_t addr_len = sizeof(*from);
+    return recvfrom(fd, buf, size, 0, (struct sockaddr *)from, &addr_len);
+}
+
+// 转发器处理一个客户端查询，返回是否转发到了上游
+static bool relay_query(dns_forward_status_t *status)
+{
+    uint8_t packet[512];
+    struct sockaddr_in from;
+    ssize_t len = recv_wait(s_relay_fd, packet, sizeof(packet), &from);
+    CHECK(len > 0, "relay did not receive query");
+    if (len <= 0) {
+        return false;
+    }
+
+    size_t cached = dns_cache_lookup(packet, (size_t)len, packet, sizeof(packet), (uint32_t)(s_now_us / 1000000));
+    if (cached > 0) {
+        sendto(s_relay_fd, packet, cached, 0, (struct sockaddr *)&from, sizeof(from));
+        *status = DNS_FORWARD_OK;
+        return false;
+    }
+
+    dns_forward_client_t client = { .addr = from.sin_addr.s_addr, .port = from.sin_port };
+    uint16_t upstream_id = s_next_upstream_id++;
+    *status = dns_forward_begin(packet, (size_t)len, &client, upstream_id, s_now_us);
+    if (*status != DNS_FORWARD_OK) {
+        return false;
+    }
+    if (sendto(s_upstream_fd, packet, (size_t)len, 0, (struct sockaddr *)&s_stub_addr, sizeof(s_stub_addr)) < 0) {
+        dns_forward_cancel(upstream_id);
+        return false;
+    }
+    return true;
+}
+
+// 转发器处理一个上游应答
+static bool relay_response(void)
+{
+    uint8_t packet[512];
+    struct sockaddr_in from;
+    ssize_t len = recv_wait(s_upstream_fd, packet, sizeof(packet), &from);
+    CHECK(len > 0, "relay did not receive upstream response");
+    if (len <= 0) {
+        return false;
+    }
+
+    dns_forward_client_t client;
+    uint32_t rtt_us;
+    if (!dns_forward_complete(packet, (size_t)len, &client, &rtt_us, s_now_us)) {
+        return false;
+    }
+    struct sockaddr_in to = { .sin_family = AF_INET, .sin_addr.s_addr = client.addr, .sin_port = client.port };
+    sendto(s_relay_fd, packet, (size_t)len, 0, (struct sockaddr *)&to, sizeof(to));
+    return true;
+}
+
+// 桩解析器：收到一个查询，返回其ID；nx开头的名称回答NXDOMAIN，其余回答A记录（TTL 60）
+static uint16_t stub_receive(uint8_t *packet, size_t *len, struct sockaddr_in *from)
+{
+    ssize_t n = recv_wait(s_stub_fd, packet, 512, from);
+    CHECK(n > 0, "stub did not receive query");
+    *len = n > 0 ? (size_t)n : 0;
+    return n > 0 ? get16(packet, 0) : 0;
+}
+
+static void stub_answer(uint8_t *packet, size_t len, const struct sockaddr_in *to)
+{
+    static const uint8_t ip[4] = { 10, 0, 0, 1 };
+    size_t pos;
+    if (packet[DNS_ENGINE_HEADER_LEN + 1] == 'n' && packet[DNS_ENGINE_HEADER_LEN + 2] == 'x') {
+        pos = add_soa(packet, begin_response(packet, len, DNS_RCODE_NXDOMAIN), 300, 60);
+    } else {
+        pos = add_a(packet, begin_response(packet, len, DNS_RCODE_NOERROR), 60, ip);
+    }
+    sendto(s_stub_fd, packet, pos, 0, (const struct sockaddr *)to, sizeof(*to));
+}
+
+static void client_send(int fd, uint16_t id, const char *name)
+{
+    uint8_t packet[512];
+    size_t len = build_query(packet, id, name, DNS_TYPE_A);
+    sendto(fd, packet, len, 0, (struct sockaddr *)&s_relay_addr, sizeof(s_relay_addr));
+}
+
+static ssize_t client_receive(int fd, uint8_t *packet)
+{
+    struct sockaddr_in from;
+    ssize_t len = recv_wait(fd, packet, 512, &from);
+    CHECK(len > 0, "client did not receive response");
+    return len;
+}
+
+static void test_forward_and_cache(void)
+{
+    int client_fd = open_udp(NULL);
+    uint8_t packet[512];
+    size_t len;
+    struct sockaddr_in from;
+    dns_forward_status_t status;
+
+    // 未命中：以新ID转发，应答还原客户端ID
+    client_send(client_fd, 0x1234, "example.com");
+    CHECK(relay_query(&status), "first query not forwarded");
+    uint16_t upstream_id = stub_receive(packet, &len, &from);
+    CHECK(upstream_id != 0x1234, "client id leaked upstream");
+    s_now_us += 20000;
+    stub_answer(packet, len, &from);
+    CHECK(relay_response(), "response not matched");
+    ssize_t n = client_receive(client_fd, packet);
+    CHECK(n > 0 && get16(packet, 0) == 0x1234 && get16(packet, 6) == 1, "forwarded response id %04x", get16(packet, 0));
+
+    // 相同问题10秒后从缓存应答，上游收不到查询
+    s_now_us += 10 * 1000000LL;
+    client_send(client_fd, 0x5678, "EXAMPLE.com");
+    CHECK(!relay_query(&status) && status == DNS_FORWARD_OK, "cached query forwarded");
+    CHECK(recv_now(s_stub_fd, packet, sizeof(packet), &from) == 0, "stub saw a cached query");
+    n = client_receive(client_fd, packet);
+    size_t question_end = DNS_ENGINE_HEADER_LEN + 13 + 4;
+    CHECK(n > 0 && get16(packet, 0) == 0x5678, "cached response id %04x", get16(packet, 0));
+    CHECK(packet[DNS_ENGINE_HEADER_LEN + 1] == 'E', "cached response lost client case");
+    CHECK(first_answer_ttl(packet, question_end) == 50, "cached ttl %u", first_answer_ttl(packet, question_end));
+
+    // TTL到期后重新转发
+    s_now_us += 60 * 1000000LL;
+    client_send(client_fd, 0x9ABC, "example.com");
+    CHECK(relay_query(&status), "expired entry not forwarded");
+    stub_receive(packet, &len, &from);
+    stub_answer(packet, len, &from);
+    CHECK(relay_response(), "refresh not matched");
+    client_receive(client_fd, packet);
+
+    // 否定应答同样缓存
+    client_send(client_fd, 0x0042, "nx.example");
+    CHECK(relay_query(&status), "nxdomain not forwarded");
+    stub_receive(packet, &len, &from);
+    stub_answer(packet, len, &from);
+    CHECK(relay_response(), "nxdomain not matched");
+    n = client_receive(client_fd, packet);
+    CHECK(n > 0 && (packet[3] & 0x0F) == DNS_RCODE_NXDOMAIN, "nxdomain rcode");
+    client_send(client_fd, 0x0043, "nx.example");
+    CHECK(!relay_query(&status), "negative answer not cached");
+    n = client_receive(client_fd, packet);
+    CHECK(n > 0 && get16(packet, 0) == 0x0043 && (packet[3] & 0x0F) == DNS_RCODE_NXDOMAIN, "cached nxdomain");
+
+    close(client_fd);
+}
+
+// 两个客户端用相同的ID查询，上游乱序应答，各自收到自己的结果
+static void test_interleaved_clients(void)
+{
+    int client_a = open_udp(NULL);
+    int client_b = open_udp(NULL);
+    uint8_t query_a[512], query_b[512], packet[512];
+    size_t len_a, len_b;
+    struct sockaddr_in from_a, from_b;
+    dns_forward_status_t status;
+
+    client_send(client_a, 0x0001, "a.example");
+    relay_query(&status);
+    client_send(client_b, 0x0001, "nxb.example");
+    relay_query(&status);
+    uint16_t id_a = stub_receive(query_a, &len_a, &from_a);
+    uint16_t id_b = stub_receive(query_b, &len_b, &from_b);
+    CHECK(id_a != id_b, "same upstream id for both clients");
+
+    stub_answer(query_b, len_b, &from_b);
+    stub_answer(query_a, len_a, &from_a);
+    relay_response();
+    relay_response();
+
+    ssize_t n = client_receive(client_a, packet);
+    CHECK(n > 0 && get16(packet, 0) == 0x0001 && (packet[3] & 0x0F) == DNS_RCODE_NOERROR &&
+          packet[DNS_ENGINE_HEADER_LEN + 1] == 'a', "client a got the wrong response");
+    n = client_receive(client_b, packet);
+    CHECK(n > 0 && get16(packet, 0) == 0x0001 && (packet[3] & 0x0F) == DNS_RCODE_NXDOMAIN, "client b got the wrong response");
+
+    close(client_a);
+    close(client_b);
+}
+
+// 待应答表满、超时和伪造应答
+static void test_pending_limits(void)
+{
+    dns_forward_reset();
+    int client_fd = open_udp(NULL);
+    uint8_t packet[512];
+    size_t len;
+    struct sockaddr_in from;
+    dns_forward_status_t status;
+    char name[32];
+
+    for (int i = 0; i < DNS_FORWARD_MAX_PENDING; i++) {
+        snprintf(name, sizeof(name), "slow%d.example", i);
+        client_send(client_fd, (uint16_t)i, name);
+        CHECK(relay_query(&status), "query %d not forwarded", i);
+        stub_receive(packet, &len, &from);
+    }
+    client_send(client_fd, 0x00FF, "overflow.example");
+    CHECK(!relay_query(&status) && status == DNS_FORWARD_FULL, "full table accepted a query");
+
+    // 未知ID的应答不会转给任何客户端
+    len = build_query(packet, 0x7777, "slow0.example", DNS_TYPE_A);
+    dns_forward_client_t client;
+    uint32_t rtt_us;
+    CHECK(!dns_forward_complete(packet, len, &client, &rtt_us, s_now_us), "spoofed id matched");
+
+    CHECK(dns_forward_expire(s_now_us + FORWARD_TIMEOUT_MS * 1000LL, FORWARD_TIMEOUT_MS) == 0, "expired at timeout");
+    CHECK(dns_forward_expire(s_now_us + FORWARD_TIMEOUT_MS * 1000LL + 1, FORWARD_TIMEOUT_MS) == DNS_FORWARD_MAX_PENDING,
+          "pending queries not expired");
+
+    client_send(client_fd, 0x0100, "after.example");
+    CHECK(relay_query(&status), "table not freed by expiry");
+    stub_receive(packet, &len, &from);
+    stub_answer(packet, len, &from);
+    CHECK(relay_response(), "response after expiry not matched");
+    CHECK(client_receive(client_fd, packet) > 0 && get16(packet, 0) == 0x0100, "response after expiry");
+
+    close(client_fd);
+}
+
+int main(void)
+{
+    s_relay_fd = open_udp(&s_relay_addr);
+    s_upstream_fd = open_udp(NULL);
+    s_stub_fd = open_udp(&s_stub_addr);
+    dns_cache_flush();
+    dns_forward_reset();
+
+    test_forward_and_cache();
+    test_interleaved_clients();
+    test_pending_limits();
+
+    close(s_relay_fd);
+    close(s_upstream_fd);
+    close(s_stub_fd);
+    return TEST_RESULT();
+}
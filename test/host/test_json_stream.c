@@ -0,0 +1,97 @@
+#include "host_test.h"
+#include "json_stream.h"
+#include <string.h>
+
+// 收集所有flush的输出，可以设置在第几次flush时失败
+typedef struct {
+    char data[4096];
+    size_t len;
+    int flushes;
+    int fail_at;
+} sink_t;
+
+static esp_err_t sink_flush(void *ctx, const char *data, size_t len)
+{
+    sink_t *sink = ctx;
+    sink->flushes++;
+    if (sink->fail_at > 0 && sink->flushes == sink->fail_at) {
+        return ESP_FAIL;
+    }
+    memcpy(sink->data + sink->len, data, len);
+    sink->len += len;
+    sink->data[sink->len] = '\0';
+    return ESP_OK;
+}
+
+static void sink_init(sink_t *sink, json_stream_t *js)
+{
+    memset(sink, 0, sizeof(*sink));
+    json_stream_init(js, sink_flush, sink);
+}
+
+int main(void)
+{
+    sink_t sink;
+    json_stream_t js;
+
+    // 超过64字节的单次输出不能被截断
+    sink_init(&sink, &js);
+    json_stream_printf(&js, "{\"success\":true,\"policy\":{\"idle_mode\":\"%s\",\"busy_mode\":\"%s\","
+                       "\"listen_interval\":%d,\"boost_ms\":%lu}}",
+                       "min_modem", "none", 3, 4294967295UL);
+    CHECK(json_stream_flush(&js) == ESP_OK, "long printf failed");
+    CHECK(strcmp(sink.data, "{\"success\":true,\"policy\":{\"idle_mode\":\"min_modem\",\"busy_mode\":\"none\","
+                 "\"listen_interval\":3,\"boost_ms\":4294967295}}") == 0, "long printf: %s", sink.data);
+
+    // 放不下时先flush已有内容再格式化，顺序不变
+    sink_init(&sink, &js);
+    char expected[2048] = "";
+    for (int i = 0; i < 20; i++) {
+        char line[64];
+        snprintf(line, sizeof(line), "%s{\"i\":%d,\"value\":\"%040d\"}", i > 0 ? "," : "", i, i);
+        strcat(expected, line);
+        json_stream_printf(&js, "%s{\"i\":%d,\"value\":\"%040d\"}", i > 0 ? "," : "", i, i);
+    }
+    esp_err_t err = json_stream_flush(&js);
+    CHECK(err == ESP_OK, "many printf failed: %d", err);
+    CHECK(strcmp(sink.data, expected) == 0, "many printf mismatch");
+    CHECK(sink.flushes > 1, "expected several flushes, got %d", sink.flushes);
+
+    // 恰好填满缓冲区（加结束符）的输出
+    sink_init(&sink, &js);
+    char fill[JSON_STREAM_BUF_SIZE];
+    memset(fill, 'x', sizeof(fill) - 1);
+    fill[sizeof(fill) - 1] = '\0';
+    json_stream_printf(&js, "%s", fill);
+    CHECK(json_stream_flush(&js) == ESP_OK, "full-buffer printf failed");
+    CHECK(sink.len == JSON_STREAM_BUF_SIZE - 1, "full-buffer printf len %zu", sink.len);
+
+    // 比整个缓冲区还长的输出报告错误，不输出截断的内容
+    sink_init(&sink, &js);
+    json_stream_raw(&js, "[");
+    char big[JSON_STREAM_BUF_SIZE + 1];
+    memset(big, 'y', sizeof(big) - 1);
+    big[sizeof(big) - 1] = '\0';
+    json_stream_printf(&js, "%s", big);
+    json_stream_raw(&js, "]");
+    CHECK(json_stream_flush(&js) == ESP_ERR_INVALID_SIZE, "oversized printf not reported");
+    CHECK(strchr(sink.data, 'y') == NULL, "oversized printf emitted partial output");
+
+    // flush失败之后的写入全部忽略，错误保留
+    sink_init(&sink, &js);
+    sink.fail_at = 1;
+    for (int i = 0; i < 20; i++) {
+        json_stream_printf(&js, "{\"i\":%d,\"value\":\"%040d\"}", i, i);
+    }
+    CHECK(json_stream_flush(&js) == ESP_FAIL, "flush error lost");
+    CHECK(sink.flushes == 1, "wrote after failure: %d flushes", sink.flushes);
+
+    // 字符串转义
+    sink_init(&sink, &js);
+    json_stream_key(&js, "ssid");
+    json_stream_string(&js, "a\"b\\c\n\x01");
+    CHECK(json_stream_flush(&js) == ESP_OK, "string failed");
+    CHECK(strcmp(sink.data, "\"ssid\":\"a\\\"b\\\\c\\n\\u0001\"") == 0, "escape: %s", sink.data);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,98 @@
+#include "host_test.h"
+#include "link_json.h"
+#include <string.h>
+
+// 收集流的全部输出
+typedef struct {
+    char data[1024];
+    size_t len;
+} sink_t;
+
+static esp_err_t sink_flush(void *ctx, const char *data, size_t len)
+{
+    sink_t *sink = ctx;
+    if (sink->len + len >= sizeof(sink->data)) {
+        return ESP_FAIL;
+    }
+    memcpy(sink->data + sink->len, data, len);
+    sink->len += len;
+    sink->data[sink->len] = '\0';
+    return ESP_OK;
+}
+
+static void sink_init(sink_t *sink, json_stream_t *js)
+{
+    memset(sink, 0, sizeof(*sink));
+    json_stream_init(js, sink_flush, sink);
+}
+
+int main(void)
+{
+    sink_t sink;
+    json_stream_t js;
+
+    // 各字段取最长的取值，输出必须完整
+    wifi_link_sample_t sample = {
+        .uptime_ms = 4294967295U,
+        .rssi = -128,
+        .channel = 14,
+        .beacon_timeouts = 255,
+        .retries = 255,
+        .disconnects = 255,
+        .rx_bytes = 5000000,        // 20 Mbit/s
+        .tx_bytes = 1,
+    };
+    sink_init(&sink, &js);
+    link_json_write_sample(&js, &sample);
+    CHECK(json_stream_flush(&js) == ESP_OK, "sample failed");
+    CHECK(strcmp(sink.data, "{\"t\":4294967295,\"rssi\":-128,\"channel\":14,\"beacon_timeouts\":255,"
+                 "\"retries\":255,\"disconnects\":255,\"rx_bps\":20000000,\"tx_bps\":4}") == 0,
+          "sample: %s", sink.data);
+
+    wifi_link_stats_t stats = {
+        .trend_valid = false,
+        .rssi_avg = -128,
+        .rssi_slope = -32768,
+        .rssi_predicted = -32768,
+    };
+    sink_init(&sink, &js);
+    link_json_write_trend(&js, &stats);
+    CHECK(json_stream_flush(&js) == ESP_OK, "trend failed");
+    CHECK(strcmp(sink.data, "\"trend\":{\"valid\":false,\"rssi_avg\":-128,\"slope_per_min\":-32768,"
+                 "\"predicted\":-32768}") == 0, "trend: %s", sink.data);
+
+    stats.trend_valid = true;
+    stats.rssi_avg = -60;
+    stats.rssi_slope = 3;
+    stats.rssi_predicted = -57;
+    sink_init(&sink, &js);
+    link_json_write_trend(&js, &stats);
+    CHECK(json_stream_flush(&js) == ESP_OK, "trend failed");
+    CHECK(strcmp(sink.data, "\"trend\":{\"valid\":true,\"rssi_avg\":-60,\"slope_per_min\":3,"
+                 "\"predicted\":-57}") == 0, "trend: %s", sink.data);
+
+    // 历史数组：多个采样连续写入时跨越缓冲区边界，顺序和内容不变
+    sink_init(&sink, &js);
+    json_stream_raw(&js, "[");
+    for (int i = 0; i < 8; i++) {
+        wifi_link_sample_t s = { .uptime_ms = (uint32_t)i * WIFI_LINK_SAMPLE_INTERVAL_MS, .rssi = -50 };
+        if (i > 0) {
+            json_stream_raw(&js, ",");
+        }
+        link_json_write_sample(&js, &s);
+    }
+    json_stream_raw(&js, "]");
+    CHECK(json_stream_flush(&js) == ESP_OK, "history failed");
+    char expected[1024] = "[";
+    for (int i = 0; i < 8; i++) {
+        char item[128];
+        snprintf(item, sizeof(item), "%s{\"t\":%d,\"rssi\":-50,\"channel\":0,\"beacon_timeouts\":0,"
+                 "\"retries\":0,\"disconnects\":0,\"rx_bps\":0,\"tx_bps\":0}",
+                 i > 0 ? "," : "", i * WIFI_LINK_SAMPLE_INTERVAL_MS);
+        strcat(expected, item);
+    }
+    strcat(expected, "]");
+    CHECK(strcmp(sink.data, expected) == 0, "history: %s", sink.data);
+
+    return TEST_RESULT();
+}
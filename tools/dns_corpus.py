@@ -0,0 +1,211 @@
+#!/usr/bin/env python3
+"""生成 dns_engine 回放用的 pcap 语料（test/host/corpus/dns_queries.pcap）。
+
+语料包括配网时各系统常见的查询（联网检测域名的 A/AAAA/HTTPS、EDNS、DNS 0x20 大小写），
+以及格式非法、边界长度和不支持的报文。每次生成的内容相同，修改后需要重新录制期望结果:
+
+    python3 tools/dns_corpus.py test/host/corpus/dns_queries.pcap
+    build/host/replay_dns_engine --record test/host/corpus/dns_queries.expected \\
+        test/host/corpus/dns_queries.pcap
+
+也可以直接回放实际抓包:
+
+    tcpdump -i wlan0 -w capture.pcap udp dst port 53
+    build/host/replay_dns_engine capture.pcap
+"""
+
+import argparse
+import random
+import struct
+
+TYPE_A = 1
+TYPE_SOA = 6
+TYPE_AAAA = 28
+TYPE_OPT = 41
+TYPE_HTTPS = 65
+TYPE_ANY = 255
+CLASS_IN = 1
+
+PROBE_NAMES = [
+    'connectivitycheck.gstatic.com',
+    'www.google.com',
+    'clients3.google.com',
+    'captive.apple.com',
+    'www.apple.com',
+    'www.msftconnecttest.com',
+    'dns.msftncsi.com',
+    'detectportal.firefox.com',
+    'esp32-butler',
+    'esp32-butler.lan',
+    'time.windows.com',
+    'pool.ntp.org',
+    'api.weixin.qq.com',
+    'www.baidu.com',
+]
+
+
+def encode_name(name):
+    out = b''
+    if name:
+        for label in name.split('.'):
+            raw = label.encode()
+            out += bytes([len(raw)]) + raw
+    return out + b'\x00'
+
+
+def header(qid, flags=0x0100, qd=1, an=0, ns=0, ar=0):
+    return struct.pack('>HHHHHH', qid, flags, qd, an, ns, ar)
+
+
+def question(name, qtype, qclass=CLASS_IN):
+    return encode_name(name) + struct.pack('>HH', qtype, qclass)
+
+
+def opt(payload=1232, version=0, do=False, name=b'\x00', rdata=b''):
+    ttl = (version << 16) | (0x8000 if do else 0)
+    return name + struct.pack('>HHIH', TYPE_OPT, payload, ttl, len(rdata)) + rdata
+
+
+def query(qid, name, qtype, edns=None, flags=0x0100):
+    body = question(name, qtype)
+    ar = 0
+    if edns is not None:
+        body += edns
+        ar = 1
+    return header(qid, flags, ar=ar) + body
+
+
+def random_case(rng, name):
+    return ''.join(c.upper() if rng.random() < 0.5 else c for c in name)
+
+
+def client_queries(rng):
+    packets = []
+    qid = 0x1000
+    for name in PROBE_NAMES:
+        for qtype in (TYPE_A, TYPE_AAAA, TYPE_HTTPS):
+            packets.append(query(qid, name, qtype))
+            qid += 1
+        # EDNS（含DO位）和DNS 0x20
+        packets.append(query(qid, random_case(rng, name), TYPE_A, edns=opt(1232, do=True)))
+        qid += 1
+        packets.append(query(qid, name, TYPE_AAAA, edns=opt(4096)))
+        qid += 1
+    packets.append(query(qid, 'example.com', TYPE_ANY))
+    packets.append(query(qid + 1, 'example.com', TYPE_SOA))
+    packets.append(query(qid + 2, 'example.com', TYPE_A)[:-2] + struct.pack('>H', 3))   # CH类
+    return packets
+
+
+def edge_cases():
+    packets = []
+    a = question('a.example', TYPE_A)
+
+    # 多问题：最多4个，第二个问题用压缩指针引用第一个
+    packets.append(header(0x2000, qd=2) + a + b'\xc0\x0c' + struct.pack('>HH', TYPE_AAAA, CLASS_IN))
+    packets.append(header(0x2001, qd=4) + a * 4)
+    packets.append(header(0x2002, qd=5) + a * 5)
+    packets.append(header(0x2003, qd=0))
+
+    # 名称长度边界：63字节标签、255字节名称
+    label63 = 'x' * 63
+    name253 = '.'.join([label63] * 3 + ['y' * 61])
+    packets.append(query(0x2010, label63 + '.example', TYPE_A))
+    packets.append(query(0x2011, name253, TYPE_A))
+    packets.append(header(0x2012) + b'\x40' + b'x' * 64 + b'\x00' + struct.pack('>HH', TYPE_A, CLASS_IN))
+    packets.append(query(0x2013, name253 + 'z', TYPE_A))
+    packets.append(query(0x2014, '', TYPE_A))   # 根
+
+    # 压缩指针：指向自身、指向后面、指向头部、循环
+    tail = struct.pack('>HH', TYPE_A, CLASS_IN)
+    packets.append(header(0x2020) + b'\xc0\x0c' + tail)
+    packets.append(header(0x2021) + b'\xc0\x20' + tail + b'\x00' * 16)
+    packets.append(header(0x2022) + b'\xc0\x02' + tail)
+    packets.append(header(0x2023, qd=2) + b'\x01a\xc0\x12' + tail + b'\x01b\xc0\x0c' + tail)
+    packets.append(header(0x2024) + b'\x80\x01a\x00' + tail)          # 保留标签类型
+
+    # 截断
+    full = query(0x2030, 'truncated.example', TYPE_A)
+    for cut in (5, 12, 20, len(full) - 3, len(full) - 1):
+        packets.append(full[:cut])
+
+    # EDNS：版本1、OPT在回答部分、两个OPT、负载小于512、OPT名称不是根
+    packets.append(query(0x2040, 'edns.example', TYPE_A, edns=opt(1232, version=1)))
+    packets.append(header(0x2041, an=1) + question('edns.example', TYPE_A) + opt())
+    packets.append(header(0x2042, ar=2) + question('edns.example', TYPE_A) + opt() + opt())
+    packets.append(query(0x2043, 'edns.example', TYPE_A, edns=opt(100)))
+    packets.append(query(0x2044, 'edns.example', TYPE_A, edns=opt(name=b'\x01x\x00')))
+    packets.append(query(0x2045, 'edns.example', TYPE_A, edns=opt(rdata=b'\x00\x0a\x00\x08' + b'\x11' * 8)))
+    packets.append(header(0x2046, ar=1) + question('edns.example', TYPE_A) + opt()[:-3])
+
+    # 不支持的操作码、响应报文（不回应）
+    packets.append(query(0x2050, 'notify.example', TYPE_SOA, flags=0x2000))
+    packets.append(query(0x2051, 'status.example', TYPE_A, flags=0x1000))
+    packets.append(query(0x2052, 'response.example', TYPE_A, flags=0x8180))
+
+    # 4个长名称的A问题加EDNS：问题部分能放下，应答只能放下一条A记录，设置TC
+    long_name = label63 + '.' + 'w' * 46
+    packets.append(header(0x2060, qd=4, ar=1) + question(long_name, TYPE_A) * 4 + opt(512))
+    return packets
+
+
+def fuzz_cases(rng, count):
+    """在正常查询上随机翻转字节，覆盖解析器的错误路径。"""
+    seeds = [query(0x3000, name, TYPE_A, edns=opt()) for name in PROBE_NAMES]
+    packets = []
+    for i in range(count):
+        data = bytearray(rng.choice(seeds))
+        struct.pack_into('>H', data, 0, 0x3000 + i)
+        for _ in range(rng.randint(1, 4)):
+            pos = rng.randrange(2, len(data))
+            data[pos] = rng.randrange(256)
+        if rng.random() < 0.2:
+            del data[rng.randrange(12, len(data)):]
+        packets.append(bytes(data))
+    return packets
+
+
+def ipv4_checksum(hdr):
+    total = sum(struct.unpack('>10H', hdr))
+    total = (total >> 16) + (total & 0xFFFF)
+    total += total >> 16
+    return ~total & 0xFFFF
+
+
+def frame(payload, index):
+    """以太网 + IPv4 + UDP 封装，客户端为 192.168.4.x。"""
+    src_ip = bytes([192, 168, 4, 2 + index % 8])
+    dst_ip = bytes([192, 168, 4, 1])
+    udp = struct.pack('>HHHH', 49152 + index, 53, 8 + len(payload), 0) + payload
+    ip = struct.pack('>BBHHHBBH4s4s', 0x45, 0, 20 + len(udp), index & 0xFFFF, 0, 64, 17, 0, src_ip, dst_ip)
+    ip = ip[:10] + struct.pack('>H', ipv4_checksum(ip)) + ip[12:]
+    eth = b'\x24\x0a\xc4\x00\x00\x01' + b'\x02\x00\x00\x00\x00' + bytes([index % 8]) + b'\x08\x00'
+    return eth + ip + udp
+
+
+def write_pcap(path, payloads):
+    with open(path, 'wb') as f:
+        # 微秒时间戳，以太网链路类型
+        f.write(struct.pack('<IHHiIII', 0xA1B2C3D4, 2, 4, 0, 0, 65535, 1))
+        for i, payload in enumerate(payloads):
+            data = frame(payload, i)
+            ts = 1700000000 * 1000000 + i * 1000
+            f.write(struct.pack('<IIII', ts // 1000000, ts % 1000000, len(data), len(data)))
+            f.write(data)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('output', help='输出的 pcap 文件')
+    parser.add_argument('--fuzz', type=int, default=200, help='随机变异的报文数')
+    parser.add_argument('--seed', type=int, default=31)
+    args = parser.parse_args()
+
+    rng = random.Random(args.seed)
+    payloads = client_queries(rng) + edge_cases() + fuzz_cases(rng, args.fuzz)
+    write_pcap(args.output, payloads)
+    print(f'{args.output}: {len(payloads)} 个报文')
+
+
+if __name__ == '__main__':
+    main()
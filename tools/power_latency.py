@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+"""测量各省电模式下的入站往返延迟，结果回报给设备，汇总在 /api/wifi/power 的 modes.*。
+
+设备向网关 ping 时射频本来就醒着，测不到省电带来的延迟；这里由局域网中的客户端周期请求
+/api/wifi/power/echo，请求要由 AP 缓存到 STA 按 DTIM/监听间隔醒来后才能送达，往返时间包含
+这段等待。该路由不会让设备退出省电模式，每次请求在下一次中回报上一次的往返时间和到达时的模式。
+
+测量期间不要打开控制页面（/ws 客户端会让设备保持 WIFI_PS_NONE）:
+
+    python3 tools/power_latency.py 192.168.1.50 --token <session_token> --count 60
+"""
+
+import argparse
+import collections
+import http.client
+import json
+import time
+
+PATH = '/api/wifi/power/echo'
+
+
+class Echo:
+    def __init__(self, host, port, token, timeout):
+        self.host = host
+        self.port = port
+        self.headers = {'Cookie': 'session_token=' + token}
+        self.timeout = timeout
+        self.conn = None
+
+    def request(self, report):
+        """返回 (往返毫秒, 到达时的模式)；连接断开时重连，本次样本作废返回 None。"""
+        path = PATH
+        if report is not None:
+            path += '?mode=%s&rtt=%d' % (report[1], report[0])
+        if self.conn is None:
+            # 新连接的握手会先唤醒设备，先发一次不计时的请求
+            self.conn = http.client.HTTPConnection(self.host, self.port, timeout=self.timeout)
+            self._send(path)
+            return None
+        try:
+            start = time.monotonic()
+            body = self._send(path)
+            rtt_ms = int((time.monotonic() - start) * 1000)
+        except (OSError, http.client.HTTPException):
+            self.conn.close()
+            self.conn = None
+            return None
+        return rtt_ms, json.loads(body)['mode']
+
+    def _send(self, path):
+        self.conn.request('GET', path, headers=self.headers)
+        resp = self.conn.getresponse()
+        body = resp.read()
+        if resp.status != 200:
+            raise SystemExit('%s: HTTP %d %s' % (path, resp.status, body.decode(errors='replace')))
+        return body
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('host')
+    parser.add_argument('--port', type=int, default=80)
+    parser.add_argument('--token', required=True, help='登录后得到的 session_token')
+    parser.add_argument('--count', type=int, default=30, help='测量次数')
+    parser.add_argument('--interval', type=float, default=10.0,
+                        help='两次请求的间隔（秒），应大于设备的 boost_ms，让设备回到空闲模式')
+    parser.add_argument('--timeout', type=float, default=5.0)
+    args = parser.parse_args()
+
+    echo = Echo(args.host, args.port, args.token, args.timeout)
+    samples = collections.defaultdict(list)
+    report = None
+    done = 0
+    while done < args.count:
+        result = echo.request(report)
+        report = result
+        if result is not None:
+            rtt_ms, mode = result
+            samples[mode].append(rtt_ms)
+            done += 1
+            print('%3d  %-10s %5d ms' % (done, mode, rtt_ms), flush=True)
+        time.sleep(args.interval)
+    # 回报最后一个样本
+    if report is not None:
+        echo.request(report)
+
+    for mode, values in sorted(samples.items()):
+        values.sort()
+        print('%-10s n=%-4d min %4d  median %4d  max %4d ms' %
+              (mode, len(values), values[0], values[len(values) // 2], values[-1]))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+"""将 /api/profiler/dump 下载的采样直方图符号化为火焰图输入（folded stacks）。
+
+用法:
+    curl -b "session_token=..." -X POST http://<ip>/api/profiler/start?rate=1000
+    curl -b "session_token=..." -X POST http://<ip>/api/profiler/stop
+    curl -b "session_token=..." -o profile.bin http://<ip>/api/profiler/dump
+    python3 tools/profiler_flamegraph.py profile.bin build/ESP32_BUTLER_WEB.elf > profile.folded
+    flamegraph.pl profile.folded > profile.svg
+
+默认使用 xtensa-esp32-elf-addr2line，可通过 --addr2line 指定其他工具链。
+"""
+
+import argparse
+import collections
+import struct
+import subprocess
+import sys
+
+MAGIC = 0x46525053
+HEADER_FMT = '<IHHIIIIII'
+HEADER_SIZE = struct.calcsize(HEADER_FMT)
+
+
+def read_profile(path):
+    with open(path, 'rb') as f:
+        data = f.read()
+
+    if len(data) < HEADER_SIZE:
+        raise ValueError('文件太短，不是有效的采样数据')
+
+    (magic, version, entry_size, rate_hz, duration_ms, total, idle,
+     dropped, entry_count) = struct.unpack_from(HEADER_FMT, data, 0)
+    if magic != MAGIC:
+        raise ValueError('魔数不匹配: 0x%08x' % magic)
+    if version != 1:
+        raise ValueError('不支持的版本: %d' % version)
+
+    header = {
+        'rate_hz': rate_hz,
+        'duration_ms': duration_ms,
+        'total': total,
+        'idle': idle,
+        'dropped': dropped,
+    }
+
+    entries = []
+    offset = HEADER_SIZE
+    for _ in range(entry_count):
+        if offset + entry_size > len(data):
+            raise ValueError('数据被截断')
+        pc, count = struct.unpack_from('<II', data, offset)
+        entries.append((pc, count))
+        offset += entry_size
+
+    return header, entries
+
+
+def symbolize(addr2line, elf, pcs):
+    """返回 {pc: [最外层函数, ..., 最内层函数]}，包含内联展开。"""
+    if not pcs:
+        return {}
+
+    proc = subprocess.run(
+        [addr2line, '-e', elf, '-f', '-i', '-C', '-a'] + ['0x%08x' % pc for pc in pcs],
+        check=True, stdout=subprocess.PIPE, universal_newlines=True)
+
+    frames = {}
+    current = None
+    lines = proc.stdout.splitlines()
+    i = 0
+    while i < len(lines):
+        line = lines[i]
+        if line.startswith('0x'):
+            current = int(line, 16)
+            frames[current] = []
+            i += 1
+            continue
+        # 每个帧输出两行：函数名、文件:行号
+        func = line.strip()
+        if func == '??':
+            func = '0x%08x' % current
+        frames[current].append(func)
+        i += 2
+
+    # addr2line 先输出最内层函数，火焰图需要从外到内
+    return {pc: list(reversed(chain)) for pc, chain in frames.items()}
+
+
+def main():
+    parser = argparse.ArgumentParser(description='采样直方图符号化')
+    parser.add_argument('profile', help='/api/profiler/dump 下载的二进制文件')
+    parser.add_argument('elf', help='固件ELF文件')
+    parser.add_argument('--addr2line', default='xtensa-esp32-elf-addr2line',
+                        help='addr2line 可执行文件')
+    parser.add_argument('--top', type=int, default=20,
+                        help='在stderr打印热点函数的数量')
+    args = parser.parse_args()
+
+    header, entries = read_profile(args.profile)
+    chains = symbolize(args.addr2line, args.elf, [pc for pc, _ in entries])
+
+    folded = collections.Counter()
+    flat = collections.Counter()
+    for pc, count in entries:
+        chain = chains.get(pc) or ['0x%08x' % pc]
+        folded[';'.join(chain)] += count
+        flat[chain[-1]] += count
+
+    for stack, count in folded.most_common():
+        print('%s %d' % (stack, count))
+
+    total = max(header['total'], 1)
+    sys.stderr.write('采样频率 %d Hz, 时长 %d ms, 总采样 %d, IDLE %.1f%%, 丢弃 %d\n' % (
+        header['rate_hz'], header['duration_ms'], header['total'],
+        100.0 * header['idle'] / total, header['dropped']))
+    for func, count in flat.most_common(args.top):
+        sys.stderr.write('%6.2f%%  %8d  %s\n' % (100.0 * count / total, count, func))
+
+
+if __name__ == '__main__':
+    main()